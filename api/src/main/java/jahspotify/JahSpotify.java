@@ -1,7 +1,10 @@
 package jahspotify;
 
+import java.util.List;
+
 import jahspotify.media.Album;
 import jahspotify.media.Artist;
+import jahspotify.media.BatchLoadedListener;
 import jahspotify.media.Image;
 import jahspotify.media.Link;
 import jahspotify.media.Playlist;
@@ -29,7 +32,8 @@ public interface JahSpotify {
 	public void initialize(String cacheFolder);
 
 	/**
-	 * Stops libJahSpotify.
+	 * Stops libJahSpotify. The native session is freed once its event loop has exited, it cannot
+	 * be initialized again afterwards.
 	 */
 	public void destroy();
 
@@ -77,6 +81,29 @@ public interface JahSpotify {
 	 */
 	public Track readTrack(Link link);
 
+	/**
+	 * Read the information for several tracks at once.
+	 * 
+	 * @param links
+	 *            The links for the tracks in question
+	 * @return The tracks in the order of the links, null for links which could not be read.
+	 *         Tracks which are not loaded yet are completed in the background, use
+	 *         {@link jahspotify.media.Track#addLoadableListener} to find out when.
+	 */
+	public List<Track> readTracks(List<Link> links);
+
+	/**
+	 * Read the information for several tracks at once, telling the listener when the whole batch
+	 * has loaded.
+	 * 
+	 * @param links
+	 *            The links for the tracks in question
+	 * @param listener
+	 *            Called once every track of the batch has loaded, right away if they all are
+	 * @return The tracks in the order of the links, null for links which could not be read.
+	 */
+	public List<Track> readTracks(List<Link> links, BatchLoadedListener<Track> listener);
+
 	/**
 	 * Read the information for the specified album.
 	 * 
@@ -97,6 +124,18 @@ public interface JahSpotify {
 	 */
 	public Image readImage(Link link);
 
+	/**
+	 * Read a thumbnail of the specified image, scaled down to the smallest
+	 * configured thumbnail size that is at least the given size.
+	 * 
+	 * @param link
+	 *            The link for the image in question
+	 * @param size
+	 *            Minimum width and height in pixels the caller needs
+	 * @return The read image or null if it could not be read
+	 */
+	public Image readImage(Link link, int size);
+
 	/**
 	 * Read the information for the specified playlist.
 	 * 
@@ -209,7 +248,9 @@ public interface JahSpotify {
 
 	/**
 	 * Initiates a search for the specified query. Results are returned
-	 * asynchronously via the {@link SearchListener} API.
+	 * asynchronously via the {@link SearchListener} API. Listeners which also
+	 * implement {@link SearchErrorListener} are told when the search fails or
+	 * times out.
 	 * 
 	 * @param search
 	 *            The search to execute towards the Spotify APIs. This bundles
@@ -220,6 +261,29 @@ public interface JahSpotify {
 	public void initiateSearch(final Search search,
 			final SearchListener searchListener);
 
+	/**
+	 * Cancels a search started with the given listener, which is not called
+	 * anymore.
+	 * 
+	 * @param searchListener
+	 *            The listener the search was started with
+	 * @return true if a search of the listener was still outstanding
+	 */
+	public boolean cancelSearch(SearchListener searchListener);
+
+	/**
+	 * Searches the tracks in the playlists of the user without going to
+	 * Spotify. Titles, artists and albums are matched, other criteria such
+	 * as years and genres match no tracks. Tracks are only found once
+	 * libspotify has loaded them.
+	 * 
+	 * @param query
+	 *            The query to match the tracks against
+	 * @return Links of the matching tracks, in the order they were first
+	 *         seen in the library
+	 */
+	public List<Link> searchLibrary(Query query);
+
 	/**
 	 * 
 	 * @param playbackListener
@@ -232,6 +296,11 @@ public interface JahSpotify {
 	 */
 	public void addPlaylistListener(PlaylistListener playlistListener);
 
+	/**
+	 * @param playlistChangeListener Told about every change applied to a playlist of the container
+	 */
+	public void addPlaylistChangeListener(PlaylistChangeListener playlistChangeListener);
+
 	/**
 	 * 
 	 * @param connectionListener
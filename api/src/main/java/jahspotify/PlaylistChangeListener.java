@@ -0,0 +1,13 @@
+package jahspotify;
+
+import jahspotify.media.Playlist;
+import jahspotify.media.PlaylistDelta;
+
+/**
+ * Told about changes made to the playlists of the container, once they have been applied to the
+ * playlist instances.
+ */
+public interface PlaylistChangeListener
+{
+    public void playlistChanged(final Playlist playlist, final PlaylistDelta delta);
+}
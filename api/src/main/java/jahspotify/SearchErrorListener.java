@@ -0,0 +1,10 @@
+package jahspotify;
+
+/**
+ * Search listener which is also told when a search fails or times out, instead of never hearing
+ * back.
+ */
+public interface SearchErrorListener extends SearchListener
+{
+    public void searchFailed(String message);
+}
@@ -0,0 +1,363 @@
+package jahspotify.impl;
+
+import jahspotify.media.AbstractLoadable;
+import jahspotify.media.Album;
+import jahspotify.media.Artist;
+import jahspotify.media.Link;
+import jahspotify.media.LoadableListener;
+import jahspotify.media.Track;
+
+import java.util.HashMap;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+import java.util.concurrent.ThreadFactory;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.TimeoutException;
+import java.util.concurrent.atomic.AtomicBoolean;
+
+import org.apache.commons.logging.Log;
+import org.apache.commons.logging.LogFactory;
+
+/**
+ * Finds the image to show for albums, artists and tracks without blocking a thread per step.
+ * <p/>
+ * Every step reads the next item and continues once libspotify reports it loaded: a track leads to
+ * its album, an album to its cover, an artist to its first portrait or, if it has none, to the cover
+ * of its first album. Callers only wait for the final link. Concurrent requests for the same link
+ * share one resolution and resolved links are remembered, so asking again is a single lookup.
+ */
+class ImageLinkResolver
+{
+    private static final Log _log = LogFactory.getLog(ImageLinkResolver.class);
+
+    /**
+     * Number of resolved links kept, the least recently used is dropped first.
+     */
+    private static final int MAX_CACHED = 4096;
+
+    /**
+     * Milliseconds after which a resolution that has not finished is started again.
+     */
+    private static final long PENDING_TIMEOUT = 10000;
+
+    private final JahSpotifyImpl jahSpotify;
+
+    /**
+     * Runs the steps following a load. Loaded events arrive on the libspotify thread, which must not
+     * call back into libspotify itself.
+     */
+    private final ExecutorService continuations = Executors.newSingleThreadExecutor(new ThreadFactory()
+    {
+        @Override
+        public Thread newThread(final Runnable runnable)
+        {
+            final Thread thread = new Thread(runnable, "libJahSpotify image links");
+            thread.setDaemon(true);
+            return thread;
+        }
+    });
+
+    private final Map<Link, Link> resolved = new LinkedHashMap<Link, Link>(16, 0.75f, true)
+    {
+        @Override
+        protected boolean removeEldestEntry(final Map.Entry<Link, Link> eldest)
+        {
+            return size() > MAX_CACHED;
+        }
+    };
+
+    private final Map<Link, Resolution> pending = new HashMap<Link, Resolution>();
+
+    ImageLinkResolver(final JahSpotifyImpl jahSpotify)
+    {
+        this.jahSpotify = jahSpotify;
+    }
+
+    /**
+     * Starts finding the image of the given album, artist, track or image link.
+     *
+     * @return A future for the image link, which is null if the item has no image.
+     */
+    Future<Link> resolve(final Link link)
+    {
+        switch (link.getType())
+        {
+            case IMAGE:
+                return new Resolution(link).complete(link);
+            case ALBUM:
+            case ARTIST:
+            case TRACK:
+                break;
+            default:
+                throw new RuntimeException("Unable to get an image from a " + link.getType() + " link (" + link + ").");
+        }
+
+        final Link cached = cached(link);
+        if (cached != null)
+        {
+            return new Resolution(link).complete(cached);
+        }
+
+        final Resolution resolution;
+        synchronized (pending)
+        {
+            final Resolution running = pending.get(link);
+            if (running != null && System.currentTimeMillis() - running.started < PENDING_TIMEOUT)
+            {
+                return running;
+            }
+            resolution = new Resolution(link);
+            pending.put(link, resolution);
+        }
+
+        try
+        {
+            start(resolution);
+        }
+        catch (RuntimeException e)
+        {
+            resolution.complete(null);
+            throw e;
+        }
+        return resolution;
+    }
+
+    private void start(final Resolution resolution)
+    {
+        final Link link = resolution.link;
+        switch (link.getType())
+        {
+            case ALBUM:
+                cover(link, resolution);
+                break;
+            case TRACK:
+                when(jahSpotify.readTrack(link), resolution, new LoadableListener<Track>()
+                {
+                    @Override
+                    public void loaded(final Track track)
+                    {
+                        if (track.getAlbum() == null)
+                        {
+                            resolution.complete(null);
+                            return;
+                        }
+                        cover(track.getAlbum(), resolution);
+                    }
+                });
+                break;
+            case ARTIST:
+                // Portraits only need the light browse, the albums are only browsed for if there are none
+                when(jahSpotify.readArtist(link, 2), resolution, new LoadableListener<Artist>()
+                {
+                    @Override
+                    public void loaded(final Artist artist)
+                    {
+                        final List<Link> portraits = artist.getPortraits();
+                        if (portraits != null && !portraits.isEmpty())
+                        {
+                            resolution.complete(portraits.get(0));
+                            return;
+                        }
+                        firstAlbumCover(resolution);
+                    }
+                });
+                break;
+            default:
+                resolution.complete(null);
+        }
+    }
+
+    private void firstAlbumCover(final Resolution resolution)
+    {
+        when(jahSpotify.readArtist(resolution.link, 1), resolution, new LoadableListener<Artist>()
+        {
+            @Override
+            public void loaded(final Artist artist)
+            {
+                final List<Link> albums = artist.getAlbums();
+                if (albums == null || albums.isEmpty())
+                {
+                    resolution.complete(null);
+                    return;
+                }
+                cover(albums.get(0), resolution);
+            }
+        });
+    }
+
+    /**
+     * Completes the resolution with the cover of the album. Covers are remembered per album, so
+     * tracks of the same album share them.
+     */
+    private void cover(final Link album, final Resolution resolution)
+    {
+        final Link cached = cached(album);
+        if (cached != null)
+        {
+            resolution.complete(cached);
+            return;
+        }
+
+        when(jahSpotify.readAlbum(album), resolution, new LoadableListener<Album>()
+        {
+            @Override
+            public void loaded(final Album loaded)
+            {
+                remember(album, loaded.getCover());
+                resolution.complete(loaded.getCover());
+            }
+        });
+    }
+
+    /**
+     * Runs the next step once the item is loaded, completing the resolution without an image if
+     * the item could not be read or the step fails.
+     */
+    private <T extends AbstractLoadable<T>> void when(final T item, final Resolution resolution, final LoadableListener<T> next)
+    {
+        if (item == null)
+        {
+            resolution.complete(null);
+            return;
+        }
+
+        final AtomicBoolean fired = new AtomicBoolean();
+        item.addLoadableListener(new LoadableListener<T>()
+        {
+            @Override
+            public void loaded(final T media)
+            {
+                // Listeners may be called twice when the item loads while being registered
+                if (!fired.compareAndSet(false, true) || resolution.isDone())
+                {
+                    return;
+                }
+                continuations.execute(new Runnable()
+                {
+                    @Override
+                    public void run()
+                    {
+                        try
+                        {
+                            next.loaded(media);
+                        }
+                        catch (RuntimeException e)
+                        {
+                            _log.debug("Unable to resolve image of " + resolution.link + ": " + e.getMessage());
+                            resolution.complete(null);
+                        }
+                    }
+                });
+            }
+        });
+    }
+
+    private Link cached(final Link link)
+    {
+        synchronized (resolved)
+        {
+            return resolved.get(link);
+        }
+    }
+
+    private void remember(final Link link, final Link image)
+    {
+        if (image == null)
+        {
+            return;
+        }
+        synchronized (resolved)
+        {
+            resolved.put(link, image);
+        }
+    }
+
+    private class Resolution implements Future<Link>
+    {
+        final Link link;
+        final long started = System.currentTimeMillis();
+        private boolean done;
+        private Link image;
+
+        Resolution(final Link link)
+        {
+            this.link = link;
+        }
+
+        Resolution complete(final Link image)
+        {
+            synchronized (this)
+            {
+                if (done)
+                {
+                    return this;
+                }
+                this.image = image;
+                this.done = true;
+                notifyAll();
+            }
+
+            if (link.getType() != Link.Type.IMAGE)
+            {
+                remember(link, image);
+            }
+            synchronized (pending)
+            {
+                if (pending.get(link) == this)
+                {
+                    pending.remove(link);
+                }
+            }
+            return this;
+        }
+
+        @Override
+        public boolean cancel(final boolean mayInterruptIfRunning)
+        {
+            return false;
+        }
+
+        @Override
+        public boolean isCancelled()
+        {
+            return false;
+        }
+
+        @Override
+        public synchronized boolean isDone()
+        {
+            return done;
+        }
+
+        @Override
+        public synchronized Link get() throws InterruptedException
+        {
+            while (!done)
+            {
+                wait();
+            }
+            return image;
+        }
+
+        @Override
+        public synchronized Link get(final long timeout, final TimeUnit unit) throws InterruptedException, TimeoutException
+        {
+            final long deadline = System.nanoTime() + unit.toNanos(timeout);
+            long remaining = deadline - System.nanoTime();
+            while (!done && remaining > 0)
+            {
+                TimeUnit.NANOSECONDS.timedWait(this, remaining);
+                remaining = deadline - System.nanoTime();
+            }
+            if (!done)
+            {
+                throw new TimeoutException("No image link for " + link + " in " + timeout + " " + unit);
+            }
+            return image;
+        }
+    }
+}
@@ -4,52 +4,60 @@ import jahspotify.Bitrate;
 import jahspotify.ConnectionListener;
 import jahspotify.JahSpotify;
 import jahspotify.PlaybackListener;
+import jahspotify.PlaylistChangeListener;
 import jahspotify.PlaylistListener;
+import jahspotify.Query;
 import jahspotify.Search;
+import jahspotify.SearchErrorListener;
 import jahspotify.SearchListener;
 import jahspotify.SearchResult;
 import jahspotify.media.Album;
 import jahspotify.media.Artist;
+import jahspotify.media.BatchLoadedListener;
 import jahspotify.media.Image;
 import jahspotify.media.ImageSize;
 import jahspotify.media.Link;
+import jahspotify.media.LoadableBatch;
 import jahspotify.media.Playlist;
 import jahspotify.media.PlaylistContainer;
+import jahspotify.media.PlaylistDelta;
+import jahspotify.media.PlaylistTrackSource;
 import jahspotify.media.TopListType;
 import jahspotify.media.Track;
 import jahspotify.media.User;
-import jahspotify.services.JahSpotifyService;
 import jahspotify.services.MediaHelper;
+import jahspotify.util.ImageResizer;
 
-import java.awt.Graphics;
-import java.awt.image.BufferedImage;
-import java.io.ByteArrayInputStream;
-import java.io.ByteArrayOutputStream;
 import java.io.IOException;
 import java.util.ArrayList;
-import java.util.HashMap;
+import java.util.Arrays;
+import java.util.Collections;
 import java.util.List;
 import java.util.Map;
-import java.util.Set;
-import java.util.TreeSet;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.TimeoutException;
 import java.util.concurrent.atomic.AtomicInteger;
-import java.util.concurrent.locks.Lock;
 import java.util.concurrent.locks.ReentrantLock;
 
-import javax.imageio.ImageIO;
-
 import org.apache.commons.logging.Log;
 import org.apache.commons.logging.LogFactory;
 
 /**
  * @author Johan Lindquist
  */
-public class JahSpotifyImpl implements JahSpotify
+public class JahSpotifyImpl implements JahSpotify, PlaylistTrackSource
 {
 	private PlayerStatus status = PlayerStatus.STOPPED;
     private static Log _log = LogFactory.getLog(JahSpotify.class);
 
-    private Lock _libSpotifyLock = new ReentrantLock();
+    /**
+     * Seconds to wait for the image of an album, artist or track to be found.
+     */
+    private static final int IMAGE_LINK_TIMEOUT = 4;
+
+    private ReentrantLock _libSpotifyLock = new ReentrantLock();
 
     private boolean _loggedIn = false;
     private boolean _loggingIn = false;
@@ -61,8 +69,9 @@ public class JahSpotifyImpl implements JahSpotify
     private List<ConnectionListener> _connectionListeners = new ArrayList<ConnectionListener>();
 
     private List<SearchListener> _searchListeners = new ArrayList<SearchListener>();
-    private Map<Integer, SearchListener> _prioritySearchListeners = new HashMap<Integer, SearchListener>();
+    private Map<Integer, SearchListener> _prioritySearchListeners = new ConcurrentHashMap<Integer, SearchListener>();
     private List<PlaylistListener> _playlistListeners = new ArrayList<PlaylistListener>();
+    private List<PlaylistChangeListener> _playlistChangeListeners = new ArrayList<PlaylistChangeListener>();
 
     private Thread _jahSpotifyThread;
     private static JahSpotifyImpl _jahSpotify;
@@ -70,8 +79,39 @@ public class JahSpotifyImpl implements JahSpotify
     private User _user;
     private AtomicInteger _globalToken = new AtomicInteger(1);
 
+    /**
+     * Address of the native session state owned by this instance, read by the native library. Reset
+     * to 0 once the event loop has exited and the state was freed.
+     */
+    private volatile long _nativeSession;
+
+    private final PlaylistContainer _playlistContainer = new PlaylistContainer(this);
+    private final PlaylistMosaicBuilder _playlistMosaics = new PlaylistMosaicBuilder(this);
+    private final ImageLinkResolver _imageLinks = new ImageLinkResolver(this);
+    private final SearchCache _searchCache = new SearchCache(60 * 1000, 1024 * 1024);
+
+    private final LibraryIndex _libraryIndex = new LibraryIndex(new LibraryIndex.Postings()
+    {
+        @Override
+        public int[] match(final int fields, final String text)
+        {
+            return nativeMatchLibrary(fields, text);
+        }
+    });
+    private LibraryPrefetcher _libraryPrefetcher;
+    private int _warmUpTracksPerSecond = 50;
+    private long _warmUpCacheBytes = 6 * 1024 * 1024;
+    private volatile int[] _thumbnailSizes = { 64, 150, 300 };
+
     protected JahSpotifyImpl()
     {
+        _nativeSession = nativeCreateSession();
+        if (_nativeSession == 0)
+        {
+            throw new IllegalStateException("Could not allocate native session");
+        }
+
+        registerNativePlaylistContainer(_playlistContainer);
         registerNativeMediaLoadedListener(new NativeMediaLoadedListener()
         {
             @Override
@@ -86,6 +126,24 @@ public class JahSpotifyImpl implements JahSpotify
             	_log.trace(String.format("Playlist loaded: link=%s", playlist.getId()));
             }
 
+            @Override
+            public void playlistTracksAdded(final long playlist, final int position, final Link[] tracks)
+            {
+                playlistChangedCallback(playlist, PlaylistDelta.added(position, Arrays.asList(tracks)));
+            }
+
+            @Override
+            public void playlistTracksRemoved(final long playlist, final int[] positions)
+            {
+                playlistChangedCallback(playlist, PlaylistDelta.removed(positions));
+            }
+
+            @Override
+            public void playlistTracksMoved(final long playlist, final int[] positions, final int newPosition)
+            {
+                playlistChangedCallback(playlist, PlaylistDelta.moved(positions, newPosition));
+            }
+
             @Override
             public void album(final int token, final Album album)
             {
@@ -188,7 +246,7 @@ public class JahSpotifyImpl implements JahSpotify
 
                 if (token > 0)
                 {
-                    final SearchListener searchListener = _prioritySearchListeners.get(token);
+                    final SearchListener searchListener = _prioritySearchListeners.remove(token);
                     if (searchListener != null)
                     {
                         searchListener.searchComplete(searchResult);
@@ -199,6 +257,18 @@ public class JahSpotifyImpl implements JahSpotify
                     searchListener.searchComplete(searchResult);
                 }
             }
+
+            @Override
+            public void searchFailed(final int token, final String message)
+            {
+                _log.debug(String.format("Search failed: token=%d message=%s", token, message));
+
+                final SearchListener searchListener = token > 0 ? _prioritySearchListeners.remove(token) : null;
+                if (searchListener instanceof SearchErrorListener)
+                {
+                    ((SearchErrorListener) searchListener).searchFailed(message);
+                }
+            }
         });
 
         registerNativeConnectionListener(new NativeConnectionListener()
@@ -244,6 +314,8 @@ public class JahSpotifyImpl implements JahSpotify
             {
                 _log.debug("Logged out");
                 _loggedIn = false;
+                stopLibraryWarmUp();
+                _searchCache.clear();
 
                 for (final ConnectionListener listener : _connectionListeners)
                 {
@@ -281,8 +353,9 @@ public class JahSpotifyImpl implements JahSpotify
 			public void playlistsLoaded() {
 				if (playlistsLoadedBefore) return;
 				playlistsLoadedBefore = true;
+				startLibraryWarmUp();
 				boolean allLoaded = true;
-				for (Playlist pl : PlaylistContainer.getPlaylists()) {
+				for (Playlist pl : _playlistContainer.getPlaylists()) {
 					if (!pl.isLoaded()) {
 						allLoaded = false;
 						break;
@@ -305,7 +378,7 @@ public class JahSpotifyImpl implements JahSpotify
 				new Thread() {
 					@Override
 					public void run() {
-						for (Playlist pl : PlaylistContainer.getPlaylists()) {
+						for (Playlist pl : _playlistContainer.getPlaylists()) {
 							while (isLoggedIn() && !MediaHelper.waitFor(pl, 5))
 								; // Do nothing.
 						}
@@ -325,13 +398,31 @@ public class JahSpotifyImpl implements JahSpotify
 	public synchronized void initialize(final String cacheFolder) {
         if (_jahSpotifyThread != null)
             return;
+        if (_nativeSession == 0)
+            throw new IllegalStateException("Session was destroyed");
 
         _jahSpotifyThread = new Thread("libJahSpotify native message handler")
         {
             @Override
             public void run()
             {
-            	nativeInitialize(cacheFolder);
+                try
+                {
+                    nativeInitialize(cacheFolder);
+                }
+                finally
+                {
+                    // Nothing calls back into the session once its event loop is gone
+                    _libSpotifyLock.lock();
+                    try
+                    {
+                        nativeDestroySession();
+                    }
+                    finally
+                    {
+                        _libSpotifyLock.unlock();
+                    }
+                }
             }
         };
         _jahSpotifyThread.start();
@@ -339,10 +430,33 @@ public class JahSpotifyImpl implements JahSpotify
 
     @Override
 	public void destroy() {
+    	stopLibraryWarmUp();
     	_jahSpotifyThread = null;
     	nativeDestroy();
 	}
 
+    protected void playlistChangedCallback(final long pointer, final PlaylistDelta delta)
+    {
+        final Playlist playlist = _playlistContainer.getPlaylistByPointer(pointer);
+        if (playlist == null)
+        {
+            return;
+        }
+
+        if (!playlist.apply(delta))
+        {
+            // Only fully materialized playlists can be patched, the others are read again when needed
+            _log.debug(String.format("Playlist change not applied: link=%s delta=%s", playlist.getId(), delta));
+            return;
+        }
+
+        _log.trace(String.format("Playlist changed: link=%s delta=%s", playlist.getId(), delta));
+        for (PlaylistChangeListener listener : _playlistChangeListeners)
+        {
+            listener.playlistChanged(playlist, delta);
+        }
+    }
+
     protected void albumLoadedCallback(final int token, final Album album)
     {
         _log.trace(String.format("Album loaded: token=%d link=%s", token, album.getId()));
@@ -358,6 +472,14 @@ public class JahSpotifyImpl implements JahSpotify
         _log.trace(String.format("Artist loaded: token=%d link=%s", token, artist.getId()));
     }
 
+    /**
+     * @return The playlists of the user logged in to this session
+     */
+    public PlaylistContainer getPlaylistContainer()
+    {
+        return _playlistContainer;
+    }
+
     public static synchronized JahSpotify getInstance()
     {
         if (_jahSpotify == null)
@@ -365,6 +487,18 @@ public class JahSpotifyImpl implements JahSpotify
         return _jahSpotify;
     }
 
+    /**
+     * Creates a session independent of the one returned by {@link #getInstance()}. It has its own
+     * listeners and, once initialized, its own event loop thread, so several accounts can be used
+     * from one JVM. Note that libspotify itself may refuse to create more than one session per process.
+     *
+     * @return A new, uninitialized instance
+     */
+    public static JahSpotify newInstance()
+    {
+        return new JahSpotifyImpl();
+    }
+
     @Override
     public void login(final String username, final String password, final String blob, final boolean savePassword)
     {
@@ -438,7 +572,7 @@ public class JahSpotifyImpl implements JahSpotify
      * @param browse 0 for no, 1 for yes, 2 for yes, but don't browse for tracks and albums.
      * @return
      */
-    private Artist readArtist(final Link uri, final int browse) {
+    Artist readArtist(final Link uri, final int browse) {
         ensureLoggedIn();
 
         _libSpotifyLock.lock();
@@ -467,6 +601,42 @@ public class JahSpotifyImpl implements JahSpotify
         }
     }
 
+    @Override
+    public List<Track> readTracks(final List<Link> links)
+    {
+        ensureLoggedIn();
+        String[] uris = new String[links.size()];
+        for (int i = 0; i < uris.length; i++)
+        {
+            uris[i] = links.get(i).asString();
+        }
+
+        Track[] tracks;
+        _libSpotifyLock.lock();
+        try
+        {
+            tracks = nativeReadTracks(uris);
+        }
+        finally
+        {
+            _libSpotifyLock.unlock();
+        }
+
+        if (tracks == null)
+        {
+            return new ArrayList<Track>(Collections.<Track>nCopies(uris.length, null));
+        }
+        return new ArrayList<Track>(Arrays.asList(tracks));
+    }
+
+    @Override
+    public List<Track> readTracks(final List<Link> links, final BatchLoadedListener<Track> listener)
+    {
+        final List<Track> tracks = readTracks(links);
+        LoadableBatch.whenLoaded(tracks, listener);
+        return tracks;
+    }
+
     @Override
     public Image readImage(Link uri)
     {
@@ -474,7 +644,7 @@ public class JahSpotifyImpl implements JahSpotify
 
         if (uri.isPlaylistLink()) {
 			try {
-				return createPlaylistImage(uri);
+				return _playlistMosaics.build(uri);
 			} catch (IOException e) {
 				_log.warn("Unable to create playlist image.");
 			}
@@ -496,103 +666,102 @@ public class JahSpotifyImpl implements JahSpotify
 
         return image;
     }
-    /**
-     * Returns the link for the image of the given linktype.
-     * @param link
-     * @return
-     */
-    private Link getCorrectImageLink(final Link link) {
-    	switch (link.getType()) {
-	    	case ALBUM:
-				Album album = readAlbum(link);
-				return album.getCover();
-			case ARTIST:
-				Artist artist = readArtist(link, 2);
-				if (!MediaHelper.waitFor(artist, 2)) break;
-				List<Link> links = artist.getPortraits();
-				if (links.size() > 0) return links.get(0);
-
-				// No artist image available. Get an album cover.
-				artist = readArtist(link, 1);
-				MediaHelper.waitFor(artist, 2);
-				if (artist.getAlbums() == null || artist.getAlbums().size() == 0)
-					return null;
-				return readAlbum(artist.getAlbums().get(0)).getCover();
-			case TRACK:
-				Track t = readTrack(link);
-				return JahSpotifyService.getInstance().getJahSpotify().readAlbum(t.getAlbum()).getCover();
-			case IMAGE:
-				return link;
-			default: throw new RuntimeException("Unable to get an image from a " + link.getType() + " link ("+link+").");
-    	}
-    	return null;
-    }
 
-    /**
-     * Gets the playlist image if available. If not this method will try to create a
-     * 2x2 image of the albums of the first 4 tracks in the playlist.
-     * If there are less than 4 different albums, only the first album will be used.
-     * @param link
-     * @return
-     * @throws IOException
-     */
-    private Image createPlaylistImage(final Link link) throws IOException {
-		if (!link.isPlaylistLink()) throw new IllegalArgumentException("Link should be of type playlist");
-		Playlist playlist = readPlaylist(link, 0, 0);
-		MediaHelper.waitFor(playlist, 1);
-
-		// If the playlist has a custom image, use that.
-		if (playlist.getPicture() != null)
-			return readImage(playlist.getPicture());
-
-		// Get the first 4 different images.
-		Set<Link> albums = new TreeSet<Link>();
-		for (int i = 0; i < playlist.getTracks().size(); i++) {
-			Track track = readTrack(playlist.getTracks().get(i));
-			if (albums.contains(track.getAlbum())) continue;
-			albums.add(track.getAlbum());
-			if (albums.size() == 4) break;
-		}
+    @Override
+    public Image readImage(final Link uri, final int size)
+    {
+        ensureLoggedIn();
 
-		if (albums.size() == 0) return null; // Empty playlist, no image.
-		if (albums.size() < 4) return readImage(albums.iterator().next()); // Too few images, just get the first one.
+        final int thumbnailSize = thumbnailSize(size);
+        if (thumbnailSize == 0)
+        {
+            return readImage(uri);
+        }
 
-		// Create an image with the 4 images combined.
-		List<Image> images = new ArrayList<Image>();
-		for (Link iLink : albums) {
-			images.add(readImage(iLink));
-		}
-		MediaHelper.waitFor(images, 2);
-
-		// Make usable image from the Spotify image types.
-		List<BufferedImage> bImages = new ArrayList<BufferedImage>();
-		Image correct = null;
-		for (Image image : images) {
-			if (image.getBytes() != null) {
-				correct = image;
-				bImages.add(ImageIO.read(new ByteArrayInputStream(image.getBytes())));
-			}
-		}
-		if (bImages.size() != 4) return correct;
+        // Mosaics are not native images, they are cached by the builder and only scaled here
+        final Link imageLink = uri.isPlaylistLink() ? null : getCorrectImageLink(uri);
+        if (imageLink != null)
+        {
+            final byte[] cached = nativeReadCachedImage(imageLink.getId(), thumbnailSize);
+            if (cached != null)
+            {
+                return loadedImage(imageLink, cached);
+            }
+        }
 
-		// Draw the target image.
-		BufferedImage target = new BufferedImage(300, 300, BufferedImage.TYPE_INT_RGB);
-		Graphics g = target.getGraphics();
-		BufferedImage image;
-		image = bImages.remove(0); g.drawImage(image,   0,   0, 150, 150, 0, 0, image.getWidth(), image.getHeight(), null);
-		image = bImages.remove(0); g.drawImage(image, 150,   0, 300, 150, 0, 0, image.getWidth(), image.getHeight(), null);
-		image = bImages.remove(0); g.drawImage(image,   0, 150, 150, 300, 0, 0, image.getWidth(), image.getHeight(), null);
-		image = bImages.remove(0); g.drawImage(image, 150, 150, 300, 300, 0, 0, image.getWidth(), image.getHeight(), null);
+        final Image original = imageLink != null ? readImage(imageLink) : readImage(uri);
+        if (original == null || !MediaHelper.waitFor(original, 2) || original.getBytes() == null)
+        {
+            return original;
+        }
 
-		ByteArrayOutputStream baos = new ByteArrayOutputStream();
-		ImageIO.write(target, "JPG", baos);
+        try
+        {
+            final byte[] bytes = ImageResizer.thumbnail(original.getBytes(), thumbnailSize);
+            if (bytes == null)
+            {
+                return original;
+            }
+            if (imageLink != null)
+            {
+                nativeCacheImage(imageLink.getId(), thumbnailSize, bytes);
+            }
+            return loadedImage(original.getId(), bytes);
+        }
+        catch (IOException e)
+        {
+            _log.warn("Unable to create thumbnail of " + uri + ": " + e.getMessage());
+            return original;
+        }
+    }
 
-		Image result = new Image();
-		result.setBytes(baos.toByteArray());
-		result.setLoaded(true);
+    /**
+     * Returns the smallest configured thumbnail size that is at least the given size, 0 if the
+     * original image should be used.
+     */
+    private int thumbnailSize(final int size)
+    {
+        for (int thumbnailSize : _thumbnailSizes)
+        {
+            if (thumbnailSize >= size)
+            {
+                return thumbnailSize;
+            }
+        }
+        return 0;
+    }
 
-		return result;
-	}
+    private static Image loadedImage(final Link link, final byte[] bytes)
+    {
+        final Image image = new Image(link, bytes);
+        image.setLoaded(true);
+        return image;
+    }
+
+    /**
+     * Returns the link for the image of the given linktype.
+     * @param link
+     * @return The image link or null if there is none or it could not be found in time
+     */
+    private Link getCorrectImageLink(final Link link) {
+        try
+        {
+            return _imageLinks.resolve(link).get(IMAGE_LINK_TIMEOUT, TimeUnit.SECONDS);
+        }
+        catch (TimeoutException e)
+        {
+            _log.debug(e.getMessage());
+        }
+        catch (ExecutionException e)
+        {
+            _log.debug("Unable to resolve image of " + link + ": " + e.getMessage());
+        }
+        catch (InterruptedException e)
+        {
+            Thread.currentThread().interrupt();
+        }
+        return null;
+    }
 
     @Override
     public Playlist readPlaylist(final Link uri, final int index, final int numEntries)
@@ -601,17 +770,48 @@ public class JahSpotifyImpl implements JahSpotify
         _libSpotifyLock.lock();
         try
         {
-            final Playlist playlist = retrievePlaylist(uri == null ? null : uri.asString());
-            if (index == 0 && numEntries == 0 || playlist == null)
-                return playlist;
+            // Only the requested window is materialized, the rest is read on demand
+            final Playlist playlist = retrievePlaylist(uri == null ? null : uri.asString(), index, numEntries);
+            if (playlist != null && (index > 0 || numEntries > 0))
+            {
+                playlist.setTrackSource(this);
+            }
+            return playlist;
+        }
+        finally
+        {
+            _libSpotifyLock.unlock();
+        }
+    }
 
-            // Trim the playlist accordingly now
-            return trimPlaylist(playlist, index, numEntries);
+    @Override
+    public List<Link> readPlaylistTracks(final Link playlist, final int index, final int count)
+    {
+        ensureLoggedIn();
+        Link[] links;
+        _libSpotifyLock.lock();
+        try
+        {
+            links = nativeReadPlaylistTracks(playlist.asString(), index, count);
         }
         finally
         {
             _libSpotifyLock.unlock();
         }
+
+        final List<Link> tracks = new ArrayList<Link>();
+        if (links != null)
+        {
+            for (Link link : links)
+            {
+                // Same rule as Playlist.addTrack
+                if (link != null && link.getType() != Link.Type.LOCAL)
+                {
+                    tracks.add(link);
+                }
+            }
+        }
+        return tracks;
     }
 
     @Override
@@ -633,23 +833,6 @@ public class JahSpotifyImpl implements JahSpotify
     	}
     }
 
-    private Playlist trimPlaylist(final Playlist playlist, final int index, int numEntries)
-    {
-        Playlist trimmedPlaylist = new Playlist();
-        trimmedPlaylist.setAuthor(playlist.getAuthor());
-        trimmedPlaylist.setCollaborative(playlist.isCollaborative());
-        trimmedPlaylist.setDescription(playlist.getDescription());
-        trimmedPlaylist.setId(playlist.getId());
-        trimmedPlaylist.setName(playlist.getName());
-        trimmedPlaylist.setPicture(playlist.getPicture());
-        numEntries = Math.min(numEntries, playlist.getNumTracks());
-        trimmedPlaylist.setNumTracks(numEntries == 0 ? playlist.getNumTracks() : numEntries);
-        trimmedPlaylist.setIndex(index);
-        // FIXME: Trim this list
-        trimmedPlaylist.setTracks(playlist.getTracks().subList(index, numEntries-index));
-        return null;
-    }
-
     @Override
     public void pause()
     {
@@ -719,6 +902,114 @@ public class JahSpotifyImpl implements JahSpotify
         return _user;
     }
 
+    /**
+     * @return A snapshot of the counters kept by the native library for this session
+     */
+    public NativeStatistics getNativeStatistics()
+    {
+        NativeStatistics statistics = new NativeStatistics();
+        nativeReadStatistics(statistics);
+        return statistics;
+    }
+
+    /**
+     * Sets how much memory the native cache of resolved tracks, albums and artists may use. The cache
+     * is shared by all sessions, 0 disables it.
+     *
+     * @param bytes Maximum size of the cache in bytes
+     */
+    public void setMetadataCacheSize(long bytes)
+    {
+        nativeSetMetadataCacheBudget(bytes);
+    }
+
+    /**
+     * Sets how much memory the native cache of image bytes may use. The cache is shared by all
+     * sessions, 0 disables it.
+     *
+     * @param bytes Maximum size of the cache in bytes
+     */
+    public void setImageCacheSize(long bytes)
+    {
+        nativeSetImageCacheBudget(bytes);
+    }
+
+    /**
+     * Sets how long search results are answered from memory and how much memory they may use.
+     * Identical searches running at the same time always share one search unless the cache is
+     * disabled.
+     *
+     * @param ttlMillis Milliseconds a result is handed out again, 0 disables the cache
+     * @param bytes     Estimated number of bytes the cached results may take
+     */
+    public void setSearchCache(final long ttlMillis, final long bytes)
+    {
+        _searchCache.configure(ttlMillis, bytes);
+    }
+
+    /**
+     * Sets the sizes thumbnails are made in. Requests for other sizes are served with the next
+     * larger one, or the original image when larger than all of them. Thumbnails are kept in the
+     * native image cache next to the originals.
+     *
+     * @param sizes Maximum width and height of the thumbnails in pixels
+     */
+    public void setThumbnailSizes(final int... sizes)
+    {
+        final int[] sorted = sizes.clone();
+        Arrays.sort(sorted);
+        for (int size : sorted)
+        {
+            if (size <= 0)
+            {
+                throw new IllegalArgumentException("Thumbnail sizes must be positive: " + Arrays.toString(sizes));
+            }
+        }
+        _thumbnailSizes = sorted;
+    }
+
+    /**
+     * Sets how fast the tracks and albums of the playlists are read in the background once the
+     * playlist container has loaded. Takes effect the next time the container loads.
+     *
+     * @param tracksPerSecond Maximum number of tracks read per second, 0 disables the warm-up
+     * @param cacheBytes      Size of the metadata cache in bytes at which the warm-up stops, keep it
+     *                        below the size of the cache so the warm-up does not evict anything
+     */
+    public synchronized void setLibraryWarmUp(int tracksPerSecond, long cacheBytes)
+    {
+        _warmUpTracksPerSecond = tracksPerSecond;
+        _warmUpCacheBytes = cacheBytes;
+    }
+
+    private synchronized void startLibraryWarmUp()
+    {
+        stopLibraryWarmUp();
+        if (_warmUpTracksPerSecond <= 0)
+        {
+            return;
+        }
+        _libraryPrefetcher = new LibraryPrefetcher(this, _warmUpTracksPerSecond, _warmUpCacheBytes);
+        _libraryPrefetcher.start();
+    }
+
+    private synchronized void stopLibraryWarmUp()
+    {
+        if (_libraryPrefetcher != null)
+        {
+            _libraryPrefetcher.stop();
+            _libraryPrefetcher = null;
+        }
+    }
+
+    /**
+     * @return true if other threads are waiting for libspotify, background work should hold off
+     */
+    boolean hasWaitingRequests()
+    {
+        return _libSpotifyLock.hasQueuedThreads();
+    }
+
     static
     {
     	try {
@@ -748,6 +1039,12 @@ public class JahSpotifyImpl implements JahSpotify
         _playlistListeners.add(playlistListener);
     }
 
+    @Override
+    public void addPlaylistChangeListener(final PlaylistChangeListener playlistChangeListener)
+    {
+        _playlistChangeListeners.add(playlistChangeListener);
+    }
+
     @Override
     public void addConnectionListener(final ConnectionListener connectionListener)
     {
@@ -812,12 +1109,19 @@ public class JahSpotifyImpl implements JahSpotify
     {
         ensureLoggedIn();
 
+        final NativeSearchParameters nativeSearchParameters = initializeFromSearch(search);
+        // Answered from a recent result or by an identical search already running
+        final SearchListener listener = _searchCache.join(new SearchCache.Key(nativeSearchParameters), searchListener);
+        if (listener == null)
+        {
+            return;
+        }
+
         _libSpotifyLock.lock();
         try
         {
             int token = _globalToken.getAndIncrement();
-            NativeSearchParameters nativeSearchParameters = initializeFromSearch(search);
-            _prioritySearchListeners.put(token, searchListener);
+            _prioritySearchListeners.put(token, listener);
             nativeInitiateSearch(token, nativeSearchParameters);
         }
         finally
@@ -826,6 +1130,69 @@ public class JahSpotifyImpl implements JahSpotify
         }
     }
 
+    @Override
+    public boolean cancelSearch(final SearchListener searchListener)
+    {
+        final SearchListener registered = _searchCache.leave(searchListener);
+        if (registered == null)
+        {
+            // Others still wait for the same search
+            return true;
+        }
+
+        for (Map.Entry<Integer, SearchListener> entry : _prioritySearchListeners.entrySet())
+        {
+            if (entry.getValue() == registered && _prioritySearchListeners.remove(entry.getKey()) != null)
+            {
+                _libSpotifyLock.lock();
+                try
+                {
+                    nativeCancelSearch(entry.getKey());
+                }
+                finally
+                {
+                    _libSpotifyLock.unlock();
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    @Override
+    public List<Link> searchLibrary(final Query query)
+    {
+        final int[] docs = _libraryIndex.evaluate(query);
+        final Link[] links = docs.length == 0 ? null : nativeReadLibraryTracks(docs);
+        if (links == null)
+        {
+            return Collections.emptyList();
+        }
+
+        // Tracks leaving the library since they were matched come back as null
+        final List<Link> tracks = new ArrayList<Link>(links.length);
+        for (Link link : links)
+        {
+            if (link != null)
+            {
+                tracks.add(link);
+            }
+        }
+        return tracks;
+    }
+
+    /**
+     * Limits how many searches libspotify runs at the same time, further searches wait in line,
+     * and how long a search may take before its listener is told it timed out.
+     *
+     * @param maxRunning    Maximum number of searches running at the same time
+     * @param timeoutMillis Milliseconds from starting a search until it is given up
+     */
+    public void setSearchLimits(final int maxRunning, final long timeoutMillis)
+    {
+        nativeSetSearchLimits(maxRunning, timeoutMillis);
+    }
+
     public NativeSearchParameters initializeFromSearch(final Search search)
     {
         NativeSearchParameters nativeSearchParameters = new NativeSearchParameters();
@@ -865,13 +1232,21 @@ public class JahSpotifyImpl implements JahSpotify
     	return status;
     }
 
+    private native long nativeCreateSession();
+    private native void nativeReadStatistics(NativeStatistics statistics);
+    private native void nativeSetMetadataCacheBudget(long bytes);
+    private native void nativeSetImageCacheBudget(long bytes);
+    private native byte[] nativeReadCachedImage(String uri, int variant);
+    private native void nativeCacheImage(String uri, int variant, byte[] bytes);
     private native int nativeInitialize(String cacheFolder);
     private native int nativeDestroy();
+    private native void nativeDestroySession();
 	private native int nativeLogin(String username, String password, String blob, boolean savePassword);
 	private native void nativeLogout();
 	private native void nativeForgetMe();
 
     private native boolean registerNativeMediaLoadedListener(final NativeMediaLoadedListener nativeMediaLoadedListener);
+    private native boolean registerNativePlaylistContainer(final PlaylistContainer playlistContainer);
 
     private native void readImage(String uri, Image image);
 
@@ -882,8 +1257,10 @@ public class JahSpotifyImpl implements JahSpotify
     private native Artist retrieveArtist(String uri, int browse);
 
     private native Track retrieveTrack(String uri);
+    private native Track[] nativeReadTracks(String[] uris);
 
-    private native Playlist retrievePlaylist(String uri);
+    private native Playlist retrievePlaylist(String uri, int index, int numEntries);
+    private native Link[] nativeReadPlaylistTracks(String uri, int index, int count);
     private native SearchResult retrieveTopList(int type, int countrycode);
 
     private native void setBitrate(int bitrate);
@@ -892,6 +1269,10 @@ public class JahSpotifyImpl implements JahSpotify
     private native void nativeTrackSeek(int offset);
 
     private native void nativeInitiateSearch(final int i, NativeSearchParameters token);
+    private native void nativeCancelSearch(int token);
+    private native void nativeSetSearchLimits(int maxRunning, long timeoutMillis);
+    private native int[] nativeMatchLibrary(int fields, String text);
+    private native Link[] nativeReadLibraryTracks(int[] docs);
     private native boolean registerNativeConnectionListener(final NativeConnectionListener nativeConnectionListener);
     private native boolean registerNativeSearchCompleteListener(final NativeSearchCompleteListener nativeSearchCompleteListener);
 
@@ -0,0 +1,266 @@
+package jahspotify.impl;
+
+import jahspotify.Query;
+import jahspotify.query.AndQuery;
+import jahspotify.query.GenreQuery;
+import jahspotify.query.NotQuery;
+import jahspotify.query.OrQuery;
+import jahspotify.query.TokenQuery;
+
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+
+/**
+ * Evaluates queries against the native index of the tracks in the playlist container, so the
+ * user's own library is searched without a round trip to Spotify.
+ * <p/>
+ * The native index hands out the tracks containing terms as ascending docs, which are combined
+ * here following the AND, OR and NOT nodes of the query. Tokens are read like Spotify does: every
+ * word has to match, words tagged with <code>track:</code>, <code>artist:</code> or
+ * <code>album:</code> only in that field. Other tags, such as years and genres, are not indexed
+ * and match no tracks.
+ */
+class LibraryIndex
+{
+    static final int TITLE = 1;
+    static final int ARTIST = 2;
+    static final int ALBUM = 4;
+    static final int ALL = TITLE | ARTIST | ALBUM;
+
+    private static final int[] NONE = new int[0];
+
+    /**
+     * Looks up terms in the index.
+     */
+    interface Postings
+    {
+        /**
+         * @return Ascending docs of the tracks containing every term of the text in one of the
+         *         fields, all tracks for a text without terms.
+         */
+        int[] match(int fields, String text);
+    }
+
+    private final Postings postings;
+
+    LibraryIndex(final Postings postings)
+    {
+        this.postings = postings;
+    }
+
+    /**
+     * @return Ascending docs of the tracks matching the query.
+     */
+    int[] evaluate(final Query query)
+    {
+        if (query instanceof AndQuery)
+        {
+            final Query left = ((AndQuery) query).getLeft();
+            final Query right = ((AndQuery) query).getRight();
+            // Subtracting avoids building the complement of the negated side
+            if (right instanceof NotQuery)
+            {
+                return difference(evaluate(left), evaluate(((NotQuery) right).getQuery()));
+            }
+            if (left instanceof NotQuery)
+            {
+                return difference(evaluate(right), evaluate(((NotQuery) left).getQuery()));
+            }
+            final int[] matches = evaluate(left);
+            return matches.length == 0 ? matches : intersect(matches, evaluate(right));
+        }
+        if (query instanceof OrQuery)
+        {
+            return union(evaluate(((OrQuery) query).getLeft()), evaluate(((OrQuery) query).getRight()));
+        }
+        if (query instanceof NotQuery)
+        {
+            return difference(match(ALL, ""), evaluate(((NotQuery) query).getQuery()));
+        }
+        if (query instanceof GenreQuery)
+        {
+            return NONE;
+        }
+        if (query instanceof TokenQuery)
+        {
+            return token(((TokenQuery) query).getToken());
+        }
+        return token(query.serialize());
+    }
+
+    private int[] token(final String token)
+    {
+        int[] result = null;
+        for (String part : split(token))
+        {
+            if ("AND".equals(part))
+            {
+                continue;
+            }
+
+            int fields = ALL;
+            String text = part;
+            final int colon = part.indexOf(':');
+            if (colon > 0 && isTag(part.substring(0, colon)))
+            {
+                fields = fields(part.substring(0, colon));
+                if (fields == 0)
+                {
+                    return NONE;
+                }
+                text = part.substring(colon + 1);
+            }
+
+            final int[] matches = match(fields, text);
+            result = result == null ? matches : intersect(result, matches);
+            if (result.length == 0)
+            {
+                return result;
+            }
+        }
+        return result == null ? match(ALL, "") : result;
+    }
+
+    private int[] match(final int fields, final String text)
+    {
+        final int[] docs = postings.match(fields, text);
+        return docs == null ? NONE : docs;
+    }
+
+    private static boolean isTag(final String tag)
+    {
+        for (int i = 0; i < tag.length(); i++)
+        {
+            if (!Character.isLetter(tag.charAt(i)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    private static int fields(final String tag)
+    {
+        if ("track".equals(tag))
+        {
+            return TITLE;
+        }
+        if ("artist".equals(tag))
+        {
+            return ARTIST;
+        }
+        if ("album".equals(tag))
+        {
+            return ALBUM;
+        }
+        return 0;
+    }
+
+    /**
+     * Splits a token at whitespace outside of quotes. The quotes are kept, the native index skips
+     * them like any other punctuation.
+     */
+    static List<String> split(final String token)
+    {
+        final List<String> parts = new ArrayList<String>();
+        final StringBuilder part = new StringBuilder();
+        boolean quoted = false;
+        for (int i = 0; i < token.length(); i++)
+        {
+            final char c = token.charAt(i);
+            if (c == '"')
+            {
+                quoted = !quoted;
+            }
+            if (!quoted && Character.isWhitespace(c))
+            {
+                if (part.length() > 0)
+                {
+                    parts.add(part.toString());
+                    part.setLength(0);
+                }
+                continue;
+            }
+            part.append(c);
+        }
+        if (part.length() > 0)
+        {
+            parts.add(part.toString());
+        }
+        return parts;
+    }
+
+    static int[] intersect(final int[] a, final int[] b)
+    {
+        final int[] result = new int[Math.min(a.length, b.length)];
+        int i = 0, j = 0, n = 0;
+        while (i < a.length && j < b.length)
+        {
+            if (a[i] < b[j])
+            {
+                i++;
+            }
+            else if (b[j] < a[i])
+            {
+                j++;
+            }
+            else
+            {
+                result[n++] = a[i++];
+                j++;
+            }
+        }
+        return n == result.length ? result : Arrays.copyOf(result, n);
+    }
+
+    static int[] union(final int[] a, final int[] b)
+    {
+        final int[] result = new int[a.length + b.length];
+        int i = 0, j = 0, n = 0;
+        while (i < a.length && j < b.length)
+        {
+            if (a[i] < b[j])
+            {
+                result[n++] = a[i++];
+            }
+            else if (b[j] < a[i])
+            {
+                result[n++] = b[j++];
+            }
+            else
+            {
+                result[n++] = a[i++];
+                j++;
+            }
+        }
+        while (i < a.length)
+        {
+            result[n++] = a[i++];
+        }
+        while (j < b.length)
+        {
+            result[n++] = b[j++];
+        }
+        return n == result.length ? result : Arrays.copyOf(result, n);
+    }
+
+    static int[] difference(final int[] a, final int[] b)
+    {
+        final int[] result = new int[a.length];
+        int i = 0, j = 0, n = 0;
+        while (i < a.length)
+        {
+            while (j < b.length && b[j] < a[i])
+            {
+                j++;
+            }
+            if (j == b.length || b[j] != a[i])
+            {
+                result[n++] = a[i];
+            }
+            i++;
+        }
+        return n == result.length ? result : Arrays.copyOf(result, n);
+    }
+}
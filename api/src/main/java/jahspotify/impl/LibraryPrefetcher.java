@@ -0,0 +1,198 @@
+package jahspotify.impl;
+
+import jahspotify.media.Link;
+import jahspotify.media.Playlist;
+import jahspotify.media.Track;
+import jahspotify.services.MediaHelper;
+
+import java.util.ArrayList;
+import java.util.HashSet;
+import java.util.List;
+import java.util.Set;
+
+import org.apache.commons.logging.Log;
+import org.apache.commons.logging.LogFactory;
+
+/**
+ * Walks the playlists of the container once they are loaded and reads their tracks and albums in
+ * the background, so the native metadata cache already holds them when they are first used.
+ * <p/>
+ * Tracks are read in batches at a limited rate. The warm-up stops once the metadata cache holds
+ * its budget of bytes and pauses while other threads wait for libspotify or many loads are still
+ * pending, so it never delays interactive requests.
+ */
+class LibraryPrefetcher implements Runnable
+{
+    private static final Log _log = LogFactory.getLog(LibraryPrefetcher.class);
+
+    /**
+     * Number of tracks read with a single call.
+     */
+    private static final int BATCH_SIZE = 50;
+
+    /**
+     * Loads pending in libspotify above which the warm-up waits.
+     */
+    private static final long MAX_PENDING_LOADS = 100;
+
+    /**
+     * Milliseconds to wait before checking again whether the session is idle.
+     */
+    private static final long IDLE_POLL = 200;
+
+    /**
+     * Seconds to wait for a batch of tracks to load before moving on.
+     */
+    private static final int BATCH_TIMEOUT = 10;
+
+    private final JahSpotifyImpl jahSpotify;
+    private final int tracksPerSecond;
+    private final long cacheBudget;
+    private final Thread thread;
+    private volatile boolean stopped;
+
+    /**
+     * @param tracksPerSecond Maximum number of tracks read per second.
+     * @param cacheBudget     Size of the metadata cache in bytes at which the warm-up stops.
+     */
+    LibraryPrefetcher(final JahSpotifyImpl jahSpotify, final int tracksPerSecond, final long cacheBudget)
+    {
+        this.jahSpotify = jahSpotify;
+        this.tracksPerSecond = tracksPerSecond;
+        this.cacheBudget = cacheBudget;
+        this.thread = new Thread(this, "libJahSpotify library warm-up");
+        this.thread.setDaemon(true);
+        this.thread.setPriority(Thread.MIN_PRIORITY);
+    }
+
+    void start()
+    {
+        thread.start();
+    }
+
+    void stop()
+    {
+        stopped = true;
+        thread.interrupt();
+    }
+
+    @Override
+    public void run()
+    {
+        final Set<Link> seenTracks = new HashSet<Link>();
+        final Set<Link> seenAlbums = new HashSet<Link>();
+        final List<Link> batch = new ArrayList<Link>(BATCH_SIZE);
+
+        try
+        {
+            for (Playlist playlist : jahSpotify.getPlaylistContainer().getPlaylists())
+            {
+                if (!playlist.isLoaded())
+                {
+                    continue;
+                }
+
+                for (Link track : new ArrayList<Link>(playlist.getTracks()))
+                {
+                    if (track.getType() != Link.Type.TRACK || !seenTracks.add(track))
+                    {
+                        continue;
+                    }
+                    batch.add(track);
+                    if (batch.size() == BATCH_SIZE)
+                    {
+                        if (!warm(batch, seenAlbums))
+                        {
+                            return;
+                        }
+                        batch.clear();
+                    }
+                }
+            }
+            if (!batch.isEmpty() && !warm(batch, seenAlbums))
+            {
+                return;
+            }
+            _log.debug(String.format("Library warm-up done: tracks=%d albums=%d", seenTracks.size(), seenAlbums.size()));
+        }
+        catch (InterruptedException e)
+        {
+            _log.debug("Library warm-up stopped");
+        }
+        catch (RuntimeException e)
+        {
+            // Usually the session logging out while a batch is read
+            _log.debug("Library warm-up aborted: " + e.getMessage());
+        }
+    }
+
+    /**
+     * Reads a batch of tracks and the albums not seen before, then waits out the rate limit.
+     *
+     * @return false if the warm-up should stop.
+     */
+    private boolean warm(final List<Link> batch, final Set<Link> seenAlbums) throws InterruptedException
+    {
+        if (!awaitIdle())
+        {
+            return false;
+        }
+
+        final long start = System.currentTimeMillis();
+        final List<Track> tracks = new ArrayList<Track>(batch.size());
+        for (Track track : jahSpotify.readTracks(batch))
+        {
+            if (track != null)
+            {
+                tracks.add(track);
+            }
+        }
+        MediaHelper.waitFor(tracks, BATCH_TIMEOUT);
+
+        for (Track track : tracks)
+        {
+            final Link album = track.getAlbum();
+            if (track.isLoaded() && album != null && seenAlbums.add(album))
+            {
+                if (!awaitIdle())
+                {
+                    return false;
+                }
+                // The album carries the link of its cover
+                jahSpotify.readAlbum(album);
+            }
+        }
+
+        final long wait = batch.size() * 1000L / tracksPerSecond - (System.currentTimeMillis() - start);
+        if (wait > 0)
+        {
+            Thread.sleep(wait);
+        }
+        return !stopped;
+    }
+
+    /**
+     * Blocks while foreground requests are waiting for libspotify or too many loads are pending.
+     *
+     * @return false if the warm-up should stop, because it was stopped, the session logged out or
+     *         the metadata cache is full.
+     */
+    private boolean awaitIdle() throws InterruptedException
+    {
+        while (!stopped && jahSpotify.isLoggedIn())
+        {
+            final NativeStatistics statistics = jahSpotify.getNativeStatistics();
+            if (statistics.getMetadataCacheBytes() >= cacheBudget)
+            {
+                _log.debug(String.format("Library warm-up reached its budget: bytes=%d", statistics.getMetadataCacheBytes()));
+                return false;
+            }
+            if (!jahSpotify.hasWaitingRequests() && statistics.getPendingLoads() < MAX_PENDING_LOADS)
+            {
+                return true;
+            }
+            Thread.sleep(IDLE_POLL);
+        }
+        return false;
+    }
+}
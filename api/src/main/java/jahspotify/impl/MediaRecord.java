@@ -0,0 +1,155 @@
+package jahspotify.impl;
+
+import java.nio.ByteBuffer;
+import java.nio.charset.Charset;
+
+import jahspotify.media.Album;
+import jahspotify.media.AlbumType;
+import jahspotify.media.Artist;
+import jahspotify.media.Link;
+import jahspotify.media.Media;
+import jahspotify.media.Track;
+
+/**
+ * Decodes the metadata records the native library writes when it populates a track, album or
+ * artist, so each instance costs a single call across JNI.
+ * <p>
+ * Records are big-endian. The header holds the kind (1 track, 2 album, 3 artist), a reserved
+ * byte, the number of artists and three int values: length, popularity and track number for a
+ * track, year and album type for an album. The uri, name, parent, cover and artists follow.
+ * <p>
+ * Strings are an unsigned short byte count and UTF-8 bytes, {@link #MISSING} standing for null.
+ * Links are a tag byte: {@link #LINK_NONE}, a kind followed by the 16 byte id of the track, album
+ * or artist, or {@link #LINK_URI} followed by the URI as a string.
+ */
+public final class MediaRecord
+{
+    public static final int KIND_TRACK = 1;
+    public static final int KIND_ALBUM = 2;
+    public static final int KIND_ARTIST = 3;
+
+    public static final int MISSING = 0xFFFF;
+
+    public static final int LINK_NONE = 0;
+    public static final int LINK_URI = 0xFF;
+
+    private static final Charset UTF8 = Charset.forName("UTF-8");
+
+    private MediaRecord()
+    {
+    }
+
+    /**
+     * Populates the media from the record. The buffer wraps native memory which is only valid
+     * for the duration of this call.
+     */
+    public static void decode(final Media<?> media, final ByteBuffer record)
+    {
+        final int kind = record.get() & 0xFF;
+        record.get();
+        final int numArtists = record.getShort() & 0xFFFF;
+        final int first = record.getInt();
+        final int second = record.getInt();
+        final int third = record.getInt();
+
+        final Link id = readLink(record);
+        final String name = readString(record);
+        final Link parent = readLink(record);
+        final Link cover = readLink(record);
+
+        if (id != null)
+        {
+            media.setId(id);
+        }
+
+        switch (kind)
+        {
+            case KIND_TRACK:
+                final Track track = (Track) media;
+                track.setTitle(name);
+                track.setLength(first);
+                track.setPopularity(second);
+                track.setTrackNumber(third);
+                if (parent != null)
+                {
+                    track.setAlbum(parent);
+                }
+                for (int i = 0; i < numArtists; i++)
+                {
+                    final Link artist = readLink(record);
+                    if (artist != null)
+                    {
+                        track.addArtist(artist);
+                    }
+                }
+                break;
+            case KIND_ALBUM:
+                final Album album = (Album) media;
+                album.setName(name);
+                album.setYear(first);
+                album.setType(AlbumType.fromOrdinal(second));
+                if (cover != null)
+                {
+                    album.setCover(cover);
+                }
+                if (parent != null)
+                {
+                    album.setArtist(parent);
+                }
+                break;
+            case KIND_ARTIST:
+                ((Artist) media).setName(name);
+                break;
+            default:
+                throw new IllegalArgumentException("Unknown record kind: " + kind);
+        }
+    }
+
+    private static String readString(final ByteBuffer record)
+    {
+        final int length = record.getShort() & 0xFFFF;
+        if (length == MISSING)
+        {
+            return null;
+        }
+        final byte[] bytes = new byte[length];
+        record.get(bytes);
+        return new String(bytes, UTF8);
+    }
+
+    private static Link readLink(final ByteBuffer record)
+    {
+        final int tag = record.get() & 0xFF;
+        switch (tag)
+        {
+            case LINK_NONE:
+                return null;
+            case LINK_URI:
+                final String uri = readString(record);
+                return uri == null ? null : Link.create(uri);
+            default:
+                final long high = record.getLong();
+                return link(tag, high, record.getLong());
+        }
+    }
+
+    /**
+     * Returns the interned link for the id of a track, album or artist, the native library calls
+     * this instead of rendering and parsing the URI.
+     */
+    public static Link link(final int kind, final long high, final long low)
+    {
+        switch (kind)
+        {
+            case KIND_TRACK:
+                return Link.create(Link.Type.TRACK, high, low);
+            case KIND_ALBUM:
+                return Link.create(Link.Type.ALBUM, high, low);
+            case KIND_ARTIST:
+                return Link.create(Link.Type.ARTIST, high, low);
+            default:
+                throw new IllegalArgumentException("Unknown link kind: " + kind);
+        }
+    }
+
+}
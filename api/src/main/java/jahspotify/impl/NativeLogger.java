@@ -28,7 +28,59 @@ import org.apache.commons.logging.LogFactory;
 public class NativeLogger
 {
     private static Log _log = LogFactory.getLog(NativeLogger.class);
-    public static final boolean SYSOUT = true;
+
+    /**
+     * Also prints every native message to standard out, enabled with the system property
+     * <code>jahspotify.native.sysout</code>.
+     */
+    public static final boolean SYSOUT = Boolean.getBoolean("jahspotify.native.sysout");
+
+    /* These match the LOG_LEVEL_* constants in Logging.h */
+    public static final int TRACE = 0;
+    public static final int DEBUG = 1;
+    public static final int INFO = 2;
+    public static final int WARN = 3;
+    public static final int ERROR = 4;
+    public static final int FATAL = 5;
+    public static final int OFF = 6;
+
+    /**
+     * Sets the lowest level the native library will format and queue. Messages below this level
+     * are discarded in native code without calling into Java.
+     *
+     * @param level One of the level constants of this class
+     */
+    public static native void setNativeLevel(int level);
+
+    /**
+     * Called from the native library when it is loaded to seed the native level.
+     *
+     * @return The lowest level enabled for this logger
+     */
+    public static int getDefaultLevel()
+    {
+        if (SYSOUT || _log.isTraceEnabled())
+        {
+            return TRACE;
+        }
+        if (_log.isDebugEnabled())
+        {
+            return DEBUG;
+        }
+        if (_log.isInfoEnabled())
+        {
+            return INFO;
+        }
+        if (_log.isWarnEnabled())
+        {
+            return WARN;
+        }
+        if (_log.isErrorEnabled())
+        {
+            return ERROR;
+        }
+        return _log.isFatalEnabled() ? FATAL : OFF;
+    }
 
     public static void trace(final String component, final String subComponent, final String message)
     {
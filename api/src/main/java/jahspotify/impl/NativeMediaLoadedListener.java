@@ -14,6 +14,16 @@ public interface NativeMediaLoadedListener
     public void track(final int token, final Link link);
     public void playlist(Playlist playlist);
 
+    /**
+     * Tracks were inserted in the playlist at the given native address, entries are null for
+     * tracks which are not available.
+     */
+    public void playlistTracksAdded(final long playlist, final int position, final Link[] tracks);
+
+    public void playlistTracksRemoved(final long playlist, final int[] positions);
+
+    public void playlistTracksMoved(final long playlist, final int[] positions, final int newPosition);
+
     public void album(final int token, final Album album);
 
     public void image(final int token, final Link link, final ImageSize imageSize, final byte[] imageBytes);
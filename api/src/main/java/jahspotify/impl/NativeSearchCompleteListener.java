@@ -8,4 +8,9 @@ import jahspotify.*;
 public interface NativeSearchCompleteListener
 {
     public void searchCompleted(int token, SearchResult searchResult);
+
+    /**
+     * Called instead of searchCompleted when the search failed, timed out or could not be started.
+     */
+    public void searchFailed(int token, String message);
 }
@@ -0,0 +1,283 @@
+package jahspotify.impl;
+
+/**
+ * Snapshot of counters kept by the native library for one session. Fields are written by the
+ * native code, latencies are in milliseconds.
+ */
+public class NativeStatistics
+{
+    private long pendingLoads;
+    private long completedLoads;
+    private long totalLoadLatency;
+    private long maxLoadLatency;
+    private long metadataCacheHits;
+    private long metadataCacheMisses;
+    private long metadataStoreHits;
+    private long metadataCacheEvictions;
+    private long metadataCacheEntries;
+    private long metadataCacheBytes;
+    private long imageCacheHits;
+    private long imageCacheMisses;
+    private long imageCacheEvictions;
+    private long imageCacheEntries;
+    private long imageCacheBytes;
+    private long browseCacheHits;
+    private long browseCacheMisses;
+    private long browseCacheCoalesced;
+    private long browseCacheExpired;
+    private long browseCacheEntries;
+    private long runningSearches;
+    private long queuedSearches;
+    private long completedSearches;
+    private long failedSearches;
+    private long timedOutSearches;
+    private long cancelledSearches;
+    private long totalSearchLatency;
+    private long maxSearchLatency;
+    private long libraryTracks;
+    private long libraryPendingTracks;
+    private long libraryRemovedTracks;
+    private long libraryTerms;
+    private long libraryPostingBytes;
+
+    /**
+     * @return Number of tracks, albums and artists currently waiting for libspotify to load them
+     */
+    public long getPendingLoads()
+    {
+        return pendingLoads;
+    }
+
+    public long getCompletedLoads()
+    {
+        return completedLoads;
+    }
+
+    public long getMaxLoadLatency()
+    {
+        return maxLoadLatency;
+    }
+
+    public long getAverageLoadLatency()
+    {
+        return completedLoads == 0 ? 0 : totalLoadLatency / completedLoads;
+    }
+
+    /**
+     * @return Number of tracks, albums and artists served from the native metadata cache, shared by all sessions
+     */
+    public long getMetadataCacheHits()
+    {
+        return metadataCacheHits;
+    }
+
+    public long getMetadataCacheMisses()
+    {
+        return metadataCacheMisses;
+    }
+
+    /**
+     * @return Number of cache misses answered from the metadata store kept in the cache folder
+     */
+    public long getMetadataStoreHits()
+    {
+        return metadataStoreHits;
+    }
+
+    public long getMetadataCacheEvictions()
+    {
+        return metadataCacheEvictions;
+    }
+
+    public long getMetadataCacheEntries()
+    {
+        return metadataCacheEntries;
+    }
+
+    public long getMetadataCacheBytes()
+    {
+        return metadataCacheBytes;
+    }
+
+    /**
+     * @return Number of images served from the native image cache, shared by all sessions
+     */
+    public long getImageCacheHits()
+    {
+        return imageCacheHits;
+    }
+
+    public long getImageCacheMisses()
+    {
+        return imageCacheMisses;
+    }
+
+    public long getImageCacheEvictions()
+    {
+        return imageCacheEvictions;
+    }
+
+    public long getImageCacheEntries()
+    {
+        return imageCacheEntries;
+    }
+
+    public long getImageCacheBytes()
+    {
+        return imageCacheBytes;
+    }
+
+    /**
+     * @return Number of album and artist browses answered with a recent browse of the same item
+     */
+    public long getBrowseCacheHits()
+    {
+        return browseCacheHits;
+    }
+
+    public long getBrowseCacheMisses()
+    {
+        return browseCacheMisses;
+    }
+
+    /**
+     * @return Number of browses which waited for an identical browse that was still running
+     */
+    public long getBrowseCacheCoalesced()
+    {
+        return browseCacheCoalesced;
+    }
+
+    public long getBrowseCacheExpired()
+    {
+        return browseCacheExpired;
+    }
+
+    public long getBrowseCacheEntries()
+    {
+        return browseCacheEntries;
+    }
+
+    /**
+     * @return Number of searches running in libspotify
+     */
+    public long getRunningSearches()
+    {
+        return runningSearches;
+    }
+
+    /**
+     * @return Number of searches waiting for one of the running searches to complete
+     */
+    public long getQueuedSearches()
+    {
+        return queuedSearches;
+    }
+
+    public long getCompletedSearches()
+    {
+        return completedSearches;
+    }
+
+    public long getFailedSearches()
+    {
+        return failedSearches;
+    }
+
+    public long getTimedOutSearches()
+    {
+        return timedOutSearches;
+    }
+
+    public long getCancelledSearches()
+    {
+        return cancelledSearches;
+    }
+
+    /**
+     * @return Average time from starting a search until it completed, waiting in line included
+     */
+    public long getAverageSearchLatency()
+    {
+        return completedSearches == 0 ? 0 : totalSearchLatency / completedSearches;
+    }
+
+    public long getMaxSearchLatency()
+    {
+        return maxSearchLatency;
+    }
+
+    /**
+     * @return Number of distinct tracks in the playlists of the container which can be searched
+     */
+    public long getLibraryTracks()
+    {
+        return libraryTracks;
+    }
+
+    /**
+     * @return Number of tracks of the library waiting to load before they are indexed
+     */
+    public long getLibraryPendingTracks()
+    {
+        return libraryPendingTracks;
+    }
+
+    /**
+     * @return Number of tracks which left the library and are not purged from the index yet
+     */
+    public long getLibraryRemovedTracks()
+    {
+        return libraryRemovedTracks;
+    }
+
+    public long getLibraryTerms()
+    {
+        return libraryTerms;
+    }
+
+    public long getLibraryPostingBytes()
+    {
+        return libraryPostingBytes;
+    }
+
+    @Override
+    public String toString()
+    {
+        return "NativeStatistics{" +
+                "pendingLoads=" + pendingLoads +
+                ", completedLoads=" + completedLoads +
+                ", averageLoadLatency=" + getAverageLoadLatency() +
+                ", maxLoadLatency=" + maxLoadLatency +
+                ", metadataCacheHits=" + metadataCacheHits +
+                ", metadataCacheMisses=" + metadataCacheMisses +
+                ", metadataStoreHits=" + metadataStoreHits +
+                ", metadataCacheEvictions=" + metadataCacheEvictions +
+                ", metadataCacheEntries=" + metadataCacheEntries +
+                ", metadataCacheBytes=" + metadataCacheBytes +
+                ", imageCacheHits=" + imageCacheHits +
+                ", imageCacheMisses=" + imageCacheMisses +
+                ", imageCacheEvictions=" + imageCacheEvictions +
+                ", imageCacheEntries=" + imageCacheEntries +
+                ", imageCacheBytes=" + imageCacheBytes +
+                ", browseCacheHits=" + browseCacheHits +
+                ", browseCacheMisses=" + browseCacheMisses +
+                ", browseCacheCoalesced=" + browseCacheCoalesced +
+                ", browseCacheExpired=" + browseCacheExpired +
+                ", browseCacheEntries=" + browseCacheEntries +
+                ", runningSearches=" + runningSearches +
+                ", queuedSearches=" + queuedSearches +
+                ", completedSearches=" + completedSearches +
+                ", failedSearches=" + failedSearches +
+                ", timedOutSearches=" + timedOutSearches +
+                ", cancelledSearches=" + cancelledSearches +
+                ", averageSearchLatency=" + getAverageSearchLatency() +
+                ", maxSearchLatency=" + maxSearchLatency +
+                ", libraryTracks=" + libraryTracks +
+                ", libraryPendingTracks=" + libraryPendingTracks +
+                ", libraryRemovedTracks=" + libraryRemovedTracks +
+                ", libraryTerms=" + libraryTerms +
+                ", libraryPostingBytes=" + libraryPostingBytes +
+                '}';
+    }
+}
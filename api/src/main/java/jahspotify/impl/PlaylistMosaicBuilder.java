@@ -0,0 +1,220 @@
+package jahspotify.impl;
+
+import jahspotify.media.Album;
+import jahspotify.media.Image;
+import jahspotify.media.Link;
+import jahspotify.media.Playlist;
+import jahspotify.media.Track;
+import jahspotify.services.MediaHelper;
+
+import java.awt.Graphics;
+import java.awt.image.BufferedImage;
+import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.LinkedHashMap;
+import java.util.LinkedHashSet;
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+
+import javax.imageio.ImageIO;
+
+/**
+ * Builds the image of playlists without a picture of their own: a 2x2 mosaic of the covers of the
+ * first four different albums in the playlist, or the cover of the first album if there are fewer.
+ * <p/>
+ * Tracks, albums and covers are each requested all at once and waited for together, so
+ * libspotify loads them in parallel. Mosaics are cached per playlist along with the albums they
+ * were built from and only built again once those albums change.
+ */
+class PlaylistMosaicBuilder
+{
+    private static final int SIZE = 300;
+    private static final int TILES = 4;
+
+    /**
+     * Number of tracks read at once while looking for four different albums.
+     */
+    private static final int TRACK_BATCH = 16;
+
+    /**
+     * Seconds to wait for each step of loading the covers.
+     */
+    private static final int LOAD_TIMEOUT = 2;
+
+    /**
+     * Number of mosaics kept, the least recently used is dropped first.
+     */
+    private static final int MAX_CACHED = 64;
+
+    private static class Mosaic
+    {
+        final List<Link> albums;
+        final byte[] bytes;
+
+        Mosaic(final List<Link> albums, final byte[] bytes)
+        {
+            this.albums = albums;
+            this.bytes = bytes;
+        }
+    }
+
+    private final JahSpotifyImpl jahSpotify;
+
+    private final Map<Link, Mosaic> cache = new LinkedHashMap<Link, Mosaic>(16, 0.75f, true)
+    {
+        @Override
+        protected boolean removeEldestEntry(final Map.Entry<Link, Mosaic> eldest)
+        {
+            return size() > MAX_CACHED;
+        }
+    };
+
+    PlaylistMosaicBuilder(final JahSpotifyImpl jahSpotify)
+    {
+        this.jahSpotify = jahSpotify;
+    }
+
+    Image build(final Link link) throws IOException
+    {
+        Playlist playlist = jahSpotify.getPlaylistContainer().getContainedPlaylist(link);
+        if (playlist == null)
+        {
+            playlist = jahSpotify.readPlaylist(link, 0, 0);
+            MediaHelper.waitFor(playlist, 1);
+        }
+
+        // If the playlist has a custom image, use that.
+        if (playlist.getPicture() != null)
+        {
+            return jahSpotify.readImage(playlist.getPicture());
+        }
+
+        final List<Link> albums = firstAlbums(playlist.getTracks());
+        if (albums.isEmpty())
+        {
+            return null; // Empty playlist, no image.
+        }
+        if (albums.size() < TILES)
+        {
+            return jahSpotify.readImage(albums.get(0)); // Too few images, just get the first one.
+        }
+
+        synchronized (cache)
+        {
+            final Mosaic cached = cache.get(link);
+            if (cached != null && cached.albums.equals(albums))
+            {
+                return loadedImage(cached.bytes);
+            }
+        }
+
+        final List<Album> read = new ArrayList<Album>(TILES);
+        for (Link album : albums)
+        {
+            read.add(jahSpotify.readAlbum(album));
+        }
+        MediaHelper.waitFor(read, LOAD_TIMEOUT);
+
+        final List<Image> covers = new ArrayList<Image>(TILES);
+        for (Album album : read)
+        {
+            if (album != null && album.getCover() != null)
+            {
+                covers.add(jahSpotify.readImage(album.getCover()));
+            }
+        }
+        MediaHelper.waitFor(covers, LOAD_TIMEOUT);
+
+        // Make usable image from the Spotify image types.
+        final List<BufferedImage> tiles = new ArrayList<BufferedImage>(TILES);
+        Image correct = null;
+        for (Image cover : covers)
+        {
+            if (cover != null && cover.getBytes() != null)
+            {
+                final BufferedImage tile = ImageIO.read(new ByteArrayInputStream(cover.getBytes()));
+                if (tile != null)
+                {
+                    correct = cover;
+                    tiles.add(tile);
+                }
+            }
+        }
+        if (tiles.size() != TILES)
+        {
+            return correct;
+        }
+
+        final byte[] bytes = draw(tiles);
+        synchronized (cache)
+        {
+            cache.put(link, new Mosaic(albums, bytes));
+        }
+        return loadedImage(bytes);
+    }
+
+    /**
+     * Returns up to four different albums of the tracks, in playlist order.
+     */
+    private List<Link> firstAlbums(final List<Link> links)
+    {
+        final Set<Link> albums = new LinkedHashSet<Link>();
+        final List<Link> all = new ArrayList<Link>(links);
+
+        for (int start = 0; start < all.size() && albums.size() < TILES; start += TRACK_BATCH)
+        {
+            final List<Track> tracks = new ArrayList<Track>(TRACK_BATCH);
+            for (Track track : jahSpotify.readTracks(all.subList(start, Math.min(start + TRACK_BATCH, all.size()))))
+            {
+                if (track != null)
+                {
+                    tracks.add(track);
+                }
+            }
+            MediaHelper.waitFor(tracks, LOAD_TIMEOUT);
+
+            for (Track track : tracks)
+            {
+                if (track.getAlbum() != null)
+                {
+                    albums.add(track.getAlbum());
+                    if (albums.size() == TILES)
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+        return new ArrayList<Link>(albums);
+    }
+
+    private static byte[] draw(final List<BufferedImage> tiles) throws IOException
+    {
+        final BufferedImage target = new BufferedImage(SIZE, SIZE, BufferedImage.TYPE_INT_RGB);
+        final Graphics g = target.getGraphics();
+        final int half = SIZE / 2;
+        for (int i = 0; i < TILES; i++)
+        {
+            final BufferedImage tile = tiles.get(i);
+            final int x = (i % 2) * half;
+            final int y = (i / 2) * half;
+            g.drawImage(tile, x, y, x + half, y + half, 0, 0, tile.getWidth(), tile.getHeight(), null);
+        }
+        g.dispose();
+
+        final ByteArrayOutputStream baos = new ByteArrayOutputStream();
+        ImageIO.write(target, "JPG", baos);
+        return baos.toByteArray();
+    }
+
+    private static Image loadedImage(final byte[] bytes)
+    {
+        final Image result = new Image();
+        result.setBytes(bytes);
+        result.setLoaded(true);
+        return result;
+    }
+}
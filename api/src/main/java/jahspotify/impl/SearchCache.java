@@ -0,0 +1,348 @@
+package jahspotify.impl;
+
+import jahspotify.SearchErrorListener;
+import jahspotify.SearchListener;
+import jahspotify.SearchResult;
+import jahspotify.impl.JahSpotifyImpl.NativeSearchParameters;
+import jahspotify.media.Link;
+import jahspotify.media.Playlist;
+
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Iterator;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Locale;
+import java.util.Map;
+
+/**
+ * Answers searches from recent results and lets identical searches share one libspotify search,
+ * which is common with type-ahead searches.
+ * <p/>
+ * Searches are identified by their normalized query and paging parameters. Results are kept for a
+ * limited time and within a budget of estimated bytes, the least recently used are dropped first.
+ * Cached results are handed to every listener asking for them, so they must not be modified.
+ */
+class SearchCache
+{
+    /**
+     * Milliseconds after which a search that has not answered is started again instead of being
+     * joined. Failures and timeouts are reported by the native search registry, this only keeps a
+     * search whose answer got lost, such as one started before the session was shut down, from
+     * being joined forever.
+     */
+    private static final long PENDING_TIMEOUT = 10000;
+
+    /**
+     * Rough number of bytes taken by a result and by each link or playlist it holds.
+     */
+    private static final int RESULT_OVERHEAD = 256;
+    private static final int LINK_OVERHEAD = 64;
+    private static final int PLAYLIST_OVERHEAD = 512;
+
+    static final class Key
+    {
+        private final String query;
+        private final int[] paging;
+        private final boolean suggest;
+
+        Key(final NativeSearchParameters parameters)
+        {
+            this.query = normalize(parameters._query);
+            this.paging = new int[] {
+                    parameters.trackOffset, parameters.numTracks, parameters.albumOffset, parameters.numAlbums,
+                    parameters.artistOffset, parameters.numArtists, parameters.playlistOffset, parameters.numPlaylists
+            };
+            this.suggest = parameters.suggest;
+        }
+
+        @Override
+        public boolean equals(final Object o)
+        {
+            if (this == o)
+            {
+                return true;
+            }
+            if (!(o instanceof Key))
+            {
+                return false;
+            }
+            final Key key = (Key) o;
+            return suggest == key.suggest && query.equals(key.query) && Arrays.equals(paging, key.paging);
+        }
+
+        @Override
+        public int hashCode()
+        {
+            int result = query.hashCode();
+            result = 31 * result + Arrays.hashCode(paging);
+            result = 31 * result + (suggest ? 1 : 0);
+            return result;
+        }
+
+        @Override
+        public String toString()
+        {
+            return "Key{" +
+                    "query='" + query + '\'' +
+                    ", paging=" + Arrays.toString(paging) +
+                    ", suggest=" + suggest +
+                    '}';
+        }
+    }
+
+    private static class Entry
+    {
+        final long started;
+        final List<SearchListener> waiters = new ArrayList<SearchListener>(1);
+        Completion completion;
+        SearchResult result;
+        long completed;
+        long bytes;
+
+        Entry(final long started)
+        {
+            this.started = started;
+        }
+    }
+
+    private final Map<Key, Entry> entries = new LinkedHashMap<Key, Entry>(16, 0.75f, true);
+    private long ttl;
+    private long budget;
+    private long bytes;
+
+    /**
+     * @param ttl    Milliseconds results are handed out again, 0 disables the cache.
+     * @param budget Estimated number of bytes the results may take.
+     */
+    SearchCache(final long ttl, final long budget)
+    {
+        configure(ttl, budget);
+    }
+
+    synchronized void configure(final long ttl, final long budget)
+    {
+        this.ttl = ttl;
+        this.budget = budget;
+        trim();
+    }
+
+    /**
+     * Hands the listener a recent result of the search or queues it on the identical search which
+     * is running.
+     *
+     * @return null if the listener was taken care of, otherwise the listener to start the search
+     *         with. It answers all listeners asking for the search until it completes.
+     */
+    SearchListener join(final Key key, final SearchListener listener)
+    {
+        final SearchResult cached;
+        synchronized (this)
+        {
+            if (ttl <= 0 || budget <= 0)
+            {
+                return listener;
+            }
+
+            final long now = System.currentTimeMillis();
+            final Entry entry = entries.get(key);
+            if (entry != null && entry.result == null && now - entry.started < PENDING_TIMEOUT)
+            {
+                entry.waiters.add(listener);
+                return null;
+            }
+            if (entry == null || entry.result == null || now - entry.completed >= ttl)
+            {
+                if (entry != null)
+                {
+                    remove(key);
+                }
+                final Entry started = new Entry(now);
+                started.waiters.add(listener);
+                started.completion = new Completion(key, started);
+                entries.put(key, started);
+                return started.completion;
+            }
+            cached = entry.result;
+        }
+
+        listener.searchComplete(cached);
+        return null;
+    }
+
+    /**
+     * Stops waiting for a search on behalf of the listener.
+     *
+     * @return the listener the search was started with if nobody else waits for it and it should
+     *         be cancelled, null if others still wait for it or the given listener if it is not
+     *         waiting for any search of the cache.
+     */
+    synchronized SearchListener leave(final SearchListener listener)
+    {
+        for (Iterator<Map.Entry<Key, Entry>> it = entries.entrySet().iterator(); it.hasNext(); )
+        {
+            final Entry entry = it.next().getValue();
+            for (Iterator<SearchListener> waiters = entry.waiters.iterator(); waiters.hasNext(); )
+            {
+                if (waiters.next() != listener)
+                {
+                    continue;
+                }
+                waiters.remove();
+                if (!entry.waiters.isEmpty())
+                {
+                    return null;
+                }
+                it.remove();
+                return entry.completion;
+            }
+        }
+        return listener;
+    }
+
+    synchronized void clear()
+    {
+        entries.clear();
+        bytes = 0;
+    }
+
+    synchronized int size()
+    {
+        return entries.size();
+    }
+
+    private void remove(final Key key)
+    {
+        final Entry entry = entries.remove(key);
+        if (entry != null)
+        {
+            bytes -= entry.bytes;
+        }
+    }
+
+    private void trim()
+    {
+        final long now = System.currentTimeMillis();
+        for (Iterator<Entry> it = entries.values().iterator(); it.hasNext(); )
+        {
+            final Entry entry = it.next();
+            if (entry.result != null && (bytes > budget || now - entry.completed >= ttl))
+            {
+                bytes -= entry.bytes;
+                it.remove();
+            }
+        }
+    }
+
+    /**
+     * Collapses whitespace and lower cases the terms of a query, leaving the operators alone.
+     */
+    static String normalize(final String query)
+    {
+        final StringBuilder normalized = new StringBuilder(query.length());
+        for (String word : query.trim().split("\\s+"))
+        {
+            if (normalized.length() > 0)
+            {
+                normalized.append(' ');
+            }
+            normalized.append("AND".equals(word) || "OR".equals(word) || "NOT".equals(word) ? word : word.toLowerCase(Locale.ENGLISH));
+        }
+        return normalized.toString();
+    }
+
+    private static long estimateBytes(final SearchResult result)
+    {
+        long estimate = RESULT_OVERHEAD;
+        estimate += estimateBytes(result.getTracksFound());
+        estimate += estimateBytes(result.getAlbumsFound());
+        estimate += estimateBytes(result.getArtistsFound());
+        if (result.getPlaylistsFound() != null)
+        {
+            for (Playlist playlist : result.getPlaylistsFound())
+            {
+                estimate += PLAYLIST_OVERHEAD + (playlist == null || playlist.getTracks() == null ? 0 : estimateBytes(playlist.getTracks()));
+            }
+        }
+        return estimate;
+    }
+
+    private static long estimateBytes(final List<Link> links)
+    {
+        long estimate = 0;
+        if (links != null)
+        {
+            for (Link link : links)
+            {
+                estimate += LINK_OVERHEAD + (link == null ? 0 : 2 * link.getId().length());
+            }
+        }
+        return estimate;
+    }
+
+    /**
+     * Stores the result of the search it was started with and answers everyone waiting for it.
+     */
+    private class Completion implements SearchErrorListener
+    {
+        private final Key key;
+        private final Entry entry;
+
+        Completion(final Key key, final Entry entry)
+        {
+            this.key = key;
+            this.entry = entry;
+        }
+
+        @Override
+        public void searchComplete(final SearchResult searchResult)
+        {
+            final List<SearchListener> waiters;
+            synchronized (SearchCache.this)
+            {
+                waiters = new ArrayList<SearchListener>(entry.waiters);
+                entry.waiters.clear();
+                if (searchResult != null && entries.get(key) == entry)
+                {
+                    entry.result = searchResult;
+                    entry.completed = System.currentTimeMillis();
+                    entry.bytes = estimateBytes(searchResult);
+                    bytes += entry.bytes;
+                    trim();
+                }
+                else if (entries.get(key) == entry)
+                {
+                    remove(key);
+                }
+            }
+
+            for (SearchListener waiter : waiters)
+            {
+                waiter.searchComplete(searchResult);
+            }
+        }
+
+        @Override
+        public void searchFailed(final String message)
+        {
+            final List<SearchListener> waiters;
+            synchronized (SearchCache.this)
+            {
+                waiters = new ArrayList<SearchListener>(entry.waiters);
+                entry.waiters.clear();
+                if (entries.get(key) == entry)
+                {
+                    remove(key);
+                }
+            }
+
+            for (SearchListener waiter : waiters)
+            {
+                if (waiter instanceof SearchErrorListener)
+                {
+                    ((SearchErrorListener) waiter).searchFailed(message);
+                }
+            }
+        }
+    }
+}
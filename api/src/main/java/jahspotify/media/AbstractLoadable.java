@@ -1,38 +1,107 @@
 package jahspotify.media;
 
-import java.util.ArrayList;
 import java.util.List;
+import java.util.concurrent.CopyOnWriteArrayList;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.Future;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.TimeoutException;
 
 /**
  * Helper class for loadable classes.
  * @author Niels
  */
 public abstract class AbstractLoadable<T extends Loadable> implements Loadable {
-	private boolean loaded;
-	private List<LoadableListener<T>> listeners = new ArrayList<LoadableListener<T>>();
-	
+	private volatile boolean loaded;
+	private final Object loadedLock = new Object();
+	private List<LoadableListener<T>> listeners = new CopyOnWriteArrayList<LoadableListener<T>>();
+
 	/**
 	 * Sets the loaded state. If the state is set to true the loadablelisteners will be
-	 * triggered.
+	 * triggered and threads waiting for the object woken up.
 	 */
 	public void setLoaded(boolean loaded) {
-		this.loaded = loaded;
+		synchronized (loadedLock) {
+			this.loaded = loaded;
+			if (loaded)
+				loadedLock.notifyAll();
+		}
 		if (loaded)
 			triggerLoadedEvent();
 	}
-	
+
 	/**
 	 * Returns if this object is loaded.
 	 */
 	public boolean isLoaded() {
 		return loaded;
 	}
-	
+
+	/**
+	 * Block until the object is loaded or the timeout has passed. The waiting thread is woken
+	 * up as soon as the object is loaded.
+	 *
+	 * @param timeout The maximum time to wait, 0 or less to not wait at all.
+	 * @param unit The unit of the timeout.
+	 * @return true if the object is loaded.
+	 */
+	public boolean waitForLoaded(long timeout, TimeUnit unit) throws InterruptedException {
+		final long deadline = System.nanoTime() + unit.toNanos(timeout);
+		synchronized (loadedLock) {
+			long remaining = deadline - System.nanoTime();
+			while (!loaded && remaining > 0) {
+				TimeUnit.NANOSECONDS.timedWait(loadedLock, remaining);
+				remaining = deadline - System.nanoTime();
+			}
+			return loaded;
+		}
+	}
+
+	/**
+	 * Returns a future which is done once the object is loaded. It can not be cancelled.
+	 */
+	public Future<T> getLoadedFuture() {
+		return new Future<T>() {
+			@Override
+			public boolean cancel(boolean mayInterruptIfRunning) {
+				return false;
+			}
+
+			@Override
+			public boolean isCancelled() {
+				return false;
+			}
+
+			@Override
+			public boolean isDone() {
+				return isLoaded();
+			}
+
+			@SuppressWarnings("unchecked")
+			@Override
+			public T get() throws InterruptedException, ExecutionException {
+				synchronized (loadedLock) {
+					while (!loaded)
+						loadedLock.wait();
+				}
+				return (T) AbstractLoadable.this;
+			}
+
+			@SuppressWarnings("unchecked")
+			@Override
+			public T get(long timeout, TimeUnit unit) throws InterruptedException, ExecutionException, TimeoutException {
+				if (!waitForLoaded(timeout, unit))
+					throw new TimeoutException("Not loaded in " + timeout + " " + unit);
+				return (T) AbstractLoadable.this;
+			}
+		};
+	}
+
 	/**
 	 * Adds a listener which will receive an event if the object is loaded.
 	 * If the object is already loaded, the listener will immediately receive
 	 * the event.
-	 * 
+	 *
 	 * @param listener
 	 */
 	@SuppressWarnings("unchecked")
@@ -41,7 +110,7 @@ public abstract class AbstractLoadable<T extends Loadable> implements Loadable {
 		if (isLoaded())
 			listener.loaded((T) this);
 	}
-	
+
 	/**
 	 * Sends the loaded event to all listeners.
 	 */
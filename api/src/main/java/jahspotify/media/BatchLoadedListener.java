@@ -0,0 +1,15 @@
+package jahspotify.media;
+
+import java.util.List;
+
+/**
+ * Interface for the callback of a batch of items read at once.
+ */
+public interface BatchLoadedListener<T extends Loadable> {
+	/**
+	 * Called once, when every item of the batch has loaded.
+	 *
+	 * @param items The items in the order they were requested, null for those which could not be read.
+	 */
+	public void loaded(List<T> items);
+}
@@ -1,14 +1,15 @@
 package jahspotify.media;
 
-import jahspotify.util.BaseConvert;
 import jahspotify.util.Hex;
+import jahspotify.util.SpotifyId;
 
 import java.io.Serializable;
 import java.io.UnsupportedEncodingException;
+import java.lang.ref.WeakReference;
 import java.net.URLDecoder;
 import java.net.URLEncoder;
-import java.util.regex.Matcher;
-import java.util.regex.Pattern;
+import java.util.Map;
+import java.util.WeakHashMap;
 
 /**
  * Represents a link (Spotify or Jah'Spotify URI) to a media object.
@@ -79,68 +80,19 @@ public class Link implements Comparable<Link>, Serializable
         }
     }
 
-    /**
-     * A regular expression to match artist, album and track URIs:
-     * <p/>
-     * <pre>spotify:(artist|album|track):([0-9A-Za-z]{22})</pre>
-     */
-    private static final Pattern mediaPattern = Pattern.compile("spotify:(artist|album|track):([0-9A-Za-z]{22})");
-
-    /**
-     * A regular expression to match artist, album and track URIs:
-     * <p/>
-     * <pre>spotify:image:([0-9A-Za-z]{40})</pre>
-     */
-    private static final Pattern imagePattern = Pattern.compile("spotify:image:([0-9A-Za-z]{40})");
-
-    /**
-     * A regular expression to match playlist URIs:
-     * <p/>
-     * <pre>spotify:user:([^:]+):playlist:([0-9A-Za-z]{22})</pre>
-     */
-    private static final Pattern playlistPattern = Pattern.compile("spotify:user:([^:]+):playlist:([0-9A-Za-z]{22})");
-
-    /**
-     * A regular expression to match search URIs:
-     * <p/>
-     * <pre>spotify:search:([^\\s]+)</pre>
-     */
-    private static final Pattern searchPattern = Pattern.compile("spotify:search:([^\\s]+)");
+    private static final String SPOTIFY_PREFIX = "spotify:";
 
-    /**
-     * A regular expression to match search URIs:
-     * <p/>
-     * <pre>jahspotify:queue:([^\\s]+)</pre>
-     */
-    private static final Pattern jahQueuePattern = Pattern.compile("jahspotify:queue((:)([^\\s]+))");
+    private static final String JAHSPOTIFY_PREFIX = "jahspotify:";
 
     /**
-     * A regular expression to match podcast URIs:
-     * <p/>
-     * <pre>jahspotify:podcast:([^\\s]+)</pre>
+     * Number of base-62 characters in the id of an artist, album, track or playlist URI.
      */
-    private static final Pattern jahPodcastPattern = Pattern.compile("jahspotify:podcast:([^\\s]+)");
+    private static final int MEDIA_ID_LENGTH = 22;
 
     /**
-     * A regular expression to match MP3 URIs:
-     * <p/>
-     * <pre>jahspotify:podcast:([^\\s]+)</pre>
+     * Number of characters in the id of an image URI.
      */
-    private static final Pattern jahMP3Pattern = Pattern.compile("jahspotify:mp3:([^\\s]+)");
-
-    /**
-     * A regular expression to match local URIs:
-     * <p/>
-     * <pre>jahspotify:folder:([^\\s]+)</pre>
-     */
-    private static final Pattern localPattern = Pattern.compile("spotify:local:(.*)");
-
-    /**
-     * A regular expression to match local URIs:
-     * <p/>
-     * <pre>jahspotify:folder:([^\\s]+)</pre>
-     */
-    private static final Pattern userPattern = Pattern.compile("spotify:user:(.*)");
+    private static final int IMAGE_ID_LENGTH = 40;
 
     /**
      * The {@link Link.Type} of this link.
@@ -170,6 +122,54 @@ public class Link implements Comparable<Link>, Serializable
 
     private Long folderId;
 
+    /**
+     * The 128-bit id of an artist, album or track link created from its raw form, in which case
+     * the URI is only rendered when first asked for.
+     */
+    private Gid gid;
+
+    /**
+     * Links created from raw ids, identical links share one instance for as long as it is in use.
+     */
+    private static final Map<Gid, WeakReference<Link>> interned = new WeakHashMap<Gid, WeakReference<Link>>();
+
+    /**
+     * Type and 128-bit id of a media link, most significant half first.
+     */
+    private static final class Gid implements Serializable
+    {
+        private static final long serialVersionUID = 1L;
+
+        private final Type type;
+        private final long high;
+        private final long low;
+
+        private Gid(final Type type, final long high, final long low)
+        {
+            this.type = type;
+            this.high = high;
+            this.low = low;
+        }
+
+        @Override
+        public boolean equals(final Object o)
+        {
+            if (!(o instanceof Gid))
+            {
+                return false;
+            }
+            final Gid other = (Gid) o;
+            return type == other.type && high == other.high && low == other.low;
+        }
+
+        @Override
+        public int hashCode()
+        {
+            // Ids are random, folding them is as good a hash as any
+            return (int) (high ^ (high >>> 32) ^ low ^ (low >>> 32)) ^ type.ordinal();
+        }
+    }
+
     /**
      * Create a {@link Link} using the given parameters.
      *
@@ -187,119 +187,213 @@ public class Link implements Comparable<Link>, Serializable
         this.query = query;
     }
 
+    private Link(final Gid gid)
+    {
+        this.type = gid.type;
+        this.gid = gid;
+    }
+
     /**
      * Create a {@link Link} from a Spotify URI.
+     * <p/>
+     * The URI is scanned once, dispatching on its prefix. The accepted forms are:
+     * <pre>
+     * spotify:(artist|album|track):([0-9A-Za-z]{22})
+     * spotify:image:([0-9A-Za-z]{40})
+     * spotify:user:([^:]+):playlist:([0-9A-Za-z]{22})
+     * spotify:user:(.*)
+     * spotify:search:([^\s]+)
+     * spotify:local:(.*)
+     * jahspotify:queue:([^\s]+)
+     * jahspotify:podcast:([^\s]+)
+     * jahspotify:mp3:([^\s]+)
+     * </pre>
      *
      * @param uri A Spotify URI to parse.
      * @throws InvalidSpotifyURIException If the Spotify URI is invalid.
      */
     private Link(String uri) throws InvalidSpotifyURIException
     {
-        /* Regex for matching Spotify URIs. */
-        Matcher mediaMatcher = mediaPattern.matcher(uri);
-        Matcher imageMatcher = imagePattern.matcher(uri);
-        Matcher playlistMatcher = playlistPattern.matcher(uri);
-        Matcher searchMatcher = searchPattern.matcher(uri);
-        Matcher jahQueueMatcher = jahQueuePattern.matcher(uri);
-        Matcher jahPodcastMatcher = jahPodcastPattern.matcher(uri);
-        Matcher jahMp3Matcher = jahMP3Pattern.matcher(uri);
-        Matcher localMatcher = localPattern.matcher(uri);
-        Matcher userMatcher = userPattern.matcher(uri);
-
-        /* Check if URI matches artist/album/track pattern. */
-        if (mediaMatcher.matches())
+        if (uri.startsWith(SPOTIFY_PREFIX))
+        {
+            parseSpotifyURI(uri, SPOTIFY_PREFIX.length());
+        }
+        else if (uri.startsWith(JAHSPOTIFY_PREFIX))
+        {
+            parseJahSpotifyURI(uri, JAHSPOTIFY_PREFIX.length());
+        }
+        else
         {
-            String type = mediaMatcher.group(1);
+            throw new InvalidSpotifyURIException("Invalid URI: " + uri);
+        }
+    }
 
-            if (type.equals("artist"))
-            {
-                this.type = Type.ARTIST;
-            }
-            else if (type.equals("album"))
+    private void parseSpotifyURI(final String uri, final int offset)
+    {
+        if (uri.startsWith("artist:", offset))
+        {
+            parseMediaURI(uri, Type.ARTIST, offset + 7);
+        }
+        else if (uri.startsWith("album:", offset))
+        {
+            parseMediaURI(uri, Type.ALBUM, offset + 6);
+        }
+        else if (uri.startsWith("track:", offset))
+        {
+            parseMediaURI(uri, Type.TRACK, offset + 6);
+        }
+        else if (uri.startsWith("image:", offset))
+        {
+            if (!isBase62(uri, offset + 6, IMAGE_ID_LENGTH))
             {
-                this.type = Type.ALBUM;
+                throw new InvalidSpotifyURIException("Invalid URI: " + uri);
             }
-            else if (type.equals("track"))
+            this.type = Type.IMAGE;
+            this.id = uri;
+        }
+        else if (uri.startsWith("user:", offset))
+        {
+            final int userStart = offset + 5;
+            final int userEnd = uri.indexOf(':', userStart);
+
+            if (userEnd > userStart && uri.startsWith(":playlist:", userEnd) && isBase62(uri, userEnd + 10, MEDIA_ID_LENGTH))
             {
-                this.type = Type.TRACK;
+                this.type = Type.PLAYLIST;
+                this.user = uri.substring(userStart, userEnd);
+                this.id = uri;
             }
             else
             {
-                throw new InvalidSpotifyURIException("Invalid type: " + type);
+                /* Anything else below a user, as long as it is a single line. */
+                requireSingleLine(uri, userStart);
+                this.type = Type.USER;
+                this.id = uri;
             }
-
-            this.id = uri;
-            this.user = null;
-            this.query = null;
         }
-        else if (imageMatcher.matches())
-        {
-            this.type = Type.IMAGE;
-            this.id = uri;
-            this.user = null;
-            this.query = null;
-        }
-        /* Check if URI matches playlist pattern. */
-        else if (playlistMatcher.matches())
-        {
-            this.type = Type.PLAYLIST;
-            this.user = playlistMatcher.group(1);
-            this.id = uri;
-            this.query = null;
-        }
-        /* Check if URI matches search pattern. */
-        else if (searchMatcher.matches())
+        else if (uri.startsWith("search:", offset))
         {
+            final String query = requireToken(uri, offset + 7);
             this.type = Type.SEARCH;
-            this.id = null;
-            this.user = null;
 
             try
             {
-                this.query = URLDecoder.decode(searchMatcher.group(1), "UTF-8");
+                this.query = URLDecoder.decode(query, "UTF-8");
             }
             catch (UnsupportedEncodingException e)
             {
                 throw new InvalidSpotifyURIException("Invalid encoding of query");
             }
         }
-        else if (jahQueueMatcher.matches())
+        else if (uri.startsWith("local:", offset))
+        {
+            requireSingleLine(uri, offset + 6);
+            this.type = Type.LOCAL;
+            this.id = uri;
+        }
+        else
+        {
+            throw new InvalidSpotifyURIException("Invalid URI: " + uri);
+        }
+    }
+
+    private void parseJahSpotifyURI(final String uri, final int offset)
+    {
+        if (uri.startsWith("queue:", offset))
         {
             this.type = Type.QUEUE;
             this.id = uri;
-            this.queue = "default";
-            if (searchMatcher.groupCount() > 0)
-            {
-                this.queue = jahQueueMatcher.group(3);
-            }
+            this.queue = requireToken(uri, offset + 6);
         }
-        else if (jahPodcastMatcher.matches())
+        else if (uri.startsWith("podcast:", offset))
         {
             this.type = Type.PODCAST;
             this.id = uri;
-            this.uri = jahPodcastMatcher.group(1);
+            this.uri = requireToken(uri, offset + 8);
         }
-        else if (jahMp3Matcher.matches())
+        else if (uri.startsWith("mp3:", offset))
         {
             this.type = Type.MP3;
             this.id = uri;
-            this.uri = jahMp3Matcher.group(1);
+            this.uri = requireToken(uri, offset + 4);
         }
-        else if (localMatcher.matches())
+        else
         {
-        	this.type = Type.LOCAL;
-        	this.id = uri;
+            throw new InvalidSpotifyURIException("Invalid URI: " + uri);
         }
-        else if (userMatcher.matches())
+    }
+
+    private void parseMediaURI(final String uri, final Type type, final int offset)
+    {
+        if (!isBase62(uri, offset, MEDIA_ID_LENGTH))
         {
-        	this.type = Type.USER;
-        	this.id = uri;
+            throw new InvalidSpotifyURIException("Invalid URI: " + uri);
         }
-        /* If nothing was matched. */
-        else
+        this.type = type;
+        this.id = uri;
+    }
+
+    /**
+     * Checks that the URI ends with exactly {@code length} base-62 characters from the offset.
+     */
+    private static boolean isBase62(final String uri, final int offset, final int length)
+    {
+        if (uri.length() - offset != length)
+        {
+            return false;
+        }
+        for (int i = offset; i < offset + length; i++)
+        {
+            final char c = uri.charAt(i);
+            if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Returns the rest of the URI from the offset, which must be non-empty and free of whitespace.
+     */
+    private String requireToken(final String uri, final int offset)
+    {
+        if (offset >= uri.length())
         {
             throw new InvalidSpotifyURIException("Invalid URI: " + uri);
         }
+        for (int i = offset; i < uri.length(); i++)
+        {
+            switch (uri.charAt(i))
+            {
+                case ' ':
+                case '\t':
+                case '\n':
+                case '\u000B':
+                case '\f':
+                case '\r':
+                    throw new InvalidSpotifyURIException("Invalid URI: " + uri);
+            }
+        }
+        return uri.substring(offset);
+    }
+
+    /**
+     * Checks that the rest of the URI from the offset has no line terminators.
+     */
+    private void requireSingleLine(final String uri, final int offset)
+    {
+        for (int i = offset; i < uri.length(); i++)
+        {
+            switch (uri.charAt(i))
+            {
+                case '\n':
+                case '\r':
+                case '\u0085':
+                case '\u2028':
+                case '\u2029':
+                    throw new InvalidSpotifyURIException("Invalid URI: " + uri);
+            }
+        }
     }
 
     public static Link createFolderLink(final long folderID)
@@ -404,12 +498,12 @@ public class Link implements Comparable<Link>, Serializable
     /**
      * Get the id of this link.
      *
-     * @return A 32-character hex id.
+     * @return The Spotify URI of the link.
      * @throws IllegalStateException If the link doesn't have an id.
      */
     public String getId()
     {
-        if (this.id == null)
+        if (this.id() == null)
         {
             throw new IllegalStateException("Link doesn't have an id!");
         }
@@ -417,6 +511,18 @@ public class Link implements Comparable<Link>, Serializable
         return this.id;
     }
 
+    /**
+     * Returns the id, rendering the URI of a link created from a raw id on first use.
+     */
+    private String id()
+    {
+        if (this.id == null && this.gid != null)
+        {
+            this.id = "spotify:" + this.type + ":" + SpotifyId.toBase62(this.gid.high, this.gid.low);
+        }
+        return this.id;
+    }
+
     /**
      * Get the user of this playlist link.
      *
@@ -466,7 +572,7 @@ public class Link implements Comparable<Link>, Serializable
      */
     public String asString()
     {
-        return id;
+        return id();
     }
 
     /**
@@ -481,7 +587,7 @@ public class Link implements Comparable<Link>, Serializable
         {
             return String.format(
                     "http://open.spotify.com/user/%s/playlist/%s",
-                    this.user, Link.toBase62(this.id)
+                    this.user, this.base62Id()
             );
         }
         else if (this.isSearchLink())
@@ -502,7 +608,7 @@ public class Link implements Comparable<Link>, Serializable
         {
             return String.format(
                     "http://open.spotify.com/%s/%s",
-                    this.type, Link.toBase62(this.id)
+                    this.type, this.base62Id()
             );
         }
     }
@@ -528,26 +634,131 @@ public class Link implements Comparable<Link>, Serializable
      */
     public static Link create(String uri) throws InvalidSpotifyURIException
     {
+        final Type type = mediaType(uri);
+        if (type != null)
+        {
+            final long[] gid;
+            try
+            {
+                gid = SpotifyId.fromBase62(uri, uri.length() - SpotifyId.BASE62_LENGTH);
+            }
+            catch (IllegalArgumentException e)
+            {
+                /* Not a base-62 id or too large for 128 bits, let the parser sort it out. */
+                return new Link(uri);
+            }
+
+            final Link link = create(type, gid[0], gid[1]);
+            if (link.id == null)
+            {
+                /* Spare rendering the URI we were given. */
+                link.id = uri;
+            }
+            return link;
+        }
         return new Link(uri);
     }
 
     /**
-     * Convert a hexadecimal id into a base-62 encoded id.
+     * Returns the type of an artist, album or track URI ending with a full length id, otherwise
+     * {@code null}.
+     */
+    private static Type mediaType(final String uri)
+    {
+        final Type type;
+        if (uri.startsWith("spotify:artist:"))
+        {
+            type = Type.ARTIST;
+        }
+        else if (uri.startsWith("spotify:album:"))
+        {
+            type = Type.ALBUM;
+        }
+        else if (uri.startsWith("spotify:track:"))
+        {
+            type = Type.TRACK;
+        }
+        else
+        {
+            return null;
+        }
+        return uri.length() == SPOTIFY_PREFIX.length() + type.toString().length() + 1 + MEDIA_ID_LENGTH ? type : null;
+    }
+
+    /**
+     * Create an artist, album or track {@link Link} from its 32-character hexadecimal id.
      *
-     * @param hex A hexadecimal id.
-     * @return A base-62 encoded id.
+     * @param type  The {@link Link.Type}, one of artist, album or track.
+     * @param hexId A hexadecimal id in either case.
+     * @return A {@link Link} object.
+     * @throws IllegalArgumentException If the id is not a 32-character hexadecimal id.
      */
-    private static String toBase62(String hex)
+    public static Link createFromHex(final Type type, final String hexId)
     {
-        StringBuffer uri = new StringBuffer(BaseConvert.convert(hex, 16, 62));
+        if (hexId.length() != SpotifyId.HEX_LENGTH)
+        {
+            throw new IllegalArgumentException("Not a hexadecimal id: " + hexId);
+        }
+        final long[] gid = SpotifyId.fromHex(hexId, 0);
+        return create(type, gid[0], gid[1]);
+    }
 
-        /* Prepend zeroes until base-62 string length is 22. */
-        while (uri.length() < 22)
+    /**
+     * Create an artist, album or track {@link Link} from its 128-bit id. Identical links share
+     * one instance and the URI is only built when it is first needed.
+     *
+     * @param type The {@link Link.Type}, one of artist, album or track.
+     * @param high The most significant 64 bits of the id.
+     * @param low  The least significant 64 bits of the id.
+     * @return A {@link Link} object.
+     */
+    public static Link create(final Type type, final long high, final long low)
+    {
+        if (type != Type.ARTIST && type != Type.ALBUM && type != Type.TRACK)
         {
-            uri.insert(0, '0');
+            throw new IllegalArgumentException("Not a media link type: " + type);
         }
 
-        return uri.toString();
+        final Gid gid = new Gid(type, high, low);
+        synchronized (interned)
+        {
+            final WeakReference<Link> reference = interned.get(gid);
+            Link link = reference != null ? reference.get() : null;
+            if (link == null)
+            {
+                link = new Link(gid);
+                interned.put(gid, new WeakReference<Link>(link));
+            }
+            return link;
+        }
+    }
+
+    /**
+     * Returns the base-62 id an artist, album, track or playlist URI ends with.
+     */
+    private String base62Id()
+    {
+        if (this.gid != null)
+        {
+            return SpotifyId.toBase62(this.gid.high, this.gid.low);
+        }
+        final String id = this.getId();
+        return id.substring(id.length() - SpotifyId.BASE62_LENGTH);
+    }
+
+    /**
+     * Get the id of this artist, album or track link in hexadecimal.
+     *
+     * @return A 32-character lower case hex id.
+     * @throws IllegalStateException If the link doesn't have a 128-bit id.
+     */
+    public String getHexId()
+    {
+        if (this.gid == null)
+        {
+            throw new IllegalStateException("Link doesn't have a 128-bit id!");
+        }
+        return SpotifyId.toHex(this.gid.high, this.gid.low);
     }
 
     @Override
@@ -564,11 +775,15 @@ public class Link implements Comparable<Link>, Serializable
 
         final Link link = (Link) o;
 
+        if (gid != null && link.gid != null)
+        {
+            return gid.equals(link.gid);
+        }
         if (folderId != null ? !folderId.equals(link.folderId) : link.folderId != null)
         {
             return false;
         }
-        if (id != null ? !id.equals(link.id) : link.id != null)
+        if (id() != null ? !id().equals(link.id()) : link.id() != null)
         {
             return false;
         }
@@ -604,7 +819,7 @@ public class Link implements Comparable<Link>, Serializable
     public int hashCode()
     {
         int result = type != null ? type.hashCode() : 0;
-        result = 31 * result + (id != null ? id.hashCode() : 0);
+        result = 31 * result + (id() != null ? id().hashCode() : 0);
         result = 31 * result + (user != null ? user.hashCode() : 0);
         result = 31 * result + (query != null ? query.hashCode() : 0);
         result = 31 * result + (queue != null ? queue.hashCode() : 0);
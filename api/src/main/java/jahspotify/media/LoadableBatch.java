@@ -0,0 +1,58 @@
+package jahspotify.media;
+
+import java.util.Collections;
+import java.util.IdentityHashMap;
+import java.util.List;
+import java.util.Set;
+
+/**
+ * Tells a listener once every item of a batch has loaded. Items which could not be read are null
+ * and do not hold the batch up.
+ */
+public class LoadableBatch<T extends AbstractLoadable<T>> implements LoadableListener<T> {
+	private final List<T> items;
+	private final BatchLoadedListener<T> listener;
+	/** Items seen loaded, a listener may be called twice when it is added while the item loads */
+	private final Set<T> loaded = Collections.newSetFromMap(new IdentityHashMap<T, Boolean>());
+	private int remaining;
+
+	private LoadableBatch(final List<T> items, final BatchLoadedListener<T> listener) {
+		this.items = Collections.unmodifiableList(items);
+		this.listener = listener;
+	}
+
+	/**
+	 * Calls the listener once every item of the batch has loaded, right away if they all are.
+	 */
+	public static <T extends AbstractLoadable<T>> void whenLoaded(final List<T> items, final BatchLoadedListener<T> listener) {
+		final LoadableBatch<T> batch = new LoadableBatch<T>(items, listener);
+		final Set<T> distinct = Collections.newSetFromMap(new IdentityHashMap<T, Boolean>());
+		for (T item : items) {
+			if (item != null)
+				distinct.add(item);
+		}
+
+		// Counted up front, plus one for adding the listeners, so items loading meanwhile cannot complete the batch early
+		synchronized (batch) {
+			batch.remaining = distinct.size() + 1;
+		}
+		for (T item : distinct)
+			item.addLoadableListener(batch);
+		batch.done(null);
+	}
+
+	@Override
+	public void loaded(final T item) {
+		done(item);
+	}
+
+	private void done(final T item) {
+		synchronized (this) {
+			if (item != null && !loaded.add(item))
+				return;
+			if (--remaining > 0)
+				return;
+		}
+		listener.loaded(items);
+	}
+}
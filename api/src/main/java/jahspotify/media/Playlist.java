@@ -3,6 +3,7 @@ package jahspotify.media;
 import jahspotify.media.Link.Type;
 
 import java.util.ArrayList;
+import java.util.Arrays;
 import java.util.List;
 
 /**
@@ -22,8 +23,18 @@ public class Playlist extends AbstractLoadable<Playlist>
     private Link picture;
 
     private List<Link> tracks;
+    /**
+     * One entry per materialized position, null for tracks which are not available. Lets changes
+     * reported by libspotify be applied by position.
+     */
+    private List<Link> entries;
     private int numTracks;
     private int index;
+    /**
+     * Number of positions from index materialized into tracks, 0 for all of them.
+     */
+    private int windowSize;
+    private transient PlaylistTrackSource trackSource;
 
     public Playlist()
     {
@@ -31,6 +42,7 @@ public class Playlist extends AbstractLoadable<Playlist>
         this.name = null;
         this.author = null;
         this.tracks = new ArrayList<Link>();
+        this.entries = new ArrayList<Link>();
         this.collaborative = false;
         this.description = null;
         this.picture = null;
@@ -78,6 +90,94 @@ public class Playlist extends AbstractLoadable<Playlist>
     public void clear() {
     	if (tracks != null)
     		tracks.clear();
+    	entries.clear();
+    }
+
+    /**
+     * Appends the track at the next position, null if it is not available.
+     */
+    public void addEntry(Link track)
+    {
+        entries.add(track);
+        if (track != null)
+        {
+            addTrack(track);
+        }
+    }
+
+    /**
+     * Applies a change reported by libspotify to the tracks. Only playlists materialized in full
+     * can follow changes, others should be read again.
+     *
+     * @param delta The change
+     * @return false if the playlist is not materialized in full or the change does not fit it
+     */
+    public synchronized boolean apply(final PlaylistDelta delta)
+    {
+        if (!isLoaded() || index != 0 || windowSize != 0 || entries.size() != numTracks)
+        {
+            return false;
+        }
+
+        final int[] positions = delta.getPositions();
+        Arrays.sort(positions);
+        for (int position : positions)
+        {
+            if (position < 0 || position >= entries.size())
+            {
+                return false;
+            }
+        }
+
+        switch (delta.getType())
+        {
+            case ADDED:
+                if (delta.getPosition() < 0 || delta.getPosition() > entries.size())
+                {
+                    return false;
+                }
+                entries.addAll(delta.getPosition(), delta.getTracks());
+                break;
+            case REMOVED:
+                for (int i = positions.length - 1; i >= 0; i--)
+                {
+                    entries.remove(positions[i]);
+                }
+                break;
+            case MOVED:
+                if (delta.getPosition() < 0 || delta.getPosition() > entries.size())
+                {
+                    return false;
+                }
+                final List<Link> moved = new ArrayList<Link>(positions.length);
+                for (int position : positions)
+                {
+                    moved.add(entries.get(position));
+                }
+                int target = delta.getPosition();
+                for (int i = positions.length - 1; i >= 0; i--)
+                {
+                    entries.remove(positions[i]);
+                    if (positions[i] < delta.getPosition())
+                    {
+                        target--;
+                    }
+                }
+                entries.addAll(target, moved);
+                break;
+        }
+
+        numTracks = entries.size();
+        final List<Link> updated = new ArrayList<Link>(numTracks);
+        for (Link entry : entries)
+        {
+            if (entry != null && entry.getType() != Type.LOCAL)
+            {
+                updated.add(entry);
+            }
+        }
+        tracks = updated;
+        return true;
     }
     public void addTrack(Link track)
     {
@@ -108,6 +208,29 @@ public class Playlist extends AbstractLoadable<Playlist>
         this.tracks = tracks;
     }
 
+    /**
+     * Returns the tracks at the given positions, reading them through the track source when the
+     * playlist was only materialized for a window.
+     *
+     * @param index Position of the first track
+     * @param count Number of positions
+     * @return The tracks in that range, local and unavailable tracks are left out
+     */
+    public List<Link> getTracks(final int index, final int count)
+    {
+        if (trackSource != null && id != null)
+        {
+            if (index == this.index && count == windowSize)
+            {
+                return this.tracks;
+            }
+            return trackSource.readPlaylistTracks(id, index, count);
+        }
+
+        final int from = Math.min(Math.max(index, 0), this.tracks.size());
+        return this.tracks.subList(from, Math.min(from + count, this.tracks.size()));
+    }
+
     public boolean hasTracks()
     {
         return !this.tracks.isEmpty();
@@ -163,6 +286,21 @@ public class Playlist extends AbstractLoadable<Playlist>
         this.index = index;
     }
 
+    public int getWindowSize()
+    {
+        return windowSize;
+    }
+
+    public void setWindowSize(final int windowSize)
+    {
+        this.windowSize = windowSize;
+    }
+
+    public void setTrackSource(final PlaylistTrackSource trackSource)
+    {
+        this.trackSource = trackSource;
+    }
+
     @Override
     public boolean equals(final Object o)
     {
@@ -245,6 +383,7 @@ public class Playlist extends AbstractLoadable<Playlist>
                 ", picture=" + picture +
                 ", tracks=" + tracks +
                 ", numTracks=" + numTracks +
+                ", windowSize=" + windowSize +
                 "} " + super.toString();
     }
 
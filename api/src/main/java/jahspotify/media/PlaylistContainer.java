@@ -1,20 +1,86 @@
 package jahspotify.media;
 
-import jahspotify.impl.JahSpotifyImpl;
+import jahspotify.JahSpotify;
 
 import java.util.ArrayList;
-import java.util.HashSet;
+import java.util.Collections;
+import java.util.HashMap;
+import java.util.IdentityHashMap;
 import java.util.List;
-import java.util.Set;
+import java.util.Map;
 
+/**
+ * The playlists of the logged in user, one container per session.
+ *
+ * Playlists are indexed by their native pointer, their link once they are loaded and the instance
+ * itself, so adding, finding and removing one does not depend on the number of playlists. Readers
+ * get an immutable snapshot which is only rebuilt after the container changed.
+ */
 public class PlaylistContainer {
 
-	private static List<Playlist> playlists = new ArrayList<Playlist>();
-	private static Set<Long> pTrs = new HashSet<Long>();
+	/**
+	 * Item types of the container, in the order of sp_playlist_type.
+	 */
+	public static final int TYPE_PLAYLIST = 0;
+	public static final int TYPE_START_FOLDER = 1;
+	public static final int TYPE_END_FOLDER = 2;
+	public static final int TYPE_PLACEHOLDER = 3;
+
+	/**
+	 * A playlist in the container, linked in the order playlists were added.
+	 */
+	private static class Entry {
+		final Playlist playlist;
+		final Long pTr;
+		Link link;
+		Entry previous;
+		Entry next;
+
+		Entry(final Playlist playlist, final Long pTr) {
+			this.playlist = playlist;
+			this.pTr = pTr;
+		}
+	}
+
+	/**
+	 * The folders and the folder of each playlist, replaced as a whole.
+	 */
+	private static class Structure {
+		final PlaylistFolder root;
+		final Map<Playlist, PlaylistFolder> folders;
+
+		Structure(final PlaylistFolder root, final Map<Playlist, PlaylistFolder> folders) {
+			this.root = root;
+			this.folders = folders;
+		}
+	}
+
+	private final JahSpotify jahSpotify;
+	private final Object lock = new Object();
+
+	private Entry first;
+	private Entry last;
+	private final Map<Long, Entry> byPointer = new HashMap<Long, Entry>();
+	private final Map<Link, Entry> byLink = new HashMap<Link, Entry>();
+	private final Map<Playlist, Entry> byPlaylist = new IdentityHashMap<Playlist, Entry>();
+
+	/**
+	 * The playlists in order, null when it has to be rebuilt.
+	 */
+	private volatile List<Playlist> snapshot = Collections.emptyList();
+	private volatile Structure structure = emptyStructure();
+
+	/**
+	 * @param jahSpotify The session owning the container, used to read playlists which are not in it.
+	 */
+	public PlaylistContainer(final JahSpotify jahSpotify) {
+		this.jahSpotify = jahSpotify;
+	}
 
-	public static void addPlaylist(final Playlist playlist) {
-		synchronized (playlists) {
-			playlists.add(playlist);
+	public void addPlaylist(final Playlist playlist) {
+		synchronized (lock) {
+			if (!byPlaylist.containsKey(playlist))
+				add(new Entry(playlist, null));
 		}
 	}
 
@@ -28,42 +94,196 @@ public class PlaylistContainer {
 	 * 			  if the playlist has been added before.
 	 * @return An empty playlist object.
 	 */
-	public static Playlist addPlaylist(final long pTr) {
-		if (pTrs.contains(pTr))
-			return null;
-
-		pTrs.add(pTr);
-		synchronized (playlists) {
-			Playlist playlist = new Playlist();
-			playlists.add(playlist);
-			return playlist;
+	public Playlist addPlaylist(final long pTr) {
+		final Playlist playlist;
+		synchronized (lock) {
+			if (byPointer.containsKey(pTr))
+				return null;
+
+			playlist = new Playlist();
+			add(new Entry(playlist, pTr));
 		}
+		return playlist;
 	}
 
-	public static void removePlaylist(final String playlist) {
-		synchronized (playlists) {
-			for (int i = playlists.size() - 1; i >= 0; i--) {
-				if (playlists.get(i).getId().getId().equals(playlist))
-					playlists.remove(i);
-			}
+	/**
+	 * Returns the playlist added for the given native pointer, null if there is none.
+	 */
+	public Playlist getPlaylistByPointer(final long pTr) {
+		synchronized (lock) {
+			final Entry entry = byPointer.get(pTr);
+			return entry == null ? null : entry.playlist;
 		}
 	}
 
-	public static void clear() {
-		playlists.clear();
+	/**
+	 * Should only be called by the C library, when the playlist at the pointer left the container.
+	 */
+	public void removePlaylist(final long pTr) {
+		synchronized (lock) {
+			remove(byPointer.get(pTr));
+		}
+	}
+
+	public void removePlaylist(final String playlist) {
+		final Link link = Link.create(playlist);
+		synchronized (lock) {
+			remove(byLink.get(link));
+		}
+	}
+
+	public void clear() {
+		synchronized (lock) {
+			first = null;
+			last = null;
+			byPointer.clear();
+			byLink.clear();
+			byPlaylist.clear();
+			snapshot = Collections.emptyList();
+			structure = emptyStructure();
+		}
 	}
 
-	public static Playlist getPlaylist(final int index) {
+	public Playlist getPlaylist(final int index) {
+		final List<Playlist> playlists = getPlaylists();
 		if (index >= 0 && index < playlists.size())
 			return playlists.get(index);
 		return null;
 	}
 
-	public static Playlist getPlaylist(final Link playlist) {
-		return JahSpotifyImpl.getInstance().readPlaylist(playlist, 0, 0);
+	public Playlist getPlaylist(final Link playlist) {
+		return jahSpotify.readPlaylist(playlist, 0, 0);
+	}
+
+	/**
+	 * Returns the playlist of the container with the given link, null if there is none or it is
+	 * not loaded yet.
+	 */
+	public Playlist getContainedPlaylist(final Link playlist) {
+		synchronized (lock) {
+			final Entry entry = byLink.get(playlist);
+			return entry == null ? null : entry.playlist;
+		}
+	}
+
+	/**
+	 * @return An immutable snapshot of the playlists, in the order they were added.
+	 */
+	public List<Playlist> getPlaylists() {
+		List<Playlist> playlists = snapshot;
+		if (playlists != null)
+			return playlists;
+
+		synchronized (lock) {
+			if (snapshot == null) {
+				final List<Playlist> rebuilt = new ArrayList<Playlist>(byPlaylist.size());
+				for (Entry entry = first; entry != null; entry = entry.next)
+					rebuilt.add(entry.playlist);
+				snapshot = Collections.unmodifiableList(rebuilt);
+			}
+			return snapshot;
+		}
+	}
+
+	/**
+	 * @return The root folder of the container as of its last structure update.
+	 */
+	public PlaylistFolder getRootFolder() {
+		return structure.root;
+	}
+
+	/**
+	 * @return The folder holding the playlist, null if it is not in the container.
+	 */
+	public PlaylistFolder getFolder(final Playlist playlist) {
+		return structure.folders.get(playlist);
+	}
+
+	/**
+	 * Should only be called by the C library, with the items of the container in order. Folder ids
+	 * and names are only set for folder items, pointers only for playlists.
+	 */
+	public void setStructure(final int[] types, final long[] pTrs, final long[] folderIds, final String[] folderNames) {
+		final PlaylistFolder root = new PlaylistFolder(0, null, null);
+		final Map<Playlist, PlaylistFolder> folders = new IdentityHashMap<Playlist, PlaylistFolder>();
+		PlaylistFolder current = root;
+
+		synchronized (lock) {
+			for (int i = 0; i < types.length; i++) {
+				switch (types[i]) {
+				case TYPE_PLAYLIST:
+					final Entry entry = byPointer.get(pTrs[i]);
+					if (entry != null) {
+						current.add(entry.playlist);
+						folders.put(entry.playlist, current);
+					}
+					break;
+				case TYPE_START_FOLDER:
+					final PlaylistFolder folder = new PlaylistFolder(folderIds[i], folderNames[i], current);
+					current.add(folder);
+					current = folder;
+					break;
+				case TYPE_END_FOLDER:
+					if (!current.isRoot())
+						current = current.getParent();
+					break;
+				default:
+					break;
+				}
+			}
+			structure = new Structure(root, folders);
+		}
+	}
+
+	private void add(final Entry entry) {
+		entry.previous = last;
+		if (last != null)
+			last.next = entry;
+		else
+			first = entry;
+		last = entry;
+
+		if (entry.pTr != null)
+			byPointer.put(entry.pTr, entry);
+		byPlaylist.put(entry.playlist, entry);
+		snapshot = null;
+
+		// The link is only known once the playlist is loaded, the listener is called right away if it is
+		entry.playlist.addLoadableListener(new LoadableListener<Playlist>() {
+			@Override
+			public void loaded(final Playlist playlist) {
+				synchronized (lock) {
+					if (byPlaylist.get(playlist) == entry && playlist.getId() != null && entry.link == null) {
+						entry.link = playlist.getId();
+						byLink.put(entry.link, entry);
+					}
+				}
+			}
+		});
+	}
+
+	private void remove(final Entry entry) {
+		if (entry == null)
+			return;
+
+		if (entry.previous != null)
+			entry.previous.next = entry.next;
+		else
+			first = entry.next;
+		if (entry.next != null)
+			entry.next.previous = entry.previous;
+		else
+			last = entry.previous;
+
+		if (entry.pTr != null)
+			byPointer.remove(entry.pTr);
+		if (entry.link != null && byLink.get(entry.link) == entry)
+			byLink.remove(entry.link);
+		byPlaylist.remove(entry.playlist);
+		snapshot = null;
 	}
 
-	public static List<Playlist> getPlaylists() {
-		return new ArrayList<Playlist>(playlists);
+	private static Structure emptyStructure() {
+		return new Structure(new PlaylistFolder(0, null, null), Collections.<Playlist, PlaylistFolder>emptyMap());
 	}
 }
@@ -0,0 +1,91 @@
+package jahspotify.media;
+
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.List;
+
+/**
+ * A change to the tracks of a playlist, as reported by libspotify. Positions are those of the
+ * playlist before the change, including tracks which are not available.
+ */
+public class PlaylistDelta
+{
+    public enum Type
+    {
+        ADDED, REMOVED, MOVED
+    }
+
+    private final Type type;
+    private final int[] positions;
+    private final int position;
+    private final List<Link> tracks;
+
+    private PlaylistDelta(final Type type, final int[] positions, final int position, final List<Link> tracks)
+    {
+        this.type = type;
+        this.positions = positions;
+        this.position = position;
+        this.tracks = tracks;
+    }
+
+    /**
+     * Tracks inserted at a position, entries are null for tracks which are not available.
+     */
+    public static PlaylistDelta added(final int position, final List<Link> tracks)
+    {
+        return new PlaylistDelta(Type.ADDED, new int[0], position, Collections.unmodifiableList(tracks));
+    }
+
+    public static PlaylistDelta removed(final int[] positions)
+    {
+        return new PlaylistDelta(Type.REMOVED, positions.clone(), -1, Collections.<Link>emptyList());
+    }
+
+    /**
+     * Tracks moved in front of the track which was at the new position before the move.
+     */
+    public static PlaylistDelta moved(final int[] positions, final int newPosition)
+    {
+        return new PlaylistDelta(Type.MOVED, positions.clone(), newPosition, Collections.<Link>emptyList());
+    }
+
+    public Type getType()
+    {
+        return type;
+    }
+
+    /**
+     * @return Positions of the removed or moved tracks
+     */
+    public int[] getPositions()
+    {
+        return positions.clone();
+    }
+
+    /**
+     * @return Where tracks were added or moved to, -1 for removals
+     */
+    public int getPosition()
+    {
+        return position;
+    }
+
+    /**
+     * @return The added tracks
+     */
+    public List<Link> getTracks()
+    {
+        return tracks;
+    }
+
+    @Override
+    public String toString()
+    {
+        return "PlaylistDelta{" +
+                "type=" + type +
+                ", positions=" + Arrays.toString(positions) +
+                ", position=" + position +
+                ", tracks=" + tracks +
+                '}';
+    }
+}
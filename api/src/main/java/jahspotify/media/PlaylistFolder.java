@@ -0,0 +1,81 @@
+package jahspotify.media;
+
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.List;
+
+/**
+ * A folder of the playlist container. The root folder has id 0, no name and no parent.
+ * <p/>
+ * Folders are built by {@link PlaylistContainer} whenever the structure of the container changes
+ * and are not modified once they are published, so they can be read from any thread.
+ */
+public class PlaylistFolder
+{
+    private final long id;
+    private final String name;
+    private final PlaylistFolder parent;
+    private final List<PlaylistFolder> folders = new ArrayList<PlaylistFolder>();
+    private final List<Playlist> playlists = new ArrayList<Playlist>();
+
+    PlaylistFolder(final long id, final String name, final PlaylistFolder parent)
+    {
+        this.id = id;
+        this.name = name;
+        this.parent = parent;
+    }
+
+    void add(final PlaylistFolder folder)
+    {
+        folders.add(folder);
+    }
+
+    void add(final Playlist playlist)
+    {
+        playlists.add(playlist);
+    }
+
+    public long getId()
+    {
+        return id;
+    }
+
+    public String getName()
+    {
+        return name;
+    }
+
+    /**
+     * @return The folder holding this one, null for the root folder
+     */
+    public PlaylistFolder getParent()
+    {
+        return parent;
+    }
+
+    public boolean isRoot()
+    {
+        return parent == null;
+    }
+
+    public List<PlaylistFolder> getFolders()
+    {
+        return Collections.unmodifiableList(folders);
+    }
+
+    public List<Playlist> getPlaylists()
+    {
+        return Collections.unmodifiableList(playlists);
+    }
+
+    @Override
+    public String toString()
+    {
+        return "PlaylistFolder{" +
+                "id=" + id +
+                ", name='" + name + '\'' +
+                ", folders=" + folders.size() +
+                ", playlists=" + playlists.size() +
+                '}';
+    }
+}
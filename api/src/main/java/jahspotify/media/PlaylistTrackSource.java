@@ -0,0 +1,19 @@
+package jahspotify.media;
+
+import java.util.List;
+
+/**
+ * Reads further windows of tracks for a {@link Playlist} which was only partly materialized.
+ */
+public interface PlaylistTrackSource
+{
+    /**
+     * Read the tracks at the given positions of a playlist.
+     *
+     * @param playlist The link for the playlist in question
+     * @param index    Position of the first track to read
+     * @param count    Number of positions to read
+     * @return The tracks in that range, local and unavailable tracks are left out
+     */
+    public List<Link> readPlaylistTracks(Link playlist, int index, int count);
+}
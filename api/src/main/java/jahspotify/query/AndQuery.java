@@ -22,6 +22,16 @@ public class AndQuery extends Query
         return andQuery;
     }
 
+    public Query getLeft()
+    {
+        return _left;
+    }
+
+    public Query getRight()
+    {
+        return _right;
+    }
+
     @Override
     public String serialize()
     {
@@ -14,6 +14,11 @@ public class GenreQuery extends Query
         _genre = genre;
     }
 
+    public Genre getGenre()
+    {
+        return _genre;
+    }
+
     @Override
     public String serialize()
     {
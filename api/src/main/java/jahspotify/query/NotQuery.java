@@ -19,6 +19,11 @@ public class NotQuery extends Query
         return new NotQuery(query);
     }
 
+    public Query getQuery()
+    {
+        return _query;
+    }
+
     @Override
     public String serialize()
     {
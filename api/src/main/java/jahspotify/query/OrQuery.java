@@ -22,6 +22,16 @@ public class OrQuery extends Query
         return new OrQuery(left, right);
     }
 
+    public Query getLeft()
+    {
+        return _left;
+    }
+
+    public Query getRight()
+    {
+        return _right;
+    }
+
     @Override
     public String serialize()
     {
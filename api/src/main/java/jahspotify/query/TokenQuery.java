@@ -14,6 +14,11 @@ public class TokenQuery extends Query
         _token = token;
     }
 
+    public String getToken()
+    {
+        return _token;
+    }
+
     @Override
     public String serialize()
     {
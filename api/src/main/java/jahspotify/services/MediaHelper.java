@@ -1,10 +1,10 @@
 package jahspotify.services;
 
+import jahspotify.media.AbstractLoadable;
 import jahspotify.media.Loadable;
 
-import java.util.ArrayList;
 import java.util.Collection;
-import java.util.List;
+import java.util.concurrent.TimeUnit;
 
 /**
  * Helper class to wait for the loading of loadable types.
@@ -18,16 +18,7 @@ public class MediaHelper {
 	 * @return true if the loadable has been loaded.
 	 */
 	public static boolean waitFor(Loadable m, int maxSeconds) {
-		for (int i = 0; i < maxSeconds * 100; i++) {
-			if (m.isLoaded())
-				return true;
-			try {
-				Thread.sleep(10);
-			} catch (InterruptedException e) {
-				e.printStackTrace();
-			}
-		}
-		return false;
+		return waitUntil(m, deadline(maxSeconds));
 	}
 
 	/**
@@ -37,22 +28,32 @@ public class MediaHelper {
 	 * @return true if the all loadables have been loaded.
 	 */
 	public static boolean waitFor(Collection<? extends Loadable> _ms, int maxSeconds) {
-		List<Loadable> ms = new ArrayList<Loadable>(_ms);
+		// All loadables share the deadline, so waiting for them in turn takes no longer than the slowest
+		final long deadline = deadline(maxSeconds);
+		for (Loadable m : _ms) {
+			if (!waitUntil(m, deadline))
+				return false;
+		}
+		return true;
+	}
 
-		for (int i = 0; i < maxSeconds * 100; i++) {
-			for (int j = ms.size() - 1; j >= 0; j--)
-				if (ms.get(j).isLoaded())
-					ms.remove(j);
-			if (ms.size() == 0)
-				return true;
+	private static long deadline(int maxSeconds) {
+		return System.nanoTime() + TimeUnit.SECONDS.toNanos(maxSeconds);
+	}
 
-			try {
+	/**
+	 * Waits on the loadable itself when it supports that, other loadables are polled.
+	 */
+	private static boolean waitUntil(Loadable m, long deadline) {
+		try {
+			if (m instanceof AbstractLoadable)
+				return ((AbstractLoadable<?>) m).waitForLoaded(deadline - System.nanoTime(), TimeUnit.NANOSECONDS);
+
+			while (!m.isLoaded() && deadline - System.nanoTime() > 0)
 				Thread.sleep(10);
-			} catch (InterruptedException e) {
-				e.printStackTrace();
-			}
+		} catch (InterruptedException e) {
+			Thread.currentThread().interrupt();
 		}
-
-		return false;
+		return m.isLoaded();
 	}
 }
@@ -2,7 +2,7 @@ package jahspotify.services;
 
 import jahspotify.JahSpotify;
 import jahspotify.Search;
-import jahspotify.SearchListener;
+import jahspotify.SearchErrorListener;
 import jahspotify.SearchResult;
 
 import java.util.concurrent.ArrayBlockingQueue;
@@ -14,6 +14,11 @@ import java.util.concurrent.TimeUnit;
  */
 public class SearchEngine
 {
+    /**
+     * Put in the queue when a search fails, so the waiting thread returns right away.
+     */
+    private static final SearchResult FAILED = new SearchResult();
+
     private JahSpotifyService _jahSpotifyService = JahSpotifyService.getInstance();
 
     private JahSpotify _jahSpotify;
@@ -37,23 +42,29 @@ public class SearchEngine
         try
         {
             final BlockingQueue<SearchResult> resultQueue = new ArrayBlockingQueue<SearchResult>(1);
-            _jahSpotify.initiateSearch(search, new SearchListener()
+            final SearchErrorListener listener = new SearchErrorListener()
             {
                 @Override
                 public void searchComplete(final SearchResult searchResult)
                 {
-                    try
-                    {
-                        searchResult.setLoaded(true);
-                        resultQueue.put(searchResult);
-                    }
-                    catch (InterruptedException e)
-                    {
-                        e.printStackTrace();
-                    }
+                    searchResult.setLoaded(true);
+                    resultQueue.offer(searchResult);
+                }
+
+                @Override
+                public void searchFailed(final String message)
+                {
+                    resultQueue.offer(FAILED);
                 }
-            });
-            return resultQueue.poll(10, TimeUnit.SECONDS);
+            };
+            _jahSpotify.initiateSearch(search, listener);
+
+            final SearchResult result = resultQueue.poll(10, TimeUnit.SECONDS);
+            if (result == null)
+            {
+                _jahSpotify.cancelSearch(listener);
+            }
+            return result == FAILED ? null : result;
         }
         catch (Exception e)
         {
@@ -63,4 +74,15 @@ public class SearchEngine
 
     }
 
+    /**
+     * Pages through the results of a search, fetching the next page while the current one is used.
+     *
+     * @param search     The query and the result types wanted, those with a number above 0.
+     * @param maxResults Maximum number of results of each type over all pages.
+     */
+    public SearchPages pages(Search search, int maxResults)
+    {
+        return new SearchPages(_jahSpotify, search, maxResults);
+    }
+
 }
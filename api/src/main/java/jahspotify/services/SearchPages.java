@@ -0,0 +1,249 @@
+package jahspotify.services;
+
+import jahspotify.JahSpotify;
+import jahspotify.Search;
+import jahspotify.SearchErrorListener;
+import jahspotify.SearchResult;
+
+import java.util.Iterator;
+import java.util.NoSuchElementException;
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.TimeUnit;
+
+/**
+ * Iterates over the results of a search page by page. The next page is requested as soon as the
+ * current one arrives, so it usually loads while the caller works through the current one.
+ * <p/>
+ * Pages start small so the first results show up quickly and grow while libspotify answers fast,
+ * shrinking again when pages get slow. Tracks, albums, artists and playlists are paged together,
+ * each until all its results or the cap are reached. {@link #hasNext()} blocks until the next
+ * page has arrived.
+ */
+public class SearchPages implements Iterator<SearchResult>
+{
+    private static final int MIN_PAGE_SIZE = 10;
+    private static final int MAX_PAGE_SIZE = 200;
+
+    /**
+     * Milliseconds above which a page is considered slow and the page size is halved, pages taking
+     * less than half of it double the size.
+     */
+    private static final long SLOW_PAGE = 2000;
+
+    /**
+     * Seconds to wait for a page before giving up.
+     */
+    private static final int PAGE_TIMEOUT = 10;
+
+    private static final int TRACKS = 0;
+    private static final int ALBUMS = 1;
+    private static final int ARTISTS = 2;
+    private static final int PLAYLISTS = 3;
+    private static final int TYPES = 4;
+
+    private final JahSpotify jahSpotify;
+    private final Search template;
+    private final boolean[] wanted = new boolean[TYPES];
+    private final int[] offsets = new int[TYPES];
+    private final int[] ends = new int[TYPES];
+    private final int[] totals = { -1, -1, -1, -1 };
+    private int pageSize = MIN_PAGE_SIZE;
+
+    private Page pending;
+    private SearchResult next;
+
+    /**
+     * @param search     The query, whether to suggest and the result types wanted: those with a
+     *                   number of results above 0. The offsets are where paging starts.
+     * @param maxResults Maximum number of results of each type over all pages.
+     */
+    public SearchPages(final JahSpotify jahSpotify, final Search search, final int maxResults)
+    {
+        this.jahSpotify = jahSpotify;
+        this.template = search;
+
+        wanted[TRACKS] = search.getNumTracks() > 0;
+        wanted[ALBUMS] = search.getNumAlbums() > 0;
+        wanted[ARTISTS] = search.getNumArtists() > 0;
+        wanted[PLAYLISTS] = search.getNumPlaylists() > 0;
+        offsets[TRACKS] = search.getTrackOffset();
+        offsets[ALBUMS] = search.getAlbumOffset();
+        offsets[ARTISTS] = search.getArtistOffset();
+        offsets[PLAYLISTS] = search.getPlaylistOffset();
+        for (int type = 0; type < TYPES; type++)
+        {
+            ends[type] = offsets[type] + maxResults;
+        }
+
+        pending = request();
+    }
+
+    @Override
+    public boolean hasNext()
+    {
+        if (next != null)
+        {
+            return true;
+        }
+        if (pending == null)
+        {
+            return false;
+        }
+
+        final Page page = pending;
+        pending = null;
+        try
+        {
+            if (!page.done.await(PAGE_TIMEOUT, TimeUnit.SECONDS))
+            {
+                jahSpotify.cancelSearch(page);
+                return false;
+            }
+        }
+        catch (InterruptedException e)
+        {
+            jahSpotify.cancelSearch(page);
+            Thread.currentThread().interrupt();
+            return false;
+        }
+        if (page.result == null)
+        {
+            return false;
+        }
+
+        advance(page);
+        next = page.result;
+        pending = request();
+        return true;
+    }
+
+    @Override
+    public SearchResult next()
+    {
+        if (!hasNext())
+        {
+            throw new NoSuchElementException();
+        }
+        final SearchResult result = next;
+        next = null;
+        return result;
+    }
+
+    @Override
+    public void remove()
+    {
+        throw new UnsupportedOperationException();
+    }
+
+    /**
+     * Stops paging, cancelling the page being fetched.
+     */
+    public void close()
+    {
+        if (pending != null)
+        {
+            jahSpotify.cancelSearch(pending);
+            pending = null;
+        }
+        next = null;
+    }
+
+    /**
+     * @return Number of results requested per type with each page from now on.
+     */
+    public int getPageSize()
+    {
+        return pageSize;
+    }
+
+    /**
+     * Requests the next page, or returns null if every wanted type has been paged through.
+     */
+    private Page request()
+    {
+        final int[] counts = new int[TYPES];
+        boolean any = false;
+        for (int type = 0; type < TYPES; type++)
+        {
+            final int end = totals[type] < 0 ? ends[type] : Math.min(ends[type], totals[type]);
+            counts[type] = wanted[type] ? Math.max(0, Math.min(pageSize, end - offsets[type])) : 0;
+            any |= counts[type] > 0;
+        }
+        if (!any)
+        {
+            return null;
+        }
+
+        final Search search = new Search(template.getQuery());
+        search.setSuggest(template.isSuggest());
+        search.setTrackOffset(offsets[TRACKS]);
+        search.setNumTracks(counts[TRACKS]);
+        search.setAlbumOffset(offsets[ALBUMS]);
+        search.setNumAlbums(counts[ALBUMS]);
+        search.setArtistOffset(offsets[ARTISTS]);
+        search.setNumArtists(counts[ARTISTS]);
+        search.setPlaylistOffset(offsets[PLAYLISTS]);
+        search.setNumPlaylists(counts[PLAYLISTS]);
+
+        final Page page = new Page(counts);
+        jahSpotify.initiateSearch(search, page);
+        return page;
+    }
+
+    /**
+     * Moves past the page and adapts the page size to how long it took.
+     */
+    private void advance(final Page page)
+    {
+        final SearchResult result = page.result;
+        totals[TRACKS] = result.getTotalNumTracks();
+        totals[ALBUMS] = result.getTotalNumAlbums();
+        totals[ARTISTS] = result.getTotalNumArtists();
+        totals[PLAYLISTS] = result.getTotalNumPlaylists();
+        for (int type = 0; type < TYPES; type++)
+        {
+            // Unavailable tracks are left out of results, so move on by what was asked for
+            offsets[type] += page.counts[type];
+        }
+
+        final long latency = page.completed - page.started;
+        if (latency < SLOW_PAGE / 2)
+        {
+            pageSize = Math.min(MAX_PAGE_SIZE, pageSize * 2);
+        }
+        else if (latency > SLOW_PAGE)
+        {
+            pageSize = Math.max(MIN_PAGE_SIZE, pageSize / 2);
+        }
+    }
+
+    private static class Page implements SearchErrorListener
+    {
+        final int[] counts;
+        final long started = System.currentTimeMillis();
+        final CountDownLatch done = new CountDownLatch(1);
+        volatile long completed;
+        volatile SearchResult result;
+
+        Page(final int[] counts)
+        {
+            this.counts = counts;
+        }
+
+        @Override
+        public void searchComplete(final SearchResult searchResult)
+        {
+            searchResult.setLoaded(true);
+            completed = System.currentTimeMillis();
+            result = searchResult;
+            done.countDown();
+        }
+
+        @Override
+        public void searchFailed(final String message)
+        {
+            completed = System.currentTimeMillis();
+            done.countDown();
+        }
+    }
+}
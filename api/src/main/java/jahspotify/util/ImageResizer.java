@@ -0,0 +1,161 @@
+package jahspotify.util;
+
+import java.awt.image.BufferedImage;
+import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+
+import javax.imageio.ImageIO;
+
+/**
+ * Class providing methods to scale images down into thumbnails.
+ * <p/>
+ * Scaling averages every source pixel covered by a target pixel, weighted by the covered area, so
+ * thumbnails of covers stay sharp without the aliasing of nearest neighbour scaling. Rows and
+ * columns are scaled in two separate passes over plain int arrays of the pixels.
+ */
+public class ImageResizer
+{
+    /**
+     * Scales an encoded image so that neither side is larger than the given size, keeping its
+     * aspect ratio.
+     *
+     * @param bytes   The encoded image, usually a JPEG as returned by libspotify.
+     * @param maxSize Maximum width and height of the thumbnail in pixels.
+     * @return The thumbnail encoded as JPEG, the given bytes if the image is already small enough or
+     *         null if the image could not be decoded.
+     */
+    public static byte[] thumbnail(final byte[] bytes, final int maxSize) throws IOException
+    {
+        final BufferedImage source = ImageIO.read(new ByteArrayInputStream(bytes));
+        if (source == null)
+        {
+            return null;
+        }
+
+        final int width = source.getWidth();
+        final int height = source.getHeight();
+        if (width <= maxSize && height <= maxSize)
+        {
+            return bytes;
+        }
+
+        final double scale = (double) maxSize / Math.max(width, height);
+        final BufferedImage target = scale(source,
+                Math.max(1, (int) Math.round(width * scale)),
+                Math.max(1, (int) Math.round(height * scale)));
+
+        final ByteArrayOutputStream baos = new ByteArrayOutputStream();
+        ImageIO.write(target, "JPG", baos);
+        return baos.toByteArray();
+    }
+
+    /**
+     * Scales an image down to the given size by area averaging. Alpha is dropped.
+     *
+     * @param source The image to scale.
+     * @param width  Width of the result, at most the width of the source.
+     * @param height Height of the result, at most the height of the source.
+     * @return The scaled image.
+     */
+    public static BufferedImage scale(final BufferedImage source, final int width, final int height)
+    {
+        final int sourceWidth = source.getWidth();
+        final int sourceHeight = source.getHeight();
+        if (width < 1 || height < 1 || width > sourceWidth || height > sourceHeight)
+        {
+            throw new IllegalArgumentException("Can only scale down, got " + width + "x" + height + " from " + sourceWidth + "x" + sourceHeight);
+        }
+
+        final int[] pixels = source.getRGB(0, 0, sourceWidth, sourceHeight, null, 0, sourceWidth);
+        final Weights columns = new Weights(sourceWidth, width);
+        final Weights rows = new Weights(sourceHeight, height);
+
+        // Horizontal pass: every source row is reduced to the target width, three channels per pixel
+        final float[] reduced = new float[sourceHeight * width * 3];
+        for (int y = 0; y < sourceHeight; y++)
+        {
+            final int row = y * sourceWidth;
+            int out = y * width * 3;
+            for (int x = 0; x < width; x++, out += 3)
+            {
+                float r = 0, g = 0, b = 0;
+                for (int i = columns.first[x], k = columns.offset[x]; i <= columns.last[x]; i++, k++)
+                {
+                    final int pixel = pixels[row + i];
+                    final float weight = columns.weights[k];
+                    r += ((pixel >> 16) & 0xff) * weight;
+                    g += ((pixel >> 8) & 0xff) * weight;
+                    b += (pixel & 0xff) * weight;
+                }
+                reduced[out] = r;
+                reduced[out + 1] = g;
+                reduced[out + 2] = b;
+            }
+        }
+
+        // Vertical pass: the reduced rows are combined into the target rows
+        final int[] result = new int[width * height];
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                float r = 0, g = 0, b = 0;
+                for (int j = rows.first[y], k = rows.offset[y]; j <= rows.last[y]; j++, k++)
+                {
+                    final int in = (j * width + x) * 3;
+                    final float weight = rows.weights[k];
+                    r += reduced[in] * weight;
+                    g += reduced[in + 1] * weight;
+                    b += reduced[in + 2] * weight;
+                }
+                result[y * width + x] = (channel(r) << 16) | (channel(g) << 8) | channel(b);
+            }
+        }
+
+        final BufferedImage target = new BufferedImage(width, height, BufferedImage.TYPE_INT_RGB);
+        target.setRGB(0, 0, width, height, result, 0, width);
+        return target;
+    }
+
+    private static int channel(final float value)
+    {
+        final int rounded = Math.round(value);
+        return rounded < 0 ? 0 : (rounded > 255 ? 255 : rounded);
+    }
+
+    /**
+     * For every target pixel along one axis, the range of source pixels it covers and the share of
+     * each, which add up to one.
+     */
+    private static class Weights
+    {
+        final int[] first;
+        final int[] last;
+        final int[] offset;
+        final float[] weights;
+
+        Weights(final int sourceSize, final int targetSize)
+        {
+            final double scale = (double) sourceSize / targetSize;
+            first = new int[targetSize];
+            last = new int[targetSize];
+            offset = new int[targetSize];
+            weights = new float[targetSize * ((int) Math.ceil(scale) + 2)];
+
+            int k = 0;
+            for (int t = 0; t < targetSize; t++)
+            {
+                final double start = t * scale;
+                final double end = Math.min(sourceSize, (t + 1) * scale);
+                first[t] = (int) start;
+                last[t] = Math.min(sourceSize - 1, (int) Math.ceil(end) - 1);
+                offset[t] = k;
+                for (int i = first[t]; i <= last[t]; i++)
+                {
+                    weights[k++] = (float) ((Math.min(end, i + 1) - Math.max(start, i)) / scale);
+                }
+            }
+        }
+    }
+}
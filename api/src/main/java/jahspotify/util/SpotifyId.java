@@ -0,0 +1,194 @@
+package jahspotify.util;
+
+import java.util.Arrays;
+
+/**
+ * Converts the 128-bit ids of Spotify artists, albums, tracks and playlists between their
+ * base-62 and hexadecimal forms. Ids are held in two longs, most significant half first, and
+ * converted with lookup tables.
+ * <p/>
+ * The digits are the same as those of {@link BaseConvert}, base-62 ids are left padded with
+ * zeroes to 22 characters and hexadecimal ids to 32.
+ */
+public class SpotifyId
+{
+    /**
+     * Number of characters in a base-62 id.
+     */
+    public static final int BASE62_LENGTH = 22;
+
+    /**
+     * Number of characters in a hexadecimal id.
+     */
+    public static final int HEX_LENGTH = 32;
+
+    private static final char[] BASE62_DIGITS =
+            "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ".toCharArray();
+
+    private static final char[] HEX_DIGITS = "0123456789abcdef".toCharArray();
+
+    /**
+     * Value of each ASCII character as a base-62 digit, -1 if it is not one.
+     */
+    private static final byte[] BASE62_VALUES = new byte[128];
+
+    /**
+     * Value of each ASCII character as a hexadecimal digit in either case, -1 if it is not one.
+     */
+    private static final byte[] HEX_VALUES = new byte[128];
+
+    static
+    {
+        Arrays.fill(BASE62_VALUES, (byte) -1);
+        Arrays.fill(HEX_VALUES, (byte) -1);
+        for (int i = 0; i < BASE62_DIGITS.length; i++)
+        {
+            BASE62_VALUES[BASE62_DIGITS[i]] = (byte) i;
+        }
+        for (int i = 0; i < HEX_DIGITS.length; i++)
+        {
+            HEX_VALUES[HEX_DIGITS[i]] = (byte) i;
+            HEX_VALUES[Character.toUpperCase(HEX_DIGITS[i])] = (byte) i;
+        }
+    }
+
+    private SpotifyId()
+    {
+    }
+
+    /**
+     * Encode an id in base 62.
+     *
+     * @param high The most significant 64 bits of the id.
+     * @param low  The least significant 64 bits of the id.
+     * @return A 22 character base-62 id.
+     */
+    public static String toBase62(final long high, final long low)
+    {
+        final char[] result = new char[BASE62_LENGTH];
+
+        /* Divide the id by 62 one 32-bit limb at a time, the remainders are the digits. */
+        long limb0 = high >>> 32, limb1 = high & 0xffffffffL, limb2 = low >>> 32, limb3 = low & 0xffffffffL;
+
+        for (int i = BASE62_LENGTH - 1; i >= 0; i--)
+        {
+            long remainder = limb0 % 62;
+            limb0 /= 62;
+
+            long current = (remainder << 32) | limb1;
+            limb1 = current / 62;
+            remainder = current % 62;
+
+            current = (remainder << 32) | limb2;
+            limb2 = current / 62;
+            remainder = current % 62;
+
+            current = (remainder << 32) | limb3;
+            limb3 = current / 62;
+            result[i] = BASE62_DIGITS[(int) (current % 62)];
+        }
+
+        return new String(result);
+    }
+
+    /**
+     * Decode a base-62 id.
+     *
+     * @param source The characters holding the id.
+     * @param offset Index of the first of its 22 characters.
+     * @return The most and least significant 64 bits of the id.
+     * @throws IllegalArgumentException If the characters are not a base-62 id.
+     */
+    public static long[] fromBase62(final CharSequence source, final int offset)
+    {
+        if (offset < 0 || source.length() - offset < BASE62_LENGTH)
+        {
+            throw new IllegalArgumentException("Too short for a base-62 id: " + source);
+        }
+
+        long limb0 = 0, limb1 = 0, limb2 = 0, limb3 = 0;
+
+        for (int i = offset; i < offset + BASE62_LENGTH; i++)
+        {
+            final int digit = digit(BASE62_VALUES, source.charAt(i));
+            if (digit < 0)
+            {
+                throw new IllegalArgumentException("Not a base-62 id: " + source);
+            }
+
+            /* Multiply the id by 62 and add the digit, carrying from the least significant limb. */
+            long current = limb3 * 62 + digit;
+            limb3 = current & 0xffffffffL;
+            current = limb2 * 62 + (current >>> 32);
+            limb2 = current & 0xffffffffL;
+            current = limb1 * 62 + (current >>> 32);
+            limb1 = current & 0xffffffffL;
+            current = limb0 * 62 + (current >>> 32);
+            limb0 = current & 0xffffffffL;
+
+            if ((current >>> 32) != 0)
+            {
+                throw new IllegalArgumentException("Base-62 id does not fit 128 bits: " + source);
+            }
+        }
+
+        return new long[] { (limb0 << 32) | limb1, (limb2 << 32) | limb3 };
+    }
+
+    /**
+     * Encode an id as 32 lower case hexadecimal characters.
+     *
+     * @param high The most significant 64 bits of the id.
+     * @param low  The least significant 64 bits of the id.
+     * @return A 32 character hexadecimal id.
+     */
+    public static String toHex(final long high, final long low)
+    {
+        final char[] result = new char[HEX_LENGTH];
+
+        for (int i = 0; i < 16; i++)
+        {
+            result[15 - i] = HEX_DIGITS[(int) (high >>> (i * 4)) & 0xf];
+            result[31 - i] = HEX_DIGITS[(int) (low >>> (i * 4)) & 0xf];
+        }
+
+        return new String(result);
+    }
+
+    /**
+     * Decode a hexadecimal id.
+     *
+     * @param source The characters holding the id.
+     * @param offset Index of the first of its 32 characters.
+     * @return The most and least significant 64 bits of the id.
+     * @throws IllegalArgumentException If the characters are not a hexadecimal id.
+     */
+    public static long[] fromHex(final CharSequence source, final int offset)
+    {
+        if (offset < 0 || source.length() - offset < HEX_LENGTH)
+        {
+            throw new IllegalArgumentException("Too short for a hexadecimal id: " + source);
+        }
+
+        long high = 0, low = 0;
+
+        for (int i = 0; i < 16; i++)
+        {
+            final int highDigit = digit(HEX_VALUES, source.charAt(offset + i));
+            final int lowDigit = digit(HEX_VALUES, source.charAt(offset + 16 + i));
+            if (highDigit < 0 || lowDigit < 0)
+            {
+                throw new IllegalArgumentException("Not a hexadecimal id: " + source);
+            }
+            high = (high << 4) | highDigit;
+            low = (low << 4) | lowDigit;
+        }
+
+        return new long[] { high, low };
+    }
+
+    private static int digit(final byte[] values, final char c)
+    {
+        return c < values.length ? values[c] : -1;
+    }
+}
@@ -0,0 +1,132 @@
+package jahspotify.impl;
+
+import jahspotify.Query;
+import jahspotify.query.Genre;
+import jahspotify.query.GenreQuery;
+import jahspotify.query.YearQuery;
+
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.Locale;
+
+import junit.framework.TestCase;
+
+import static jahspotify.Query.*;
+
+/**
+ * Checks queries are combined and tags are read as the native index expects.
+ */
+public class TestLibraryIndex extends TestCase
+{
+    private static final String[][] TRACKS = {
+            { "One More Time", "Daft Punk", "Discovery" },
+            { "Digital Love", "Daft Punk", "Discovery" },
+            { "Army of Me", "Bjork", "Post" },
+            { "Da Funk", "Daft Punk", "Homework" },
+    };
+
+    /**
+     * Matches the terms of the tracks above like the native index does.
+     */
+    private static class Terms implements LibraryIndex.Postings
+    {
+        final List<String> texts = new ArrayList<String>();
+
+        @Override
+        public int[] match(final int fields, final String text)
+        {
+            texts.add(fields + ":" + text);
+            final List<Integer> docs = new ArrayList<Integer>();
+            for (int doc = 0; doc < TRACKS.length; doc++)
+            {
+                if (matches(doc, fields, text))
+                {
+                    docs.add(doc);
+                }
+            }
+            final int[] result = new int[docs.size()];
+            for (int i = 0; i < result.length; i++)
+            {
+                result[i] = docs.get(i);
+            }
+            return result;
+        }
+
+        private static boolean matches(final int doc, final int fields, final String text)
+        {
+            for (String term : terms(text))
+            {
+                boolean found = false;
+                for (int field = 0; field < 3; field++)
+                {
+                    found |= (fields & (1 << field)) != 0 && terms(TRACKS[doc][field]).contains(term);
+                }
+                if (!found)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        private static List<String> terms(final String text)
+        {
+            final List<String> terms = new ArrayList<String>();
+            for (String term : text.toLowerCase(Locale.ENGLISH).split("[^a-z0-9]+"))
+            {
+                if (term.length() > 0)
+                {
+                    terms.add(term);
+                }
+            }
+            return terms;
+        }
+    }
+
+    private final Terms terms = new Terms();
+    private final LibraryIndex index = new LibraryIndex(terms);
+
+    private void assertDocs(final Query query, final int... expected)
+    {
+        assertEquals(query.serialize(), Arrays.toString(expected), Arrays.toString(index.evaluate(query)));
+    }
+
+    public void testTokens() throws Exception
+    {
+        assertDocs(token("daft"), 0, 1, 3);
+        assertDocs(token("daft love"), 1);
+        assertDocs(token(""), 0, 1, 2, 3);
+        assertDocs(artist("Daft Punk"), 0, 1, 3);
+        assertDocs(token("track:funk"), 3);
+        assertDocs(token("album:funk"));
+        assertEquals(LibraryIndex.ARTIST + ":\"Daft Punk\"", terms.texts.get(terms.texts.size() - 3));
+    }
+
+    public void testOperators() throws Exception
+    {
+        assertDocs(artist("daft punk").and(token("discovery")), 0, 1);
+        assertDocs(token("army").or(token("funk")), 2, 3);
+        assertDocs(not(token("discovery")), 2, 3);
+        assertDocs(artist("daft punk").and(not(token("discovery"))), 3);
+        assertDocs(not(token("discovery")).and(artist("daft punk")), 3);
+        assertDocs(not(token("daft").or(token("post"))));
+    }
+
+    public void testUnindexedCriteria() throws Exception
+    {
+        assertDocs(new YearQuery(2001));
+        assertDocs(new GenreQuery(Genre.values()[0]));
+        assertDocs(token("army").or(new YearQuery(2001)), 2);
+    }
+
+    public void testSetOperations() throws Exception
+    {
+        final int[] a = { 1, 3, 5, 7 };
+        final int[] b = { 3, 4, 7, 9 };
+        assertEquals("[3, 7]", Arrays.toString(LibraryIndex.intersect(a, b)));
+        assertEquals("[1, 3, 4, 5, 7, 9]", Arrays.toString(LibraryIndex.union(a, b)));
+        assertEquals("[1, 5]", Arrays.toString(LibraryIndex.difference(a, b)));
+        assertEquals("[artist:\"Daft Punk\", AND, x]", LibraryIndex.split(" artist:\"Daft Punk\"  AND x").toString());
+    }
+}
@@ -0,0 +1,180 @@
+package jahspotify.impl;
+
+import jahspotify.media.Album;
+import jahspotify.media.AlbumType;
+import jahspotify.media.Artist;
+import jahspotify.media.Link;
+import jahspotify.media.Track;
+
+import java.nio.ByteBuffer;
+
+import junit.framework.TestCase;
+
+/**
+ * Checks records laid out the way the native media_record_write() does decode to the right
+ * fields.
+ */
+public class TestMediaRecord extends TestCase
+{
+    private static final long ALBUM_HIGH = 0x7dce3254de7c4230L;
+    private static final long ALBUM_LOW = 0xa75a3e8f56794da7L;
+
+    private static final long TRACK_HIGH = 0x0123456789abcdefL;
+    private static final long TRACK_LOW = 0xfedcba9876543210L;
+
+    private static final long ARTIST_HIGH = 0x8000000000000001L;
+    private static final long ARTIST_LOW = 0x00000000ffffffffL;
+
+    private static final String COVER = "spotify:image:0123456789abcdef0123456789abcdef01234567";
+
+    /**
+     * Writes records to native memory in the layout documented on {@link MediaRecord}.
+     */
+    private static class Writer
+    {
+        final ByteBuffer buffer = ByteBuffer.allocateDirect(1024);
+
+        Writer header(final int kind, final int numArtists, final int first, final int second, final int third)
+        {
+            buffer.put((byte) kind);
+            buffer.put((byte) 0);
+            buffer.putShort((short) numArtists);
+            buffer.putInt(first);
+            buffer.putInt(second);
+            buffer.putInt(third);
+            return this;
+        }
+
+        Writer string(final String str) throws Exception
+        {
+            if (str == null)
+            {
+                buffer.putShort((short) MediaRecord.MISSING);
+                return this;
+            }
+            final byte[] bytes = str.getBytes("UTF-8");
+            buffer.putShort((short) bytes.length);
+            buffer.put(bytes);
+            return this;
+        }
+
+        Writer id(final int kind, final long high, final long low)
+        {
+            buffer.put((byte) kind);
+            buffer.putLong(high);
+            buffer.putLong(low);
+            return this;
+        }
+
+        Writer uri(final String uri) throws Exception
+        {
+            buffer.put((byte) MediaRecord.LINK_URI);
+            return string(uri);
+        }
+
+        Writer none()
+        {
+            buffer.put((byte) MediaRecord.LINK_NONE);
+            return this;
+        }
+
+        ByteBuffer done()
+        {
+            buffer.flip();
+            return buffer;
+        }
+    }
+
+    public void testHeaderSize() throws Exception
+    {
+        // MEDIA_RECORD_HEADER_SIZE on the native side
+        assertEquals("bad header size", 16, new Writer().header(MediaRecord.KIND_ARTIST, 0, 0, 0, 0).done().remaining());
+    }
+
+    public void testTrack() throws Exception
+    {
+        final ByteBuffer record = new Writer()
+                .header(MediaRecord.KIND_TRACK, 2, 215000, 67, 4)
+                .id(MediaRecord.KIND_TRACK, TRACK_HIGH, TRACK_LOW)
+                .string("Caf\u00e9 del Mar")
+                .id(MediaRecord.KIND_ALBUM, ALBUM_HIGH, ALBUM_LOW)
+                .none()
+                .id(MediaRecord.KIND_ARTIST, ARTIST_HIGH, ARTIST_LOW)
+                .uri("spotify:local:artist:album:title:123")
+                .done();
+
+        final Track track = new Track();
+        MediaRecord.decode(track, record);
+
+        assertFalse("record not consumed", record.hasRemaining());
+        assertSame("bad id", Link.create(Link.Type.TRACK, TRACK_HIGH, TRACK_LOW), track.getId());
+        assertEquals("bad title", "Caf\u00e9 del Mar", track.getTitle());
+        assertEquals("bad length", 215000, track.getLength());
+        assertEquals("bad popularity", 67, track.getPopularity());
+        assertEquals("bad track number", 4, track.getTrackNumber());
+        assertEquals("bad album", "spotify:album:3PogVmhNucYNfyywZvTd7F", track.getAlbum().asString());
+        assertEquals("bad number of artists", 2, track.getArtists().size());
+        assertSame("bad artist", Link.create(Link.Type.ARTIST, ARTIST_HIGH, ARTIST_LOW), track.getArtists().get(0));
+        assertEquals("bad artist", Link.create("spotify:local:artist:album:title:123"), track.getArtists().get(1));
+    }
+
+    public void testAlbum() throws Exception
+    {
+        final ByteBuffer record = new Writer()
+                .header(MediaRecord.KIND_ALBUM, 0, 1997, AlbumType.COMPILATION.ordinal(), 0)
+                .id(MediaRecord.KIND_ALBUM, ALBUM_HIGH, ALBUM_LOW)
+                .string("Homework")
+                .id(MediaRecord.KIND_ARTIST, ARTIST_HIGH, ARTIST_LOW)
+                .uri(COVER)
+                .done();
+
+        final Album album = new Album();
+        MediaRecord.decode(album, record);
+
+        assertFalse("record not consumed", record.hasRemaining());
+        assertEquals("bad id", "spotify:album:3PogVmhNucYNfyywZvTd7F", album.getId().asString());
+        assertEquals("bad name", "Homework", album.getName());
+        assertEquals("bad year", 1997, album.getYear());
+        assertEquals("bad type", AlbumType.COMPILATION, album.getType());
+        assertSame("bad artist", Link.create(Link.Type.ARTIST, ARTIST_HIGH, ARTIST_LOW), album.getArtist());
+        assertEquals("bad cover", COVER, album.getCover().asString());
+    }
+
+    public void testArtistWithMissingFields() throws Exception
+    {
+        final ByteBuffer record = new Writer()
+                .header(MediaRecord.KIND_ARTIST, 0, 0, 0, 0)
+                .none()
+                .string(null)
+                .none()
+                .none()
+                .done();
+
+        final Artist artist = new Artist();
+        MediaRecord.decode(artist, record);
+
+        assertFalse("record not consumed", record.hasRemaining());
+        assertNull("id made up", artist.getId());
+        assertNull("name made up", artist.getName());
+    }
+
+    public void testUnknownKind() throws Exception
+    {
+        final ByteBuffer record = new Writer()
+                .header(0, 0, 0, 0, 0)
+                .none()
+                .string("")
+                .none()
+                .none()
+                .done();
+
+        try
+        {
+            MediaRecord.decode(new Artist(), record);
+            fail("decoded an unknown kind");
+        }
+        catch (IllegalArgumentException e)
+        {
+        }
+    }
+}
@@ -0,0 +1,118 @@
+package jahspotify.impl;
+
+import jahspotify.SearchErrorListener;
+import jahspotify.SearchListener;
+import jahspotify.SearchResult;
+import jahspotify.impl.JahSpotifyImpl.NativeSearchParameters;
+
+import java.util.ArrayList;
+import java.util.List;
+
+import junit.framework.TestCase;
+
+/**
+ * Checks identical searches share one search and recent results are handed out again.
+ */
+public class TestSearchCache extends TestCase
+{
+    private static class Recorder implements SearchErrorListener
+    {
+        final List<SearchResult> results = new ArrayList<SearchResult>();
+        final List<String> failures = new ArrayList<String>();
+
+        @Override
+        public void searchComplete(final SearchResult searchResult)
+        {
+            results.add(searchResult);
+        }
+
+        @Override
+        public void searchFailed(final String message)
+        {
+            failures.add(message);
+        }
+    }
+
+    private static SearchCache.Key key(final String query, final int trackOffset)
+    {
+        final NativeSearchParameters parameters = new NativeSearchParameters();
+        parameters._query = query;
+        parameters.trackOffset = trackOffset;
+        return new SearchCache.Key(parameters);
+    }
+
+    public void testCoalescesAndCaches() throws Exception
+    {
+        final SearchCache cache = new SearchCache(60000, 1024 * 1024);
+        final Recorder first = new Recorder();
+        final Recorder second = new Recorder();
+        final Recorder third = new Recorder();
+
+        final SearchListener search = cache.join(key("Daft  Punk", 0), first);
+        assertNotNull(search);
+        assertNull("identical search should wait", cache.join(key(" daft punk ", 0), second));
+
+        final SearchResult result = new SearchResult();
+        search.searchComplete(result);
+        assertSame(result, first.results.get(0));
+        assertSame(result, second.results.get(0));
+
+        assertNull("recent result should be handed out", cache.join(key("daft punk", 0), third));
+        assertSame(result, third.results.get(0));
+
+        assertNotNull("other page is another search", cache.join(key("daft punk", 50), new Recorder()));
+    }
+
+    public void testDisabled() throws Exception
+    {
+        final SearchCache cache = new SearchCache(0, 1024 * 1024);
+        final Recorder listener = new Recorder();
+        assertSame(listener, cache.join(key("daft punk", 0), listener));
+        assertSame(listener, cache.join(key("daft punk", 0), listener));
+    }
+
+    public void testBudget() throws Exception
+    {
+        final SearchCache cache = new SearchCache(60000, 1);
+        cache.join(key("daft punk", 0), new Recorder()).searchComplete(new SearchResult());
+        assertEquals(0, cache.size());
+        assertNotNull(cache.join(key("daft punk", 0), new Recorder()));
+    }
+
+    public void testFailureReachesAllWaiters() throws Exception
+    {
+        final SearchCache cache = new SearchCache(60000, 1024 * 1024);
+        final Recorder first = new Recorder();
+        final Recorder second = new Recorder();
+
+        final SearchListener search = cache.join(key("daft punk", 0), first);
+        cache.join(key("daft punk", 0), second);
+        ((SearchErrorListener) search).searchFailed("timed out");
+
+        assertEquals("timed out", first.failures.get(0));
+        assertEquals("timed out", second.failures.get(0));
+        assertEquals("failed search is not kept", 0, cache.size());
+    }
+
+    public void testLeave() throws Exception
+    {
+        final SearchCache cache = new SearchCache(60000, 1024 * 1024);
+        final Recorder first = new Recorder();
+        final Recorder second = new Recorder();
+        final Recorder stranger = new Recorder();
+
+        final SearchListener search = cache.join(key("daft punk", 0), first);
+        cache.join(key("daft punk", 0), second);
+
+        assertNull("others still wait", cache.leave(first));
+        assertSame("last one cancels the search", search, cache.leave(second));
+        assertSame(stranger, cache.leave(stranger));
+        assertEquals(0, cache.size());
+    }
+
+    public void testNormalizeKeepsOperators() throws Exception
+    {
+        assertEquals("(daft AND punk)", SearchCache.normalize("  (Daft   AND Punk) "));
+        assertEquals("daft or punk", SearchCache.normalize("Daft or Punk"));
+    }
+}
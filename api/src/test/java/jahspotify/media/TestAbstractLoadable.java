@@ -0,0 +1,61 @@
+package jahspotify.media;
+
+import java.util.concurrent.Future;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.TimeoutException;
+
+import jahspotify.services.MediaHelper;
+import junit.framework.TestCase;
+
+/**
+ * Checks waiters are woken up by setLoaded instead of polling.
+ */
+public class TestAbstractLoadable extends TestCase
+{
+    private static class Item extends AbstractLoadable<Item>
+    {
+    }
+
+    public void testWaitWakesUp() throws Exception
+    {
+        final Item item = new Item();
+        new Thread()
+        {
+            @Override
+            public void run()
+            {
+                item.setLoaded(true);
+            }
+        }.start();
+
+        final long start = System.nanoTime();
+        assertTrue(MediaHelper.waitFor(item, 10));
+        assertTrue("waited for the timeout", System.nanoTime() - start < TimeUnit.SECONDS.toNanos(5));
+    }
+
+    public void testFuture() throws Exception
+    {
+        final Item item = new Item();
+        final Future<Item> future = item.getLoadedFuture();
+        assertFalse(future.isDone());
+        try
+        {
+            future.get(10, TimeUnit.MILLISECONDS);
+            fail("not loaded yet");
+        }
+        catch (TimeoutException e)
+        {
+            // expected
+        }
+
+        item.setLoaded(true);
+        assertTrue(future.isDone());
+        assertSame(item, future.get());
+    }
+
+    public void testTimeout() throws Exception
+    {
+        assertFalse(new Item().waitForLoaded(10, TimeUnit.MILLISECONDS));
+        assertFalse(MediaHelper.waitFor(new Item(), 0));
+    }
+}
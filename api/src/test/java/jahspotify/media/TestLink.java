@@ -33,4 +33,95 @@ public class TestLink extends TestCase
         assertEquals("bad type", Link.Type.MP3,link.getType());
         assertEquals("bad uri","http://www.localhost/",link.getUri());
     }
+
+    public void testCreateOtherForms() throws Exception
+    {
+        Link link = Link.create("spotify:user:johan:playlist:3PogVmhNucYNfyywZvTd7F");
+        assertEquals("bad type", Link.Type.PLAYLIST, link.getType());
+        assertEquals("bad user", "johan", link.getUser());
+
+        link = Link.create("spotify:user:johan:starred");
+        assertEquals("bad type", Link.Type.USER, link.getType());
+
+        link = Link.create("spotify:image:0123456789abcdef0123456789abcdef01234567");
+        assertEquals("bad type", Link.Type.IMAGE, link.getType());
+
+        link = Link.create("spotify:search:daft+punk");
+        assertEquals("bad type", Link.Type.SEARCH, link.getType());
+        assertEquals("bad query", "daft punk", link.getQuery());
+
+        link = Link.create("spotify:local:artist:album:title:123");
+        assertEquals("bad type", Link.Type.LOCAL, link.getType());
+    }
+
+    public void testCreateInvalid() throws Exception
+    {
+        final String[] invalid = {
+                "spotify:album:3PogVmhNucYNfyywZvTd7", "spotify:track:3PogVmhNucYNfyywZvTd7F1",
+                "spotify:artist:3PogVmhNucYNf-ywZvTd7F", "spotify:search:", "spotify:search:a b",
+                "jahspotify:queue", "jahspotify:mp3:", "spotify:local:a\nb", "http://open.spotify.com/"
+        };
+        for (String uri : invalid)
+        {
+            try
+            {
+                Link.create(uri);
+                fail("accepted " + uri);
+            }
+            catch (RuntimeException e)
+            {
+                // expected
+            }
+        }
+    }
+
+    public void testCreateFromId() throws Exception
+    {
+        Link link = Link.create(Link.Type.ALBUM, 0x7dce3254de7c4230L, 0xa75a3e8f56794da7L);
+        assertEquals("bad type", Link.Type.ALBUM, link.getType());
+        assertEquals("bad uri", "spotify:album:3PogVmhNucYNfyywZvTd7F", link.asString());
+        assertEquals("not equal to parsed link", Link.create("spotify:album:3PogVmhNucYNfyywZvTd7F"), link);
+        assertEquals("not equal to parsed link", link, Link.create("spotify:album:3PogVmhNucYNfyywZvTd7F"));
+        assertEquals("bad hash", Link.create("spotify:album:3PogVmhNucYNfyywZvTd7F").hashCode(), link.hashCode());
+
+        assertSame("not interned", link, Link.create(Link.Type.ALBUM, 0x7dce3254de7c4230L, 0xa75a3e8f56794da7L));
+        assertFalse("types mixed up", link.equals(Link.create(Link.Type.TRACK, 0x7dce3254de7c4230L, 0xa75a3e8f56794da7L)));
+    }
+
+    public void testParsedIdsAreInterned() throws Exception
+    {
+        Link link = Link.create("spotify:track:3PogVmhNucYNfyywZvTd7F");
+        assertSame("not interned", link, Link.create(Link.Type.TRACK, 0x7dce3254de7c4230L, 0xa75a3e8f56794da7L));
+        assertSame("not interned", link, Link.create("spotify:track:3PogVmhNucYNfyywZvTd7F"));
+        assertEquals("bad uri", "spotify:track:3PogVmhNucYNfyywZvTd7F", link.asString());
+        assertEquals("bad http link", "http://open.spotify.com/track/3PogVmhNucYNfyywZvTd7F", link.asHTTPLink());
+
+        // 22 base-62 characters can exceed 128 bits, such links still parse
+        link = Link.create("spotify:track:ZZZZZZZZZZZZZZZZZZZZZZ");
+        assertEquals("bad uri", "spotify:track:ZZZZZZZZZZZZZZZZZZZZZZ", link.asString());
+        try
+        {
+            link.getHexId();
+            fail("hex id of an oversized id");
+        }
+        catch (IllegalStateException e)
+        {
+        }
+    }
+
+    public void testHexId() throws Exception
+    {
+        Link link = Link.create("spotify:album:3PogVmhNucYNfyywZvTd7F");
+        assertEquals("bad hex id", "7dce3254de7c4230a75a3e8f56794da7", link.getHexId());
+        assertSame("not interned", link, Link.createFromHex(Link.Type.ALBUM, "7DCE3254DE7C4230A75A3E8F56794DA7"));
+
+        try
+        {
+            Link.createFromHex(Link.Type.ALBUM, "7dce3254de7c4230a75a3e8f56794da7ff");
+            fail("accepted an overlong hex id");
+        }
+        catch (IllegalArgumentException e)
+        {
+        }
+    }
 }
@@ -0,0 +1,59 @@
+package jahspotify.media;
+
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+
+import junit.framework.TestCase;
+
+/**
+ * Checks the listener of a batch is called once, after the last item has loaded.
+ */
+public class TestLoadableBatch extends TestCase
+{
+    private static class Item extends AbstractLoadable<Item>
+    {
+    }
+
+    private static class Batches implements BatchLoadedListener<Item>
+    {
+        final List<List<Item>> calls = new ArrayList<List<Item>>();
+
+        @Override
+        public void loaded(final List<Item> items)
+        {
+            calls.add(items);
+        }
+    }
+
+    public void testWaitsForLastItem() throws Exception
+    {
+        final Item first = new Item();
+        final Item second = new Item();
+        final Batches batches = new Batches();
+        LoadableBatch.whenLoaded(Arrays.asList(first, null, second, first), batches);
+
+        first.setLoaded(true);
+        first.setLoaded(true);
+        assertTrue(batches.calls.isEmpty());
+
+        second.setLoaded(true);
+        assertEquals(1, batches.calls.size());
+        assertEquals(Arrays.asList(first, null, second, first), batches.calls.get(0));
+
+        second.setLoaded(true);
+        assertEquals(1, batches.calls.size());
+    }
+
+    public void testLoadedRightAway() throws Exception
+    {
+        final Item item = new Item();
+        item.setLoaded(true);
+        final Batches batches = new Batches();
+        LoadableBatch.whenLoaded(Arrays.asList(item, null), batches);
+        assertEquals(1, batches.calls.size());
+
+        LoadableBatch.whenLoaded(new ArrayList<Item>(), batches);
+        assertEquals(2, batches.calls.size());
+    }
+}
@@ -0,0 +1,73 @@
+package jahspotify.media;
+
+import java.util.Arrays;
+import java.util.List;
+
+import junit.framework.TestCase;
+
+/**
+ * Checks changes reported by libspotify are applied by position.
+ */
+public class TestPlaylist extends TestCase
+{
+    private static Link track(final int id)
+    {
+        return Link.create(Link.Type.TRACK, 0L, id);
+    }
+
+    private static Playlist playlist(final Link... entries)
+    {
+        final Playlist playlist = new Playlist();
+        for (Link entry : entries)
+        {
+            playlist.addEntry(entry);
+        }
+        playlist.setNumTracks(entries.length);
+        playlist.setLoaded(true);
+        return playlist;
+    }
+
+    public void testAdded() throws Exception
+    {
+        final Playlist playlist = playlist(track(0), null, track(2));
+
+        assertTrue(playlist.apply(PlaylistDelta.added(1, Arrays.asList(track(4), track(5)))));
+        assertEquals(5, playlist.getNumTracks());
+        assertEquals(Arrays.asList(track(0), track(4), track(5), track(2)), playlist.getTracks());
+    }
+
+    public void testRemoved() throws Exception
+    {
+        final Playlist playlist = playlist(track(0), null, track(2), track(3));
+
+        assertTrue(playlist.apply(PlaylistDelta.removed(new int[] { 3, 1 })));
+        assertEquals(2, playlist.getNumTracks());
+        assertEquals(Arrays.asList(track(0), track(2)), playlist.getTracks());
+    }
+
+    public void testMoved() throws Exception
+    {
+        final Playlist playlist = playlist(track(0), track(1), track(2), track(3), track(4));
+
+        // Tracks 0 and 2 end up in front of track 4
+        assertTrue(playlist.apply(PlaylistDelta.moved(new int[] { 0, 2 }, 4)));
+        assertEquals(Arrays.asList(track(1), track(3), track(0), track(2), track(4)), playlist.getTracks());
+
+        // Moving to the end
+        assertTrue(playlist.apply(PlaylistDelta.moved(new int[] { 0 }, 5)));
+        final List<Link> tracks = playlist.getTracks();
+        assertEquals(Arrays.asList(track(3), track(0), track(2), track(4), track(1)), tracks);
+    }
+
+    public void testRejected() throws Exception
+    {
+        final Playlist playlist = playlist(track(0), track(1));
+        assertFalse(playlist.apply(PlaylistDelta.removed(new int[] { 2 })));
+        assertFalse(playlist.apply(PlaylistDelta.added(3, Arrays.asList(track(2)))));
+
+        final Playlist windowed = playlist(track(0), track(1));
+        windowed.setNumTracks(10);
+        assertFalse(windowed.apply(PlaylistDelta.removed(new int[] { 0 })));
+        assertEquals(2, windowed.getTracks().size());
+    }
+}
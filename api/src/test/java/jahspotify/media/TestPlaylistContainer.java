@@ -0,0 +1,65 @@
+package jahspotify.media;
+
+import java.util.Arrays;
+import java.util.List;
+
+import junit.framework.TestCase;
+
+/**
+ * Checks the indexes, snapshots and folders of the container.
+ */
+public class TestPlaylistContainer extends TestCase
+{
+    private final PlaylistContainer container = new PlaylistContainer(null);
+
+    public void testAddRemove() throws Exception
+    {
+        final Playlist first = container.addPlaylist(1L);
+        final Playlist second = container.addPlaylist(2L);
+        assertNull("added twice", container.addPlaylist(1L));
+
+        final List<Playlist> snapshot = container.getPlaylists();
+        assertEquals(2, snapshot.size());
+        assertSame(first, snapshot.get(0));
+        assertSame(second, container.getPlaylistByPointer(2L));
+
+        container.removePlaylist(1L);
+        assertEquals("snapshot changed", 2, snapshot.size());
+        assertEquals(Arrays.asList(second), container.getPlaylists());
+        assertNull(container.getPlaylistByPointer(1L));
+    }
+
+    public void testRemoveByLink() throws Exception
+    {
+        final Playlist playlist = container.addPlaylist(1L);
+        final Link link = Link.create("spotify:user:test:playlist:3PogVmhNucYNfyywZvTd7F");
+        playlist.setId(link);
+        playlist.setLoaded(true);
+        assertSame(playlist, container.getContainedPlaylist(link));
+
+        container.removePlaylist(link.getId());
+        assertTrue(container.getPlaylists().isEmpty());
+        assertNull(container.getContainedPlaylist(link));
+    }
+
+    public void testStructure() throws Exception
+    {
+        final Playlist outside = container.addPlaylist(1L);
+        final Playlist inside = container.addPlaylist(2L);
+
+        container.setStructure(
+                new int[] { PlaylistContainer.TYPE_PLAYLIST, PlaylistContainer.TYPE_START_FOLDER,
+                        PlaylistContainer.TYPE_PLAYLIST, PlaylistContainer.TYPE_END_FOLDER },
+                new long[] { 1L, 0L, 2L, 0L }, new long[] { 0L, 42L, 0L, 42L }, new String[] { null, "Folder", null, null });
+
+        final PlaylistFolder root = container.getRootFolder();
+        assertEquals(Arrays.asList(outside), root.getPlaylists());
+        assertEquals(1, root.getFolders().size());
+
+        final PlaylistFolder folder = root.getFolders().get(0);
+        assertEquals("Folder", folder.getName());
+        assertEquals(42L, folder.getId());
+        assertSame(folder, container.getFolder(inside));
+        assertSame(root, container.getFolder(outside));
+    }
+}
@@ -0,0 +1,143 @@
+package jahspotify.services;
+
+import jahspotify.JahSpotify;
+import jahspotify.Query;
+import jahspotify.Search;
+import jahspotify.SearchErrorListener;
+import jahspotify.SearchListener;
+import jahspotify.SearchResult;
+
+import java.lang.reflect.Field;
+import java.lang.reflect.InvocationHandler;
+import java.lang.reflect.Method;
+import java.lang.reflect.Proxy;
+import java.util.ArrayList;
+import java.util.List;
+
+import junit.framework.TestCase;
+
+/**
+ * Checks pages follow each other, grow while answered quickly and stop at the totals and the cap.
+ */
+public class TestSearchPages extends TestCase
+{
+    /**
+     * Answers every search right away with the given total number of tracks.
+     */
+    private static class Searches implements InvocationHandler
+    {
+        final int totalTracks;
+        final boolean fail;
+        final List<Search> started = new ArrayList<Search>();
+        int cancelled;
+
+        Searches(final int totalTracks, final boolean fail)
+        {
+            this.totalTracks = totalTracks;
+            this.fail = fail;
+        }
+
+        @Override
+        public Object invoke(final Object proxy, final Method method, final Object[] args) throws Throwable
+        {
+            if ("initiateSearch".equals(method.getName()))
+            {
+                started.add((Search) args[0]);
+                if (fail)
+                {
+                    ((SearchErrorListener) args[1]).searchFailed("failed");
+                }
+                else
+                {
+                    final SearchResult result = new SearchResult();
+                    set(result, "totalNumTracks", totalTracks);
+                    ((SearchListener) args[1]).searchComplete(result);
+                }
+                return null;
+            }
+            if ("cancelSearch".equals(method.getName()))
+            {
+                cancelled++;
+                return true;
+            }
+            throw new UnsupportedOperationException(method.getName());
+        }
+
+        JahSpotify jahSpotify()
+        {
+            return (JahSpotify) Proxy.newProxyInstance(JahSpotify.class.getClassLoader(), new Class[] { JahSpotify.class }, this);
+        }
+    }
+
+    private static void set(final Object target, final String name, final int value) throws Exception
+    {
+        final Field field = target.getClass().getDeclaredField(name);
+        field.setAccessible(true);
+        field.setInt(target, value);
+    }
+
+    private static Search tracks(final int offset)
+    {
+        final Search search = new Search(Query.token("daft punk"));
+        search.setTrackOffset(offset);
+        search.setNumAlbums(0);
+        search.setNumArtists(0);
+        search.setNumPlaylists(0);
+        return search;
+    }
+
+    public void testGrowsUntilTotal() throws Exception
+    {
+        final Searches searches = new Searches(100, false);
+        final SearchPages pages = new SearchPages(searches.jahSpotify(), tracks(5), 1000);
+
+        int count = 0;
+        while (pages.hasNext())
+        {
+            pages.next();
+            count++;
+        }
+
+        assertEquals(4, count);
+        assertEquals(4, searches.started.size());
+        final int[] offsets = { 5, 15, 35, 75 };
+        final int[] sizes = { 10, 20, 40, 25 };
+        for (int i = 0; i < 4; i++)
+        {
+            assertEquals(offsets[i], searches.started.get(i).getTrackOffset());
+            assertEquals(sizes[i], searches.started.get(i).getNumTracks());
+            assertEquals(0, searches.started.get(i).getNumAlbums());
+        }
+    }
+
+    public void testStopsAtCap() throws Exception
+    {
+        final Searches searches = new Searches(1000, false);
+        final SearchPages pages = new SearchPages(searches.jahSpotify(), tracks(0), 25);
+
+        pages.next();
+        pages.next();
+        assertFalse(pages.hasNext());
+        assertEquals(15, searches.started.get(1).getNumTracks());
+    }
+
+    public void testPrefetchesAndCancels() throws Exception
+    {
+        final Searches searches = new Searches(1000, false);
+        final SearchPages pages = new SearchPages(searches.jahSpotify(), tracks(0), 1000);
+
+        assertEquals("first page is requested right away", 1, searches.started.size());
+        pages.next();
+        assertEquals("next page is requested with the current one", 2, searches.started.size());
+        pages.close();
+        assertEquals(1, searches.cancelled);
+        assertFalse(pages.hasNext());
+    }
+
+    public void testFailureEnds() throws Exception
+    {
+        final Searches searches = new Searches(0, true);
+        final SearchPages pages = new SearchPages(searches.jahSpotify(), tracks(0), 1000);
+        assertFalse(pages.hasNext());
+    }
+}
@@ -0,0 +1,79 @@
+package jahspotify.util;
+
+import java.awt.image.BufferedImage;
+import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream;
+
+import javax.imageio.ImageIO;
+
+import junit.framework.TestCase;
+
+/**
+ * Checks area averaging keeps colours and sizes of scaled images.
+ */
+public class TestImageResizer extends TestCase
+{
+    public void testHalvesAverage() throws Exception
+    {
+        final BufferedImage source = new BufferedImage(4, 2, BufferedImage.TYPE_INT_RGB);
+        for (int y = 0; y < 2; y++)
+        {
+            for (int x = 0; x < 4; x++)
+            {
+                source.setRGB(x, y, x < 2 ? 0xff0000 : (x == 2 ? 0x0000ff : 0x000080));
+            }
+        }
+
+        final BufferedImage target = ImageResizer.scale(source, 2, 1);
+        assertEquals(0xff0000, target.getRGB(0, 0) & 0xffffff);
+        assertEquals(0x0000c0, target.getRGB(1, 0) & 0xffffff);
+    }
+
+    public void testFractionalCoverage() throws Exception
+    {
+        final BufferedImage source = new BufferedImage(3, 3, BufferedImage.TYPE_INT_RGB);
+        for (int y = 0; y < 3; y++)
+        {
+            for (int x = 0; x < 3; x++)
+            {
+                source.setRGB(x, y, 0x406080);
+            }
+        }
+
+        final BufferedImage target = ImageResizer.scale(source, 2, 2);
+        for (int y = 0; y < 2; y++)
+        {
+            for (int x = 0; x < 2; x++)
+            {
+                assertEquals(0x406080, target.getRGB(x, y) & 0xffffff);
+            }
+        }
+    }
+
+    public void testThumbnailKeepsAspectRatio() throws Exception
+    {
+        final ByteArrayOutputStream baos = new ByteArrayOutputStream();
+        ImageIO.write(new BufferedImage(300, 150, BufferedImage.TYPE_INT_RGB), "JPG", baos);
+        final byte[] original = baos.toByteArray();
+
+        final BufferedImage thumbnail = ImageIO.read(new ByteArrayInputStream(ImageResizer.thumbnail(original, 64)));
+        assertEquals(64, thumbnail.getWidth());
+        assertEquals(32, thumbnail.getHeight());
+
+        assertSame(original, ImageResizer.thumbnail(original, 300));
+        assertNull(ImageResizer.thumbnail(new byte[] { 1, 2, 3 }, 64));
+    }
+
+    public void testRejectsUpscaling() throws Exception
+    {
+        try
+        {
+            ImageResizer.scale(new BufferedImage(2, 2, BufferedImage.TYPE_INT_RGB), 3, 1);
+            fail("scaled up");
+        }
+        catch (IllegalArgumentException e)
+        {
+            // expected
+        }
+    }
+}
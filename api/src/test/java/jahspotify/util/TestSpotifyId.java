@@ -0,0 +1,81 @@
+package jahspotify.util;
+
+import java.util.Random;
+
+import junit.framework.TestCase;
+
+/**
+ * Checks {@link SpotifyId} against the generic {@link BaseConvert} for random and edge ids.
+ */
+public class TestSpotifyId extends TestCase
+{
+    private static final long[][] EDGES = {
+            { 0L, 0L }, { 0L, 1L }, { -1L, -1L }, { Long.MIN_VALUE, 0L }, { 0L, Long.MIN_VALUE },
+            { Long.MAX_VALUE, Long.MAX_VALUE }, { 0x7dce3254de7c4230L, 0xa75a3e8f56794da7L }
+    };
+
+    public void testKnownId() throws Exception
+    {
+        assertEquals("3PogVmhNucYNfyywZvTd7F", SpotifyId.toBase62(0x7dce3254de7c4230L, 0xa75a3e8f56794da7L));
+        assertEquals("7dce3254de7c4230a75a3e8f56794da7", SpotifyId.toHex(0x7dce3254de7c4230L, 0xa75a3e8f56794da7L));
+        assertEquals("0000000000000000000000", SpotifyId.toBase62(0L, 0L));
+    }
+
+    public void testMatchesBaseConvert() throws Exception
+    {
+        final Random random = new Random(62);
+        for (long[] edge : EDGES)
+        {
+            assertRoundTrip(edge[0], edge[1]);
+        }
+        for (int i = 0; i < 10000; i++)
+        {
+            // Shifting some values right keeps ids with leading zeroes in the mix
+            assertRoundTrip(random.nextLong() >>> random.nextInt(64), random.nextLong());
+        }
+    }
+
+    public void testRejectsInvalid() throws Exception
+    {
+        final String[] invalid = { "3PogVmhNucYNfyywZvTd7", "3PogVmhNucYNf-ywZvTd7F", "ZZZZZZZZZZZZZZZZZZZZZZ" };
+        for (String id : invalid)
+        {
+            try
+            {
+                SpotifyId.fromBase62(id, 0);
+                fail("accepted " + id);
+            }
+            catch (IllegalArgumentException e)
+            {
+                // expected
+            }
+        }
+    }
+
+    private static void assertRoundTrip(final long high, final long low)
+    {
+        final String hex = SpotifyId.toHex(high, low);
+        final String base62 = SpotifyId.toBase62(high, low);
+
+        assertEquals("hex differs", Hex.toHex(high, 8) + Hex.toHex(low, 8), hex);
+        assertEquals("base-62 differs for " + hex, expectedBase62(hex), base62);
+
+        long[] decoded = SpotifyId.fromBase62("spotify:track:" + base62, 14);
+        assertEquals("high half of " + base62, high, decoded[0]);
+        assertEquals("low half of " + base62, low, decoded[1]);
+
+        decoded = SpotifyId.fromHex(hex.toUpperCase(), 0);
+        assertEquals("high half of " + hex, high, decoded[0]);
+        assertEquals("low half of " + hex, low, decoded[1]);
+    }
+
+    private static String expectedBase62(final String hex)
+    {
+        final StringBuilder expected = new StringBuilder(BaseConvert.convert(hex, 16, 62));
+        while (expected.length() < SpotifyId.BASE62_LENGTH)
+        {
+            expected.insert(0, '0');
+        }
+        return expected.toString();
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef JAHSPOTIFY_BROWSE_CACHE
+
+#define JAHSPOTIFY_BROWSE_CACHE
+
+#include <stdint.h>
+#include <jni.h>
+
+/* Milliseconds a completed browse is handed out again before it is browsed anew */
+#define BROWSE_CACHE_TTL (10 * 60 * 1000)
+/* Number of completed browses kept per session */
+#define BROWSE_CACHE_MAX_ENTRIES 128
+
+typedef enum browse_type {
+	BROWSE_ALBUM,
+	BROWSE_ARTIST_NO_TRACKS,
+	BROWSE_ARTIST_NO_ALBUMS
+} browse_type;
+
+/**
+ * A Java instance waiting for a running browse.
+ */
+typedef struct browse_waiter {
+	struct browse_waiter *next;
+	jobject instance;
+} browse_waiter;
+
+/**
+ * A browse of an album or artist, running or completed. The item is referenced while the entry
+ * exists, so libspotify hands out the same object for its GID and the pointer identifies it.
+ */
+typedef struct browse_entry {
+	/// Next entry, the list is ordered from most to least recently used
+	struct browse_entry *next;
+	browse_type type;
+	/// The sp_album or sp_artist browsed
+	void *item;
+	/// The sp_albumbrowse or sp_artistbrowse once completed, NULL while running
+	void *result;
+	/// Instances waiting for the browse while it runs
+	browse_waiter *waiters;
+	/// Time the browse completed, in milliseconds
+	uint64_t completed;
+	struct jahspotify_session *session;
+} browse_entry;
+
+typedef struct browse_cache {
+	browse_entry *entries;
+	/// Number of completed entries
+	unsigned int size;
+
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t coalesced;
+	uint64_t expired;
+} browse_cache;
+
+browse_entry *browse_cache_find(browse_cache *cache, browse_type type, void *item, uint64_t now);
+browse_entry *browse_cache_add(browse_cache *cache, struct jahspotify_session *session, browse_type type, void *item);
+int browse_cache_wait(browse_entry *entry, jobject instance);
+browse_waiter *browse_cache_complete(browse_cache *cache, browse_entry *entry, void *result, uint64_t now);
+void browse_cache_clear(JNIEnv *env, browse_cache *cache);
+
+#endif
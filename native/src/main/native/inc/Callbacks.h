@@ -4,14 +4,16 @@
 
 #include <libspotify/api.h>
 
+#include "Session.h"
+
 void startPlaybackSignalled();
-int signalInitialized(int initialized);
-int signalLoggedIn(int loggedIn);
-int signalPlaylistsLoaded();
-int signalConnected();
-int signalDisconnected();
-int signalLoggedOut();
-void signalBlobUpdated(const char* blob);
+int signalInitialized(jahspotify_session *session, int initialized);
+int signalLoggedIn(jahspotify_session *session, int loggedIn);
+int signalPlaylistsLoaded(jahspotify_session *session);
+int signalConnected(jahspotify_session *session);
+int signalDisconnected(jahspotify_session *session);
+int signalLoggedOut(jahspotify_session *session);
+void signalBlobUpdated(jahspotify_session *session, const char* blob);
 
 int signalStartFolderSeen(char *folderName, uint64_t folderId);
 int signalSynchStarting(int numPlaylists);
@@ -19,19 +21,26 @@ int signalSynchCompleted();
 int signalMetadataUpdated(sp_playlist *playlist);
 int signalEndFolderSeen();
 
-int signalTrackEnded(char *uri, bool forcedTrackEnd);
-int signalTrackStarted(const char *uri);
-void signalPlayTokenLost();
+int signalTrackEnded(jahspotify_session *session, char *uri, bool forcedTrackEnd);
+int signalTrackStarted(jahspotify_session *session, const char *uri);
+void signalPlayTokenLost(jahspotify_session *session);
 int signalPlaylistSeen(const char *playlistName, char *linkName);
 
-int signalSearchComplete(sp_search *search, int32_t token);
-int signalImageLoaded(sp_image *image, jobject imageInstance);
+int signalSearchComplete(JNIEnv *env, jahspotify_session *session, sp_search *search, int32_t token);
+jobject createJSearchResult(JNIEnv *env, jahspotify_session *session, sp_search *search);
+int notifySearchComplete(JNIEnv *env, jahspotify_session *session, int32_t token, jobject nativeSearchResult);
+int signalSearchFailed(JNIEnv *env, jahspotify_session *session, int32_t token, const char *message);
+int signalImageLoaded(JNIEnv *env, jahspotify_session *session, jobject imageInstance, jbyteArray bytes);
 int signalTrackLoaded(sp_track *track, int32_t token);
-int signalPlaylistLoaded(jobject playlist);
-int signalAlbumBrowseLoaded(sp_albumbrowse *albumBrowse, jobject token);
-int signalArtistBrowseLoaded(sp_artistbrowse *artistBrowse, jobject token);
+int signalPlaylistLoaded(jahspotify_session *session, jobject playlist);
+int signalAlbumBrowseLoaded(JNIEnv *env, jahspotify_session *session, sp_albumbrowse *albumBrowse, jobject albumInstance);
+int populateAlbumFromBrowse(JNIEnv *env, sp_albumbrowse *albumBrowse, jobject albumInstance);
+int notifyAlbumLoaded(JNIEnv *env, jahspotify_session *session, jobject albumInstance);
+int signalArtistBrowseLoaded(JNIEnv *env, jahspotify_session *session, sp_artistbrowse *artistBrowse, jobject artistInstance);
+int populateArtistFromBrowse(JNIEnv *env, jahspotify_session *session, sp_artistbrowse *artistBrowse, jobject artistInstance);
+int notifyArtistLoaded(JNIEnv *env, jahspotify_session *session, jobject artistInstance);
 
 jobject createSearchResult(JNIEnv* env);
-void signalToplistComplete(sp_toplistbrowse *result, jobject nativeSearchResult);
+void signalToplistComplete(jahspotify_session *session, sp_toplistbrowse *result, jobject nativeSearchResult);
 
 #endif
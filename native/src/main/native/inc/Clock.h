@@ -0,0 +1,9 @@
+#ifndef JAHSPOTIFY_CLOCK
+
+#define JAHSPOTIFY_CLOCK
+
+#include <stdint.h>
+
+uint64_t monotonic_millis();
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef JAHSPOTIFY_IMAGE_CACHE
+
+#define JAHSPOTIFY_IMAGE_CACHE
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Size of the id of an image, as in sp_image_image_id */
+#define IMAGE_ID_SIZE 20
+/* Variant of the original bytes of an image, others are thumbnails keyed by their size */
+#define IMAGE_VARIANT_ORIGINAL 0
+/* Default number of bytes the image cache may hold */
+#define IMAGE_CACHE_DEFAULT_BUDGET (16 * 1024 * 1024)
+
+typedef struct image_cache_stats {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t entries;
+	uint64_t bytes;
+	uint64_t budget;
+} image_cache_stats;
+
+int image_id_from_uri(const char *uri, uint8_t *id);
+
+void image_cache_put(const uint8_t *id, int variant, const void *data, size_t size);
+const void *image_cache_acquire(const uint8_t *id, int variant, size_t *size);
+void image_cache_release();
+
+void image_cache_set_budget(size_t budget);
+void image_cache_read_stats(image_cache_stats *stats);
+
+#endif
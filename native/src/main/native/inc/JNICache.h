@@ -0,0 +1,132 @@
+#ifndef JAHSPOTIFY_JNI_CACHE
+
+#define JAHSPOTIFY_JNI_CACHE
+
+#include <jni.h>
+
+/*
+ * Classes, fields and methods used when marshalling media objects. Each list expands into an
+ * enum and a table which JNI_OnLoad fills in, so the hot paths never look anything up by name.
+ */
+
+#define JNI_CACHE_CLASSES(X) \
+	X(LINK, "jahspotify/media/Link") \
+	X(LOADABLE, "jahspotify/media/AbstractLoadable") \
+	X(MEDIA, "jahspotify/media/Media") \
+	X(TRACK, "jahspotify/media/Track") \
+	X(ALBUM, "jahspotify/media/Album") \
+	X(ARTIST, "jahspotify/media/Artist") \
+	X(PLAYLIST, "jahspotify/media/Playlist") \
+	X(IMAGE, "jahspotify/media/Image") \
+	X(MEDIA_LOADED_LISTENER, "jahspotify/impl/NativeMediaLoadedListener") \
+	X(MEDIA_RECORD, "jahspotify/impl/MediaRecord") \
+	X(PLAYLIST_CONTAINER, "jahspotify/media/PlaylistContainer") \
+	X(STRING, "java/lang/String") \
+	X(SEARCH_COMPLETE_LISTENER, "jahspotify/impl/NativeSearchCompleteListener") \
+	X(SEARCH_RESULT, "jahspotify/SearchResult") \
+	X(COLLECTION, "java/util/Collection") \
+	X(ARRAY_LIST, "java/util/ArrayList")
+
+#define JNI_CACHE_FIELDS(X) \
+	X(MEDIA_ID, MEDIA, "id", "Ljahspotify/media/Link;") \
+	X(ALBUM_NAME, ALBUM, "name", "Ljava/lang/String;") \
+	X(ALBUM_REVIEW, ALBUM, "review", "Ljava/lang/String;") \
+	X(ARTIST_NAME, ARTIST, "name", "Ljava/lang/String;") \
+	X(ARTIST_BIOS, ARTIST, "bios", "Ljava/lang/String;") \
+	X(PLAYLIST_ID, PLAYLIST, "id", "Ljahspotify/media/Link;") \
+	X(PLAYLIST_NAME, PLAYLIST, "name", "Ljava/lang/String;") \
+	X(PLAYLIST_AUTHOR, PLAYLIST, "author", "Ljava/lang/String;") \
+	X(PLAYLIST_NUM_TRACKS, PLAYLIST, "numTracks", "I") \
+	X(PLAYLIST_INDEX, PLAYLIST, "index", "I") \
+	X(PLAYLIST_WINDOW_SIZE, PLAYLIST, "windowSize", "I") \
+	X(IMAGE_ID, IMAGE, "id", "Ljahspotify/media/Link;") \
+	X(IMAGE_BYTES, IMAGE, "bytes", "[B") \
+	X(SEARCH_RESULT_QUERY, SEARCH_RESULT, "query", "Ljava/lang/String;") \
+	X(SEARCH_RESULT_DID_YOU_MEAN, SEARCH_RESULT, "didYouMean", "Ljava/lang/String;") \
+	X(SEARCH_RESULT_TRACKS, SEARCH_RESULT, "tracksFound", "Ljava/util/List;") \
+	X(SEARCH_RESULT_TOTAL_TRACKS, SEARCH_RESULT, "totalNumTracks", "I") \
+	X(SEARCH_RESULT_TRACK_OFFSET, SEARCH_RESULT, "trackOffset", "I") \
+	X(SEARCH_RESULT_ALBUMS, SEARCH_RESULT, "albumsFound", "Ljava/util/List;") \
+	X(SEARCH_RESULT_TOTAL_ALBUMS, SEARCH_RESULT, "totalNumAlbums", "I") \
+	X(SEARCH_RESULT_ALBUM_OFFSET, SEARCH_RESULT, "albumOffset", "I") \
+	X(SEARCH_RESULT_ARTISTS, SEARCH_RESULT, "artistsFound", "Ljava/util/List;") \
+	X(SEARCH_RESULT_TOTAL_ARTISTS, SEARCH_RESULT, "totalNumArtists", "I") \
+	X(SEARCH_RESULT_ARTIST_OFFSET, SEARCH_RESULT, "artistOffset", "I") \
+	X(SEARCH_RESULT_PLAYLISTS, SEARCH_RESULT, "playlistsFound", "Ljava/util/List;") \
+	X(SEARCH_RESULT_TOTAL_PLAYLISTS, SEARCH_RESULT, "totalNumPlaylists", "I") \
+	X(SEARCH_RESULT_PLAYLIST_OFFSET, SEARCH_RESULT, "playlistOffset", "I")
+
+#define JNI_CACHE_METHODS(X) \
+	X(LOADABLE_SET_LOADED, LOADABLE, "setLoaded", "(Z)V") \
+	X(TRACK_INIT, TRACK, "<init>", "()V") \
+	X(ALBUM_INIT, ALBUM, "<init>", "()V") \
+	X(ALBUM_ADD_TRACK, ALBUM, "addTrack", "(ILjahspotify/media/Link;)V") \
+	X(ALBUM_ADD_COPYRIGHT, ALBUM, "addCopyright", "(Ljava/lang/String;)V") \
+	X(ARTIST_INIT, ARTIST, "<init>", "()V") \
+	X(ARTIST_ADD_SIMILAR_ARTIST, ARTIST, "addSimilarArtist", "(Ljahspotify/media/Link;)V") \
+	X(ARTIST_ADD_PORTRAIT, ARTIST, "addPortrait", "(Ljahspotify/media/Link;)V") \
+	X(ARTIST_ADD_ALBUM, ARTIST, "addAlbum", "(Ljahspotify/media/Link;)V") \
+	X(ARTIST_ADD_TOP_HIT_TRACK, ARTIST, "addTopHitTrack", "(Ljahspotify/media/Link;)V") \
+	X(PLAYLIST_INIT, PLAYLIST, "<init>", "()V") \
+	X(PLAYLIST_ADD_ENTRY, PLAYLIST, "addEntry", "(Ljahspotify/media/Link;)V") \
+	X(PLAYLIST_CLEAR, PLAYLIST, "clear", "()V") \
+	X(MEDIA_LOADED_PLAYLIST, MEDIA_LOADED_LISTENER, "playlist", "(Ljahspotify/media/Playlist;)V") \
+	X(MEDIA_LOADED_ARTIST, MEDIA_LOADED_LISTENER, "artist", "(ILjahspotify/media/Artist;)V") \
+	X(MEDIA_LOADED_ALBUM, MEDIA_LOADED_LISTENER, "album", "(ILjahspotify/media/Album;)V") \
+	X(MEDIA_LOADED_IMAGE, MEDIA_LOADED_LISTENER, "image", "(ILjahspotify/media/Link;Ljahspotify/media/ImageSize;[B)V") \
+	X(MEDIA_LOADED_TRACKS_ADDED, MEDIA_LOADED_LISTENER, "playlistTracksAdded", "(JI[Ljahspotify/media/Link;)V") \
+	X(MEDIA_LOADED_TRACKS_REMOVED, MEDIA_LOADED_LISTENER, "playlistTracksRemoved", "(J[I)V") \
+	X(MEDIA_LOADED_TRACKS_MOVED, MEDIA_LOADED_LISTENER, "playlistTracksMoved", "(J[II)V") \
+	X(SEARCH_COMPLETED, SEARCH_COMPLETE_LISTENER, "searchCompleted", "(ILjahspotify/SearchResult;)V") \
+	X(SEARCH_FAILED, SEARCH_COMPLETE_LISTENER, "searchFailed", "(ILjava/lang/String;)V") \
+	X(SEARCH_RESULT_INIT, SEARCH_RESULT, "<init>", "()V") \
+	X(ARRAY_LIST_INIT, ARRAY_LIST, "<init>", "()V") \
+	X(COLLECTION_ADD, COLLECTION, "add", "(Ljava/lang/Object;)Z") \
+	X(PLAYLIST_CONTAINER_ADD, PLAYLIST_CONTAINER, "addPlaylist", "(J)Ljahspotify/media/Playlist;") \
+	X(PLAYLIST_CONTAINER_REMOVE, PLAYLIST_CONTAINER, "removePlaylist", "(J)V") \
+	X(PLAYLIST_CONTAINER_SET_STRUCTURE, PLAYLIST_CONTAINER, "setStructure", "([I[J[J[Ljava/lang/String;)V")
+
+#define JNI_CACHE_STATIC_METHODS(X) \
+	X(LINK_CREATE, LINK, "create", "(Ljava/lang/String;)Ljahspotify/media/Link;") \
+	X(MEDIA_RECORD_DECODE, MEDIA_RECORD, "decode", "(Ljahspotify/media/Media;Ljava/nio/ByteBuffer;)V") \
+	X(MEDIA_RECORD_LINK, MEDIA_RECORD, "link", "(IJJ)Ljahspotify/media/Link;") \
+	X(PLAYLIST_CREATE, PLAYLIST, "create", "(Ljahspotify/media/Link;Ljava/lang/String;Ljahspotify/media/Link;)Ljahspotify/media/Playlist;")
+
+#define JNI_CACHE_ENUM_CLASS(name, path) JNI_CLASS_##name,
+#define JNI_CACHE_ENUM_FIELD(name, owner, member, signature) JNI_FIELD_##name,
+#define JNI_CACHE_ENUM_METHOD(name, owner, member, signature) JNI_METHOD_##name,
+#define JNI_CACHE_ENUM_STATIC(name, owner, member, signature) JNI_STATIC_##name,
+
+typedef enum jni_class_index {
+	JNI_CACHE_CLASSES(JNI_CACHE_ENUM_CLASS)
+	JNI_CLASS_COUNT
+} jni_class_index;
+
+typedef enum jni_field_index {
+	JNI_CACHE_FIELDS(JNI_CACHE_ENUM_FIELD)
+	JNI_FIELD_COUNT
+} jni_field_index;
+
+typedef enum jni_method_index {
+	JNI_CACHE_METHODS(JNI_CACHE_ENUM_METHOD)
+	JNI_METHOD_COUNT
+} jni_method_index;
+
+typedef enum jni_static_method_index {
+	JNI_CACHE_STATIC_METHODS(JNI_CACHE_ENUM_STATIC)
+	JNI_STATIC_COUNT
+} jni_static_method_index;
+
+extern jclass g_jni_classes[JNI_CLASS_COUNT];
+extern jfieldID g_jni_fields[JNI_FIELD_COUNT];
+extern jmethodID g_jni_methods[JNI_METHOD_COUNT];
+extern jmethodID g_jni_static_methods[JNI_STATIC_COUNT];
+
+#define JCLASS(name) (g_jni_classes[JNI_CLASS_##name])
+#define JFIELD(name) (g_jni_fields[JNI_FIELD_##name])
+#define JMETHOD(name) (g_jni_methods[JNI_METHOD_##name])
+#define JSTATIC(name) (g_jni_static_methods[JNI_STATIC_##name])
+
+int jni_cache_init(JNIEnv *env);
+
+#endif
@@ -14,6 +14,9 @@ jint setObjectStringField(JNIEnv * env, jobject obj, const char *name, const cha
 jint setObjectObjectField(JNIEnv * env, jobject obj, const char *name, char *fieldTypeName, jobject value);
 jint setObjectBooleanField(JNIEnv * env, jobject obj, const char *name, jboolean value);
 
+jint setStringField(JNIEnv * env, jobject obj, jfieldID field, const char *value);
+jint setObjectField(JNIEnv * env, jobject obj, jfieldID field, jobject value);
+
 jint getObjectLongField(JNIEnv * env, jobject obj, const char *name, jlong *value);
 jstring getObjectStringField(JNIEnv * env, jobject obj, const char *name);
 jint getObjectIntField(JNIEnv * env, jobject obj, const char *name, jint *value);
@@ -25,6 +28,7 @@ jobject createInstanceFromJClass(JNIEnv *env, jclass jClass);
 jint invokeVoidMethod(JNIEnv *env, jobject instance, const char *methodName);
 jint invokeVoidMethod_II(JNIEnv *env, jobject instance, const char *methodName, jint arg1, jint arg2);
 jint invokeVoidMethod_Z(JNIEnv *env, jobject instance, const char *methodName, jboolean arg1);
+jint setLoaded(JNIEnv *env, jobject instance);
 jint invokeIntMethod_B(JNIEnv *env, jobject instance, const char *methodName, int *returnValue, jbyteArray arr);
 
 jint checkException(JNIEnv *env);
@@ -2,17 +2,11 @@
 
 #define JAHSPOTIFY
 
-typedef struct media {
-	struct media* prev;
-	struct media* next;
-	jobject javainstance;
-	sp_track* track;
-	sp_album* album;
-	sp_artist* artist;
-	int browse;
-} media;
+#include "PendingLoads.h"
 
-void addLoading(jobject javainstance, sp_track* track, sp_album* album, sp_artist* artist, int browse);
-void checkLoaded();
+struct jahspotify_session;
+
+void addLoading(struct jahspotify_session *session, jobject javainstance, sp_track* track, sp_album* album, sp_artist* artist, int browse);
+void checkLoaded(struct jahspotify_session *session);
 
 #endif
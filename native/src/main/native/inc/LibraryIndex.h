@@ -0,0 +1,137 @@
+#ifndef JAHSPOTIFY_LIBRARY_INDEX
+
+#define JAHSPOTIFY_LIBRARY_INDEX
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <libspotify/api.h>
+
+/* Fields of a track which are indexed, combined as a mask when matching */
+#define LIBRARY_FIELD_TITLE 1
+#define LIBRARY_FIELD_ARTIST 2
+#define LIBRARY_FIELD_ALBUM 4
+#define LIBRARY_FIELD_ALL (LIBRARY_FIELD_TITLE | LIBRARY_FIELD_ARTIST | LIBRARY_FIELD_ALBUM)
+
+/* Longer terms are cut to this many bytes */
+#define LIBRARY_MAX_TERM 64
+/* Removed tracks are purged from the posting lists once there are this many and more of them than live ones */
+#define LIBRARY_PURGE_THRESHOLD 256
+/* Marks a doc whose track was purged */
+#define LIBRARY_NO_SLOT UINT32_MAX
+/* Docs handed out stay below this, they are Java ints */
+#define LIBRARY_MAX_DOC INT32_MAX
+
+/**
+ * A track of the library, one per distinct track over all playlists of the container. Its doc
+ * is assigned once the track has loaded and its terms are in the posting lists.
+ */
+typedef struct library_track {
+	/// Referenced while the slot is in use, NULL for a free slot
+	sp_track *track;
+	char *uri;
+	/// Number of playlist positions holding the track, removed while 0
+	int refs;
+	/// Doc of the track, -1 while waiting for it to load
+	int32_t doc;
+} library_track;
+
+/**
+ * Doc ids of one term in one field, ascending and delta encoded as varints. Docs are assigned in
+ * increasing order so indexing a track only appends.
+ */
+typedef struct library_postings {
+	struct library_postings *next;
+	uint8_t field;
+	uint32_t count;
+	uint32_t last;
+	size_t size;
+	size_t capacity;
+	uint8_t *data;
+	char term[];
+} library_postings;
+
+/**
+ * A playlist of the container and the tracks it held when it was last synced.
+ */
+typedef struct library_playlist {
+	struct library_playlist *next;
+	sp_playlist *playlist;
+	sp_track **tracks;
+	int num_tracks;
+	/// Non-zero when the tracks changed since the last sync
+	int stale;
+} library_playlist;
+
+/**
+ * Inverted index over the titles, artists and albums of the tracks in the playlist container.
+ * Changes are noted from the libspotify callbacks and applied by library_index_refresh on the
+ * event loop, which holds the spotify mutex. Matching only takes the index mutex, so it neither
+ * waits for libspotify nor calls into it.
+ */
+typedef struct library_index {
+	pthread_mutex_t mutex;
+
+	library_track *tracks;
+	uint32_t num_tracks;
+	uint32_t capacity_tracks;
+	/// Free slots, chained through their doc field
+	int32_t free_slot;
+
+	/// Slot of every doc
+	uint32_t *docs;
+	uint32_t num_docs;
+	uint32_t capacity_docs;
+	/// Added to the docs handed out, grows on every clear so docs matched before never name other tracks
+	uint32_t first_doc;
+
+	/// Open addressing from track to slot + 1, 0 for an empty bucket
+	uint32_t *lookup;
+	uint32_t capacity_lookup;
+
+	library_postings **terms;
+	uint32_t capacity_terms;
+	uint32_t num_terms;
+	size_t postings_bytes;
+
+	library_playlist *playlists;
+
+	/// Slots waiting for their track to load
+	uint32_t *pending;
+	uint32_t num_pending;
+	uint32_t capacity_pending;
+
+	/// Indexed tracks which are in no playlist anymore
+	uint32_t num_removed;
+	uint32_t num_live;
+	/// Playlists which could not be synced as they have not loaded yet
+	uint32_t num_unsynced;
+
+	/// Set when there is something for library_index_refresh to do
+	int dirty;
+} library_index;
+
+typedef struct library_index_stats {
+	uint32_t tracks;
+	uint32_t pending;
+	uint32_t removed;
+	uint32_t terms;
+	size_t bytes;
+} library_index_stats;
+
+void library_index_init(library_index *index);
+
+void library_index_add_playlist(library_index *index, sp_playlist *playlist);
+void library_index_remove_playlist(library_index *index, sp_playlist *playlist);
+void library_index_touch(library_index *index, sp_playlist *playlist);
+void library_index_metadata_updated(library_index *index);
+void library_index_refresh(library_index *index);
+void library_index_clear(library_index *index);
+
+int library_index_match(library_index *index, int fields, const char *text, uint32_t **docs, uint32_t *count);
+const char *library_index_uri(library_index *index, uint32_t doc);
+void library_index_read_stats(library_index *index, library_index_stats *stats);
+
+size_t library_next_term(const char **text, char *term);
+
+#endif
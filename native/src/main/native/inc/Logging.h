@@ -9,6 +9,26 @@
 #include <stdarg.h>
 #include <stdio.h>
 
+/* Levels, these match the constants in jahspotify.impl.NativeLogger */
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_WARN 3
+#define LOG_LEVEL_ERROR 4
+#define LOG_LEVEL_FATAL 5
+
+/* Number of records the ring can hold, must be a power of two */
+#define LOG_RING_SIZE 1024
+#define LOG_MESSAGE_SIZE 512
+
+extern volatile int g_log_level;
+
+#define log_enabled(level) ((level) >= g_log_level)
+
+void log_set_level(int level);
+int log_start(JNIEnv *env);
+unsigned int log_dropped();
+
 void log_trace(const char* component, const char *subComponent, const char* format, ...);
 void log_debug(const char* component, const char *subComponent, const char* format, ...);
 void log_info(const char *component, const char *subComponent, char *format, ...);
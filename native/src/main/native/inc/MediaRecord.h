@@ -0,0 +1,27 @@
+#ifndef JAHSPOTIFY_MEDIA_RECORD
+
+#define JAHSPOTIFY_MEDIA_RECORD
+
+#include "MetadataCache.h"
+
+/* Size of the fixed header: kind, reserved byte, artist count and three values */
+#define MEDIA_RECORD_HEADER_SIZE 16
+/* Records up to this size are built on the stack */
+#define MEDIA_RECORD_STACK_SIZE 1024
+/* Length written for a missing string */
+#define MEDIA_RECORD_MISSING 0xFFFF
+/* Tags of links which are not written as a kind and id */
+#define MEDIA_RECORD_LINK_NONE 0
+#define MEDIA_RECORD_LINK_URI 0xFF
+
+/*
+ * Records are what jahspotify.impl.MediaRecord decodes, see there for the layout. They are
+ * big-endian so Java can read them without setting the byte order of the buffer.
+ */
+
+size_t media_record_size(const metadata *item);
+size_t media_record_write(const metadata *item, uint8_t *buffer);
+
+uint64_t media_record_gid_half(const uint8_t *gid);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef JAHSPOTIFY_METADATA_CACHE
+
+#define JAHSPOTIFY_METADATA_CACHE
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define METADATA_GID_SIZE 16
+/* Default number of bytes the metadata cache may hold */
+#define METADATA_CACHE_DEFAULT_BUDGET (8 * 1024 * 1024)
+
+typedef enum metadata_kind {
+	METADATA_NONE = 0,
+	METADATA_TRACK = 1,
+	METADATA_ALBUM = 2,
+	METADATA_ARTIST = 3
+} metadata_kind;
+
+/**
+ * Resolved metadata of a track, album or artist, enough to populate the Java instance
+ * without going back to libspotify. Links are kept as spotify URIs.
+ */
+typedef struct metadata {
+	metadata_kind kind;
+	const char *uri;
+	/// Track title, album or artist name
+	const char *name;
+	/// Album of a track, artist of an album
+	const char *parent;
+	/// Cover of an album
+	const char *cover;
+	/// Track: length, popularity, track number. Album: year, album type.
+	int values[3];
+	int num_artists;
+	const char **artists;
+} metadata;
+
+typedef struct metadata_cache_stats {
+	uint64_t hits;
+	uint64_t misses;
+	/// Misses answered from the on-disk store
+	uint64_t store_hits;
+	uint64_t evictions;
+	uint64_t entries;
+	uint64_t bytes;
+	uint64_t budget;
+} metadata_cache_stats;
+
+int metadata_gid(const char *uri, metadata_kind *kind, uint8_t *gid);
+
+void metadata_cache_put(const metadata *item);
+const metadata *metadata_cache_acquire(metadata_kind kind, const uint8_t *gid, int *stale);
+void metadata_cache_release();
+
+void metadata_cache_set_budget(size_t budget);
+void metadata_cache_read_stats(metadata_cache_stats *stats);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef JAHSPOTIFY_METADATA_STORE
+
+#define JAHSPOTIFY_METADATA_STORE
+
+#include "MetadataCache.h"
+
+#define METADATA_STORE_FILE "jahspotify-metadata.db"
+/* Bump whenever the record layout changes, older files are discarded */
+#define METADATA_STORE_VERSION 1
+/* Number of record slots in the file, must be a power of two */
+#define METADATA_STORE_CAPACITY 16384
+#define METADATA_STORE_RECORD_SIZE 512
+/* Room for the uri, name, parent, cover and artist URIs of a record */
+#define METADATA_STORE_TEXT_SIZE (METADATA_STORE_RECORD_SIZE - 36)
+#define METADATA_STORE_MAX_ARTISTS 32
+/* The store is synced once this many records were written since the last sync */
+#define METADATA_STORE_SYNC_WRITES 256
+/* or once written records are this old, in milliseconds */
+#define METADATA_STORE_SYNC_INTERVAL (30 * 1000)
+
+/**
+ * A record read back from the store, the metadata points into the text and artists arrays.
+ */
+typedef struct stored_metadata {
+	metadata item;
+	const char *artists[METADATA_STORE_MAX_ARTISTS];
+	char text[METADATA_STORE_TEXT_SIZE];
+} stored_metadata;
+
+int metadata_store_open(const char *folder);
+void metadata_store_sync();
+void metadata_store_sync_due(uint64_t now);
+
+int metadata_store_write(const metadata *item, const uint8_t *gid);
+int metadata_store_read(metadata_kind kind, const uint8_t *gid, stored_metadata *stored);
+
+#endif
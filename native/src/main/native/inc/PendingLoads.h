@@ -0,0 +1,53 @@
+#ifndef JAHSPOTIFY_PENDING_LOADS
+
+#define JAHSPOTIFY_PENDING_LOADS
+
+#include <stdint.h>
+#include <jni.h>
+#include <libspotify/api.h>
+
+/* Initial number of buckets in the pending table, must be a power of two */
+#define PENDING_INITIAL_CAPACITY 64
+
+/**
+ * A Java instance waiting for a track, album or artist to be loaded by libspotify.
+ */
+typedef struct media {
+	/// Next item in the same bucket, or in the same completed batch
+	struct media* next;
+	/// Further requests waiting for the same libspotify item
+	struct media* waiting;
+	jobject javainstance;
+	sp_track* track;
+	sp_album* album;
+	sp_artist* artist;
+	int browse;
+	/// Time the request was queued, in milliseconds
+	uint64_t added;
+} media;
+
+/**
+ * Items waiting to be loaded, hashed on the libspotify pointer. Requests for an item which is
+ * already pending are chained onto the existing entry.
+ */
+typedef struct pending_table {
+	media **buckets;
+	unsigned int capacity;
+	/// Number of distinct items pending
+	unsigned int size;
+	/// Number of Java instances waiting, at least size
+	unsigned int waiting;
+	/// Set when the table should be swept on the next event loop iteration
+	int dirty;
+
+	uint64_t completed;
+	uint64_t latency_total;
+	uint64_t latency_max;
+} pending_table;
+
+int pending_add(pending_table *table, media *item);
+media *pending_take_loaded(pending_table *table);
+void pending_completed(pending_table *table, media *item, uint64_t now);
+void pending_clear(JNIEnv *env, pending_table *table);
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef JAHSPOTIFY_SEARCH_REGISTRY
+
+#define JAHSPOTIFY_SEARCH_REGISTRY
+
+#include <stdint.h>
+#include <libspotify/api.h>
+
+/* Default number of searches libspotify runs at the same time, further ones wait in line */
+#define SEARCH_DEFAULT_MAX_RUNNING 4
+/* Default milliseconds from submitting a search until it is given up */
+#define SEARCH_DEFAULT_TIMEOUT 10000
+/* Milliseconds between deadline checks of the event loop while searches are outstanding */
+#define SEARCH_CHECK_INTERVAL 250
+
+typedef enum search_state {
+	/// Waiting in line for a free slot
+	SEARCH_QUEUED,
+	/// Created in libspotify, which will call back
+	SEARCH_RUNNING,
+	/// Cancelled or timed out while running, libspotify still calls back but nobody is told
+	SEARCH_ABANDONED,
+	/// Cancelled or timed out while queued, taken out of the registry
+	SEARCH_EXPIRED
+} search_state;
+
+/**
+ * A search submitted from Java, identified by the token its listener is registered with.
+ */
+typedef struct search_request {
+	struct search_request *next;
+	struct jahspotify_session *session;
+	int32_t token;
+	search_state state;
+
+	char *query;
+	int32_t track_offset;
+	int32_t num_tracks;
+	int32_t album_offset;
+	int32_t num_albums;
+	int32_t artist_offset;
+	int32_t num_artists;
+	int32_t playlist_offset;
+	int32_t num_playlists;
+	sp_search_type type;
+
+	/// Times in milliseconds
+	uint64_t submitted;
+	uint64_t deadline;
+} search_request;
+
+/**
+ * Searches of one session, guarded by its spotify mutex.
+ */
+typedef struct search_registry {
+	/// Running and abandoned searches
+	search_request *running;
+	/// Queued searches, oldest first
+	search_request *queue_head;
+	search_request *queue_tail;
+	unsigned int num_running;
+	unsigned int num_queued;
+
+	unsigned int max_running;
+	uint64_t timeout;
+
+	uint64_t completed;
+	uint64_t failed;
+	uint64_t timed_out;
+	uint64_t cancelled;
+	uint64_t latency_total;
+	uint64_t latency_max;
+} search_registry;
+
+search_request *search_request_create(struct jahspotify_session *session, int32_t token);
+void search_request_free(search_request *request);
+
+void search_registry_submit(search_registry *registry, search_request *request, uint64_t now);
+search_request *search_registry_next(search_registry *registry);
+void search_registry_finish(search_registry *registry, search_request *request, int success, uint64_t now);
+search_request *search_registry_cancel(search_registry *registry, int32_t token);
+search_request *search_registry_expire(search_registry *registry, uint64_t now);
+int search_registry_outstanding(search_registry *registry);
+void search_registry_clear(search_registry *registry);
+
+#endif
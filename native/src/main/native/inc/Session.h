@@ -0,0 +1,149 @@
+#ifndef JAHSPOTIFY_SESSION
+
+#define JAHSPOTIFY_SESSION
+
+#include <stdint.h>
+#include <pthread.h>
+#include <jni.h>
+#include <libspotify/api.h>
+
+#include "JahSpotify.h"
+#include "ImageCache.h"
+#include "BrowseCache.h"
+#include "SearchRegistry.h"
+#include "LibraryIndex.h"
+
+/* Number of playlists read a window at a time which are kept referenced */
+#define SESSION_RETAINED_PLAYLISTS 16
+
+/**
+ * An Image instance waiting for an image, chained onto the load of that image.
+ */
+typedef struct image_waiter {
+	struct image_waiter *next;
+	jobject instance;
+} image_waiter;
+
+/**
+ * An image being loaded by libspotify. Further requests for the same image wait on this load
+ * instead of starting their own.
+ */
+typedef struct image_load {
+	struct image_load *next;
+	sp_image *image;
+	uint8_t id[IMAGE_ID_SIZE];
+	image_waiter *waiters;
+	struct jahspotify_session *session;
+} image_load;
+
+typedef enum session_signal_type {
+	SESSION_SIGNAL_ARTIST,
+	SESSION_SIGNAL_ALBUM,
+	SESSION_SIGNAL_SEARCH_COMPLETE,
+	SESSION_SIGNAL_SEARCH_FAILED,
+	SESSION_SIGNAL_IMAGE
+} session_signal_type;
+
+/**
+ * A Java listener call deferred until the spotify mutex is released, so listeners never run while
+ * libspotify is locked.
+ */
+typedef struct session_signal {
+	struct session_signal *next;
+	session_signal_type type;
+	/// Global reference to the populated instance or search result, NULL for a failed search
+	jobject instance;
+	/// Global reference to the bytes of an image
+	jobject bytes;
+	/// Token of the search
+	int32_t token;
+	/// Why the search failed
+	char *message;
+} session_signal;
+
+/**
+ * State belonging to a single libspotify session. One is created for every JahSpotifyImpl
+ * instance, its address is kept in the _nativeSession field of that instance and handed to
+ * libspotify as userdata so callbacks can find the session they were raised for.
+ */
+typedef struct jahspotify_session {
+	sp_session *sess;
+	sp_session_config config;
+	/// Handle to the current track
+	sp_track *currenttrack;
+
+	jobject connectionListener;
+	jobject playbackListener;
+	jobject searchCompleteListener;
+	jobject mediaLoadedListener;
+	/// PlaylistContainer of the JahSpotifyImpl instance, told about the playlists of the user
+	jobject playlistContainer;
+
+	pthread_mutex_t spotify_mutex;
+	/// Synchronization mutex for the event loop
+	pthread_mutex_t notify_mutex;
+	/// Synchronization condition variable for the event loop
+	pthread_cond_t notify_cond;
+	/// Synchronization variable telling the event loop to process events
+	int notify_do;
+	/// Non-zero when a track has ended and a new one has not yet started
+	int playback_done;
+	int playback_stopped;
+	int stop_after_logout;
+	int stop;
+
+	/// Java instances waiting for metadata to load
+	pending_table loading;
+
+	/// Playlists read a window at a time, referenced so further windows are cheap to read
+	sp_playlist *retained_playlists[SESSION_RETAINED_PLAYLISTS];
+	/// Slot the next retained playlist goes in, the oldest one is released to make room
+	int retained_next;
+
+	/// Images being loaded, guarded by spotify_mutex
+	image_load *image_loads;
+
+	/// Running and recently completed album and artist browses, guarded by spotify_mutex
+	browse_cache browses;
+
+	/// Running and queued searches, guarded by spotify_mutex
+	search_registry searches;
+
+	/// Tracks of the playlist container, changed with spotify_mutex held
+	library_index library;
+
+	/// Playlist instances waiting for their playlist to load, guarded by spotify_mutex
+	struct session_request *playlist_requests;
+
+	/// Listener calls to make once spotify_mutex is released, oldest first, guarded by spotify_mutex
+	session_signal *signals_head;
+	session_signal *signals_tail;
+} jahspotify_session;
+
+/**
+ * Userdata for asynchronous libspotify requests (browse, image, search, playlist callbacks),
+ * ties the Java instance waiting for the result to the session which issued the request.
+ */
+typedef struct session_request {
+	jahspotify_session *session;
+	jobject instance;
+	int32_t token;
+	/// Playlist the request waits for, referenced while it is in playlist_requests
+	sp_playlist *playlist;
+	struct session_request *next;
+} session_request;
+
+jahspotify_session *session_create();
+jahspotify_session *session_from_java(JNIEnv *env, jobject obj);
+void session_destroy(JNIEnv *env, jobject obj, jahspotify_session *session);
+
+session_request *session_request_create(jahspotify_session *session, jobject instance, int32_t token);
+
+session_signal *session_defer_signal(jahspotify_session *session, session_signal_type type, jobject instance);
+session_signal *session_take_signals(jahspotify_session *session);
+void session_drop_signals(JNIEnv *env, session_signal *signal);
+
+void session_retain_playlist(jahspotify_session *session, sp_playlist *playlist);
+void session_release_playlists(jahspotify_session *session);
+
+#endif
@@ -0,0 +1,152 @@
+#include <stdlib.h>
+#include <libspotify/api.h>
+
+#include "BrowseCache.h"
+#include "Logging.h"
+
+/*
+ * Album and artist browses are expensive server round trips. Completed browses are kept for a
+ * while and handed out again, and requests for a browse which is still running wait for it
+ * instead of starting another one. All functions are called with the spotify mutex held.
+ */
+
+static void browse_entry_free(browse_entry *entry) {
+	if (entry->type == BROWSE_ALBUM) {
+		if (entry->result) sp_albumbrowse_release((sp_albumbrowse*) entry->result);
+		sp_album_release((sp_album*) entry->item);
+	} else {
+		if (entry->result) sp_artistbrowse_release((sp_artistbrowse*) entry->result);
+		sp_artist_release((sp_artist*) entry->item);
+	}
+	free(entry);
+}
+
+static void browse_cache_remove(browse_cache *cache, browse_entry **link) {
+	browse_entry *entry = *link;
+	*link = entry->next;
+	if (entry->result) cache->size--;
+	browse_entry_free(entry);
+}
+
+/**
+ * Drops the least recently used completed browses over the limit, except the one which is kept as
+ * its caller still uses its result.
+ */
+static void browse_cache_trim(browse_cache *cache, browse_entry *keep) {
+	browse_entry **link = &cache->entries;
+	unsigned int kept = 0;
+
+	while (*link && cache->size > BROWSE_CACHE_MAX_ENTRIES) {
+		// Running browses are never dropped, their callbacks still refer to them
+		if ((*link)->result && ++kept > BROWSE_CACHE_MAX_ENTRIES && *link != keep) browse_cache_remove(cache, link);
+		else link = &(*link)->next;
+	}
+}
+
+/**
+ * Returns the running browse or fresh completed browse of the item, NULL if it has to be browsed.
+ */
+browse_entry *browse_cache_find(browse_cache *cache, browse_type type, void *item, uint64_t now) {
+	browse_entry **link;
+
+	for (link = &cache->entries; *link; link = &(*link)->next) {
+		browse_entry *entry = *link;
+		if (entry->item != item || entry->type != type) continue;
+
+		if (entry->result && now - entry->completed > BROWSE_CACHE_TTL) {
+			browse_cache_remove(cache, link);
+			cache->expired++;
+			break;
+		}
+
+		if (entry->result) cache->hits++;
+		else cache->coalesced++;
+
+		*link = entry->next;
+		entry->next = cache->entries;
+		cache->entries = entry;
+		return entry;
+	}
+
+	cache->misses++;
+	return NULL;
+}
+
+/**
+ * Adds a running browse of the item, referencing the item until the entry is dropped.
+ */
+browse_entry *browse_cache_add(browse_cache *cache, struct jahspotify_session *session, browse_type type, void *item) {
+	browse_entry *entry = calloc(1, sizeof(browse_entry));
+	if (!entry) {
+		log_error("browsecache", "browse_cache_add", "Could not allocate browse entry");
+		return NULL;
+	}
+
+	if (type == BROWSE_ALBUM) sp_album_add_ref((sp_album*) item);
+	else sp_artist_add_ref((sp_artist*) item);
+
+	entry->type = type;
+	entry->item = item;
+	entry->session = session;
+	entry->next = cache->entries;
+	cache->entries = entry;
+	return entry;
+}
+
+/**
+ * Queues the instance, a global reference, on the running browse. Returns non-zero if it could not be queued.
+ */
+int browse_cache_wait(browse_entry *entry, jobject instance) {
+	browse_waiter *waiter = calloc(1, sizeof(browse_waiter));
+	if (!waiter) {
+		log_error("browsecache", "browse_cache_wait", "Could not allocate browse waiter");
+		return 1;
+	}
+	waiter->instance = instance;
+	waiter->next = entry->waiters;
+	entry->waiters = waiter;
+	return 0;
+}
+
+/**
+ * Marks the browse completed and returns the instances which waited for it, the caller signals
+ * and frees them. The cache takes over the reference to the result; a NULL result, for a failed
+ * browse, drops the entry so the next request browses again.
+ */
+browse_waiter *browse_cache_complete(browse_cache *cache, browse_entry *entry, void *result, uint64_t now) {
+	browse_waiter *waiters = entry->waiters;
+	browse_entry **link;
+
+	entry->waiters = NULL;
+	if (result) {
+		entry->result = result;
+		entry->completed = now;
+		cache->size++;
+		browse_cache_trim(cache, entry);
+		return waiters;
+	}
+
+	for (link = &cache->entries; *link; link = &(*link)->next) {
+		if (*link == entry) {
+			browse_cache_remove(cache, link);
+			break;
+		}
+	}
+	return waiters;
+}
+
+/**
+ * Drops all entries, called once libspotify no longer calls back for running browses.
+ */
+void browse_cache_clear(JNIEnv *env, browse_cache *cache) {
+	while (cache->entries) {
+		browse_waiter *waiter = cache->entries->waiters, *next;
+		for (; waiter; waiter = next) {
+			next = waiter->next;
+			(*env)->DeleteGlobalRef(env, waiter->instance);
+			free(waiter);
+		}
+		browse_cache_remove(cache, &cache->entries);
+	}
+	cache->size = 0;
+}
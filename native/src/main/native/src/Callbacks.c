@@ -6,48 +6,52 @@
 #include <stdlib.h>
 
 #include "Callbacks.h"
+#include "JNICache.h"
 #include "JahSpotify.h"
 #include "JNIHelpers.h"
 #include "ThreadHelpers.h"
 #include "Logging.h"
 
 extern void populateJAlbumInstanceFromAlbumBrowse(JNIEnv *env, sp_album *album, sp_albumbrowse *albumBrowse, jobject albumInstance);
-extern void populateJArtistInstanceFromArtistBrowse(JNIEnv *env, sp_artistbrowse *artistBrowse, jobject artist);
+extern void populateJArtistInstanceFromArtistBrowse(JNIEnv *env, jahspotify_session *session, sp_artistbrowse *artistBrowse, jobject artist);
 extern jobject createJLinkInstance(JNIEnv *env, sp_link *link);
 extern jobject createJPlaylistInstance(JNIEnv *env, sp_link* link, const char* name, sp_link* image);
 
-extern sp_session *g_sess;
-
-extern jobject g_connectionListener;
-extern jobject g_playbackListener;
-extern jobject g_searchCompleteListener;
-extern jobject g_mediaLoadedListener;
-
 extern jclass g_playbackListenerClass;
 extern jclass g_connectionListenerClass;
 extern jclass g_searchCompleteListenerClass;
-extern jclass g_nativeSearchResultClass;
 extern jclass g_mediaLoadedListenerClass;
 
+/**
+ * Adds the object to the collection and drops the local reference to the object.
+ */
 jint addObjectToCollection(JNIEnv *env, jobject collection, jobject object) {
-	jclass clazz;
-	jmethodID methodID;
-
-	clazz = (*env)->GetObjectClass(env, collection);
-	if (clazz == NULL) return 1;
-
-	methodID = (*env)->GetMethodID(env, clazz, "add", "(Ljava/lang/Object;)Z");
-	if (methodID == NULL) return 1;
+	if (!collection || !object) {
+		if (object) (*env)->DeleteLocalRef(env, object);
+		return 1;
+	}
 
-	// Invoke the method
-	(*env)->CallBooleanMethod(env, collection, methodID, object);
+	(*env)->CallBooleanMethod(env, collection, JMETHOD(COLLECTION_ADD), object);
 	if (checkException(env) != 0) {
 		log_error("callbacks", "addObjectToCollection", "Exception while adding object to collection");
 	}
-
+	(*env)->DeleteLocalRef(env, object);
 	return 0;
 }
 
+/**
+ * Creates an empty list and sets it on the field, returns a local reference to the list.
+ */
+static jobject createListField(JNIEnv *env, jobject instance, jfieldID field) {
+	jobject list = (*env)->NewObject(env, JCLASS(ARRAY_LIST), JMETHOD(ARRAY_LIST_INIT));
+	if (!list) {
+		log_error("callbacks", "createListField", "Could not create list");
+		return NULL;
+	}
+	(*env)->SetObjectField(env, instance, field, list);
+	return list;
+}
+
 void startPlaybackSignalled() {
 //	JNIEnv* env = NULL;
 //	int result;
@@ -108,11 +112,11 @@ void startPlaybackSignalled() {
 //     }
 }
 
-int signalConnected() {
+int signalConnected(jahspotify_session *session) {
 	JNIEnv* env = NULL;
 	jmethodID method;
 
-	if (!g_connectionListener) {
+	if (!session->connectionListener) {
 		log_error("jahspotify", "signalConnected", "No connection listener registered");
 		return 1;
 	}
@@ -128,7 +132,7 @@ int signalConnected() {
 		goto fail;
 	}
 
-	(*env)->CallVoidMethod(env, g_connectionListener, method);
+	(*env)->CallVoidMethod(env, session->connectionListener, method);
 	checkException(env);
 
 	goto exit;
@@ -140,11 +144,11 @@ int signalConnected() {
 	return 0;
 }
 
-int signalInitialized(int initialized) {
+int signalInitialized(jahspotify_session *session, int initialized) {
 	JNIEnv* env = NULL;
 	jmethodID method;
 
-	if (!g_connectionListener) {
+	if (!session->connectionListener) {
 		log_error("jahspotify", "signalInitialized", "No connection listener registered");
 		return 1;
 	}
@@ -160,7 +164,7 @@ int signalInitialized(int initialized) {
 		goto fail;
 	}
 
-	(*env)->CallVoidMethod(env, g_connectionListener, method, initialized == 1 ? JNI_TRUE : JNI_FALSE);
+	(*env)->CallVoidMethod(env, session->connectionListener, method, initialized == 1 ? JNI_TRUE : JNI_FALSE);
 	checkException(env);
 
 	goto exit;
@@ -172,11 +176,11 @@ int signalInitialized(int initialized) {
 	return 0;
 }
 
-int signalDisconnected() {
+int signalDisconnected(jahspotify_session *session) {
 	JNIEnv* env = NULL;
 	jmethodID method;
 
-	if (!g_connectionListener) {
+	if (!session->connectionListener) {
 		log_error("jahspotify", "signalDisconnected", "No connection listener registered");
 		return 1;
 	}
@@ -192,7 +196,7 @@ int signalDisconnected() {
 		goto fail;
 	}
 
-	(*env)->CallVoidMethod(env, g_connectionListener, method);
+	(*env)->CallVoidMethod(env, session->connectionListener, method);
 	checkException(env);
 
 	goto exit;
@@ -204,23 +208,23 @@ int signalDisconnected() {
 	return 0;
 }
 
-int signalLoggedOut() {
+int signalLoggedOut(jahspotify_session *session) {
 	JNIEnv* env = NULL;
 	if (!retrieveEnv((JNIEnv*) &env)) {
 		log_info("callbacks", "signalLoggedOut", "Error during callback");
 	} else {
-		invokeVoidMethod(env, g_connectionListener, "loggedOut");
+		invokeVoidMethod(env, session->connectionListener, "loggedOut");
 		log_info("callbacks", "signalLoggedOut", "Logout signalled");
 	}
 	detachThread();
 	return 0;
 }
 
-int signalLoggedIn(int loggedIn) {
+int signalLoggedIn(jahspotify_session *session, int loggedIn) {
 	JNIEnv* env = NULL;
 	jmethodID method;
 
-	if (!g_connectionListener) {
+	if (!session->connectionListener) {
 		log_error("jahspotify", "signalLoggedIn", "No connection listener registered");
 		return 1;
 	}
@@ -236,7 +240,7 @@ int signalLoggedIn(int loggedIn) {
 		goto fail;
 	}
 
-	(*env)->CallVoidMethod(env, g_connectionListener, method, loggedIn == 1 ? JNI_TRUE : JNI_FALSE);
+	(*env)->CallVoidMethod(env, session->connectionListener, method, loggedIn == 1 ? JNI_TRUE : JNI_FALSE);
 	if (checkException(env) != 0) {
 		log_error("callbacks", "signalLoggedIn", "Exception while calling listener");
 		goto fail;
@@ -250,23 +254,23 @@ int signalLoggedIn(int loggedIn) {
 	return 0;
 }
 
-int signalPlaylistsLoaded() {
+int signalPlaylistsLoaded(jahspotify_session *session) {
 	JNIEnv* env = NULL;
 	if (!retrieveEnv((JNIEnv*) &env)) {
 		log_error("callbacks", "signalPlaylistsLoaded", "Error sending signal about playlists loaded.");
 		detachThread();
 		return -1;
 	}
-	invokeVoidMethod(env, g_connectionListener, "playlistsLoaded");
+	invokeVoidMethod(env, session->connectionListener, "playlistsLoaded");
 	return 0;
 }
 
-void signalBlobUpdated(const char* blob) {
+void signalBlobUpdated(jahspotify_session *session, const char* blob) {
 	JNIEnv* env = NULL;
 	jmethodID method;
 	jstring blobStr = NULL;
 
-	if (!g_connectionListener) {
+	if (!session->connectionListener) {
 		log_error("jahspotify", "signalLoggedIn", "No connection listener registered");
 		return;
 	}
@@ -283,7 +287,7 @@ void signalBlobUpdated(const char* blob) {
 
 	blobStr = (*env)->NewStringUTF(env, blob);
 
-	(*env)->CallVoidMethod(env, g_connectionListener, method, blobStr);
+	(*env)->CallVoidMethod(env, session->connectionListener, method, blobStr);
 	if (checkException(env) != 0) {
 		log_error("callbacks", "signalLoggedIn", "Exception while calling listener");
 		goto fail;
@@ -300,8 +304,8 @@ void signalBlobUpdated(const char* blob) {
 	detachThread();
 }
 
-int signalTrackEnded(char *uri, bool forcedTrackEnd) {
-	if (!g_playbackListener) {
+int signalTrackEnded(jahspotify_session *session, char *uri, bool forcedTrackEnd) {
+	if (!session->playbackListener) {
 		log_error("jahspotify", "signalTrackEnded", "No playback listener");
 		return 1;
 	}
@@ -329,7 +333,7 @@ int signalTrackEnded(char *uri, bool forcedTrackEnd) {
 		goto fail;
 	}
 
-	(*env)->CallVoidMethod(env, g_playbackListener, method, uriStr, forcedTrackEnd);
+	(*env)->CallVoidMethod(env, session->playbackListener, method, uriStr, forcedTrackEnd);
 	if (checkException(env) != 0) {
 		log_error("callbacks", "signalTrackEnded", "Exception while calling callback");
 		goto fail;
@@ -345,13 +349,13 @@ int signalTrackEnded(char *uri, bool forcedTrackEnd) {
 	return 0;
 }
 
-int signalTrackStarted(const char *uri) {
+int signalTrackStarted(jahspotify_session *session, const char *uri) {
 	JNIEnv* env = NULL;
 	jmethodID method;
 	jstring uriStr;
 
 	log_debug("callbacks", "signalTrackStarted", "URI: %s", uri);
-	if (!g_playbackListener) {
+	if (!session->playbackListener) {
 		log_error("callbacks", "signalTrackStarted", "No playback listener");
 		return 1;
 	}
@@ -375,7 +379,7 @@ int signalTrackStarted(const char *uri) {
 		goto fail;
 	}
 
-	(*env)->CallVoidMethod(env, g_playbackListener, method, uriStr);
+	(*env)->CallVoidMethod(env, session->playbackListener, method, uriStr);
 	checkException(env);
 
 	goto exit;
@@ -388,11 +392,11 @@ int signalTrackStarted(const char *uri) {
 	return 0;
 }
 
-void signalPlayTokenLost() {
+void signalPlayTokenLost(jahspotify_session *session) {
 	JNIEnv* env = NULL;
 	jmethodID method;
 
-	if (!g_playbackListener) {
+	if (!session->playbackListener) {
 		log_error("callbacks", "signalPlayTokenLost", "No playback listener");
 		return;
 	}
@@ -407,7 +411,7 @@ void signalPlayTokenLost() {
 		goto fail;
 	}
 
-	(*env)->CallVoidMethod(env, g_playbackListener, method);
+	(*env)->CallVoidMethod(env, session->playbackListener, method);
 	checkException(env);
 	goto exit;
 
@@ -416,41 +420,18 @@ void signalPlayTokenLost() {
 	exit: detachThread();
 }
 
-int signalArtistBrowseLoaded(sp_artistbrowse *artistBrowse, jobject artistInstance) {
-	JNIEnv* env = NULL;
-	jmethodID aMethod;
-
+/**
+ * Fills in the Artist instance from the browse and releases the reference to the browse handed
+ * in. No listener is called and the instance is not marked loaded yet.
+ */
+int populateArtistFromBrowse(JNIEnv *env, jahspotify_session *session, sp_artistbrowse *artistBrowse, jobject artistInstance) {
 	sp_link *artistLink = NULL;
-	jclass jClass;
-
-	log_debug("jahspotify", "signalArtistBrowseLoaded", "Artist browse loaded");
-
-	if (!retrieveEnv((JNIEnv*) &env)) {
-		goto fail;
-	}
-
-	jClass = (*env)->FindClass(env, "jahspotify/media/Artist");
-	if (jClass == NULL) {
-		log_error("jahspotify", "createJArtistInstance", "Could not load jahnotify.media.Artist");
-		goto fail;
-	}
-
-	if (!g_mediaLoadedListener) {
-		log_error("jahspotify", "signalArtistBrowseLoaded", "No playlist media loaded listener registered");
-		goto fail;
-	}
-
-	aMethod = (*env)->GetMethodID(env, g_mediaLoadedListenerClass, "artist", "(ILjahspotify/media/Artist;)V");
-
-	if (aMethod == NULL) {
-		log_error("callbacks", "signalArtistBrowseLoaded", "Could not load callback method artist(int,artist) on class NativeMediaLoadedListener");
-		goto fail;
-	}
+	int result = 1;
 
 	sp_artist *artist = sp_artistbrowse_artist(artistBrowse);
 	if (!artist) {
-		log_error("callbacks", "signalArtistBrowseLoaded", "Could not load artist from ArtistBrowse");
-		goto fail;
+		log_error("callbacks", "populateArtistFromBrowse", "Could not load artist from ArtistBrowse");
+		goto exit;
 	}
 
 	sp_artist_add_ref(artist);
@@ -459,109 +440,89 @@ int signalArtistBrowseLoaded(sp_artistbrowse *artistBrowse, jobject artistInstan
 
 	sp_link_add_ref(artistLink);
 
-	jobject artistJLink = createJLinkInstance(env, artistLink);
-
-	setObjectObjectField(env, artistInstance, "id", "Ljahspotify/media/Link;", artistJLink);
+	setObjectField(env, artistInstance, JFIELD(MEDIA_ID), createJLinkInstance(env, artistLink));
 
 	sp_link_release(artistLink);
 
-	setObjectStringField(env, artistInstance, "name", sp_artist_name(artist));
+	setStringField(env, artistInstance, JFIELD(ARTIST_NAME), sp_artist_name(artist));
 
 	sp_artist_release(artist);
 
 	// Convert the instance to an artist
-	// Pass it up in the callback
-	populateJArtistInstanceFromArtistBrowse(env, artistBrowse, artistInstance);
+	populateJArtistInstanceFromArtistBrowse(env, session, artistBrowse, artistInstance);
+	result = 0;
 
-	invokeVoidMethod_Z(env, artistInstance, "setLoaded", JNI_TRUE);
-	(*env)->CallVoidMethod(env, g_mediaLoadedListener, aMethod, 0, artistInstance);
-	if (checkException(env) != 0) {
-		log_error("callbacks", "signalArtistBrowseLoaded", "Exception while calling callback");
-		goto fail;
-	}
-
-	goto exit;
-
-	fail: log_error("jahspotify", "signalArtistBrowseLoaded", "Error occurred while processing callback");
-
-	exit: (*env)->DeleteGlobalRef(env, artistInstance);
-	if (artistBrowse) {
+	exit: if (artistBrowse) {
 		sp_artistbrowse_release(artistBrowse);
 	}
-	detachThread();
-	return 0;
+	return result;
 }
 
-int signalImageLoaded(sp_image *image, jobject imageInstance) {
-	if (!g_mediaLoadedListener) {
-		log_error("jahspotify", "signalImageLoaded", "No playlist media loaded listener registered");
-		return 1;
-	}
-
-	JNIEnv* env = NULL;
-	jmethodID method;
+/**
+ * Marks the populated Artist instance loaded, passes it up to the media loaded listener and
+ * releases the global reference to it.
+ */
+int notifyArtistLoaded(JNIEnv *env, jahspotify_session *session, jobject artistInstance) {
+	log_debug("jahspotify", "notifyArtistLoaded", "Artist browse loaded");
 
-	log_debug("callbacks", "signalImageLoaded", "Image loaded: token: %d\n", 0);
-
-	if (!retrieveEnv((JNIEnv*) &env)) {
-		goto fail;
+	if (!session->mediaLoadedListener) {
+		log_error("jahspotify", "notifyArtistLoaded", "No playlist media loaded listener registered");
+		goto exit;
 	}
 
-	method = (*env)->GetMethodID(env, g_mediaLoadedListenerClass, "image", "(ILjahspotify/media/Link;Ljahspotify/media/ImageSize;[B)V");
-
-	if (method == NULL) {
-		log_error("callbacks", "signalImageLoaded", "Could not load callback method image(Link) on class NativeMediaLoadedListener");
-		goto fail;
-	}
-
-	sp_link *link = sp_link_create_from_image(image);
-	sp_link_add_ref(link);
-	jobject jLink = createJLinkInstance(env, link);
-	sp_link_release(link);
-
-	size_t size;
-	const void* pData = sp_image_data(image, &size);
-	jbyteArray byteArray = (*env)->NewByteArray(env, size);
-	jboolean isCopy = 0;
-	jbyte* pByteData = (*env)->GetByteArrayElements(env, byteArray, &isCopy);
-	size_t i;
-	for (i = 0; i < size; i++)
-		pByteData[i] = ((byte*) pData)[i];
-	(*env)->ReleaseByteArrayElements(env, byteArray, pByteData, 0);
-	setObjectObjectField(env, imageInstance, "bytes", "[B", byteArray);
-	(*env)->DeleteLocalRef(env, byteArray);
-
-	invokeVoidMethod_Z(env, imageInstance, "setLoaded", JNI_TRUE);
-	(*env)->CallVoidMethod(env, g_mediaLoadedListener, method, 0, jLink, NULL, NULL);
-
+	setLoaded(env, artistInstance);
+	(*env)->CallVoidMethod(env, session->mediaLoadedListener, JMETHOD(MEDIA_LOADED_ARTIST), 0, artistInstance);
 	if (checkException(env) != 0) {
-		log_error("callbacks", "signalImageLoaded", "Exception while calling listener");
-		goto fail;
+		log_error("callbacks", "notifyArtistLoaded", "Exception while calling callback");
 	}
 
-	log_debug("callbacks", "signalImageLoaded", "Callback invokved");
-
-	goto exit;
+	exit: (*env)->DeleteGlobalRef(env, artistInstance);
+	return 0;
+}
 
-	fail:
+/**
+ * Populates the Artist instance from the browse and releases the global reference to the instance
+ * and the reference to the browse handed in.
+ */
+int signalArtistBrowseLoaded(JNIEnv *env, jahspotify_session *session, sp_artistbrowse *artistBrowse, jobject artistInstance) {
+	if (populateArtistFromBrowse(env, session, artistBrowse, artistInstance) != 0) {
+		log_error("jahspotify", "signalArtistBrowseLoaded", "Error occurred while processing callback");
+		(*env)->DeleteGlobalRef(env, artistInstance);
+		return 0;
+	}
+	return notifyArtistLoaded(env, session, artistInstance);
+}
 
-	exit:
+/**
+ * Hands the bytes to the waiting Image instance and releases the global reference to it. The
+ * same array may be handed to several instances waiting for the same image.
+ */
+int signalImageLoaded(JNIEnv *env, jahspotify_session *session, jobject imageInstance, jbyteArray bytes) {
+	log_debug("callbacks", "signalImageLoaded", "Image loaded");
+
+	setObjectField(env, imageInstance, JFIELD(IMAGE_BYTES), bytes);
+	setLoaded(env, imageInstance);
+
+	if (session->mediaLoadedListener) {
+		jobject jLink = (*env)->GetObjectField(env, imageInstance, JFIELD(IMAGE_ID));
+		(*env)->CallVoidMethod(env, session->mediaLoadedListener, JMETHOD(MEDIA_LOADED_IMAGE), 0, jLink, NULL, NULL);
+		if (checkException(env) != 0) {
+			log_error("callbacks", "signalImageLoaded", "Exception while calling listener");
+		}
+		if (jLink) (*env)->DeleteLocalRef(env, jLink);
+	}
 
 	(*env)->DeleteGlobalRef(env, imageInstance);
-	sp_image_release(image);
-	detachThread();
-
 	return 0;
 }
 
-int signalPlaylistLoaded(jobject playlist) {
-	if (!g_mediaLoadedListener) {
+int signalPlaylistLoaded(jahspotify_session *session, jobject playlist) {
+	if (!session->mediaLoadedListener) {
 		log_error("jahspotify", "signalPlaylistLoaded", "No playlist media loaded listener registered");
 		return 1;
 	}
 
 	JNIEnv* env = NULL;
-	jmethodID method;
 
 	log_debug("jahspotify", "signalPlaylistLoaded", "Playlist loaded");
 
@@ -569,13 +530,10 @@ int signalPlaylistLoaded(jobject playlist) {
 		goto fail;
 	}
 
-	method = (*env)->GetMethodID(env, g_mediaLoadedListenerClass, "playlist", "(Ljahspotify/media/Playlist;)V");
-	if (method == NULL) {
-		log_error("callbacks", "signalPlaylistLoaded", "Could not load callback method playlist(Link) on class NativeMediaLoadedListener");
-		goto fail;
+	(*env)->CallVoidMethod(env, session->mediaLoadedListener, JMETHOD(MEDIA_LOADED_PLAYLIST), playlist);
+	if (checkException(env) != 0) {
+		log_error("callbacks", "signalPlaylistLoaded", "Exception while calling listener");
 	}
-
-	(*env)->CallVoidMethod(env, g_mediaLoadedListener, method, playlist);
 	log_debug("callbacks", "signalPlaylistLoaded", "Callback invokved");
 
 	goto exit;
@@ -586,43 +544,20 @@ int signalPlaylistLoaded(jobject playlist) {
 	return 0;
 }
 
-int signalAlbumBrowseLoaded(sp_albumbrowse *albumBrowse, jobject albumInstance) {
-	JNIEnv* env = NULL;
-	jmethodID aMethod;
-
+/**
+ * Fills in the Album instance from the browse and releases the reference to the browse handed
+ * in. No listener is called and the instance is not marked loaded yet.
+ */
+int populateAlbumFromBrowse(JNIEnv *env, sp_albumbrowse *albumBrowse, jobject albumInstance) {
 	sp_album *album = NULL;
 	sp_link *albumLink = NULL;
-	jclass jClass;
-
-	if (!g_mediaLoadedListener) {
-		log_error("jahspotify", "signalAlbumBrowseLoaded", "No album media loaded listener registered");
-		goto fail;
-	}
-
-	log_debug("jahspotify", "signalAlbumBrowseLoaded", "Albumbrowse loaded");
-
-	if (!retrieveEnv((JNIEnv*) &env)) {
-		goto fail;
-	}
-
-	jClass = (*env)->FindClass(env, "jahspotify/media/Album");
-	if (jClass == NULL) {
-		log_error("jahspotify", "signalAlbumBrowseLoaded", "Could not load jahnotify.media.Album");
-		goto fail;
-	}
-
-	aMethod = (*env)->GetMethodID(env, g_mediaLoadedListenerClass, "album", "(ILjahspotify/media/Album;)V");
-
-	if (aMethod == NULL) {
-		log_error("callbacks", "signalAlbumBrowseLoaded", "Could not load callback method album(int,album) on class NativeMediaLoadedListener");
-		goto fail;
-	}
+	int result = 1;
 
 	album = sp_albumbrowse_album(albumBrowse);
 
 	if (!album) {
-		log_error("callbacks", "signalAlbumBrowseLoaded", "Could not load album from AlbumBrowse");
-		goto fail;
+		log_error("callbacks", "populateAlbumFromBrowse", "Could not load album from AlbumBrowse");
+		goto exit;
 	}
 	sp_album_add_ref(album);
 
@@ -630,30 +565,15 @@ int signalAlbumBrowseLoaded(sp_albumbrowse *albumBrowse, jobject albumInstance)
 
 	sp_link_add_ref(albumLink);
 
-	jobject albumJLink = createJLinkInstance(env, albumLink);
+	setObjectField(env, albumInstance, JFIELD(MEDIA_ID), createJLinkInstance(env, albumLink));
 
-	setObjectObjectField(env, albumInstance, "id", "Ljahspotify/media/Link;", albumJLink);
+	setStringField(env, albumInstance, JFIELD(ALBUM_NAME), sp_album_name(album));
 
-	setObjectStringField(env, albumInstance, "name", sp_album_name(album));
-
-	// Convert the instance to an artist
-	// Pass it up in the callback
+	// Convert the instance to an album
 	populateJAlbumInstanceFromAlbumBrowse(env, album, albumBrowse, albumInstance);
+	result = 0;
 
-	(*env)->CallVoidMethod(env, g_mediaLoadedListener, aMethod, 0, albumInstance);
-	invokeVoidMethod_Z(env, albumInstance, "setLoaded", JNI_TRUE);
-
-	if (checkException(env) != 0) {
-		log_error("callbacks", "signalAlbumBrowseLoaded", "Exception while calling callback");
-		goto fail;
-	}
-
-	goto exit;
-
-	fail:
-
-	exit: (*env)->DeleteGlobalRef(env, albumInstance);
-	if (albumLink) {
+	exit: if (albumLink) {
 		sp_link_release(albumLink);
 	}
 
@@ -663,10 +583,43 @@ int signalAlbumBrowseLoaded(sp_albumbrowse *albumBrowse, jobject albumInstance)
 	if (albumBrowse) {
 		sp_albumbrowse_release(albumBrowse);
 	}
-	detachThread();
+	return result;
+}
+
+/**
+ * Marks the populated Album instance loaded, passes it up to the media loaded listener and
+ * releases the global reference to it.
+ */
+int notifyAlbumLoaded(JNIEnv *env, jahspotify_session *session, jobject albumInstance) {
+	log_debug("jahspotify", "notifyAlbumLoaded", "Albumbrowse loaded");
+
+	if (!session->mediaLoadedListener) {
+		log_error("jahspotify", "notifyAlbumLoaded", "No album media loaded listener registered");
+		goto exit;
+	}
+
+	setLoaded(env, albumInstance);
+	(*env)->CallVoidMethod(env, session->mediaLoadedListener, JMETHOD(MEDIA_LOADED_ALBUM), 0, albumInstance);
+	if (checkException(env) != 0) {
+		log_error("callbacks", "notifyAlbumLoaded", "Exception while calling callback");
+	}
+
+	exit: (*env)->DeleteGlobalRef(env, albumInstance);
 	return 0;
 }
 
+/**
+ * Populates the Album instance from the browse and releases the global reference to the instance
+ * and the reference to the browse handed in.
+ */
+int signalAlbumBrowseLoaded(JNIEnv *env, jahspotify_session *session, sp_albumbrowse *albumBrowse, jobject albumInstance) {
+	if (populateAlbumFromBrowse(env, albumBrowse, albumInstance) != 0) {
+		(*env)->DeleteGlobalRef(env, albumInstance);
+		return 0;
+	}
+	return notifyAlbumLoaded(env, session, albumInstance);
+}
+
 // int signalTrackLoaded(sp_track *track, int32_t token)
 // {
 //   if (!g_mediaLoadedListener)
@@ -719,10 +672,10 @@ int signalAlbumBrowseLoaded(sp_albumbrowse *albumBrowse, jobject albumInstance)
 // }
 
 jobject createSearchResult(JNIEnv* env) {
-	return createInstanceFromJClass(env, g_nativeSearchResultClass);
+	return (*env)->NewObject(env, JCLASS(SEARCH_RESULT), JMETHOD(SEARCH_RESULT_INIT));
 }
 
-void signalToplistComplete(sp_toplistbrowse *result, jobject nativeSearchResult) {
+void signalToplistComplete(jahspotify_session *session, sp_toplistbrowse *result, jobject nativeSearchResult) {
 	sp_toplistbrowse_add_ref(result);
 	JNIEnv* env = NULL;
 	jobject jLink;
@@ -739,13 +692,12 @@ void signalToplistComplete(sp_toplistbrowse *result, jobject nativeSearchResult)
 		goto fail;
 	}
 
-	trackLinkCollection = createInstance(env, "java/util/ArrayList");
-	setObjectObjectField(env, nativeSearchResult, "tracksFound", "Ljava/util/List;", trackLinkCollection);
+	trackLinkCollection = createListField(env, nativeSearchResult, JFIELD(SEARCH_RESULT_TRACKS));
 
 	numResultsFound = sp_toplistbrowse_num_tracks(result);
 	for (index = 0; index < numResultsFound; index++) {
 		sp_track *track = sp_toplistbrowse_track(result, index);
-		if (track && sp_track_get_availability(g_sess, track) == SP_TRACK_AVAILABILITY_AVAILABLE) {
+		if (track && sp_track_get_availability(session->sess, track) == SP_TRACK_AVAILABILITY_AVAILABLE) {
 			sp_track_add_ref(track);
 
 			if (sp_track_is_loaded(track)) {
@@ -764,8 +716,7 @@ void signalToplistComplete(sp_toplistbrowse *result, jobject nativeSearchResult)
 	}
 	if (trackLinkCollection) (*env)->DeleteLocalRef(env, trackLinkCollection);
 
-	albumLinkCollection = createInstance(env, "java/util/ArrayList");
-	setObjectObjectField(env, nativeSearchResult, "albumsFound", "Ljava/util/List;", albumLinkCollection);
+	albumLinkCollection = createListField(env, nativeSearchResult, JFIELD(SEARCH_RESULT_ALBUMS));
 
 	numResultsFound = sp_toplistbrowse_num_albums(result);
 	for (index = 0; index < numResultsFound; index++) {
@@ -789,8 +740,7 @@ void signalToplistComplete(sp_toplistbrowse *result, jobject nativeSearchResult)
 	}
 	if (albumLinkCollection) (*env)->DeleteLocalRef(env, albumLinkCollection);
 
-	artistLinkCollection = createInstance(env, "java/util/ArrayList");
-	setObjectObjectField(env, nativeSearchResult, "artistsFound", "Ljava/util/List;", artistLinkCollection);
+	artistLinkCollection = createListField(env, nativeSearchResult, JFIELD(SEARCH_RESULT_ARTISTS));
 
 	numResultsFound = sp_toplistbrowse_num_artists(result);
 	for (index = 0; index < numResultsFound; index++) {
@@ -814,7 +764,7 @@ void signalToplistComplete(sp_toplistbrowse *result, jobject nativeSearchResult)
 	}
 	if (artistLinkCollection) (*env)->DeleteLocalRef(env, artistLinkCollection);
 
-	invokeVoidMethod_Z(env, nativeSearchResult, "setLoaded", JNI_TRUE);
+	setLoaded(env, nativeSearchResult);
 
 	goto exit;
 
@@ -825,15 +775,12 @@ void signalToplistComplete(sp_toplistbrowse *result, jobject nativeSearchResult)
 	detachThread();
 }
 
-int signalSearchComplete(sp_search *search, int32_t token) {
-	if (!g_searchCompleteListener) {
-		log_error("jahspotify", "signalSearchComplete", "No playlist media loaded listener registered");
-		return 1;
-	}
-
+/**
+ * Reads the results of the completed search into a new NativeSearchResult. Called with the spotify
+ * mutex held, no listener is called.
+ */
+jobject createJSearchResult(JNIEnv *env, jahspotify_session *session, sp_search *search) {
 	sp_search_add_ref(search);
-	JNIEnv* env = NULL;
-	jmethodID method;
 	jobject jLink;
 	jobject nativeSearchResult;
 	jobject trackLinkCollection;
@@ -843,22 +790,20 @@ int signalSearchComplete(sp_search *search, int32_t token) {
 	int numResultsFound = 0;
 	int index = 0;
 
-	log_debug("jahspotify", "signalSearchComplete", "Search complete: token: %d", token);
-
-	if (!retrieveEnv((JNIEnv*) &env)) {
-		goto fail;
-	}
-
 	// Create the Native Search Result instance
-	nativeSearchResult = createInstanceFromJClass(env, g_nativeSearchResultClass);
+	nativeSearchResult = (*env)->NewObject(env, JCLASS(SEARCH_RESULT), JMETHOD(SEARCH_RESULT_INIT));
+	if (!nativeSearchResult) {
+		log_error("jahspotify", "createJSearchResult", "Could not create search result");
+		sp_search_release(search);
+		return NULL;
+	}
 
-	trackLinkCollection = createInstance(env, "java/util/ArrayList");
-	setObjectObjectField(env, nativeSearchResult, "tracksFound", "Ljava/util/List;", trackLinkCollection);
+	trackLinkCollection = createListField(env, nativeSearchResult, JFIELD(SEARCH_RESULT_TRACKS));
 
 	numResultsFound = sp_search_num_tracks(search);
 	for (index = 0; index < numResultsFound; index++) {
 		sp_track *track = sp_search_track(search, index);
-		if (track && sp_track_get_availability(g_sess, track) == SP_TRACK_AVAILABILITY_AVAILABLE) {
+		if (track && sp_track_get_availability(session->sess, track) == SP_TRACK_AVAILABILITY_AVAILABLE) {
 			sp_track_add_ref(track);
 
 			if (sp_track_is_loaded(track)) {
@@ -879,8 +824,7 @@ int signalSearchComplete(sp_search *search, int32_t token) {
 	}
 	if (trackLinkCollection) (*env)->DeleteLocalRef(env, trackLinkCollection);
 
-	albumLinkCollection = createInstance(env, "java/util/ArrayList");
-	setObjectObjectField(env, nativeSearchResult, "albumsFound", "Ljava/util/List;", albumLinkCollection);
+	albumLinkCollection = createListField(env, nativeSearchResult, JFIELD(SEARCH_RESULT_ALBUMS));
 
 	numResultsFound = sp_search_num_albums(search);
 	for (index = 0; index < numResultsFound; index++) {
@@ -906,8 +850,7 @@ int signalSearchComplete(sp_search *search, int32_t token) {
 	}
 	if (albumLinkCollection) (*env)->DeleteLocalRef(env, albumLinkCollection);
 
-	artistLinkCollection = createInstance(env, "java/util/ArrayList");
-	setObjectObjectField(env, nativeSearchResult, "artistsFound", "Ljava/util/List;", artistLinkCollection);
+	artistLinkCollection = createListField(env, nativeSearchResult, JFIELD(SEARCH_RESULT_ARTISTS));
 
 	numResultsFound = sp_search_num_artists(search);
 	for (index = 0; index < numResultsFound; index++) {
@@ -933,8 +876,7 @@ int signalSearchComplete(sp_search *search, int32_t token) {
 	}
 	if (artistLinkCollection) (*env)->DeleteLocalRef(env, artistLinkCollection);
 
-	playlistLinkCollection = createInstance(env, "java/util/ArrayList");
-	setObjectObjectField(env, nativeSearchResult, "playlistsFound", "Ljava/util/List;", playlistLinkCollection);
+	playlistLinkCollection = createListField(env, nativeSearchResult, JFIELD(SEARCH_RESULT_PLAYLISTS));
 
 	numResultsFound = sp_search_num_playlists(search);
 	for (index = 0; index < numResultsFound; index++) {
@@ -949,39 +891,75 @@ int signalSearchComplete(sp_search *search, int32_t token) {
 	}
 	if (playlistLinkCollection) (*env)->DeleteLocalRef(env, playlistLinkCollection);
 
-	setObjectIntField(env, nativeSearchResult, "totalNumTracks", sp_search_total_tracks(search));
-	setObjectIntField(env, nativeSearchResult, "trackOffset", sp_search_num_tracks(search));
+	(*env)->SetIntField(env, nativeSearchResult, JFIELD(SEARCH_RESULT_TOTAL_TRACKS), sp_search_total_tracks(search));
+	(*env)->SetIntField(env, nativeSearchResult, JFIELD(SEARCH_RESULT_TRACK_OFFSET), sp_search_num_tracks(search));
 
-	setObjectIntField(env, nativeSearchResult, "totalNumAlbums", sp_search_total_albums(search));
-	setObjectIntField(env, nativeSearchResult, "albumOffset", sp_search_num_albums(search));
+	(*env)->SetIntField(env, nativeSearchResult, JFIELD(SEARCH_RESULT_TOTAL_ALBUMS), sp_search_total_albums(search));
+	(*env)->SetIntField(env, nativeSearchResult, JFIELD(SEARCH_RESULT_ALBUM_OFFSET), sp_search_num_albums(search));
 
-	setObjectIntField(env, nativeSearchResult, "totalNumArtists", sp_search_total_artists(search));
-	setObjectIntField(env, nativeSearchResult, "artistOffset", sp_search_num_artists(search));
+	(*env)->SetIntField(env, nativeSearchResult, JFIELD(SEARCH_RESULT_TOTAL_ARTISTS), sp_search_total_artists(search));
+	(*env)->SetIntField(env, nativeSearchResult, JFIELD(SEARCH_RESULT_ARTIST_OFFSET), sp_search_num_artists(search));
 
-	setObjectIntField(env, nativeSearchResult, "totalNumPlaylists", sp_search_total_playlists(search));
-	setObjectIntField(env, nativeSearchResult, "playlistOffset", sp_search_num_playlists(search));
+	(*env)->SetIntField(env, nativeSearchResult, JFIELD(SEARCH_RESULT_TOTAL_PLAYLISTS), sp_search_total_playlists(search));
+	(*env)->SetIntField(env, nativeSearchResult, JFIELD(SEARCH_RESULT_PLAYLIST_OFFSET), sp_search_num_playlists(search));
 
-	setObjectStringField(env, nativeSearchResult, "query", sp_search_query(search));
-	setObjectStringField(env, nativeSearchResult, "didYouMean", sp_search_did_you_mean(search));
+	setStringField(env, nativeSearchResult, JFIELD(SEARCH_RESULT_QUERY), sp_search_query(search));
+	setStringField(env, nativeSearchResult, JFIELD(SEARCH_RESULT_DID_YOU_MEAN), sp_search_did_you_mean(search));
 
-	method = (*env)->GetMethodID(env, g_searchCompleteListenerClass, "searchCompleted", "(ILjahspotify/SearchResult;)V");
+	sp_search_release(search);
+	return nativeSearchResult;
+}
 
-	if (method == NULL) {
-		log_error("jahspotify", "signalSearchComplete", "Could not load callback method searchCompleted() on class SearchListener");
-		goto fail;
+/**
+ * Hands the result of the search with the token to the search complete listener.
+ */
+int notifySearchComplete(JNIEnv *env, jahspotify_session *session, int32_t token, jobject nativeSearchResult) {
+	if (!session->searchCompleteListener) {
+		log_error("jahspotify", "notifySearchComplete", "No search complete listener registered");
+		return 1;
 	}
 
-	(*env)->CallVoidMethod(env, g_searchCompleteListener, method, token, nativeSearchResult);
+	log_debug("jahspotify", "notifySearchComplete", "Search complete: token: %d", token);
+
+	(*env)->CallVoidMethod(env, session->searchCompleteListener, JMETHOD(SEARCH_COMPLETED), token, nativeSearchResult);
 	if (checkException(env) != 0) {
-		log_error("jahspotify", "signalSearchComplete", "Exception while calling search complete listener");
-		goto fail;
+		log_error("jahspotify", "notifySearchComplete", "Exception while calling search complete listener");
 	}
+	return 0;
+}
 
-	goto exit;
+int signalSearchComplete(JNIEnv *env, jahspotify_session *session, sp_search *search, int32_t token) {
+	jobject nativeSearchResult;
 
-	fail:
+	if (!session->searchCompleteListener) {
+		log_error("jahspotify", "signalSearchComplete", "No search complete listener registered");
+		return 1;
+	}
 
-	exit: sp_search_release(search);
-	detachThread();
+	nativeSearchResult = createJSearchResult(env, session, search);
+	notifySearchComplete(env, session, token, nativeSearchResult);
+	if (nativeSearchResult) (*env)->DeleteLocalRef(env, nativeSearchResult);
+	return 0;
+}
+
+/**
+ * Tells the listener of the search with the token that it failed, timed out or could not be started.
+ */
+int signalSearchFailed(JNIEnv *env, jahspotify_session *session, int32_t token, const char *message) {
+	jstring jMessage;
+
+	if (!session->searchCompleteListener) {
+		log_error("jahspotify", "signalSearchFailed", "No search complete listener registered");
+		return 1;
+	}
+
+	log_debug("jahspotify", "signalSearchFailed", "Search failed: token: %d: %s", token, message);
+
+	jMessage = (*env)->NewStringUTF(env, message);
+	(*env)->CallVoidMethod(env, session->searchCompleteListener, JMETHOD(SEARCH_FAILED), token, jMessage);
+	if (checkException(env) != 0) {
+		log_error("jahspotify", "signalSearchFailed", "Exception while calling search complete listener");
+	}
+	if (jMessage) (*env)->DeleteLocalRef(env, jMessage);
 	return 0;
 }
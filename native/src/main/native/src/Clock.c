@@ -0,0 +1,21 @@
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "Clock.h"
+
+/**
+ * Milliseconds from an arbitrary start, used for deadlines and ages. Does not jump when the wall
+ * clock is set, so differences of two readings never go negative.
+ */
+uint64_t monotonic_millis() {
+#if defined(_POSIX_TIMERS) && _POSIX_TIMERS > 0 && defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (uint64_t) tv.tv_sec * 1000 + tv.tv_usec / 1000;
+#endif
+}
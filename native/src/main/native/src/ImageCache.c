@@ -0,0 +1,216 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "ImageCache.h"
+#include "Logging.h"
+
+/* Initial number of hash buckets, must be a power of two */
+#define IMAGE_CACHE_INITIAL_CAPACITY 256
+
+typedef struct image_entry {
+	struct image_entry *hash_next;
+	/// Neighbours in the LRU list, head is the most recently used
+	struct image_entry *prev;
+	struct image_entry *next;
+	uint8_t id[IMAGE_ID_SIZE];
+	/// IMAGE_VARIANT_ORIGINAL or the size of a thumbnail
+	int variant;
+	/// Number of bytes of the image, which follow the entry
+	size_t length;
+	/// Bytes accounted against the budget, entry included
+	size_t size;
+} image_entry;
+
+static pthread_mutex_t g_image_mutex = PTHREAD_MUTEX_INITIALIZER;
+static image_entry **g_image_buckets = NULL;
+static unsigned int g_image_capacity = 0;
+static image_entry *g_image_head = NULL;
+static image_entry *g_image_tail = NULL;
+static size_t g_image_budget = IMAGE_CACHE_DEFAULT_BUDGET;
+static image_cache_stats g_image_stats;
+
+static int hex_value(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+/**
+ * Extracts the 20 byte id from an image URI. Returns non-zero for any other URI.
+ */
+int image_id_from_uri(const char *uri, uint8_t *id) {
+	static const char prefix[] = "spotify:image:";
+	int i;
+
+	if (!uri || strncmp(uri, prefix, sizeof(prefix) - 1) != 0) return 1;
+	uri += sizeof(prefix) - 1;
+
+	for (i = 0; i < IMAGE_ID_SIZE; i++) {
+		int high = hex_value(uri[i * 2]);
+		int low = high < 0 ? -1 : hex_value(uri[i * 2 + 1]);
+		if (low < 0) return 1;
+		id[i] = (uint8_t) ((high << 4) | low);
+	}
+	return uri[IMAGE_ID_SIZE * 2] == '\0' ? 0 : 1;
+}
+
+static unsigned int image_hash(const uint8_t *id, int variant, unsigned int capacity) {
+	// Ids are hashes themselves, their last bytes are as good a hash as any
+	uint32_t value = ((uint32_t) id[16] << 24) | ((uint32_t) id[17] << 16) | ((uint32_t) id[18] << 8) | id[19];
+	return (value ^ ((uint32_t) variant * 0x9E3779B1u)) & (capacity - 1);
+}
+
+static void image_resize(unsigned int capacity) {
+	image_entry **buckets = calloc(capacity, sizeof(image_entry*));
+	unsigned int i;
+
+	if (!buckets) {
+		log_error("imagecache", "image_resize", "Could not allocate %u buckets", capacity);
+		return;
+	}
+
+	for (i = 0; i < g_image_capacity; i++) {
+		image_entry *entry = g_image_buckets[i];
+		while (entry) {
+			image_entry *next = entry->hash_next;
+			unsigned int bucket = image_hash(entry->id, entry->variant, capacity);
+			entry->hash_next = buckets[bucket];
+			buckets[bucket] = entry;
+			entry = next;
+		}
+	}
+
+	free(g_image_buckets);
+	g_image_buckets = buckets;
+	g_image_capacity = capacity;
+}
+
+static image_entry *image_find(const uint8_t *id, int variant) {
+	image_entry *entry;
+	if (!g_image_buckets) return NULL;
+	for (entry = g_image_buckets[image_hash(id, variant, g_image_capacity)]; entry; entry = entry->hash_next) {
+		if (entry->variant == variant && memcmp(entry->id, id, IMAGE_ID_SIZE) == 0) return entry;
+	}
+	return NULL;
+}
+
+static void image_lru_unlink(image_entry *entry) {
+	if (entry->prev) entry->prev->next = entry->next;
+	else g_image_head = entry->next;
+	if (entry->next) entry->next->prev = entry->prev;
+	else g_image_tail = entry->prev;
+	entry->prev = entry->next = NULL;
+}
+
+static void image_lru_push(image_entry *entry) {
+	entry->prev = NULL;
+	entry->next = g_image_head;
+	if (g_image_head) g_image_head->prev = entry;
+	g_image_head = entry;
+	if (!g_image_tail) g_image_tail = entry;
+}
+
+static void image_remove(image_entry *entry) {
+	image_entry **link = &g_image_buckets[image_hash(entry->id, entry->variant, g_image_capacity)];
+	while (*link && *link != entry)
+		link = &(*link)->hash_next;
+	if (*link) *link = entry->hash_next;
+
+	image_lru_unlink(entry);
+	g_image_stats.entries--;
+	g_image_stats.bytes -= entry->size;
+	free(entry);
+}
+
+static void image_trim() {
+	while (g_image_tail && g_image_stats.bytes > g_image_budget) {
+		image_remove(g_image_tail);
+		g_image_stats.evictions++;
+	}
+}
+
+/**
+ * Stores a copy of the bytes of an image or one of its thumbnails, replacing any previous entry
+ * for the same id and variant.
+ */
+void image_cache_put(const uint8_t *id, int variant, const void *data, size_t length) {
+	size_t size = sizeof(image_entry) + length;
+	image_entry *entry, *existing;
+
+	pthread_mutex_lock(&g_image_mutex);
+	if (size > g_image_budget) goto exit;
+
+	entry = malloc(size);
+	if (!entry) {
+		log_error("imagecache", "image_cache_put", "Could not allocate %u bytes", (unsigned int) size);
+		goto exit;
+	}
+	memcpy(entry->id, id, IMAGE_ID_SIZE);
+	entry->variant = variant;
+	entry->length = length;
+	entry->size = size;
+	memcpy(entry + 1, data, length);
+
+	existing = image_find(id, variant);
+	if (existing) image_remove(existing);
+
+	if (!g_image_buckets) image_resize(IMAGE_CACHE_INITIAL_CAPACITY);
+	else if (g_image_stats.entries >= g_image_capacity) image_resize(g_image_capacity * 2);
+
+	if (!g_image_buckets) {
+		free(entry);
+		goto exit;
+	}
+
+	unsigned int bucket = image_hash(id, variant, g_image_capacity);
+	entry->hash_next = g_image_buckets[bucket];
+	g_image_buckets[bucket] = entry;
+	image_lru_push(entry);
+	g_image_stats.entries++;
+	g_image_stats.bytes += size;
+	image_trim();
+
+	exit: pthread_mutex_unlock(&g_image_mutex);
+}
+
+/**
+ * Looks up the bytes of an image or one of its thumbnails. When found the cache stays locked so the bytes cannot be
+ * evicted while they are copied, image_cache_release() must be called once done with them.
+ */
+const void *image_cache_acquire(const uint8_t *id, int variant, size_t *length) {
+	image_entry *entry;
+
+	pthread_mutex_lock(&g_image_mutex);
+	entry = image_find(id, variant);
+	if (!entry) {
+		g_image_stats.misses++;
+		pthread_mutex_unlock(&g_image_mutex);
+		return NULL;
+	}
+
+	g_image_stats.hits++;
+	image_lru_unlink(entry);
+	image_lru_push(entry);
+	*length = entry->length;
+	return entry + 1;
+}
+
+void image_cache_release() {
+	pthread_mutex_unlock(&g_image_mutex);
+}
+
+void image_cache_set_budget(size_t budget) {
+	pthread_mutex_lock(&g_image_mutex);
+	g_image_budget = budget;
+	image_trim();
+	pthread_mutex_unlock(&g_image_mutex);
+}
+
+void image_cache_read_stats(image_cache_stats *stats) {
+	pthread_mutex_lock(&g_image_mutex);
+	*stats = g_image_stats;
+	stats->budget = g_image_budget;
+	pthread_mutex_unlock(&g_image_mutex);
+}
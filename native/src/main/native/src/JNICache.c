@@ -0,0 +1,72 @@
+#include "JNICache.h"
+#include "Logging.h"
+
+typedef struct jni_member {
+	jni_class_index owner;
+	const char *name;
+	const char *signature;
+} jni_member;
+
+#define JNI_CACHE_CLASS_PATH(name, path) path,
+#define JNI_CACHE_MEMBER(name, owner, member, signature) { JNI_CLASS_##owner, member, signature },
+
+static const char *g_jni_class_paths[JNI_CLASS_COUNT] = { JNI_CACHE_CLASSES(JNI_CACHE_CLASS_PATH) };
+static const jni_member g_jni_field_members[JNI_FIELD_COUNT] = { JNI_CACHE_FIELDS(JNI_CACHE_MEMBER) };
+static const jni_member g_jni_method_members[JNI_METHOD_COUNT] = { JNI_CACHE_METHODS(JNI_CACHE_MEMBER) };
+static const jni_member g_jni_static_members[JNI_STATIC_COUNT] = { JNI_CACHE_STATIC_METHODS(JNI_CACHE_MEMBER) };
+
+jclass g_jni_classes[JNI_CLASS_COUNT];
+jfieldID g_jni_fields[JNI_FIELD_COUNT];
+jmethodID g_jni_methods[JNI_METHOD_COUNT];
+jmethodID g_jni_static_methods[JNI_STATIC_COUNT];
+
+/**
+ * Resolves every entry of the tables, called once from JNI_OnLoad. Returns non-zero if any of
+ * them is missing, which means the Java classes do not match this library.
+ */
+int jni_cache_init(JNIEnv *env) {
+	int i;
+
+	for (i = 0; i < JNI_CLASS_COUNT; i++) {
+		jclass aClass = (*env)->FindClass(env, g_jni_class_paths[i]);
+		if (aClass == NULL ) {
+			log_error("jnicache", "jni_cache_init", "Could not load %s", g_jni_class_paths[i]);
+			goto fail;
+		}
+		g_jni_classes[i] = (*env)->NewGlobalRef(env, aClass);
+		(*env)->DeleteLocalRef(env, aClass);
+	}
+
+	for (i = 0; i < JNI_FIELD_COUNT; i++) {
+		const jni_member *member = &g_jni_field_members[i];
+		g_jni_fields[i] = (*env)->GetFieldID(env, g_jni_classes[member->owner], member->name, member->signature);
+		if (g_jni_fields[i] == NULL ) {
+			log_error("jnicache", "jni_cache_init", "Could not find field %s.%s", g_jni_class_paths[member->owner], member->name);
+			goto fail;
+		}
+	}
+
+	for (i = 0; i < JNI_METHOD_COUNT; i++) {
+		const jni_member *member = &g_jni_method_members[i];
+		g_jni_methods[i] = (*env)->GetMethodID(env, g_jni_classes[member->owner], member->name, member->signature);
+		if (g_jni_methods[i] == NULL ) {
+			log_error("jnicache", "jni_cache_init", "Could not find method %s.%s%s", g_jni_class_paths[member->owner], member->name, member->signature);
+			goto fail;
+		}
+	}
+
+	for (i = 0; i < JNI_STATIC_COUNT; i++) {
+		const jni_member *member = &g_jni_static_members[i];
+		g_jni_static_methods[i] = (*env)->GetStaticMethodID(env, g_jni_classes[member->owner], member->name, member->signature);
+		if (g_jni_static_methods[i] == NULL ) {
+			log_error("jnicache", "jni_cache_init", "Could not find static method %s.%s%s", g_jni_class_paths[member->owner], member->name, member->signature);
+			goto fail;
+		}
+	}
+
+	return 0;
+
+	fail:
+	// Leave the pending NoSuchFieldError/NoSuchMethodError for the caller of System.loadLibrary
+	return 1;
+}
@@ -4,6 +4,7 @@
 #include <libspotify/api.h>
 
 #include "JNIHelpers.h"
+#include "JNICache.h"
 #include "Logging.h"
 
 JavaVM* g_vm = NULL;
@@ -106,6 +107,37 @@ jint invokeIntMethod_B(JNIEnv *env, jobject instance, const char *methodName, in
 	return 0;
 }
 
+/**
+ * Sets the loaded flag of a media object, search result or image.
+ */
+jint setLoaded(JNIEnv *env, jobject instance) {
+	if (!instance) return 1;
+	(*env)->CallVoidMethod(env, instance, JMETHOD(LOADABLE_SET_LOADED), JNI_TRUE);
+	return 0;
+}
+
+jint setStringField(JNIEnv * env, jobject obj, jfieldID field, const char *value) {
+	jstring str;
+
+	if (value == NULL ) return 1;
+
+	str = (*env)->NewStringUTF(env, value);
+	if (str == NULL ) return 1;
+
+	(*env)->SetObjectField(env, obj, field, str);
+	(*env)->DeleteLocalRef(env, str);
+	return 0;
+}
+
+/**
+ * Sets the field and drops the local reference to the value.
+ */
+jint setObjectField(JNIEnv * env, jobject obj, jfieldID field, jobject value) {
+	(*env)->SetObjectField(env, obj, field, value);
+	if (value) (*env)->DeleteLocalRef(env, value);
+	return 0;
+}
+
 jint createNativeString(JNIEnv *env, jstring str, char **nativeStr) {
 	char *tmpStr = NULL;
 	char *tmpStrCopy = NULL;
@@ -403,19 +435,15 @@ jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved) {
 	}
 	g_searchCompleteListenerClass = (*env)->NewGlobalRef(env, aClass);
 
-	aClass = (*env)->FindClass(env, "jahspotify/media/Link");
-	if (aClass == NULL ) {
-		log_error("jahspotify", "JNI_OnLoad", "Could not load jahspotify.media.Link");
+	if (jni_cache_init(env) != 0) {
 		goto error;
 	}
-	g_linkClass = (*env)->NewGlobalRef(env, aClass);
+	g_linkClass = JCLASS(LINK);
+	g_playlistCLass = JCLASS(PLAYLIST);
 
-	aClass = (*env)->FindClass(env, "jahspotify/media/Playlist");
-	if (aClass == NULL ) {
-		log_error("jahspotify", "JNI_OnLoad", "Could not load jahspotify.media.Playlist");
-		goto error;
+	if (log_start(env) != 0) {
+		log_warn("jahspotify", "JNI_OnLoad", "Could not start the log thread");
 	}
-	g_playlistCLass = (*env)->NewGlobalRef(env, aClass);
 
 	/* success -- return valid version number */
 	result = JNI_VERSION_1_4;
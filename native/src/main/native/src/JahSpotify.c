@@ -23,74 +23,158 @@
 #include <string.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <pthread.h>
 
 #include "Logging.h"
 #include "JNIHelpers.h"
 #include "JahSpotify.h"
+#include "MetadataCache.h"
+#include "MetadataStore.h"
+#include "MediaRecord.h"
+#include "ImageCache.h"
+#include "BrowseCache.h"
+#include "LibraryIndex.h"
+#include "JNICache.h"
 #include "jahspotify_impl_JahSpotifyImpl.h"
 #include "AppKey.h"
 #include "Callbacks.h"
 #include "ThreadHelpers.h"
+#include "Session.h"
+#include "Clock.h"
 
 #define MAX_LENGTH_FOLDER_NAME 256
 
-/// The global session handle
-sp_session *g_sess = NULL;
-/// Handle to the curren track
-sp_track *g_currenttrack = NULL;
-static void track_ended(jboolean forced);
+static void track_ended(jahspotify_session *session, jboolean forced);
 
-jobject g_connectionListener = NULL;
-jobject g_playbackListener = NULL;
-jobject g_searchCompleteListener = NULL;
-jobject g_mediaLoadedListener = NULL;
 extern jclass g_linkClass;
 extern jclass g_playlistCLass;
 
-pthread_mutex_t g_spotify_mutex;
-/// Synchronization mutex for the main thread
-static pthread_mutex_t g_notify_mutex;
-/// Synchronization condition variable for the main thread
-static pthread_cond_t g_notify_cond;
-/// Synchronization variable telling the main thread to process events
-static int g_notify_do;
-/// Non-zero when a track has ended and a new one has not yet started a new one
-static int g_playback_done;
-static int g_playback_stopped;
-static int g_stop_after_logout = 0;
-static int g_stop = 0;
-
-static media *loading = NULL;
-
-
 void populateJAlbumInstanceFromAlbumBrowse(JNIEnv *env, sp_album *album, sp_albumbrowse *albumBrowse, jobject albumInstance);
-void populateJArtistInstanceFromArtistBrowse(JNIEnv *env, sp_artistbrowse *artistBrowse, jobject artist);
+void populateJArtistInstanceFromArtistBrowse(JNIEnv *env, jahspotify_session *session, sp_artistbrowse *artistBrowse, jobject artist);
 jobject createJPlaylistInstance(JNIEnv *env, sp_link* link, const char* name, sp_link* image);
-jobject createJArtistInstance(JNIEnv *env, sp_artist *artist, int browse);
-jobject createJAlbumInstance(JNIEnv *env, sp_album *album, int browse);
-jobject createJTrackInstance(JNIEnv *env, sp_track *track);
+jobject createJArtistInstance(JNIEnv *env, jahspotify_session *session, sp_artist *artist, int browse);
+jobject createJAlbumInstance(JNIEnv *env, jahspotify_session *session, sp_album *album, int browse);
+jobject createJTrackInstance(JNIEnv *env, jahspotify_session *session, sp_track *track);
 
 void populateJTrackInstance(JNIEnv *env, jobject trackInstance, sp_track *track);
-void populateJAlbumInstance(JNIEnv *env, jobject albumInstance, sp_album *album, int browse);
-void populateJArtistInstance(JNIEnv *env, jobject artistInstance, sp_artist *artist, int browse);
+void populateJAlbumInstance(JNIEnv *env, jahspotify_session *session, jobject albumInstance, sp_album *album, int browse);
+void populateJArtistInstance(JNIEnv *env, jahspotify_session *session, jobject artistInstance, sp_artist *artist, int browse);
 
-jobject createJPlaylist(JNIEnv *env, jobject playlistInstance, sp_playlist *playlist);
+jobject createJPlaylist(JNIEnv *env, jahspotify_session *session, jobject playlistInstance, sp_playlist *playlist);
 jobject createJLinkInstance(JNIEnv *env, sp_link *link);
+jobject createJLinkInstanceFromString(JNIEnv *env, const char *linkStr);
+static jobject createJTrackLink(JNIEnv *env, jahspotify_session *session, sp_track *track);
 static sp_playlist_callbacks pl_callbacks;
+static sp_playlist_callbacks pl_delta_callbacks;
+static void clearImageLoads(JNIEnv *env, jahspotify_session *session);
 
 /* --------------------------  PLAYLIST CALLBACKS  ------------------------- */
+/**
+ * Registers the playlist callbacks to fill in the instance once the playlist has loaded. The
+ * request is kept with the session so the callbacks can be removed again with the same userdata.
+ */
+static void watchPlaylist(JNIEnv *env, jahspotify_session *session, sp_playlist *playlist, jobject playlistInstance) {
+	session_request *request = session_request_create(session, (*env)->NewGlobalRef(env, playlistInstance), 0);
+	if (!request) return;
+
+	pthread_mutex_lock(&session->spotify_mutex);
+	sp_playlist_add_ref(playlist);
+	request->playlist = playlist;
+	request->next = session->playlist_requests;
+	session->playlist_requests = request;
+	sp_playlist_add_callbacks(playlist, &pl_callbacks, request);
+	pthread_mutex_unlock(&session->spotify_mutex);
+}
+
+/**
+ * Removes the callbacks registered for the request and frees it.
+ */
+static void unwatchPlaylist(JNIEnv *env, session_request *request) {
+	jahspotify_session *session = request->session;
+	session_request **link;
+
+	pthread_mutex_lock(&session->spotify_mutex);
+	for (link = &session->playlist_requests; *link; link = &(*link)->next) {
+		if (*link == request) {
+			*link = request->next;
+			break;
+		}
+	}
+	sp_playlist_remove_callbacks(request->playlist, &pl_callbacks, request);
+	sp_playlist_release(request->playlist);
+	pthread_mutex_unlock(&session->spotify_mutex);
+
+	if (request->instance) (*env)->DeleteGlobalRef(env, request->instance);
+	free(request);
+}
+
+/**
+ * Drops every request waiting for the playlist, or for any playlist when it is NULL.
+ */
+static void unwatchPlaylists(JNIEnv *env, jahspotify_session *session, sp_playlist *playlist) {
+	session_request *request;
+	session_request *next;
+
+	pthread_mutex_lock(&session->spotify_mutex);
+	for (request = session->playlist_requests; request; request = next) {
+		next = request->next;
+		if (!playlist || request->playlist == playlist) unwatchPlaylist(env, request);
+	}
+	pthread_mutex_unlock(&session->spotify_mutex);
+}
+
+/**
+ * Wraps the track indices of a removal or move in a Java int array.
+ */
+static jintArray createJTrackPositions(JNIEnv *env, const int *tracks, int num_tracks) {
+	jintArray positions = (*env)->NewIntArray(env, num_tracks);
+	if (positions) (*env)->SetIntArrayRegion(env, positions, 0, num_tracks, (const jint*) tracks);
+	return positions;
+}
+
 /**
  * Callback from libspotify, saying that a track has been added to a playlist.
  *
+ * The tracks are passed on to the media loaded listener as links, null for those which are not
+ * available, so the Java playlist can be patched instead of read again.
+ *
  * @param  pl          The playlist handle
  * @param  tracks      An array of track handles
  * @param  num_tracks  The number of tracks in the \c tracks array
  * @param  position    Where the tracks were inserted
- * @param  userdata    The opaque pointer
+ * @param  userdata    The session
  */
 static void SP_CALLCONV tracks_added(sp_playlist *pl, sp_track * const *tracks, int num_tracks, int position, void *userdata) {
 	log_debug("jahspotify", "tracks_added", "Tracks added: playlist: %s numtracks: %d position: %d", sp_playlist_name(pl), num_tracks, position);
+	jahspotify_session *session = (jahspotify_session*) userdata;
+	jobjectArray links = NULL;
+	int i;
+
+	library_index_touch(&session->library, pl);
+	if (!session->mediaLoadedListener) return;
+
+	JNIEnv *env = NULL;
+	if (!retrieveEnv((JNIEnv*) &env)) return;
+
+	links = (*env)->NewObjectArray(env, num_tracks, JCLASS(LINK), NULL);
+	if (!links) {
+		log_error("jahspotify", "tracks_added", "Could not allocate the links of the added tracks");
+		goto exit;
+	}
+
+	for (i = 0; i < num_tracks; i++) {
+		jobject trackJLink = createJTrackLink(env, session, tracks[i]);
+		if (trackJLink) {
+			(*env)->SetObjectArrayElement(env, links, i, trackJLink);
+			(*env)->DeleteLocalRef(env, trackJLink);
+		}
+	}
+
+	(*env)->CallVoidMethod(env, session->mediaLoadedListener, JMETHOD(MEDIA_LOADED_TRACKS_ADDED), (jlong) (intptr_t) pl, position, links);
+
+	exit: if (links) (*env)->DeleteLocalRef(env, links);
+	detachThread();
 }
 
 /**
@@ -99,10 +183,24 @@ static void SP_CALLCONV tracks_added(sp_playlist *pl, sp_track * const *tracks,
  * @param  pl          The playlist handle
  * @param  tracks      An array of track indices
  * @param  num_tracks  The number of tracks in the \c tracks array
- * @param  userdata    The opaque pointer
+ * @param  userdata    The session
  */
 static void SP_CALLCONV tracks_removed(sp_playlist *pl, const int *tracks, int num_tracks, void *userdata) {
 	log_debug("jahspotify", "tracks_removed", "Tracks removed: playlist: %s numtracks: %d", sp_playlist_name(pl), num_tracks);
+	jahspotify_session *session = (jahspotify_session*) userdata;
+
+	library_index_touch(&session->library, pl);
+	if (!session->mediaLoadedListener) return;
+
+	JNIEnv *env = NULL;
+	if (!retrieveEnv((JNIEnv*) &env)) return;
+
+	jintArray positions = createJTrackPositions(env, tracks, num_tracks);
+	if (positions) {
+		(*env)->CallVoidMethod(env, session->mediaLoadedListener, JMETHOD(MEDIA_LOADED_TRACKS_REMOVED), (jlong) (intptr_t) pl, positions);
+		(*env)->DeleteLocalRef(env, positions);
+	}
+	detachThread();
 }
 
 /**
@@ -112,10 +210,23 @@ static void SP_CALLCONV tracks_removed(sp_playlist *pl, const int *tracks, int n
  * @param  tracks        An array of track indices
  * @param  num_tracks    The number of tracks in the \c tracks array
  * @param  new_position  To where the tracks were moved
- * @param  userdata      The opaque pointer
+ * @param  userdata      The session
  */
 static void SP_CALLCONV tracks_moved(sp_playlist *pl, const int *tracks, int num_tracks, int new_position, void *userdata) {
 	log_debug("jahspotify", "tracks_moved", "Tracks moved: playlist: %s numtracks: %d", sp_playlist_name(pl), num_tracks);
+	jahspotify_session *session = (jahspotify_session*) userdata;
+
+	if (!session->mediaLoadedListener) return;
+
+	JNIEnv *env = NULL;
+	if (!retrieveEnv((JNIEnv*) &env)) return;
+
+	jintArray positions = createJTrackPositions(env, tracks, num_tracks);
+	if (positions) {
+		(*env)->CallVoidMethod(env, session->mediaLoadedListener, JMETHOD(MEDIA_LOADED_TRACKS_MOVED), (jlong) (intptr_t) pl, positions, new_position);
+		(*env)->DeleteLocalRef(env, positions);
+	}
+	detachThread();
 }
 
 /**
@@ -126,10 +237,11 @@ static void SP_CALLCONV tracks_moved(sp_playlist *pl, const int *tracks, int num
  */
 static void SP_CALLCONV playlist_renamed(sp_playlist *pl, void *userdata) {
 	log_debug("jahspotify", "playlist_renamed", "Playlist renamed: playlist: %s", sp_playlist_name(pl));
+	session_request *request = (session_request*) userdata;
 	JNIEnv *env = NULL;
 	if (!retrieveEnv((JNIEnv*) &env)) return;
 
-	setObjectStringField(env, (jobject) userdata, "name", sp_playlist_name(pl));
+	setObjectStringField(env, request->instance, "name", sp_playlist_name(pl));
 	detachThread();
 }
 
@@ -142,15 +254,11 @@ static void SP_CALLCONV playlist_state_changed(sp_playlist *pl, void *userdata)
           log_debug("jahspotify", "playlist_state_changed", "Playlist state changed: %s link: %s (loaded: %s)", sp_playlist_name(pl), linkName,
                     (sp_playlist_is_loaded(pl) ? "yes" : "no"));
           
-          jobject playlist = (jobject) userdata;
-          if (sp_playlist_is_loaded(pl)) {
-            sp_playlist_remove_callbacks(pl, &pl_callbacks, userdata);
-            
-            JNIEnv* env = NULL;
-            if (!retrieveEnv((JNIEnv*) &env)) return;
-            
-            createJPlaylist(env, playlist, pl);
-            (*env)->DeleteGlobalRef(env, playlist);
+          session_request *request = (session_request*) userdata;
+          JNIEnv* env = NULL;
+          if (sp_playlist_is_loaded(pl) && retrieveEnv((JNIEnv*) &env)) {
+            createJPlaylist(env, request->session, request->instance, pl);
+            unwatchPlaylist(env, request);
             detachThread();
           }
           
@@ -171,11 +279,92 @@ static void SP_CALLCONV playlist_metadata_updated(sp_playlist *pl, void *userdat
 /**
  * The callbacks we are interested in for individual playlists.
  */
-static sp_playlist_callbacks pl_callbacks = { .tracks_added = &tracks_added, .tracks_removed = &tracks_removed, .tracks_moved = &tracks_moved,
-		.playlist_renamed = &playlist_renamed, .playlist_state_changed = &playlist_state_changed, .playlist_update_in_progress = &playlist_update_in_progress,
+static sp_playlist_callbacks pl_callbacks = { .playlist_renamed = &playlist_renamed, .playlist_state_changed = &playlist_state_changed, .playlist_update_in_progress = &playlist_update_in_progress,
 		.playlist_metadata_updated = &playlist_metadata_updated, };
 
+/**
+ * The track changes of the playlists in the container, with the session as userdata. They are
+ * registered once per playlist, for as long as it is in the container.
+ */
+static sp_playlist_callbacks pl_delta_callbacks = { .tracks_added = &tracks_added, .tracks_removed = &tracks_removed,
+		.tracks_moved = &tracks_moved, };
+
 /* --------------------  PLAYLIST CONTAINER CALLBACKS  --------------------- */
+/**
+ * Hands the order and folders of the container to the Java PlaylistContainer in a single call.
+ */
+static void updateContainerStructure(JNIEnv *env, jahspotify_session *session, sp_playlistcontainer *pc) {
+	int numItems = sp_playlistcontainer_num_playlists(pc);
+	jintArray types = (*env)->NewIntArray(env, numItems);
+	jlongArray pointers = (*env)->NewLongArray(env, numItems);
+	jlongArray folderIds = (*env)->NewLongArray(env, numItems);
+	jobjectArray folderNames = (*env)->NewObjectArray(env, numItems, JCLASS(STRING), NULL);
+	jint *nativeTypes = malloc(sizeof(jint) * (numItems + 1));
+	jlong *nativePointers = malloc(sizeof(jlong) * (numItems + 1));
+	jlong *nativeFolderIds = malloc(sizeof(jlong) * (numItems + 1));
+	char folderName[256];
+	int i;
+
+	if (!types || !pointers || !folderIds || !folderNames || !nativeTypes || !nativePointers || !nativeFolderIds) {
+		log_error("jahspotify", "updateContainerStructure", "Could not allocate the container structure");
+		goto exit;
+	}
+
+	for (i = 0; i < numItems; i++) {
+		sp_playlist_type type = sp_playlistcontainer_playlist_type(pc, i);
+		nativeTypes[i] = type;
+		nativePointers[i] = 0;
+		nativeFolderIds[i] = 0;
+
+		if (type == SP_PLAYLIST_TYPE_PLAYLIST) {
+			nativePointers[i] = (jlong) (intptr_t) sp_playlistcontainer_playlist(pc, i);
+		} else if (type == SP_PLAYLIST_TYPE_START_FOLDER || type == SP_PLAYLIST_TYPE_END_FOLDER) {
+			nativeFolderIds[i] = (jlong) sp_playlistcontainer_playlist_folder_id(pc, i);
+		}
+
+		if (type == SP_PLAYLIST_TYPE_START_FOLDER
+				&& sp_playlistcontainer_playlist_folder_name(pc, i, folderName, sizeof(folderName)) == SP_ERROR_OK) {
+			jstring jName = (*env)->NewStringUTF(env, folderName);
+			if (jName) {
+				(*env)->SetObjectArrayElement(env, folderNames, i, jName);
+				(*env)->DeleteLocalRef(env, jName);
+			}
+		}
+	}
+
+	(*env)->SetIntArrayRegion(env, types, 0, numItems, nativeTypes);
+	(*env)->SetLongArrayRegion(env, pointers, 0, numItems, nativePointers);
+	(*env)->SetLongArrayRegion(env, folderIds, 0, numItems, nativeFolderIds);
+	(*env)->CallVoidMethod(env, session->playlistContainer, JMETHOD(PLAYLIST_CONTAINER_SET_STRUCTURE), types, pointers, folderIds, folderNames);
+
+	exit:
+	if (nativeTypes) free(nativeTypes);
+	if (nativePointers) free(nativePointers);
+	if (nativeFolderIds) free(nativeFolderIds);
+	if (types) (*env)->DeleteLocalRef(env, types);
+	if (pointers) (*env)->DeleteLocalRef(env, pointers);
+	if (folderIds) (*env)->DeleteLocalRef(env, folderIds);
+	if (folderNames) (*env)->DeleteLocalRef(env, folderNames);
+}
+
+/**
+ * Adds the playlist at the position to the Java PlaylistContainer, unless it is a folder marker
+ * or was added before.
+ */
+static void addContainerPlaylist(JNIEnv *env, jahspotify_session *session, sp_playlistcontainer *pc, sp_playlist *pl, int position) {
+	if (sp_playlistcontainer_playlist_type(pc, position) != SP_PLAYLIST_TYPE_PLAYLIST) return;
+
+	jobject playlist = (*env)->CallObjectMethod(env, session->playlistContainer, JMETHOD(PLAYLIST_CONTAINER_ADD), (jlong) (intptr_t) pl);
+
+	// If the playlist is null then it was already added.
+	if (playlist != NULL) {
+		createJPlaylist(env, session, playlist, pl);
+		sp_playlist_add_callbacks(pl, &pl_delta_callbacks, session);
+		library_index_add_playlist(&session->library, pl);
+		(*env)->DeleteLocalRef(env, playlist);
+	}
+}
+
 /**
  * Callback from libspotify, telling us a playlist was added to the playlist container.
  *
@@ -188,26 +377,14 @@ static sp_playlist_callbacks pl_callbacks = { .tracks_added = &tracks_added, .tr
  */
 static void SP_CALLCONV playlist_added(sp_playlistcontainer *pc, sp_playlist *pl, int position, void *userdata) {
 	log_debug("jahspotify", "playlist_added", "Playlist added: %s (loaded: %s)", sp_playlist_name(pl), sp_playlist_is_loaded(pl) ? "Yes" : "No");
+	jahspotify_session *session = (jahspotify_session*) userdata;
 
 	JNIEnv *env = NULL;
 	if (!retrieveEnv((JNIEnv*) &env)) return;
 
-	// Get container.
-	jclass jPc = (*env)->FindClass(env, "jahspotify/media/PlaylistContainer");
-	if (jPc == NULL ) {
-		log_error("jahspotify", "playlist_added", "Unable to get playlistcontainer class.");
-		detachThread();
-		return;
-	}
-
-	// Get 'Playlist addPlaylist(Long)' method
-	jmethodID jMethod = (*env)->GetStaticMethodID(env, jPc, "addPlaylist", "(J)Ljahspotify/media/Playlist;");
-	long pTr = (long) pl;
-	jobject playlist = (*env)->CallStaticObjectMethod(env, jPc, jMethod, (jlong) pTr);
-
-	// If the playlist is null then it was already added.
-	if (playlist != NULL)
-		createJPlaylist(env, playlist, pl);
+	addContainerPlaylist(env, session, pc, pl, position);
+	// While the container loads container_loaded sends the structure once
+	if (sp_playlistcontainer_is_loaded(pc)) updateContainerStructure(env, session, pc);
 
 	detachThread();
 }
@@ -223,32 +400,42 @@ static void SP_CALLCONV playlist_added(sp_playlistcontainer *pc, sp_playlist *pl
  * @param  userdata      The opaque pointer
  */
 static void SP_CALLCONV playlist_removed(sp_playlistcontainer *pc, sp_playlist *pl, int position, void *userdata) {
+  jahspotify_session *session = (jahspotify_session*) userdata;
   JNIEnv* env = NULL;
   if (!retrieveEnv((JNIEnv*) &env)) return;
-  pthread_mutex_lock(&g_spotify_mutex);
-  sp_playlist_remove_callbacks( pl, &pl_callbacks, NULL );
+  pthread_mutex_lock(&session->spotify_mutex);
+  unwatchPlaylists(env, session, pl);
+  sp_playlist_remove_callbacks( pl, &pl_delta_callbacks, session );
+  library_index_remove_playlist(&session->library, pl);
   
-  const char *name = sp_playlist_name(pl);
-  log_debug("jahspotify", "playlist_removed", "Playlist removed: %s", name);
+  log_debug("jahspotify", "playlist_removed", "Playlist removed: %s", sp_playlist_name(pl));
   
+  // Removed by pointer, the playlist may never have loaded far enough to have a link
+  (*env)->CallVoidMethod(env, session->playlistContainer, JMETHOD(PLAYLIST_CONTAINER_REMOVE), (jlong) (intptr_t) pl);
+  if (sp_playlistcontainer_is_loaded(pc)) updateContainerStructure(env, session, pc);
   
-  sp_link *link = sp_link_create_from_playlist(pl);
-  char *linkName = malloc(sizeof(char) * 100);
-  sp_link_as_string(link, linkName, 100);
-  jstring jString = (*env)->NewStringUTF(env, linkName);
-  
-  jclass jPc = (*env)->FindClass(env, "jahspotify/media/PlaylistContainer");
-  if (jPc == NULL ) {
-    log_error("jahspotify", "playlist_removed", "Unable to get playlistcontainer class.");
-    pthread_mutex_unlock(&g_spotify_mutex);
-    return;
-  }
-  jmethodID jMethod = (*env)->GetStaticMethodID(env, jPc, "removePlaylist", "(Ljava/lang/String;)V");
-  (*env)->CallStaticVoidMethod(env, jPc, jMethod, jString);
-  
-  if (linkName) free(linkName);
-  if (jString) (*env)->DeleteLocalRef(env, jString);
-  pthread_mutex_unlock(&g_spotify_mutex);
+  pthread_mutex_unlock(&session->spotify_mutex);
+  detachThread();
+}
+
+/**
+ * Callback from libspotify, telling us a playlist or folder was moved in the playlist container.
+ *
+ * @param  pc            The playlist container handle
+ * @param  pl            The playlist handle
+ * @param  position      Previous index of the playlist
+ * @param  new_position  New index of the playlist
+ * @param  userdata      The opaque pointer
+ */
+static void SP_CALLCONV playlist_moved(sp_playlistcontainer *pc, sp_playlist *pl, int position, int new_position, void *userdata) {
+  jahspotify_session *session = (jahspotify_session*) userdata;
+  log_debug("jahspotify", "playlist_moved", "Playlist moved: %d -> %d", position, new_position);
+  if (!sp_playlistcontainer_is_loaded(pc)) return;
+
+  JNIEnv* env = NULL;
+  if (!retrieveEnv((JNIEnv*) &env)) return;
+  updateContainerStructure(env, session, pc);
+  detachThread();
 }
 
 /**
@@ -258,22 +445,27 @@ static void SP_CALLCONV playlist_removed(sp_playlistcontainer *pc, sp_playlist *
  * @param  userdata      The opaque pointer
  */
 static void SP_CALLCONV container_loaded(sp_playlistcontainer *pc, void *userdata) {
-  pthread_mutex_lock(&g_spotify_mutex);
+  jahspotify_session *session = (jahspotify_session*) userdata;
+  JNIEnv* env = NULL;
+  if (!retrieveEnv((JNIEnv*) &env)) return;
+  pthread_mutex_lock(&session->spotify_mutex);
   int i;
   // Make sure all playlists are added.
   for (i = 0; i < sp_playlistcontainer_num_playlists(pc); ++i) {
     sp_playlist *pl = sp_playlistcontainer_playlist(pc, i);
-    playlist_added(pc, pl, i, userdata);
+    addContainerPlaylist(env, session, pc, pl, i);
   }
-  signalPlaylistsLoaded();
-  pthread_mutex_unlock(&g_spotify_mutex);
+  updateContainerStructure(env, session, pc);
+  detachThread();
+  signalPlaylistsLoaded(session);
+  pthread_mutex_unlock(&session->spotify_mutex);
  }
 
 /**
  * The playlist container callbacks
  */
-static sp_playlistcontainer_callbacks pc_callbacks = { .playlist_added = &playlist_added, .playlist_removed = &playlist_removed, .container_loaded =
-		&container_loaded, };
+static sp_playlistcontainer_callbacks pc_callbacks = { .playlist_added = &playlist_added, .playlist_removed = &playlist_removed,
+		.playlist_moved = &playlist_moved, .container_loaded = &container_loaded, };
 
 /* ---------------------------  SESSION CALLBACKS  ------------------------- */
 /**
@@ -282,34 +474,45 @@ static sp_playlistcontainer_callbacks pc_callbacks = { .playlist_added = &playli
  * @sa sp_session_callbacks#logged_in
  */
 static void SP_CALLCONV logged_in(sp_session *sess, sp_error error) {
+  jahspotify_session *session = sp_session_userdata(sess);
   if (SP_ERROR_OK != error) {
     log_error("jahspotify", "logged_in", "Login failed: %s", sp_error_message(error));
-    signalLoggedIn(0);
+    signalLoggedIn(session, 0);
     return;
   }
-  pthread_mutex_lock(&g_spotify_mutex);
+  pthread_mutex_lock(&session->spotify_mutex);
   sp_playlistcontainer *pc = sp_session_playlistcontainer(sess);
-  sp_playlistcontainer_add_callbacks(sp_session_playlistcontainer(g_sess), &pc_callbacks, NULL );
+  sp_playlistcontainer_add_callbacks(pc, &pc_callbacks, session);
   
   log_debug("jahspotify", "logged_in", "Login Success: %d", sp_playlistcontainer_num_playlists(pc));
-  signalLoggedIn(1);
+  signalLoggedIn(session, 1);
   log_debug("jahspotify", "logged_in", "All done");
-  pthread_mutex_unlock(&g_spotify_mutex);
+  pthread_mutex_unlock(&session->spotify_mutex);
 }
 
-static void SP_CALLCONV credentials_blob_updated(sp_session *session, const char *blob) {
-  signalBlobUpdated(blob);
+static void SP_CALLCONV credentials_blob_updated(sp_session *sess, const char *blob) {
+  signalBlobUpdated(sp_session_userdata(sess), blob);
 }
 
 static void SP_CALLCONV logged_out(sp_session *sess) {
+  jahspotify_session *session = sp_session_userdata(sess);
+  JNIEnv *env = NULL;
   log_debug("jahspotify", "logged_out", "Logged out");
-  signalLoggedOut();
-  if (g_stop_after_logout) {
-    pthread_mutex_lock(&g_notify_mutex);
-    g_stop = 1;
-    g_notify_do = 1;
-    pthread_cond_signal(&g_notify_cond);
-    pthread_mutex_unlock(&g_notify_mutex);
+  // The next user has a library of their own
+  library_index_clear(&session->library);
+  if (retrieveEnv((JNIEnv*) &env)) {
+    pthread_mutex_lock(&session->spotify_mutex);
+    clearImageLoads(env, session);
+    pthread_mutex_unlock(&session->spotify_mutex);
+    detachThread();
+  }
+  signalLoggedOut(session);
+  if (session->stop_after_logout) {
+    pthread_mutex_lock(&session->notify_mutex);
+    session->stop = 1;
+    session->notify_do = 1;
+    pthread_cond_signal(&session->notify_cond);
+    pthread_mutex_unlock(&session->notify_mutex);
   }
 }
 
@@ -322,10 +525,11 @@ static void SP_CALLCONV logged_out(sp_session *sess) {
  * @sa sp_session_callbacks#notify_main_thread
  */
 static void SP_CALLCONV notify_main_thread(sp_session *sess) {
-  pthread_mutex_lock(&g_notify_mutex);
-  g_notify_do = 1;
-  pthread_cond_signal(&g_notify_cond);
-  pthread_mutex_unlock(&g_notify_mutex);
+  jahspotify_session *session = sp_session_userdata(sess);
+  pthread_mutex_lock(&session->notify_mutex);
+  session->notify_do = 1;
+  pthread_cond_signal(&session->notify_cond);
+  pthread_mutex_unlock(&session->notify_mutex);
 }
 
 /**
@@ -336,10 +540,11 @@ static void SP_CALLCONV notify_main_thread(sp_session *sess) {
 static int SP_CALLCONV music_delivery(sp_session *sess, const sp_audioformat *format, const void *frames, int num_frames) {
   if (num_frames == 0) return 0; // Audio discontinuity, do nothing
   
+  jahspotify_session *session = sp_session_userdata(sess);
   JNIEnv* env = NULL;
   if (!retrieveEnv((JNIEnv*) &env)) return 0;
   
-  invokeVoidMethod_II(env, g_playbackListener, "setAudioFormat", (jint) format->sample_rate, (jint) format->channels);
+  invokeVoidMethod_II(env, session->playbackListener, "setAudioFormat", (jint) format->sample_rate, (jint) format->channels);
   
   int sampleSize = 2 * format->channels;
   int numBytes = num_frames * sampleSize;
@@ -348,7 +553,7 @@ static int SP_CALLCONV music_delivery(sp_session *sess, const sp_audioformat *fo
   
   (*env)->SetByteArrayRegion(env, byteArray, 0, numBytes, (jbyte*) frames);
   int buffered;
-  invokeIntMethod_B(env, g_playbackListener, "addToBuffer", &buffered, byteArray);
+  invokeIntMethod_B(env, session->playbackListener, "addToBuffer", &buffered, byteArray);
   
   (*env)->DeleteLocalRef(env, byteArray);
   return buffered;
@@ -360,23 +565,26 @@ static int SP_CALLCONV music_delivery(sp_session *sess, const sp_audioformat *fo
  * @sa sp_session_callbacks#end_of_track
  */
 static void SP_CALLCONV end_of_track(sp_session *sess) {
-  pthread_mutex_lock(&g_notify_mutex);
-  g_playback_done = 1;
-  pthread_cond_signal(&g_notify_cond);
-  pthread_mutex_unlock(&g_notify_mutex);
+  jahspotify_session *session = sp_session_userdata(sess);
+  pthread_mutex_lock(&session->notify_mutex);
+  session->playback_done = 1;
+  pthread_cond_signal(&session->notify_cond);
+  pthread_mutex_unlock(&session->notify_mutex);
 }
 
 /**
  * Callback called when libspotify has new metadata available
  *
- * Not used in this example (but available to be able to reuse the session.c file
- * for other examples.)
+ * Marks the pending-load table so it is checked once the event loop is done processing events.
  *
  * @sa sp_session_callbacks#metadata_updated
  */
 static void SP_CALLCONV metadata_updated(sp_session *sess) {
 	log_debug("jahspotify", "metadata_updated", "Metadata updated");
-	checkLoaded();
+	jahspotify_session *session = sp_session_userdata(sess);
+	// Swept by the event loop once the current batch of events has been processed
+	session->loading.dirty = 1;
+	library_index_metadata_updated(&session->library);
 }
 
 /**
@@ -387,7 +595,7 @@ static void SP_CALLCONV metadata_updated(sp_session *sess) {
  */
 static void SP_CALLCONV play_token_lost(sp_session *sess) {
 	log_error("jahspotify", "play_token_lost", "Play token lost");
-	signalPlayTokenLost();
+	signalPlayTokenLost(sp_session_userdata(sess));
 }
 
 static void SP_CALLCONV userinfo_updated(sp_session *sess) {
@@ -402,7 +610,7 @@ static void SP_CALLCONV connection_error(sp_session *session, sp_error error) {
 	log_error("jahspotify", "connection_error", "Error: %s", sp_error_message(error));
 	// FIXME: should propagate this to java land
 	if (error == SP_ERROR_OK) {
-		signalConnected();
+		signalConnected(sp_session_userdata(session));
 	} else {
 		log_error("jahspotify", "connection_error", "Unhandled error: %s", sp_error_message(error));
 	}
@@ -430,24 +638,89 @@ static sp_session_callbacks session_callbacks = { .message_to_user = &message_to
 		log_message, .end_of_track = &end_of_track, .userinfo_updated = &userinfo_updated, .connection_error = &connection_error, .streaming_error =
 		&streaming_error, .start_playback = &start_playback, .credentials_blob_updated = &credentials_blob_updated };
 
-static sp_session_config spconfig = { .api_version = SPOTIFY_API_VERSION, .cache_location = "", // set in main
-		.settings_location = "", // set in main
-		.application_key = g_appkey, .application_key_size = 0, // Set in main()
-		.user_agent = "jahspotify/0.0.1", .callbacks = &session_callbacks, NULL , };
+static void SP_CALLCONV searchCompleteCallback(sp_search *result, void *userdata);
+
+/**
+ * Starts queued searches while there are free slots. Called with the spotify mutex held.
+ */
+static void startQueuedSearches(jahspotify_session *session) {
+	search_request *request;
+
+	while ((request = search_registry_next(&session->searches))) {
+		sp_search_create(session->sess, request->query, request->track_offset, request->num_tracks, request->album_offset, request->num_albums,
+				request->artist_offset, request->num_artists, request->playlist_offset, request->num_playlists, request->type, searchCompleteCallback,
+				request);
+	}
+}
+
+/**
+ * Queues telling the listener of the search that it failed. Called with the spotify mutex held.
+ */
+static void deferSearchFailed(jahspotify_session *session, int32_t token, const char *message) {
+	session_signal *signal = session_defer_signal(session, SESSION_SIGNAL_SEARCH_FAILED, NULL);
+	if (!signal) {
+		log_error("jahspotify", "deferSearchFailed", "Search %d is not told it failed: %s", token, message);
+		return;
+	}
+	signal->token = token;
+	signal->message = strdup(message);
+}
+
+/**
+ * Gives up searches past their deadline, their listeners are told once the event loop releases
+ * the spotify mutex. Called from the event loop with the spotify mutex held.
+ */
+static void expireSearches(jahspotify_session *session) {
+	search_request *request;
+
+	while ((request = search_registry_expire(&session->searches, monotonic_millis()))) {
+		deferSearchFailed(session, request->token, "Search timed out");
+		if (request->state == SEARCH_EXPIRED) search_request_free(request);
+	}
+	startQueuedSearches(session);
+}
 
+/**
+ * Reads the results of the search, its listener is told once the event loop releases the spotify
+ * mutex.
+ */
 static void SP_CALLCONV searchCompleteCallback(sp_search *result, void *userdata) {
-	int32_t *token = (int32_t*) userdata;
+	search_request *request = (search_request*) userdata;
+	jahspotify_session *session = request->session;
+	sp_error error = sp_search_error(result);
+	session_signal *signal;
+	jobject nativeSearchResult;
+	JNIEnv *env = NULL;
 
-	if (sp_search_error(result) == SP_ERROR_OK) {
-		signalSearchComplete(result, *token);
-	} else {
-		log_error("jahspotify", "searchCompleteCallback", "Search completed with error: %s\n", sp_error_message(sp_search_error(result)));
+	if (!retrieveEnv((JNIEnv*) &env)) return;
+
+	pthread_mutex_lock(&session->spotify_mutex);
+	// Abandoned searches were already answered when they were cancelled or timed out
+	if (request->state == SEARCH_RUNNING) {
+		if (error == SP_ERROR_OK) {
+			nativeSearchResult = createJSearchResult(env, session, result);
+			signal = nativeSearchResult ? session_defer_signal(session, SESSION_SIGNAL_SEARCH_COMPLETE, (*env)->NewGlobalRef(env, nativeSearchResult)) : NULL;
+			if (signal) signal->token = request->token;
+			else deferSearchFailed(session, request->token, "Could not read search result");
+			if (nativeSearchResult) (*env)->DeleteLocalRef(env, nativeSearchResult);
+		} else {
+			log_error("jahspotify", "searchCompleteCallback", "Search completed with error: %s\n", sp_error_message(error));
+			deferSearchFailed(session, request->token, sp_error_message(error));
+		}
 	}
+	search_registry_finish(&session->searches, request, error == SP_ERROR_OK, monotonic_millis());
+	search_request_free(request);
+	sp_search_release(result);
+
+	startQueuedSearches(session);
+	pthread_mutex_unlock(&session->spotify_mutex);
+	detachThread();
 }
 
 JNIEXPORT void JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeInitiateSearch(JNIEnv *env, jobject obj, jint javaToken, jobject javaNativeSearchParameters) {
-	char *nativeQuery;
-	int32_t *token = calloc(1, sizeof(int32_t));
+	jahspotify_session *session = session_from_java(env, obj);
+	char *nativeQuery = NULL;
+	search_request *request;
 	int32_t numAlbums;
 	int32_t albumOffset;
 	int32_t numArtists;
@@ -460,7 +733,7 @@ JNIEXPORT void JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeInitiateSearch(
 	jint value;
 	jboolean bValue;
 
-	*token = javaToken;
+	if (!session) return;
 
 	getObjectIntField(env, javaNativeSearchParameters, "numAlbums", &value);
 	numAlbums = value;
@@ -481,59 +754,124 @@ JNIEXPORT void JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeInitiateSearch(
 	getObjectBoolField(env, javaNativeSearchParameters, "suggest", &bValue);
 	suggest = bValue == JNI_TRUE ? 1 : 0;
 
-	if (createNativeString(env, getObjectStringField(env, javaNativeSearchParameters, "_query"), &nativeQuery) != 1) {
-		// FIXME: Handle error
+	createNativeString(env, getObjectStringField(env, javaNativeSearchParameters, "_query"), &nativeQuery);
+	request = nativeQuery ? search_request_create(session, javaToken) : NULL;
+	if (!request) {
+		free(nativeQuery);
+		signalSearchFailed(env, session, javaToken, "Could not start search");
+		return;
 	}
 
-	sp_search_type type = suggest ? SP_SEARCH_SUGGEST : SP_SEARCH_STANDARD;
-	sp_search_create(g_sess, nativeQuery, trackOffset, numTracks, albumOffset, numAlbums, artistOffset, numArtists, playlistOffset,
-			numPlaylists, type, searchCompleteCallback, token);
+	request->query = nativeQuery;
+	request->track_offset = trackOffset;
+	request->num_tracks = numTracks;
+	request->album_offset = albumOffset;
+	request->num_albums = numAlbums;
+	request->artist_offset = artistOffset;
+	request->num_artists = numArtists;
+	request->playlist_offset = playlistOffset;
+	request->num_playlists = numPlaylists;
+	request->type = suggest ? SP_SEARCH_SUGGEST : SP_SEARCH_STANDARD;
+
+	pthread_mutex_lock(&session->spotify_mutex);
+	search_registry_submit(&session->searches, request, monotonic_millis());
+	startQueuedSearches(session);
+	pthread_mutex_unlock(&session->spotify_mutex);
+}
+
+/**
+ * Cancels the search with the token. Its listener is not called anymore.
+ */
+JNIEXPORT void JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeCancelSearch(JNIEnv *env, jobject obj, jint javaToken) {
+	jahspotify_session *session = session_from_java(env, obj);
+	search_request *request;
+
+	if (!session) return;
+
+	pthread_mutex_lock(&session->spotify_mutex);
+	request = search_registry_cancel(&session->searches, javaToken);
+	if (request) search_request_free(request);
+	startQueuedSearches(session);
+	pthread_mutex_unlock(&session->spotify_mutex);
+}
+
+JNIEXPORT void JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeSetSearchLimits(JNIEnv *env, jobject obj, jint maxRunning, jlong timeoutMillis) {
+	jahspotify_session *session = session_from_java(env, obj);
+
+	if (!session) return;
+
+	pthread_mutex_lock(&session->spotify_mutex);
+	session->searches.max_running = maxRunning > 0 ? (unsigned int) maxRunning : 0;
+	session->searches.timeout = timeoutMillis > 0 ? (uint64_t) timeoutMillis : 0;
+	if (session->sess) startQueuedSearches(session);
+	pthread_mutex_unlock(&session->spotify_mutex);
 }
 
 JNIEXPORT jboolean JNICALL Java_jahspotify_impl_JahSpotifyImpl_registerNativeMediaLoadedListener(JNIEnv *env, jobject obj, jobject mediaLoadedListener) {
-	g_mediaLoadedListener = (*env)->NewGlobalRef(env, mediaLoadedListener);
-	log_debug("jahspotify", "registerNativeMediaLoadedListener", "Registered media loaded listener: 0x%x\n", (int) g_mediaLoadedListener);
+	jahspotify_session *session = session_from_java(env, obj);
+	if (!session) return JNI_FALSE;
+	session->mediaLoadedListener = (*env)->NewGlobalRef(env, mediaLoadedListener);
+	log_debug("jahspotify", "registerNativeMediaLoadedListener", "Registered media loaded listener: 0x%x\n", (int) session->mediaLoadedListener);
+	return JNI_TRUE;
+}
+
+JNIEXPORT jboolean JNICALL Java_jahspotify_impl_JahSpotifyImpl_registerNativePlaylistContainer(JNIEnv *env, jobject obj, jobject playlistContainer) {
+	jahspotify_session *session = session_from_java(env, obj);
+	if (!session) return JNI_FALSE;
+	session->playlistContainer = (*env)->NewGlobalRef(env, playlistContainer);
 	return JNI_TRUE;
 }
 
 JNIEXPORT jboolean JNICALL Java_jahspotify_impl_JahSpotifyImpl_registerNativeSearchCompleteListener(JNIEnv *env, jobject obj, jobject searchCompleteListener) {
-	g_searchCompleteListener = (*env)->NewGlobalRef(env, searchCompleteListener);
-	log_debug("jahspotify", "registerNativeSearchCompleteListener", "Registered search complete listener: 0x%x\n", (int) g_searchCompleteListener);
+	jahspotify_session *session = session_from_java(env, obj);
+	if (!session) return JNI_FALSE;
+	session->searchCompleteListener = (*env)->NewGlobalRef(env, searchCompleteListener);
+	log_debug("jahspotify", "registerNativeSearchCompleteListener", "Registered search complete listener: 0x%x\n", (int) session->searchCompleteListener);
 	return JNI_TRUE;
 }
 
 JNIEXPORT jboolean JNICALL Java_jahspotify_impl_JahSpotifyImpl_registerNativePlaybackListener(JNIEnv *env, jobject obj, jobject playbackListener) {
-	g_playbackListener = (*env)->NewGlobalRef(env, playbackListener);
-	log_debug("jahspotify", "registerNativePlaybackListener", "Registered playback listener: 0x%x\n", (int) g_playbackListener);
+	jahspotify_session *session = session_from_java(env, obj);
+	if (!session) return JNI_FALSE;
+	session->playbackListener = (*env)->NewGlobalRef(env, playbackListener);
+	log_debug("jahspotify", "registerNativePlaybackListener", "Registered playback listener: 0x%x\n", (int) session->playbackListener);
 	return JNI_TRUE;
 }
 
 JNIEXPORT jboolean JNICALL Java_jahspotify_impl_JahSpotifyImpl_registerNativeConnectionListener(JNIEnv *env, jobject obj, jobject connectionListener) {
-	g_connectionListener = (*env)->NewGlobalRef(env, connectionListener);
-	log_debug("jahspotify", "registerNativeConnectionListener", "Registered connection listener: 0x%x\n", (int) g_connectionListener);
+	jahspotify_session *session = session_from_java(env, obj);
+	if (!session) return JNI_FALSE;
+	session->connectionListener = (*env)->NewGlobalRef(env, connectionListener);
+	log_debug("jahspotify", "registerNativeConnectionListener", "Registered connection listener: 0x%x\n", (int) session->connectionListener);
 	return JNI_TRUE;
 }
 
 JNIEXPORT jboolean JNICALL Java_jahspotify_impl_JahSpotifyImpl_unregisterListeners(JNIEnv *env, jobject obj) {
-	if (g_mediaLoadedListener) {
-		(*env)->DeleteGlobalRef(env, g_mediaLoadedListener);
-		g_mediaLoadedListener = NULL;
+	jahspotify_session *session = session_from_java(env, obj);
+	if (!session) return JNI_FALSE;
+
+	if (session->mediaLoadedListener) {
+		(*env)->DeleteGlobalRef(env, session->mediaLoadedListener);
+		session->mediaLoadedListener = NULL;
 	}
 
-	if (g_searchCompleteListener) {
-		(*env)->DeleteGlobalRef(env, g_searchCompleteListener);
-		g_searchCompleteListener = NULL;
+	if (session->searchCompleteListener) {
+		(*env)->DeleteGlobalRef(env, session->searchCompleteListener);
+		session->searchCompleteListener = NULL;
 	}
 
-	if (g_connectionListener) {
-		(*env)->DeleteGlobalRef(env, g_connectionListener);
-		g_connectionListener = NULL;
+	if (session->connectionListener) {
+		(*env)->DeleteGlobalRef(env, session->connectionListener);
+		session->connectionListener = NULL;
 	}
 	return JNI_TRUE;
 }
 
 JNIEXPORT jobject JNICALL Java_jahspotify_impl_JahSpotifyImpl_retrieveUser(JNIEnv *env, jobject obj) {
-	sp_user *user = sp_session_user(g_sess);
+	jahspotify_session *session = session_from_java(env, obj);
+	if (!session) return NULL;
+
+	sp_user *user = sp_session_user(session->sess);
 	const char *value = NULL;
 	int country = 0;
 
@@ -572,7 +910,7 @@ JNIEXPORT jobject JNICALL Java_jahspotify_impl_JahSpotifyImpl_retrieveUser(JNIEn
 		}
 
 		// Country encoded in an integer 'SE' = 'S' << 8 | 'E'
-		country = sp_session_user_country(g_sess);
+		country = sp_session_user_country(session->sess);
 		char countryStr[] = "  ";
 		countryStr[0] = (byte) (country >> 8);
 		countryStr[1] = (byte) country;
@@ -591,30 +929,120 @@ char* createLinkStr(sp_link *link) {
 	return linkStr;
 }
 
-jobject createJLinkInstance(JNIEnv *env, sp_link *link) {
-	if (!link) return NULL ;
+jobject createJLinkInstanceFromString(JNIEnv *env, const char *linkStr) {
+	if (!linkStr) return NULL ;
 	jobject linkInstance = NULL;
-	jmethodID jMethod = NULL;
-
-	char *linkStr = createLinkStr(link);
+	uint8_t gid[METADATA_GID_SIZE];
+	metadata_kind kind;
+
+	// Tracks, albums and artists go over as their id, Java interns them and renders the URI lazily
+	if (metadata_gid(linkStr, &kind, gid) == 0) {
+		linkInstance = (*env)->CallStaticObjectMethod(env, JCLASS(MEDIA_RECORD), JSTATIC(MEDIA_RECORD_LINK), (jint) kind,
+				(jlong) media_record_gid_half(gid), (jlong) media_record_gid_half(gid + 8));
+		if (linkInstance) return linkInstance;
+	}
 
 	jstring jString = (*env)->NewStringUTF(env, linkStr);
 
-	jMethod = (*env)->GetStaticMethodID(env, g_linkClass, "create", "(Ljava/lang/String;)Ljahspotify/media/Link;");
-
-	linkInstance = (*env)->CallStaticObjectMethod(env, g_linkClass, jMethod, jString);
+	linkInstance = (*env)->CallStaticObjectMethod(env, JCLASS(LINK), JSTATIC(LINK_CREATE), jString);
 
 	if (!linkInstance) {
 		log_error("jahspotify", "createJLinkInstance", "Could not create instance of jahspotify.media.Link");
-		goto exit;
 	}
 
-	exit: if (linkStr) {
-		free(linkStr);
-	}
 	if (jString) (*env)->DeleteLocalRef(env, jString);
 	return linkInstance;
+}
+
+jobject createJLinkInstance(JNIEnv *env, sp_link *link) {
+	if (!link) return NULL ;
+
+	char stackStr[256];
+	char *linkStr = stackStr;
+	int length = sp_link_as_string(link, stackStr, sizeof(stackStr));
+
+	// Only search and local links get this long
+	if (length >= (int) sizeof(stackStr)) {
+		linkStr = malloc(length + 1);
+		if (!linkStr) return NULL ;
+		sp_link_as_string(link, linkStr, length + 1);
+	}
+
+	jobject linkInstance = createJLinkInstanceFromString(env, linkStr);
+
+	if (linkStr != stackStr) free(linkStr);
+	return linkInstance;
+}
+
+/**
+ * Returns the URI of the link and releases it, NULL if there is no link.
+ */
+static char *takeLinkStr(sp_link *link) {
+	if (!link) return NULL ;
+	char *linkStr = createLinkStr(link);
+	sp_link_release(link);
+	return linkStr;
+}
+
+/**
+ * Frees the strings of a metadata snapshot, the name belongs to libspotify and is left alone.
+ */
+static void releaseMetadata(metadata *item) {
+	int i;
+	free((char*) item->uri);
+	free((char*) item->parent);
+	free((char*) item->cover);
+	for (i = 0; i < item->num_artists; i++)
+		free((char*) item->artists[i]);
+	free(item->artists);
+}
+
+/**
+ * Fills in the metadata of a loaded track, strings are owned by the caller (see releaseMetadata).
+ */
+static void trackMetadata(sp_track *track, metadata *item) {
+	int i;
+
+	memset(item, 0, sizeof *item);
+	item->kind = METADATA_TRACK;
+	item->uri = takeLinkStr(sp_link_create_from_track(track, 0));
+	item->name = sp_track_name(track);
+	item->values[0] = sp_track_duration(track);
+	item->values[1] = sp_track_popularity(track);
+	item->values[2] = sp_track_index(track);
+
+	sp_album *album = sp_track_album(track);
+	if (album) item->parent = takeLinkStr(sp_link_create_from_album(album));
+
+	int numArtists = sp_track_num_artists(track);
+	if (numArtists > 0) item->artists = calloc(numArtists, sizeof(char*));
+	for (i = 0; i < numArtists && item->artists; i++) {
+		sp_artist *artist = sp_track_artist(track, i);
+		if (artist) {
+			char *artistStr = takeLinkStr(sp_link_create_from_artist(artist));
+			if (artistStr) item->artists[item->num_artists++] = artistStr;
+		}
+	}
+}
+
+static void albumMetadata(sp_album *album, metadata *item) {
+	memset(item, 0, sizeof *item);
+	item->kind = METADATA_ALBUM;
+	item->uri = takeLinkStr(sp_link_create_from_album(album));
+	item->name = sp_album_name(album);
+	item->values[0] = sp_album_year(album);
+	item->values[1] = (int) sp_album_type(album);
+	item->cover = takeLinkStr(sp_link_create_from_album_cover(album, SP_IMAGE_SIZE_NORMAL));
+
+	sp_artist *artist = sp_album_artist(album);
+	if (artist) item->parent = takeLinkStr(sp_link_create_from_artist(artist));
+}
 
+static void artistMetadata(sp_artist *artist, metadata *item) {
+	memset(item, 0, sizeof *item);
+	item->kind = METADATA_ARTIST;
+	item->uri = takeLinkStr(sp_link_create_from_artist(artist));
+	item->name = sp_artist_name(artist);
 }
 
 jobject createJPlaylistInstance(JNIEnv *env, sp_link* link, const char* name, sp_link* image) {
@@ -624,11 +1052,8 @@ jobject createJPlaylistInstance(JNIEnv *env, sp_link* link, const char* name, sp
 	jstring jString = (*env)->NewStringUTF(env, name);
 
 	jobject playlistInstance = NULL;
-	jmethodID jMethod = NULL;
 
-	jMethod = (*env)->GetStaticMethodID(env, g_playlistCLass, "create",
-			"(Ljahspotify/media/Link;Ljava/lang/String;Ljahspotify/media/Link;)Ljahspotify/media/Playlist;");
-	playlistInstance = (*env)->CallStaticObjectMethod(env, g_linkClass, jMethod, linkInstance, jString, imageLinkInstance);
+	playlistInstance = (*env)->CallStaticObjectMethod(env, JCLASS(PLAYLIST), JSTATIC(PLAYLIST_CREATE), linkInstance, jString, imageLinkInstance);
 
 	if (!playlistInstance) {
 		log_error("jahspotify", "createJPlaylistInstance", "Could not create instance of jahspotify.media.Playlist");
@@ -641,17 +1066,10 @@ jobject createJPlaylistInstance(JNIEnv *env, sp_link* link, const char* name, sp
 	return playlistInstance;
 }
 
-jobject createJTrackInstance(JNIEnv *env, sp_track *track) {
-	jclass jClass;
+jobject createJTrackInstance(JNIEnv *env, jahspotify_session *session, sp_track *track) {
 	jobject trackInstance;
 
-	jClass = (*env)->FindClass(env, "jahspotify/media/Track");
-	if (jClass == NULL ) {
-		log_error("jahspotify", "createJTrackInstance", "Could not load jahnotify.media.Track");
-		return NULL ;
-	}
-
-	trackInstance = createInstanceFromJClass(env, jClass);
+	trackInstance = (*env)->NewObject(env, JCLASS(TRACK), JMETHOD(TRACK_INIT));
 	if (!trackInstance) {
 		log_error("jahspotify", "createJTrackInstance", "Could not create instance of jahspotify.media.Track");
 		return NULL ;
@@ -660,95 +1078,66 @@ jobject createJTrackInstance(JNIEnv *env, sp_track *track) {
 	if (sp_track_is_loaded(track))
 		populateJTrackInstance(env, trackInstance, track);
 	else
-		addLoading((*env)->NewGlobalRef(env, trackInstance), track, NULL, NULL, 0);
+		addLoading(session, (*env)->NewGlobalRef(env, trackInstance), track, NULL, NULL, 0);
 
 	return trackInstance;
 }
 
-void populateJTrackInstance(JNIEnv *env, jobject trackInstance, sp_track *track) {
-	jclass jClass;
-
-	jClass = (*env)->FindClass(env, "jahspotify/media/Track");
-	if (jClass == NULL ) {
-		log_error("jahspotify", "populateJTrackInstance", "Could not load jahnotify.media.Track");
-		sp_track_release(track);
-		return ;
-	}
-
-	sp_link *trackLink = sp_link_create_from_track(track, 0);
-
-	if (trackLink) {
-		sp_link_add_ref(trackLink);
-		jobject trackJLink = createJLinkInstance(env, trackLink);
-		setObjectObjectField(env, trackInstance, "id", "Ljahspotify/media/Link;", trackJLink);
-
-		setObjectStringField(env, trackInstance, "title", sp_track_name(track));
-		setObjectIntField(env, trackInstance, "length", sp_track_duration(track));
-		setObjectIntField(env, trackInstance, "popularity", sp_track_popularity(track));
-		setObjectIntField(env, trackInstance, "trackNumber", sp_track_index(track));
-
-		sp_album *album = sp_track_album(track);
-		if (album) {
-			sp_album_add_ref(album);
-			sp_link *albumLink = sp_link_create_from_album(album);
-			if (albumLink) {
-				sp_link_add_ref(albumLink);
-
-				jobject albumJLink = createJLinkInstance(env, albumLink);
-
-				jmethodID jMethod = (*env)->GetMethodID(env, jClass, "setAlbum", "(Ljahspotify/media/Link;)V");
-
-				if (jMethod == NULL ) {
-					log_error("jahspotify", "populateJTrackInstance", "Could not load method setAlbum(link) on class Track");
-					sp_track_release(track);
-					return ;
-				}
-
-				// set it on the track
-				(*env)->CallVoidMethod(env, trackInstance, jMethod, albumJLink);
-
-				sp_link_release(albumLink);
-
-			}
-			sp_album_release(album);
+/**
+ * Writes the record of the item into the stack buffer, or a buffer allocated if it does not fit.
+ * Returns the buffer holding the record, NULL if it could not be allocated.
+ */
+static uint8_t *writeMediaRecord(const metadata *item, uint8_t *stackBuffer, size_t *size) {
+	uint8_t *buffer = stackBuffer;
+
+	*size = media_record_size(item);
+	if (*size > MEDIA_RECORD_STACK_SIZE) {
+		buffer = malloc(*size);
+		if (!buffer) {
+			log_error("jahspotify", "writeMediaRecord", "Could not allocate %u bytes", (unsigned int) *size);
+			return NULL;
 		}
+	}
 
-		int numArtists = sp_track_num_artists(track);
-		if (numArtists > 0) {
-			jmethodID jMethod = (*env)->GetMethodID(env, jClass, "addArtist", "(Ljahspotify/media/Link;)V");
-
-			if (jMethod == NULL ) {
-				log_error("jahspotify", "populateJTrackInstance", "Could not load method addArtist(link) on class Track");
-				sp_track_release(track);
-				return ;
-			}
-
-			int i = 0;
-			for (i = 0; i < numArtists; i++) {
-				sp_artist *artist = sp_track_artist(track, i);
-				if (artist) {
-					sp_artist_add_ref(artist);
-
-					sp_link *artistLink = sp_link_create_from_artist(artist);
-					if (artistLink) {
-						sp_link_add_ref(artistLink);
+	*size = media_record_write(item, buffer);
+	return buffer;
+}
 
-						jobject artistJLink = createJLinkInstance(env, artistLink);
+static void decodeMediaRecord(JNIEnv *env, jobject instance, uint8_t *buffer, size_t size) {
+	jobject record = (*env)->NewDirectByteBuffer(env, buffer, (jlong) size);
+	if (record) {
+		(*env)->CallStaticVoidMethod(env, JCLASS(MEDIA_RECORD), JSTATIC(MEDIA_RECORD_DECODE), instance, record);
+		(*env)->DeleteLocalRef(env, record);
+	} else {
+		log_error("jahspotify", "decodeMediaRecord", "Could not wrap record of %u bytes", (unsigned int) size);
+	}
+}
 
-						// set it on the track
-						(*env)->CallVoidMethod(env, trackInstance, jMethod, artistJLink);
+/**
+ * Populates a track, album or artist from the metadata in a single call into Java, which decodes
+ * the record (see jahspotify.impl.MediaRecord).
+ */
+static void populateJInstanceFromMetadata(JNIEnv *env, jobject instance, const metadata *item) {
+	uint8_t stackBuffer[MEDIA_RECORD_STACK_SIZE];
+	size_t size;
+	uint8_t *buffer = writeMediaRecord(item, stackBuffer, &size);
 
-						sp_link_release(artistLink);
+	if (!buffer) return;
+	decodeMediaRecord(env, instance, buffer, size);
+	if (buffer != stackBuffer) free(buffer);
+}
 
-					}
-					sp_artist_release(artist);
-				}
-			}
-		}
+void populateJTrackInstance(JNIEnv *env, jobject trackInstance, sp_track *track) {
+	metadata item;
 
-		sp_link_release(trackLink);
+	trackMetadata(track, &item);
+	if (item.uri) {
+		metadata_cache_put(&item);
+		populateJInstanceFromMetadata(env, trackInstance, &item);
 	}
-	invokeVoidMethod_Z(env, trackInstance, "setLoaded", JNI_TRUE);
+	releaseMetadata(&item);
+
+	setLoaded(env, trackInstance);
 	sp_track_release(track);
 }
 
@@ -772,44 +1161,254 @@ char* toHexString(byte* bytes) {
 	return finalHash;
 }
 
+/**
+ * Makes the listener calls taken from the session and frees them. Called without the spotify mutex.
+ */
+static void deliverSignals(JNIEnv *env, jahspotify_session *session, session_signal *signal) {
+	session_signal *next;
+
+	for (; signal; signal = next) {
+		next = signal->next;
+		switch (signal->type) {
+		case SESSION_SIGNAL_ARTIST:
+			notifyArtistLoaded(env, session, signal->instance);
+			break;
+		case SESSION_SIGNAL_ALBUM:
+			notifyAlbumLoaded(env, session, signal->instance);
+			break;
+		case SESSION_SIGNAL_SEARCH_COMPLETE:
+			notifySearchComplete(env, session, signal->token, signal->instance);
+			(*env)->DeleteGlobalRef(env, signal->instance);
+			break;
+		case SESSION_SIGNAL_SEARCH_FAILED:
+			signalSearchFailed(env, session, signal->token, signal->message ? signal->message : "Search failed");
+			break;
+		case SESSION_SIGNAL_IMAGE:
+			signalImageLoaded(env, session, signal->instance, (jbyteArray) signal->bytes);
+			(*env)->DeleteGlobalRef(env, signal->bytes);
+			break;
+		}
+		free(signal->message);
+		free(signal);
+	}
+}
+
 void SP_CALLCONV artistBrowseCompleteCallback(sp_artistbrowse *result, void *userdata) {
-	jobject instance = (jobject) userdata;
-	signalArtistBrowseLoaded(result, instance);
+	browse_entry *entry = (browse_entry*) userdata;
+	jahspotify_session *session = entry->session;
+	browse_waiter *waiter, *next;
+	JNIEnv *env = NULL;
+
+	if (!retrieveEnv((JNIEnv*) &env)) return;
+
+	pthread_mutex_lock(&session->spotify_mutex);
+	// The cache keeps the reference handed to this callback, failed browses are not kept
+	waiter = browse_cache_complete(&session->browses, entry, sp_artistbrowse_error(result) == SP_ERROR_OK ? result : NULL, monotonic_millis());
+	// Listeners are called by the event loop once it releases the spotify mutex
+	for (; waiter; waiter = next) {
+		next = waiter->next;
+		sp_artistbrowse_add_ref(result);
+		if (populateArtistFromBrowse(env, session, result, waiter->instance) != 0) (*env)->DeleteGlobalRef(env, waiter->instance);
+		else if (session_defer_signal(session, SESSION_SIGNAL_ARTIST, waiter->instance) == NULL) notifyArtistLoaded(env, session, waiter->instance);
+		free(waiter);
+	}
+	if (sp_artistbrowse_error(result) != SP_ERROR_OK) sp_artistbrowse_release(result);
+	pthread_mutex_unlock(&session->spotify_mutex);
+	detachThread();
+}
+
+/**
+ * Browses the artist, or hands out a recent browse of it. Requests for a browse which is still
+ * running wait for it.
+ */
+static void browseArtist(JNIEnv *env, jahspotify_session *session, jobject artistInstance, sp_artist *artist, int browse) {
+	browse_type type = browse == 1 ? BROWSE_ARTIST_NO_TRACKS : BROWSE_ARTIST_NO_ALBUMS;
+	browse_entry *entry;
+	jobject hit = NULL;
+
+	pthread_mutex_lock(&session->spotify_mutex);
+	entry = browse_cache_find(&session->browses, type, artist, monotonic_millis());
+	if (entry && entry->result) {
+		// Only populated here, the listeners are told once the mutex is released
+		sp_artistbrowse_add_ref((sp_artistbrowse*) entry->result);
+		hit = (*env)->NewGlobalRef(env, artistInstance);
+		if (populateArtistFromBrowse(env, session, (sp_artistbrowse*) entry->result, hit) != 0) {
+			(*env)->DeleteGlobalRef(env, hit);
+			hit = NULL;
+		}
+		goto exit;
+	}
+
+	if (!entry) {
+		entry = browse_cache_add(&session->browses, session, type, artist);
+		if (!entry) goto exit;
+		if (browse_cache_wait(entry, (*env)->NewGlobalRef(env, artistInstance)) == 0)
+			sp_artistbrowse_create(session->sess, artist, browse == 1 ? SP_ARTISTBROWSE_NO_TRACKS : SP_ARTISTBROWSE_NO_ALBUMS,
+					artistBrowseCompleteCallback, entry);
+		goto exit;
+	}
+
+	browse_cache_wait(entry, (*env)->NewGlobalRef(env, artistInstance));
+
+	exit: pthread_mutex_unlock(&session->spotify_mutex);
+	if (hit) notifyArtistLoaded(env, session, hit);
+}
+
+/**
+ * Copies image bytes into a new Java array with a single bulk copy.
+ */
+static jbyteArray createJImageBytes(JNIEnv *env, const void *data, size_t size) {
+	jbyteArray bytes = (*env)->NewByteArray(env, (jsize) size);
+	if (!bytes) {
+		log_error("jahspotify", "createJImageBytes", "Could not allocate %u bytes", (unsigned int) size);
+		return NULL;
+	}
+	if (size > 0) (*env)->SetByteArrayRegion(env, bytes, 0, (jsize) size, (const jbyte*) data);
+	return bytes;
+}
+
+/**
+ * Adds the bytes of a loaded image to the image cache and forgets the load. Handing them to the
+ * instances waiting for it is queued on the session, the caller makes those calls once it has
+ * released the spotify mutex. Called with the spotify mutex held.
+ */
+static void completeImageLoad(JNIEnv *env, image_load *load) {
+	image_load **link = &load->session->image_loads;
+	image_waiter *waiter, *next;
+	session_signal *signal;
+	size_t size = 0;
+	const void *data = sp_image_data(load->image, &size);
+	jbyteArray bytes;
+
+	if (!data) size = 0;
+	if (size > 0) image_cache_put(load->id, IMAGE_VARIANT_ORIGINAL, data, size);
+	bytes = createJImageBytes(env, data, size);
+
+	for (waiter = load->waiters; waiter; waiter = next) {
+		next = waiter->next;
+		signal = bytes ? session_defer_signal(load->session, SESSION_SIGNAL_IMAGE, waiter->instance) : NULL;
+		if (signal) signal->bytes = (*env)->NewGlobalRef(env, bytes);
+		else (*env)->DeleteGlobalRef(env, waiter->instance);
+		free(waiter);
+	}
+	if (bytes) (*env)->DeleteLocalRef(env, bytes);
+
+	while (*link && *link != load)
+		link = &(*link)->next;
+	if (*link) *link = load->next;
+
+	sp_image_release(load->image);
+	free(load);
 }
 
-void SP_CALLCONV imageLoadedCallback(sp_image *image, void *userdata) {
-	sp_image_remove_load_callback(image, imageLoadedCallback, userdata);
-	jobject instance = (jobject) userdata;
-	signalImageLoaded(image, instance);
-}
-/*
- void trackLoadedCallback(sp_track *track, void *userdata)
- {
- int32_t *token = (int32_t*)userdata;
- signalTrackLoaded(track, *token);
- }*/
+void SP_CALLCONV imageLoadedCallback(sp_image *image, void *userdata) {
+	image_load *load = (image_load*) userdata;
+	jahspotify_session *session = load->session;
+	JNIEnv *env = NULL;
+
+	sp_image_remove_load_callback(image, imageLoadedCallback, userdata);
+	if (!retrieveEnv((JNIEnv*) &env)) return;
+
+	// Called from the event loop, which hands the bytes over once it releases the spotify mutex
+	pthread_mutex_lock(&session->spotify_mutex);
+	completeImageLoad(env, load);
+	pthread_mutex_unlock(&session->spotify_mutex);
+	detachThread();
+}
+
+/**
+ * Gives up the images still loading, their waiting instances are never handed bytes. Called with
+ * the spotify mutex held on logout and shutdown.
+ */
+static void clearImageLoads(JNIEnv *env, jahspotify_session *session) {
+	image_load *load;
+	image_waiter *waiter;
+
+	while ((load = session->image_loads)) {
+		session->image_loads = load->next;
+		sp_image_remove_load_callback(load->image, imageLoadedCallback, load);
+		while ((waiter = load->waiters)) {
+			load->waiters = waiter->next;
+			(*env)->DeleteGlobalRef(env, waiter->instance);
+			free(waiter);
+		}
+		sp_image_release(load->image);
+		free(load);
+	}
+}
+/*
+ void trackLoadedCallback(sp_track *track, void *userdata)
+ {
+ int32_t *token = (int32_t*)userdata;
+ signalTrackLoaded(track, *token);
+ }*/
+
+void SP_CALLCONV albumBrowseCompleteCallback(sp_albumbrowse *result, void *userdata) {
+	browse_entry *entry = (browse_entry*) userdata;
+	jahspotify_session *session = entry->session;
+	browse_waiter *waiter, *next;
+	JNIEnv *env = NULL;
+
+	if (!retrieveEnv((JNIEnv*) &env)) return;
+
+	pthread_mutex_lock(&session->spotify_mutex);
+	// The cache keeps the reference handed to this callback, failed browses are not kept
+	waiter = browse_cache_complete(&session->browses, entry, sp_albumbrowse_error(result) == SP_ERROR_OK ? result : NULL, monotonic_millis());
+	// Listeners are called by the event loop once it releases the spotify mutex
+	for (; waiter; waiter = next) {
+		next = waiter->next;
+		sp_albumbrowse_add_ref(result);
+		if (populateAlbumFromBrowse(env, result, waiter->instance) != 0) (*env)->DeleteGlobalRef(env, waiter->instance);
+		else if (session_defer_signal(session, SESSION_SIGNAL_ALBUM, waiter->instance) == NULL) notifyAlbumLoaded(env, session, waiter->instance);
+		free(waiter);
+	}
+	if (sp_albumbrowse_error(result) != SP_ERROR_OK) sp_albumbrowse_release(result);
+	pthread_mutex_unlock(&session->spotify_mutex);
+	detachThread();
+}
+
+/**
+ * Browses the album, or hands out a recent browse of it. Requests for a browse which is still
+ * running wait for it.
+ */
+static void browseAlbum(JNIEnv *env, jahspotify_session *session, jobject albumInstance, sp_album *album) {
+	browse_entry *entry;
+	jobject hit = NULL;
+
+	pthread_mutex_lock(&session->spotify_mutex);
+	entry = browse_cache_find(&session->browses, BROWSE_ALBUM, album, monotonic_millis());
+	if (entry && entry->result) {
+		// Only populated here, the listeners are told once the mutex is released
+		sp_albumbrowse_add_ref((sp_albumbrowse*) entry->result);
+		hit = (*env)->NewGlobalRef(env, albumInstance);
+		if (populateAlbumFromBrowse(env, (sp_albumbrowse*) entry->result, hit) != 0) {
+			(*env)->DeleteGlobalRef(env, hit);
+			hit = NULL;
+		}
+		goto exit;
+	}
+
+	if (!entry) {
+		entry = browse_cache_add(&session->browses, session, BROWSE_ALBUM, album);
+		if (!entry) goto exit;
+		if (browse_cache_wait(entry, (*env)->NewGlobalRef(env, albumInstance)) == 0)
+			sp_albumbrowse_create(session->sess, album, albumBrowseCompleteCallback, entry);
+		goto exit;
+	}
+
+	browse_cache_wait(entry, (*env)->NewGlobalRef(env, albumInstance));
 
-void SP_CALLCONV albumBrowseCompleteCallback(sp_albumbrowse *result, void *userdata) {
-	jobject instance = (jobject) userdata;
-	signalAlbumBrowseLoaded(result, instance);
+	exit: pthread_mutex_unlock(&session->spotify_mutex);
+	if (hit) notifyAlbumLoaded(env, session, hit);
 }
 
 void populateJAlbumInstanceFromAlbumBrowse(JNIEnv *env, sp_album *album, sp_albumbrowse *albumBrowse, jobject albumInstance) {
-	jclass albumJClass;
-
 	sp_album_add_ref(album);
 	sp_albumbrowse_add_ref(albumBrowse);
 
-	albumJClass = (*env)->FindClass(env, "jahspotify/media/Album");
-	if (albumJClass == NULL ) {
-		log_error("jahspotify", "populateJAlbumInstanceFromAlbumBrowse", "Could not load jahnotify.media.Album");
-		return;
-	}
-
 	int numTracks = sp_albumbrowse_num_tracks(albumBrowse);
 	if (numTracks > 0) {
 		// Add each track to the album - also pass in the disk as need be
-		jmethodID addTrackJMethodID = (*env)->GetMethodID(env, albumJClass, "addTrack", "(ILjahspotify/media/Link;)V");
 		int i = 0;
 		for (i = 0; i < numTracks; i++) {
 			sp_track *track = sp_albumbrowse_track(albumBrowse, i);
@@ -821,7 +1420,8 @@ void populateJAlbumInstanceFromAlbumBrowse(JNIEnv *env, sp_album *album, sp_albu
 				if (trackLink) {
 					sp_link_add_ref(trackLink);
 					jobject trackJLink = createJLinkInstance(env, trackLink);
-					(*env)->CallVoidMethod(env, albumInstance, addTrackJMethodID, sp_track_disc(track), trackJLink);
+					(*env)->CallVoidMethod(env, albumInstance, JMETHOD(ALBUM_ADD_TRACK), sp_track_disc(track), trackJLink);
+					if (trackJLink) (*env)->DeleteLocalRef(env, trackJLink);
 					sp_link_release(trackLink);
 				}
 			}
@@ -831,13 +1431,12 @@ void populateJAlbumInstanceFromAlbumBrowse(JNIEnv *env, sp_album *album, sp_albu
 	int numCopyrights = sp_albumbrowse_num_copyrights(albumBrowse);
 	if (numCopyrights > 0) {
 		// Add copyrights to album
-		jmethodID addCopyrightMethodID = (*env)->GetMethodID(env, albumJClass, "addCopyright", "(Ljava/lang/String;)V");
 		int i = 0;
 		for (i = 0; i < numCopyrights; i++) {
 			const char *copyright = sp_albumbrowse_copyright(albumBrowse, i);
 			if (copyright) {
 				jstring str = (*env)->NewStringUTF(env, copyright);
-				(*env)->CallVoidMethod(env, albumInstance, addCopyrightMethodID, str);
+				(*env)->CallVoidMethod(env, albumInstance, JMETHOD(ALBUM_ADD_COPYRIGHT), str);
 				(*env)->DeleteLocalRef(env, str);
 			}
 		}
@@ -845,7 +1444,7 @@ void populateJAlbumInstanceFromAlbumBrowse(JNIEnv *env, sp_album *album, sp_albu
 
 	const char *review = sp_albumbrowse_review(albumBrowse);
 	if (review) {
-		setObjectStringField(env, albumInstance, "review", review);
+		setStringField(env, albumInstance, JFIELD(ALBUM_REVIEW), review);
 	}
 
 	sp_album_release(album);
@@ -853,18 +1452,10 @@ void populateJAlbumInstanceFromAlbumBrowse(JNIEnv *env, sp_album *album, sp_albu
 
 }
 
-jobject createJAlbumInstance(JNIEnv *env, sp_album *album, int browse) {
+jobject createJAlbumInstance(JNIEnv *env, jahspotify_session *session, sp_album *album, int browse) {
 	jobject albumInstance;
-	jclass albumJClass;
 
-	albumJClass = (*env)->FindClass(env, "jahspotify/media/Album");
-	if (albumJClass == NULL ) {
-		log_error("jahspotify", "createJAlbumInstance", "Could not load jahnotify.media.Album");
-		sp_album_release(album);
-		return NULL ;
-	}
-
-	albumInstance = createInstanceFromJClass(env, albumJClass);
+	albumInstance = (*env)->NewObject(env, JCLASS(ALBUM), JMETHOD(ALBUM_INIT));
 	if (!albumInstance) {
 		log_error("jahspotify", "createJAlbumInstance", "Could not create instance of jahspotify.media.Album");
 		sp_album_release(album);
@@ -872,92 +1463,37 @@ jobject createJAlbumInstance(JNIEnv *env, sp_album *album, int browse) {
 	}
 
 	if (sp_album_is_loaded(album)) {
-		populateJAlbumInstance(env, albumInstance, album, browse);
+		populateJAlbumInstance(env, session, albumInstance, album, browse);
 	} else {
-		addLoading((*env)->NewGlobalRef(env, albumInstance), NULL, album, NULL, browse);
+		addLoading(session, (*env)->NewGlobalRef(env, albumInstance), NULL, album, NULL, browse);
 	}
 	return albumInstance;
 }
-void populateJAlbumInstance(JNIEnv *env, jobject albumInstance, sp_album *album, int browse) {
-	// By now it looks like the album will be loaded
-	sp_link *albumLink = sp_link_create_from_album(album);
-
-	if (albumLink) {
-		sp_link_add_ref(albumLink);
-
-		jobject albumJLink = createJLinkInstance(env, albumLink);
-		setObjectObjectField(env, albumInstance, "id", "Ljahspotify/media/Link;", albumJLink);
-
-		sp_link_release(albumLink);
-	}
-
-	setObjectStringField(env, albumInstance, "name", sp_album_name(album));
-	setObjectIntField(env, albumInstance, "year", sp_album_year(album));
-
-	sp_albumtype albumType = sp_album_type(album);
-
-	jclass albumTypeJClass = (*env)->FindClass(env, "jahspotify/media/AlbumType");
-	jmethodID jMethod = (*env)->GetStaticMethodID(env, albumTypeJClass, "fromOrdinal", "(I)Ljahspotify/media/AlbumType;");
-	jobject albumTypeEnum = (jobjectArray) (*env)->CallStaticObjectMethod(env, albumTypeJClass, jMethod, (int) albumType);
-	setObjectObjectField(env, albumInstance, "type", "Ljahspotify/media/AlbumType;", albumTypeEnum);
-
-	sp_link *albumCoverLink = sp_link_create_from_album_cover(album, SP_IMAGE_SIZE_NORMAL);
-	if (albumCoverLink) {
-		sp_link_add_ref(albumCoverLink);
-
-		jobject albumCoverJLink = createJLinkInstance(env, albumCoverLink);
-		setObjectObjectField(env, albumInstance, "cover", "Ljahspotify/media/Link;", albumCoverJLink);
-
-//		sp_image *albumCoverImage = sp_image_create_from_link(g_sess, albumCoverLink);
-//		if (albumCoverImage) {
-//			sp_image_add_ref(albumCoverImage);
-//        	sp_image_add_load_callback(albumCoverImage,imageLoadedCallback,NULL);
-//		}
-//		sp_link_release(albumCoverLink);
-	}
+void populateJAlbumInstance(JNIEnv *env, jahspotify_session *session, jobject albumInstance, sp_album *album, int browse) {
+	metadata item;
 
-	sp_artist *artist = sp_album_artist(album);
-	if (artist) {
-		sp_artist_add_ref(artist);
-
-		sp_link *artistLink = sp_link_create_from_artist(artist);
-
-		if (artistLink) {
-			sp_link_add_ref(artistLink);
-
-			jobject artistJLink = createJLinkInstance(env, artistLink);
-
-			setObjectObjectField(env, albumInstance, "artist", "Ljahspotify/media/Link;", artistJLink);
-
-			sp_link_release(artistLink);
-		}
-
-		sp_artist_release(artist);
-	}
+	// By now it looks like the album will be loaded
+	albumMetadata(album, &item);
+	metadata_cache_put(&item);
+	populateJInstanceFromMetadata(env, albumInstance, &item);
+	releaseMetadata(&item);
 
 	if (browse)
-		sp_albumbrowse_create(g_sess, album, albumBrowseCompleteCallback, (*env)->NewGlobalRef(env, albumInstance));
+		browseAlbum(env, session, albumInstance, album);
 	else
-		invokeVoidMethod_Z(env, albumInstance, "setLoaded", JNI_TRUE);
+		setLoaded(env, albumInstance);
 
 	sp_album_release(album);
 }
 
-void populateJArtistInstanceFromArtistBrowse(JNIEnv *env, sp_artistbrowse *artistBrowse, jobject artistInstance) {
+void populateJArtistInstanceFromArtistBrowse(JNIEnv *env, jahspotify_session *session, sp_artistbrowse *artistBrowse, jobject artistInstance) {
 	log_debug("jahspotify", "populateJArtistInstanceFromArtistBrowse", "Populating artist browse instance");
 
 	sp_artistbrowse_add_ref(artistBrowse);
 
 	int numSimilarArtists = sp_artistbrowse_num_similar_artists(artistBrowse);
-	jclass jClass = (*env)->FindClass(env, "jahspotify/media/Artist");
 	if (numSimilarArtists > 0) {
-		jmethodID jMethod = (*env)->GetMethodID(env, jClass, "addSimilarArtist", "(Ljahspotify/media/Link;)V");
-
-		if (jMethod == NULL ) {
-			log_error("jahspotify", "populateJArtistInstanceFromArtistBrowse", "Could not load method addSimilarArtist(link) on class Artist");
-			sp_artistbrowse_release(artistBrowse);
-			return;
-		}
+		jmethodID jMethod = JMETHOD(ARTIST_ADD_SIMILAR_ARTIST);
 
 		// Load the artist links
 		int count = 0;
@@ -987,13 +1523,7 @@ void populateJArtistInstanceFromArtistBrowse(JNIEnv *env, sp_artistbrowse *artis
 	int numPortraits = sp_artistbrowse_num_portraits(artistBrowse);
 
 	if (numPortraits > 0) {
-		jmethodID jMethod = (*env)->GetMethodID(env, jClass, "addPortrait", "(Ljahspotify/media/Link;)V");
-
-		if (jMethod == NULL ) {
-			log_error("jahspotify", "populateJArtistInstanceFromArtistBrowse", "Could not load method addAlbum(link) on class Artist");
-			sp_artistbrowse_release(artistBrowse);
-			return;
-		}
+		jmethodID jMethod = JMETHOD(ARTIST_ADD_PORTRAIT);
 
 		int count = 0;
 
@@ -1038,13 +1568,7 @@ void populateJArtistInstanceFromArtistBrowse(JNIEnv *env, sp_artistbrowse *artis
 
 	int numAlbums = sp_artistbrowse_num_albums(artistBrowse);
 	if (numAlbums > 0) {
-		jmethodID jMethod = (*env)->GetMethodID(env, jClass, "addAlbum", "(Ljahspotify/media/Link;)V");
-
-		if (jMethod == NULL ) {
-			log_error("jahspotify", "populateJArtistInstanceFromArtistBrowse", "Could not load method addAlbum(link) on class Artist");
-			sp_artistbrowse_release(artistBrowse);
-			return;
-		}
+		jmethodID jMethod = JMETHOD(ARTIST_ADD_ALBUM);
 
 		int count = 0;
 		for (count = 0; count < numAlbums; count++) {
@@ -1066,18 +1590,12 @@ void populateJArtistInstanceFromArtistBrowse(JNIEnv *env, sp_artistbrowse *artis
 
 	int numTopTracks = sp_artistbrowse_num_tophit_tracks(artistBrowse);
 	if (numTopTracks > 0) {
-		jmethodID jMethod = (*env)->GetMethodID(env, jClass, "addTopHitTrack", "(Ljahspotify/media/Link;)V");
-
-		if (jMethod == NULL ) {
-			log_error("jahspotify", "populateJArtistInstanceFromArtistBrowse", "Could not load method addTopHitTrack(link) on class Artist");
-			sp_artistbrowse_release(artistBrowse);
-			return;
-		}
+		jmethodID jMethod = JMETHOD(ARTIST_ADD_TOP_HIT_TRACK);
 
 		int count = 0;
 		for (count = 0; count < numTopTracks; count++) {
 			sp_track *track = sp_artistbrowse_tophit_track(artistBrowse, count);
-			if (track && sp_track_get_availability(g_sess, track) == SP_TRACK_AVAILABILITY_AVAILABLE) {
+			if (track && sp_track_get_availability(session->sess, track) == SP_TRACK_AVAILABILITY_AVAILABLE) {
 				sp_track_add_ref(track);
 				sp_link *trackLink = sp_link_create_from_track(track, 0);
 				if (trackLink) {
@@ -1095,70 +1613,171 @@ void populateJArtistInstanceFromArtistBrowse(JNIEnv *env, sp_artistbrowse *artis
 	const char *bios = sp_artistbrowse_biography(artistBrowse);
 
 	if (bios) {
-		setObjectStringField(env, artistInstance, "bios", bios);
+		setStringField(env, artistInstance, JFIELD(ARTIST_BIOS), bios);
 	}
 
 	sp_artistbrowse_release(artistBrowse);
 }
 
-jobject createJArtistInstance(JNIEnv *env, sp_artist *artist, int browse) {
+jobject createJArtistInstance(JNIEnv *env, jahspotify_session *session, sp_artist *artist, int browse) {
 	jobject artistInstance = NULL;
 
 	sp_artist_add_ref(artist);
 
-	jclass jClass = (*env)->FindClass(env, "jahspotify/media/Artist");
-
-	if (jClass == NULL ) {
-		log_error("jahspotify", "createJArtistInstance", "Could not load jahnotify.media.Artist");
+	artistInstance = (*env)->NewObject(env, JCLASS(ARTIST), JMETHOD(ARTIST_INIT));
+	if (!artistInstance) {
+		log_error("jahspotify", "createJArtistInstance", "Could not create instance of jahspotify.media.Artist");
 		sp_artist_release(artist);
 		return NULL ;
 	}
 
-	artistInstance = createInstanceFromJClass(env, jClass);
-
 	if (sp_artist_is_loaded(artist))
-		populateJArtistInstance(env, artistInstance, artist, browse);
+		populateJArtistInstance(env, session, artistInstance, artist, browse);
 	else
-		addLoading((*env)->NewGlobalRef(env, artistInstance), NULL, NULL, artist, browse);
+		addLoading(session, (*env)->NewGlobalRef(env, artistInstance), NULL, NULL, artist, browse);
 	return artistInstance;
 }
 
-void populateJArtistInstance(JNIEnv *env, jobject artistInstance, sp_artist *artist, int browse) {
-	sp_link *artistLink = NULL;
-	artistLink = sp_link_create_from_artist(artist);
-
-	if (artistLink) {
-		sp_link_add_ref(artistLink);
-
-		jobject artistJLink = createJLinkInstance(env, artistLink);
-		setObjectObjectField(env, artistInstance, "id", "Ljahspotify/media/Link;", artistJLink);
-
-		sp_link_release(artistLink);
+void populateJArtistInstance(JNIEnv *env, jahspotify_session *session, jobject artistInstance, sp_artist *artist, int browse) {
+	metadata item;
 
-		setObjectStringField(env, artistInstance, "name", sp_artist_name(artist));
+	artistMetadata(artist, &item);
+	if (item.uri) {
+		metadata_cache_put(&item);
+		populateJInstanceFromMetadata(env, artistInstance, &item);
 
 		if (browse > 0)
-			sp_artistbrowse_create(g_sess, artist, browse == 1 ? SP_ARTISTBROWSE_NO_TRACKS : SP_ARTISTBROWSE_NO_ALBUMS, artistBrowseCompleteCallback,
-					(*env)->NewGlobalRef(env, artistInstance));
+			browseArtist(env, session, artistInstance, artist, browse);
 		else
-			invokeVoidMethod_Z(env, artistInstance, "setLoaded", JNI_TRUE);
+			setLoaded(env, artistInstance);
+	} else {
+		// Nothing to fill in, but whoever waits for the artist has to hear of it
+		setLoaded(env, artistInstance);
 	}
+	releaseMetadata(&item);
 
 	sp_artist_release(artist);
 }
 
-jobject createJPlaylist(JNIEnv *env, jobject playlistInstance, sp_playlist *playlist) {
-	jmethodID jMethod;
-	jclass jClass;
+/**
+ * Puts what libspotify now knows about a pending item into the metadata cache, used for items
+ * queued by revalidateMetadata which have no Java instance waiting.
+ */
+static void refreshMetadata(media *pending) {
+	metadata item;
+
+	memset(&item, 0, sizeof item);
+	if (pending->track) {
+		trackMetadata(pending->track, &item);
+		sp_track_release(pending->track);
+	} else if (pending->album) {
+		albumMetadata(pending->album, &item);
+		sp_album_release(pending->album);
+	} else if (pending->artist) {
+		artistMetadata(pending->artist, &item);
+		sp_artist_release(pending->artist);
+	}
+
+	if (item.uri) metadata_cache_put(&item);
+	releaseMetadata(&item);
+}
 
-	jClass = (*env)->FindClass(env, "jahspotify/media/Playlist");
-	if (!playlistInstance) {
-		if (jClass == NULL ) {
-			log_error("jahspotify", "createJPlaylist", "Could not load jahnotify.media.Playlist");
-			return NULL ;
+/**
+ * Queues an item which was served from the on-disk store so the cached copy is refreshed once
+ * libspotify has loaded the current version.
+ */
+static void revalidateMetadata(jahspotify_session *session, const char *uri, metadata_kind kind) {
+	sp_link *link = sp_link_create_from_string(uri);
+	if (!link) return;
+
+	if (kind == METADATA_TRACK) {
+		sp_track *track = sp_link_as_track(link);
+		if (track) {
+			sp_track_add_ref(track);
+			addLoading(session, NULL, track, NULL, NULL, 0);
+		}
+	} else if (kind == METADATA_ALBUM) {
+		sp_album *album = sp_link_as_album(link);
+		if (album) {
+			sp_album_add_ref(album);
+			addLoading(session, NULL, NULL, album, NULL, 0);
+		}
+	} else if (kind == METADATA_ARTIST) {
+		sp_artist *artist = sp_link_as_artist(link);
+		if (artist) {
+			sp_artist_add_ref(artist);
+			addLoading(session, NULL, NULL, NULL, artist, 0);
+		}
+	}
+	sp_link_release(link);
+}
+
+/**
+ * Creates a loaded instance of the given class from the metadata cache, NULL when the URI is not
+ * of the expected kind or has not been resolved before.
+ */
+static jobject createJInstanceFromCache(JNIEnv *env, jahspotify_session *session, const char *uri, metadata_kind expected) {
+	uint8_t gid[METADATA_GID_SIZE];
+	uint8_t stackBuffer[MEDIA_RECORD_STACK_SIZE];
+	uint8_t *buffer;
+	size_t size;
+	metadata_kind kind;
+	const metadata *item;
+	jobject instance;
+	int stale;
+
+	if (!uri || metadata_gid(uri, &kind, gid) != 0 || kind != expected) return NULL ;
+
+	item = metadata_cache_acquire(kind, gid, &stale);
+	if (!item) return NULL ;
+
+	// Only the copy is read once the cache is unlocked, Java is never called with the cache locked
+	buffer = writeMediaRecord(item, stackBuffer, &size);
+	metadata_cache_release();
+	if (!buffer) return NULL ;
+
+	if (kind == METADATA_TRACK)
+		instance = (*env)->NewObject(env, JCLASS(TRACK), JMETHOD(TRACK_INIT));
+	else if (kind == METADATA_ALBUM)
+		instance = (*env)->NewObject(env, JCLASS(ALBUM), JMETHOD(ALBUM_INIT));
+	else
+		instance = (*env)->NewObject(env, JCLASS(ARTIST), JMETHOD(ARTIST_INIT));
+	if (instance) {
+		decodeMediaRecord(env, instance, buffer, size);
+		setLoaded(env, instance);
+	}
+	if (buffer != stackBuffer) free(buffer);
+
+	if (stale) revalidateMetadata(session, uri, kind);
+	return instance;
+}
+
+/**
+ * Returns the link of the track, NULL if it is not available.
+ */
+static jobject createJTrackLink(JNIEnv *env, jahspotify_session *session, sp_track *track) {
+	jobject trackJLink = NULL;
+
+	if (track && sp_track_get_availability(session->sess, track) <= SP_TRACK_AVAILABILITY_AVAILABLE) {
+		sp_link *trackLink = sp_link_create_from_track(track, 0);
+		if (trackLink) {
+			trackJLink = createJLinkInstance(env, trackLink);
+			sp_link_release(trackLink);
 		}
+	}
+	return trackJLink;
+}
+
+/**
+ * Returns the link of the track at the position in the playlist, NULL if it is not available.
+ */
+static jobject createJPlaylistTrackLink(JNIEnv *env, jahspotify_session *session, sp_playlist *playlist, int position) {
+	return createJTrackLink(env, session, sp_playlist_track(playlist, position));
+}
 
-		playlistInstance = createInstanceFromJClass(env, jClass);
+jobject createJPlaylist(JNIEnv *env, jahspotify_session *session, jobject playlistInstance, sp_playlist *playlist) {
+	if (!playlistInstance) {
+		playlistInstance = (*env)->NewObject(env, JCLASS(PLAYLIST), JMETHOD(PLAYLIST_INIT));
 		if (!playlistInstance) {
 			log_error("jahspotify", "createJPlaylist", "Could not create instance of jahspotify.media.Playlist");
 			return NULL ;
@@ -1167,73 +1786,75 @@ jobject createJPlaylist(JNIEnv *env, jobject playlistInstance, sp_playlist *play
 
 	// Return the unloaded instance.
 	if (!sp_playlist_is_loaded(playlist)) {
-		sp_playlist_add_callbacks(playlist, &pl_callbacks, (*env)->NewGlobalRef(env, playlistInstance));
+		watchPlaylist(env, session, playlist, playlistInstance);
 		return playlistInstance;
 	}
 
 	sp_link *playlistLink = sp_link_create_from_playlist(playlist);
 	if (playlistLink) {
-		jobject playlistJLink = createJLinkInstance(env, playlistLink);
-		setObjectObjectField(env, playlistInstance, "id", "Ljahspotify/media/Link;", playlistJLink);
+		setObjectField(env, playlistInstance, JFIELD(PLAYLIST_ID), createJLinkInstance(env, playlistLink));
 		sp_link_release(playlistLink);
 	}
 
-	setObjectStringField(env, playlistInstance, "name", sp_playlist_name(playlist));
+	setStringField(env, playlistInstance, JFIELD(PLAYLIST_NAME), sp_playlist_name(playlist));
 	sp_user *owner = sp_playlist_owner(playlist);
 	if (owner) {
-		setObjectStringField(env, playlistInstance, "author", sp_user_display_name(owner));
+		setStringField(env, playlistInstance, JFIELD(PLAYLIST_AUTHOR), sp_user_display_name(owner));
 		sp_user_release(owner);
 	}
 
-	// Lookup the method now - saves us looking it up for each iteration of the loop
-	jMethod = (*env)->GetMethodID(env, jClass, "addTrack", "(Ljahspotify/media/Link;)V");
-	if (jMethod == NULL ) {
-		log_error("jahspotify", "createJPlaylist", "Could not load method addTrack(track) on class Playlist");
-		return NULL ;
-	}
-	jmethodID clearMethod = (*env)->GetMethodID(env, jClass, "clear", "()V");
-	(*env)->CallVoidMethod(env, playlistInstance, clearMethod);
+	(*env)->CallVoidMethod(env, playlistInstance, JMETHOD(PLAYLIST_CLEAR));
 
 	int numTracks = sp_playlist_num_tracks(playlist);
-	setObjectIntField(env, playlistInstance, "numTracks", numTracks);
+	(*env)->SetIntField(env, playlistInstance, JFIELD(PLAYLIST_NUM_TRACKS), numTracks);
 
-	int trackCounter = 0;
-	for (trackCounter = 0; trackCounter < numTracks; trackCounter++) {
-		sp_track *track = sp_playlist_track(playlist, trackCounter);
-		if (track && sp_track_get_availability(g_sess, track) <= SP_TRACK_AVAILABILITY_AVAILABLE) {
-			sp_track_add_ref(track);
-			sp_link *trackLink = sp_link_create_from_track(track, 0);
-			if (trackLink) {
-				sp_link_add_ref(trackLink);
-				jobject trackJLink = createJLinkInstance(env, trackLink);
-				// Add it to the playlist
-				(*env)->CallVoidMethod(env, playlistInstance, jMethod, trackJLink);
-				sp_link_release(trackLink);
-			}
-			sp_track_release(track);
+	// Only the window set up by retrievePlaylist is materialized, the rest is read on demand
+	int first = (*env)->GetIntField(env, playlistInstance, JFIELD(PLAYLIST_INDEX));
+	int windowSize = (*env)->GetIntField(env, playlistInstance, JFIELD(PLAYLIST_WINDOW_SIZE));
+	int last = numTracks;
+	if (first < 0) first = 0;
+	if (first > numTracks) first = numTracks;
+	if (windowSize > 0 && windowSize < numTracks - first) last = first + windowSize;
+	if (first > 0 || windowSize > 0) session_retain_playlist(session, playlist);
 
-		}
+	int trackCounter = 0;
+	for (trackCounter = first; trackCounter < last; trackCounter++) {
+		// Unavailable tracks are added as null entries so positions match those of libspotify
+		jobject trackJLink = createJPlaylistTrackLink(env, session, playlist, trackCounter);
+		(*env)->CallVoidMethod(env, playlistInstance, JMETHOD(PLAYLIST_ADD_ENTRY), trackJLink);
+		if (trackJLink) (*env)->DeleteLocalRef(env, trackJLink);
 	}
 	if (sp_playlist_is_loaded(playlist)) {
-		invokeVoidMethod_Z(env, playlistInstance, "setLoaded", JNI_TRUE);
-		signalPlaylistLoaded(playlistInstance);
+		setLoaded(env, playlistInstance);
+		signalPlaylistLoaded(session, playlistInstance);
 	}
 	return playlistInstance;
 }
 
 JNIEXPORT jobject JNICALL Java_jahspotify_impl_JahSpotifyImpl_retrieveArtist(JNIEnv *env, jobject obj, jstring uri, jint browse) {
+	jahspotify_session *session = session_from_java(env, obj);
 	jobject artistInstance;
 	const char *nativeUri = NULL;
 
+	if (!session) return NULL;
+
 	nativeUri = (*env)->GetStringUTFChars(env, uri, NULL );
 
+	if (browse == 0) {
+		artistInstance = createJInstanceFromCache(env, session, nativeUri, METADATA_ARTIST);
+		if (artistInstance) {
+			(*env)->ReleaseStringUTFChars(env, uri, nativeUri);
+			return artistInstance;
+		}
+	}
+
 	sp_link *link = sp_link_create_from_string(nativeUri);
 	if (link) {
 		sp_artist *artist = sp_link_as_artist(link);
 
 		if (artist) {
 			sp_artist_add_ref(artist);
-			artistInstance = createJArtistInstance(env, artist, browse);
+			artistInstance = createJArtistInstance(env, session, artist, browse);
 		}
 		sp_link_release(link);
 	}
@@ -1244,18 +1865,29 @@ JNIEXPORT jobject JNICALL Java_jahspotify_impl_JahSpotifyImpl_retrieveArtist(JNI
 }
 
 JNIEXPORT jobject JNICALL Java_jahspotify_impl_JahSpotifyImpl_retrieveAlbum(JNIEnv *env, jobject obj, jstring uri, jboolean browse) {
+	jahspotify_session *session = session_from_java(env, obj);
 	jobject albumInstance;
 	const char *nativeUri = NULL;
 
+	if (!session) return NULL;
+
 	nativeUri = (*env)->GetStringUTFChars(env, uri, NULL );
 
+	if (!browse) {
+		albumInstance = createJInstanceFromCache(env, session, nativeUri, METADATA_ALBUM);
+		if (albumInstance) {
+			(*env)->ReleaseStringUTFChars(env, uri, nativeUri);
+			return albumInstance;
+		}
+	}
+
 	sp_link *link = sp_link_create_from_string(nativeUri);
 	if (link) {
 		sp_album *album = sp_link_as_album(link);
 
 		if (album) {
 			sp_album_add_ref(album);
-			albumInstance = createJAlbumInstance(env, album, browse ? 1 : 0);
+			albumInstance = createJAlbumInstance(env, session, album, browse ? 1 : 0);
 		}
 		sp_link_release(link);
 	}
@@ -1266,40 +1898,64 @@ JNIEXPORT jobject JNICALL Java_jahspotify_impl_JahSpotifyImpl_retrieveAlbum(JNIE
 }
 
 JNIEXPORT jboolean JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeShutdown(JNIEnv *env, jobject obj) {
-	sp_session_logout(g_sess);
+	jahspotify_session *session = session_from_java(env, obj);
+	if (!session) return JNI_FALSE;
+	sp_session_logout(session->sess);
 	return JNI_TRUE;
 }
 
-JNIEXPORT jobject JNICALL Java_jahspotify_impl_JahSpotifyImpl_retrieveTrack(JNIEnv *env, jobject obj, jstring uri) {
+/**
+ * Returns the track for the URI, from the metadata cache when possible. Tracks libspotify has
+ * not loaded yet are returned unloaded and completed by checkLoaded.
+ */
+static jobject readTrack(JNIEnv *env, jahspotify_session *session, const char *nativeUri) {
 	jobject trackInstance;
-	const char *nativeUri = NULL;
 
-	nativeUri = (*env)->GetStringUTFChars(env, uri, NULL );
+	trackInstance = createJInstanceFromCache(env, session, nativeUri, METADATA_TRACK);
+	if (trackInstance) return trackInstance;
 
 	sp_link *link = sp_link_create_from_string(nativeUri);
 	if (!link) {
 		// hmm
-		log_error("jahspotify", "Java_jahspotify_impl_JahSpotifyImpl_retrieveTrack", "Could not create link!");
-		return JNI_FALSE;
+		log_error("jahspotify", "readTrack", "Could not create link!");
+		return NULL;
 	}
 
 	sp_track *track = sp_link_as_track(link);
-	sp_track_add_ref(track);
+	if (track) {
+		sp_track_add_ref(track);
+		trackInstance = createJTrackInstance(env, session, track);
+	}
 
-	trackInstance = createJTrackInstance(env, track);
+	sp_link_release(link);
+	return trackInstance;
+}
 
-	if (link) sp_link_release(link);
-	if (nativeUri) (*env)->ReleaseStringUTFChars(env, uri, nativeUri);
+JNIEXPORT jobject JNICALL Java_jahspotify_impl_JahSpotifyImpl_retrieveTrack(JNIEnv *env, jobject obj, jstring uri) {
+	jahspotify_session *session = session_from_java(env, obj);
+	jobject trackInstance;
+	const char *nativeUri = NULL;
+
+	if (!session) return NULL;
+
+	nativeUri = (*env)->GetStringUTFChars(env, uri, NULL );
+	if (!nativeUri) return NULL;
+
+	trackInstance = readTrack(env, session, nativeUri);
 
+	(*env)->ReleaseStringUTFChars(env, uri, nativeUri);
 	return trackInstance;
 }
 
-JNIEXPORT jobject JNICALL Java_jahspotify_impl_JahSpotifyImpl_retrievePlaylist(JNIEnv *env, jobject obj, jstring uri) {
+JNIEXPORT jobject JNICALL Java_jahspotify_impl_JahSpotifyImpl_retrievePlaylist(JNIEnv *env, jobject obj, jstring uri, jint index, jint numEntries) {
+	jahspotify_session *session = session_from_java(env, obj);
 	jobject playlistInstance;
 	sp_playlist *playlist;
 	const char *nativeUri = NULL;
 	sp_link *link = NULL;
 
+	if (!session) return NULL;
+
 	if (uri) {
 		nativeUri = (*env)->GetStringUTFChars(env, uri, NULL );
 
@@ -1312,13 +1968,20 @@ JNIEXPORT jobject JNICALL Java_jahspotify_impl_JahSpotifyImpl_retrievePlaylist(J
 			return JNI_FALSE;
 		}
 
-		playlist = sp_playlist_create(g_sess, link);
+		playlist = sp_playlist_create(session->sess, link);
 	} else {
-		playlist = sp_session_starred_create(g_sess);
+		playlist = sp_session_starred_create(session->sess);
+	}
+
+	playlistInstance = (*env)->NewObject(env, JCLASS(PLAYLIST), JMETHOD(PLAYLIST_INIT));
+	if (playlistInstance) {
+		// createJPlaylist only materializes this window, also once a pending playlist has loaded
+		(*env)->SetIntField(env, playlistInstance, JFIELD(PLAYLIST_INDEX), index);
+		(*env)->SetIntField(env, playlistInstance, JFIELD(PLAYLIST_WINDOW_SIZE), numEntries);
 	}
 
-	playlistInstance = createJPlaylist(env, NULL, playlist);
-	if (!sp_playlist_is_loaded(playlist)) sp_playlist_add_callbacks(playlist, &pl_callbacks, (*env)->NewGlobalRef(env, playlistInstance));
+	// An instance of a playlist which has not loaded yet is filled in by the playlist callbacks
+	playlistInstance = createJPlaylist(env, session, playlistInstance, playlist);
 
 	if (playlist) sp_playlist_release(playlist);
 	if (link) sp_link_release(link);
@@ -1328,92 +1991,323 @@ JNIEXPORT jobject JNICALL Java_jahspotify_impl_JahSpotifyImpl_retrievePlaylist(J
 }
 
 static void SP_CALLCONV toplistCallback(sp_toplistbrowse *result, void *userdata) {
-	signalToplistComplete(result, (jobject) userdata);
+	session_request *request = (session_request*) userdata;
+	signalToplistComplete(request->session, result, request->instance);
+	free(request);
 }
 JNIEXPORT jobject JNICALL Java_jahspotify_impl_JahSpotifyImpl_retrieveTopList(JNIEnv *env, jobject obj, jint type, jint countrycode) {
+	jahspotify_session *session = session_from_java(env, obj);
+	if (!session) return NULL;
+
 	jobject searchResult = createSearchResult(env);
-	sp_toplistbrowse_create(g_sess, (int) type, countrycode == -1 ? SP_TOPLIST_REGION_EVERYWHERE : countrycode, NULL, toplistCallback, (*env)->NewGlobalRef(env, searchResult));
+	sp_toplistbrowse_create(session->sess, (int) type, countrycode == -1 ? SP_TOPLIST_REGION_EVERYWHERE : countrycode, NULL, toplistCallback,
+			session_request_create(session, (*env)->NewGlobalRef(env, searchResult), 0));
 	return searchResult;
 }
 
+/**
+ * Reads the links of the tracks at positions index to index + count of a playlist, elements are
+ * null for unavailable tracks. Returns NULL when the playlist is not loaded.
+ */
+JNIEXPORT jobjectArray JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeReadPlaylistTracks(JNIEnv *env, jobject obj, jstring uri, jint index, jint count) {
+	jahspotify_session *session = session_from_java(env, obj);
+	jobjectArray links = NULL;
+	sp_playlist *playlist;
+	sp_link *link;
+	const char *nativeUri;
+	int i, last;
+
+	if (!session || !uri || index < 0 || count <= 0) return NULL;
+
+	nativeUri = (*env)->GetStringUTFChars(env, uri, NULL );
+	if (!nativeUri) return NULL;
+	link = sp_link_create_from_string(nativeUri);
+	(*env)->ReleaseStringUTFChars(env, uri, nativeUri);
+	if (!link) return NULL;
+
+	// libspotify hands back the instance it already holds, retained by an earlier window
+	playlist = sp_playlist_create(session->sess, link);
+	sp_link_release(link);
+	if (!playlist) return NULL;
+	if (!sp_playlist_is_loaded(playlist)) goto exit;
+
+	last = sp_playlist_num_tracks(playlist);
+	if (index > last) index = last;
+	if (count < last - index) last = index + count;
+
+	links = (*env)->NewObjectArray(env, last - index, JCLASS(LINK), NULL);
+	if (!links) goto exit;
+
+	for (i = index; i < last; i++) {
+		jobject trackJLink = createJPlaylistTrackLink(env, session, playlist, i);
+		if (trackJLink) {
+			(*env)->SetObjectArrayElement(env, links, i - index, trackJLink);
+			(*env)->DeleteLocalRef(env, trackJLink);
+		}
+	}
+	session_retain_playlist(session, playlist);
+
+	exit:
+	sp_playlist_release(playlist);
+	return links;
+}
+
+/**
+ * Reads a batch of tracks in one call, elements are null for URIs which are not tracks.
+ */
 JNIEXPORT jobjectArray JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeReadTracks(JNIEnv *env, jobject obj, jobjectArray uris) {
-	// For each track, read out the info and populate all of the info in the Track instance
-	return NULL ;
+	jahspotify_session *session = session_from_java(env, obj);
+	jobjectArray tracks;
+	jsize count, i;
+
+	if (!session || !uris) return NULL;
+
+	count = (*env)->GetArrayLength(env, uris);
+	tracks = (*env)->NewObjectArray(env, count, JCLASS(TRACK), NULL);
+	if (!tracks) return NULL;
+
+	for (i = 0; i < count; i++) {
+		jobject trackInstance = NULL;
+
+		// Each track creates a handful of local references, drop them as we go
+		if ((*env)->PushLocalFrame(env, 16) != 0) break;
+
+		jstring uri = (jstring) (*env)->GetObjectArrayElement(env, uris, i);
+		const char *nativeUri = uri ? (*env)->GetStringUTFChars(env, uri, NULL ) : NULL;
+		if (nativeUri) {
+			trackInstance = readTrack(env, session, nativeUri);
+			(*env)->ReleaseStringUTFChars(env, uri, nativeUri);
+		}
+
+		trackInstance = (*env)->PopLocalFrame(env, trackInstance);
+		if (trackInstance) {
+			(*env)->SetObjectArrayElement(env, tracks, i, trackInstance);
+			(*env)->DeleteLocalRef(env, trackInstance);
+		}
+	}
+
+	log_debug("jahspotify", "nativeReadTracks", "Read %d tracks, %u loads pending", count, session->loading.waiting);
+	return tracks;
+}
+
+/**
+ * Matches the text against the given fields of the library index, returns the ascending docs of
+ * the tracks containing every term of it.
+ */
+JNIEXPORT jintArray JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeMatchLibrary(JNIEnv *env, jobject obj, jint fields, jstring text) {
+	jahspotify_session *session = session_from_java(env, obj);
+	jintArray result = NULL;
+	uint32_t *docs = NULL;
+	uint32_t count = 0;
+
+	if (!session || !text) return NULL;
+
+	const char *nativeText = (*env)->GetStringUTFChars(env, text, NULL);
+	if (!nativeText) return NULL;
+
+	if (library_index_match(&session->library, fields, nativeText, &docs, &count) == 0) {
+		result = (*env)->NewIntArray(env, count);
+		if (result && count > 0) (*env)->SetIntArrayRegion(env, result, 0, count, (const jint*) docs);
+	}
+
+	free(docs);
+	(*env)->ReleaseStringUTFChars(env, text, nativeText);
+	return result;
+}
+
+/**
+ * Links of the tracks of the docs, elements are null for tracks which left the library since they
+ * were matched.
+ */
+JNIEXPORT jobjectArray JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeReadLibraryTracks(JNIEnv *env, jobject obj, jintArray docs) {
+	jahspotify_session *session = session_from_java(env, obj);
+	jobjectArray links = NULL;
+	jint *nativeDocs = NULL;
+	char **uris = NULL;
+	jsize count, i;
+
+	if (!session || !docs) return NULL;
+
+	count = (*env)->GetArrayLength(env, docs);
+	nativeDocs = malloc(sizeof(jint) * (count + 1));
+	uris = calloc(count + 1, sizeof(char*));
+	links = (*env)->NewObjectArray(env, count, JCLASS(LINK), NULL);
+	if (!nativeDocs || !uris || !links) {
+		log_error("jahspotify", "nativeReadLibraryTracks", "Could not allocate %d tracks", count);
+		goto exit;
+	}
+	(*env)->GetIntArrayRegion(env, docs, 0, count, nativeDocs);
+
+	// Only copy the uris under the index mutex, which the event loop waits for while holding the spotify mutex
+	pthread_mutex_lock(&session->library.mutex);
+	for (i = 0; i < count; i++) {
+		const char *uri = nativeDocs[i] >= 0 ? library_index_uri(&session->library, (uint32_t) nativeDocs[i]) : NULL;
+		if (uri) uris[i] = strdup(uri);
+	}
+	pthread_mutex_unlock(&session->library.mutex);
+
+	for (i = 0; i < count; i++) {
+		jobject link = uris[i] ? createJLinkInstanceFromString(env, uris[i]) : NULL;
+		if (link) {
+			(*env)->SetObjectArrayElement(env, links, i, link);
+			(*env)->DeleteLocalRef(env, link);
+		}
+	}
+
+	exit:
+	if (uris) {
+		for (i = 0; i < count; i++) free(uris[i]);
+		free(uris);
+	}
+	if (nativeDocs) free(nativeDocs);
+	return links;
 }
 
 JNIEXPORT jint JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativePause(JNIEnv *env, jobject obj) {
+	jahspotify_session *session = session_from_java(env, obj);
 	log_debug("jahspotify", "nativeResume", "Pausing playback");
-	if (g_currenttrack) {
-		sp_session_player_play(g_sess, 0);
+	if (session && session->currenttrack) {
+		sp_session_player_play(session->sess, 0);
 	}
 	return 0;
 }
 
 JNIEXPORT jint JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeResume(JNIEnv *env, jobject obj) {
+	jahspotify_session *session = session_from_java(env, obj);
 	log_debug("jahspotify", "nativeResume", "Resuming playback");
-	if (g_currenttrack) {
-		sp_session_player_play(g_sess, 1);
+	if (session && session->currenttrack) {
+		sp_session_player_play(session->sess, 1);
 	}
 	return 0;
 }
 
+/**
+ * Reads an image into the Image instance. Images in the image cache are handed over right away,
+ * requests for an image which is already being loaded wait for that load.
+ */
 JNIEXPORT void JNICALL Java_jahspotify_impl_JahSpotifyImpl_readImage(JNIEnv *env, jobject obj, jstring uri, jobject imageInstance) {
+	jahspotify_session *session = session_from_java(env, obj);
+	uint8_t id[IMAGE_ID_SIZE];
+	const void *data;
+	size_t size = 0;
+	image_load *load;
+	image_waiter *waiter;
+	session_signal *signals;
+	int created = 0;
+
+	if (!session) return;
+
 	const char *nativeURI = (*env)->GetStringUTFChars(env, uri, NULL );
-	sp_link *imageLink = sp_link_create_from_string(nativeURI);
+	if (!nativeURI) return;
 	log_debug("jahspotify", "readImage", "Loading image: %s", nativeURI);
 
-	if (imageLink) {
-		sp_link_add_ref(imageLink);
-		sp_image *image = sp_image_create_from_link(g_sess, imageLink);
-		if (image) {
-			imageInstance = (*env)->NewGlobalRef(env, imageInstance);
-			// Reference is released by the image loaded callback
-			if (sp_image_is_loaded(image)) {
-				log_debug("jahspotify", "readImage", "Image already loaded, dont wait for callback.");
-				signalImageLoaded(image, imageInstance);
-			} else {
-				sp_image_add_load_callback(image, imageLoadedCallback, (*env)->NewGlobalRef(env, imageInstance));
-			}
+	if (image_id_from_uri(nativeURI, id) != 0) {
+		log_error("jahspotify", "readImage", "Not an image link: %s", nativeURI);
+		goto exit;
+	}
+
+	data = image_cache_acquire(id, IMAGE_VARIANT_ORIGINAL, &size);
+	if (data) {
+		jbyteArray bytes = createJImageBytes(env, data, size);
+		image_cache_release();
+		if (bytes) {
+			signalImageLoaded(env, session, (*env)->NewGlobalRef(env, imageInstance), bytes);
+			(*env)->DeleteLocalRef(env, bytes);
+		}
+		goto exit;
+	}
+
+	waiter = calloc(1, sizeof(image_waiter));
+	if (!waiter) {
+		log_error("jahspotify", "readImage", "Could not allocate image waiter");
+		goto exit;
+	}
+
+	pthread_mutex_lock(&session->spotify_mutex);
+	for (load = session->image_loads; load; load = load->next) {
+		if (memcmp(load->id, id, IMAGE_ID_SIZE) == 0) break;
+	}
+
+	if (!load) {
+		sp_link *imageLink = sp_link_create_from_string(nativeURI);
+		sp_image *image = imageLink ? sp_image_create_from_link(session->sess, imageLink) : NULL;
+		if (imageLink) sp_link_release(imageLink);
+
+		if (image) load = calloc(1, sizeof(image_load));
+		if (!load) {
+			log_error("jahspotify", "readImage", "Could not start loading image: %s", nativeURI);
+			if (image) sp_image_release(image);
+			pthread_mutex_unlock(&session->spotify_mutex);
+			free(waiter);
+			goto exit;
 		}
-		sp_link_release(imageLink);
+
+		load->image = image;
+		load->session = session;
+		memcpy(load->id, id, IMAGE_ID_SIZE);
+		load->next = session->image_loads;
+		session->image_loads = load;
+		created = 1;
 	} else {
-		log_error("jahspotify", "readImage", "Image link is null");
+		log_debug("jahspotify", "readImage", "Image already loading, waiting for it: %s", nativeURI);
 	}
 
-	if (nativeURI) (*env)->ReleaseStringUTFChars(env, uri, (char *) nativeURI);
+	// Reference is released once the image is handed over
+	waiter->instance = (*env)->NewGlobalRef(env, imageInstance);
+	waiter->next = load->waiters;
+	load->waiters = waiter;
+
+	if (created) {
+		if (sp_image_is_loaded(load->image)) {
+			log_debug("jahspotify", "readImage", "Image already loaded, dont wait for callback.");
+			completeImageLoad(env, load);
+		} else {
+			sp_image_add_load_callback(load->image, imageLoadedCallback, load);
+		}
+	}
+	signals = session_take_signals(session);
+	pthread_mutex_unlock(&session->spotify_mutex);
+	deliverSignals(env, session, signals);
+
+	exit: (*env)->ReleaseStringUTFChars(env, uri, nativeURI);
 }
 
 JNIEXPORT void JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeTrackSeek(JNIEnv *env, jobject obj, jint offset) {
+	jahspotify_session *session = session_from_java(env, obj);
 	log_debug("jahspotify", "nativeTrackSeek", "Seeking in track offset: %d", offset);
-	sp_session_player_seek(g_sess, offset);
+	if (session) sp_session_player_seek(session->sess, offset);
 }
 
 
 JNIEXPORT void JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeStopTrack(JNIEnv *env, jobject obj) {
+  jahspotify_session *session = session_from_java(env, obj);
+  if (!session) return;
+
   log_debug("jahspotify", "nativeStopTrack", "Stopping playback");
-  pthread_mutex_lock(&g_notify_mutex);
-  g_playback_stopped = 1;
-  pthread_cond_signal(&g_notify_cond);
-  pthread_mutex_unlock(&g_notify_mutex);
+  pthread_mutex_lock(&session->notify_mutex);
+  session->playback_stopped = 1;
+  pthread_cond_signal(&session->notify_cond);
+  pthread_mutex_unlock(&session->notify_mutex);
 }
 
 JNIEXPORT void JNICALL Java_jahspotify_impl_JahSpotifyImpl_setBitrate(JNIEnv * env, jobject obj, jint rate) {
-  sp_session_preferred_bitrate(g_sess, rate);
+  jahspotify_session *session = session_from_java(env, obj);
+  if (session) sp_session_preferred_bitrate(session->sess, rate);
 }
 
-static jint doPlay(const char *nativeURI) {
+static jint doPlay(jahspotify_session *session, const char *nativeURI) {
   
   log_debug("jahspotify", "nativePlayTrack", "Initiating play: %s", nativeURI);
   
   // For each track, read out the info and populate all of the info in the Track instance
-  pthread_mutex_lock(&g_spotify_mutex);
+  pthread_mutex_lock(&session->spotify_mutex);
   sp_link *link = sp_link_create_from_string(nativeURI);
   if (link) {
     sp_track *t = sp_link_as_track(link);
     
     if (!t) {
       log_error("jahspotify", "nativePlayTrack", "No track from link");
-      pthread_mutex_unlock(&g_spotify_mutex);
+      pthread_mutex_unlock(&session->spotify_mutex);
       return -1;
     }
     
@@ -1425,13 +2319,13 @@ static jint doPlay(const char *nativeURI) {
     
     if (count == 4) {
       log_warn("jahspotify", "nativePlayTrack", "Track not loaded after 1 second, will have to wait for callback");
-      pthread_mutex_unlock(&g_spotify_mutex);
+      pthread_mutex_unlock(&session->spotify_mutex);
       return -1;
     }
     
     if (sp_track_error(t) != SP_ERROR_OK) {
       log_debug("jahspotify", "nativePlayTrack", "Error with track: %s", sp_error_message(sp_track_error(t)));
-      pthread_mutex_unlock(&g_spotify_mutex);
+      pthread_mutex_unlock(&session->spotify_mutex);
       return -1;
     }
     
@@ -1440,15 +2334,15 @@ static jint doPlay(const char *nativeURI) {
 
     
     // If there is one playing, unload that now
-    if (g_currenttrack) {
+    if (session->currenttrack) {
       // Unload the current track now
-      sp_session_player_play(g_sess, 0);
-      track_ended(JNI_TRUE);
+      sp_session_player_play(session->sess, 0);
+      track_ended(session, JNI_TRUE);
     }
     
     sp_track_add_ref(t);
     
-    sp_error result = sp_session_player_load(g_sess, t);
+    sp_error result = sp_session_player_load(session->sess, t);
     int ret;
     
     if (sp_track_error(t) != SP_ERROR_OK) {
@@ -1458,23 +2352,23 @@ static jint doPlay(const char *nativeURI) {
       log_debug("jahspotify", "nativePlayTrack", "Track loaded: %s", (result == SP_ERROR_OK ? "yes" : "no"));
     
       // Update the global reference
-      g_currenttrack = t;
+      session->currenttrack = t;
 
       if (result != SP_ERROR_OK) {
-        signalTrackStarted(nativeURI);
-        track_ended(JNI_TRUE);
+        signalTrackStarted(session, nativeURI);
+        track_ended(session, JNI_TRUE);
         ret = 0;
       } else {
         // Start playing the next track
-        sp_session_player_play(g_sess, 1);
+        sp_session_player_play(session->sess, 1);
         log_debug("jahspotify", "nativePlayTrack", "Playing track");
       }
       sp_link_release(link);
       ret = 1;
     }
-    pthread_mutex_unlock(&g_spotify_mutex);
+    pthread_mutex_unlock(&session->spotify_mutex);
     if (ret > 0) {
-      signalTrackStarted(nativeURI);
+      signalTrackStarted(session, nativeURI);
     }
     return ret;
   } else {
@@ -1487,11 +2381,14 @@ static jint doPlay(const char *nativeURI) {
 }
 
 JNIEXPORT jint JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativePlayTrack(JNIEnv *env, jobject obj, jstring uri) {
+  jahspotify_session *session = session_from_java(env, obj);
   const char *nativeURI = NULL;
-  pthread_mutex_lock(&g_spotify_mutex);  
+  if (!session) return -1;
+
+  pthread_mutex_lock(&session->spotify_mutex);  
   nativeURI = (*env)->GetStringUTFChars(env, uri, NULL );
-  jint result = doPlay(nativeURI);
-  pthread_mutex_unlock(&g_spotify_mutex);  
+  jint result = doPlay(session, nativeURI);
+  pthread_mutex_unlock(&session->spotify_mutex);  
   if (nativeURI) (*env)->ReleaseStringUTFChars(env, uri, (char *) nativeURI);
   return result;
 }
@@ -1501,13 +2398,13 @@ JNIEXPORT jint JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativePlayTrack(JNIEn
 /**
  * A track has ended. Remove it from the playlist.
  *
- * Called from the main loop when the music_delivery() callback has set g_playback_done.
+ * Called from the event loop when the end_of_track() callback has flagged the session.
  */
-static void track_ended(jboolean forced) {
+static void track_ended(jahspotify_session *session, jboolean forced) {
   log_debug("jahspotify", "track_ended", "Called");
-  if (g_currenttrack) {
+  if (session->currenttrack) {
     log_debug("jahspotify", "track_ended", "current track exists");
-    sp_link *link = sp_link_create_from_track(g_currenttrack, 0);
+    sp_link *link = sp_link_create_from_track(session->currenttrack, 0);
     char *trackLinkStr = NULL;
     if (link) {
       trackLinkStr = createLinkStr(link);
@@ -1515,13 +2412,13 @@ static void track_ended(jboolean forced) {
     }
     if (forced) {
       log_debug("jahspotify", "track_ended", "unload session");
-      sp_session_player_unload(g_sess);
+      sp_session_player_unload(session->sess);
     }
     log_debug("jahspotify", "track_ended", "track release");
-    sp_track_release(g_currenttrack);
-    g_currenttrack = NULL;
+    sp_track_release(session->currenttrack);
+    session->currenttrack = NULL;
     log_debug("jahspotify", "track_ended", "signalling track ended");
-    signalTrackEnded(trackLinkStr, forced);
+    signalTrackEnded(session, trackLinkStr, forced);
     
     if (trackLinkStr) {
       free(trackLinkStr);
@@ -1531,44 +2428,60 @@ static void track_ended(jboolean forced) {
   }
 }
 
+JNIEXPORT jlong JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeCreateSession(JNIEnv *env, jobject obj) {
+	return (jlong) (intptr_t) session_create();
+}
+
+JNIEXPORT void JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeDestroySession(JNIEnv *env, jobject obj) {
+	jahspotify_session *session = session_from_java(env, obj);
+	if (!session) return;
+	session_destroy(env, obj, session);
+}
+
 JNIEXPORT jint JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeInitialize(JNIEnv *env, jobject obj, jstring cacheFolder) {
+	jahspotify_session *session = session_from_java(env, obj);
 	sp_session *sp;
 	sp_error err;
 	int next_timeout = 0;
+	session_signal *signals;
 
-        pthread_mutexattr_t Attr;
-        pthread_mutexattr_init(&Attr);
-        pthread_mutexattr_settype(&Attr, PTHREAD_MUTEX_RECURSIVE);
-        pthread_mutex_init(&g_spotify_mutex, &Attr);
-	pthread_mutex_init(&g_notify_mutex, NULL );
-	pthread_cond_init(&g_notify_cond, NULL );
+	if (!session) return 1;
 
 	const char* nativeCacheFolder = (*env)->GetStringUTFChars(env, cacheFolder, NULL );
 
 	log_debug("jahspotify", "Java_jahspotify_impl_JahSpotifyImpl_initialize", "Using the following cache and setting location: %s\n", nativeCacheFolder);
-	spconfig.cache_location = nativeCacheFolder;
-	spconfig.settings_location = nativeCacheFolder;
+	memset(&session->config, 0, sizeof(sp_session_config));
+	session->config.api_version = SPOTIFY_API_VERSION;
+	session->config.cache_location = nativeCacheFolder;
+	session->config.settings_location = nativeCacheFolder;
+	session->config.application_key = g_appkey;
+	session->config.application_key_size = g_appkey_size;
+	session->config.user_agent = "jahspotify/0.0.1";
+	session->config.callbacks = &session_callbacks;
+	session->config.userdata = session;
+
+	metadata_store_open(nativeCacheFolder);
 
 	/* Create session */
-	spconfig.application_key_size = g_appkey_size;
-	err = sp_session_create(&spconfig, &sp);
+	err = sp_session_create(&session->config, &sp);
 
 	if (SP_ERROR_OK != err) {
 		log_error("jahspotify", "Java_jahspotify_impl_JahSpotifyImpl_initialize", "Unable to create session: %s\n", sp_error_message(err));
+		if (nativeCacheFolder) (*env)->ReleaseStringUTFChars(env, cacheFolder, nativeCacheFolder);
 		return 1;
 	}
-	g_sess = sp;
-	sp_session_set_volume_normalization(g_sess, 1);
+	session->sess = sp;
+	sp_session_set_volume_normalization(session->sess, 1);
 	log_debug("jahspotify", "Java_jahspotify_impl_JahSpotifyImpl_initialize", "Session created 0x%x", sp);
 
-	pthread_mutex_lock(&g_notify_mutex);
+	pthread_mutex_lock(&session->notify_mutex);
 
-	g_stop = 0;
+	session->stop = 0;
 	for (;;) {
           if (next_timeout == 0) {
-            signalInitialized(1);
-            while (!g_notify_do && !g_playback_done)
-              pthread_cond_wait(&g_notify_cond, &g_notify_mutex);
+            signalInitialized(session, 1);
+            while (!session->notify_do && !session->playback_done)
+              pthread_cond_wait(&session->notify_cond, &session->notify_mutex);
           } else {
             struct timespec ts;
             
@@ -1585,33 +2498,21 @@ JNIEXPORT jint JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeInitialize(JNIE
             ts.tv_sec += next_timeout / 1000;
             ts.tv_nsec += (next_timeout % 1000) * 1000000;
             
-            if (!g_notify_do) // Only wait if we know we have nothing to do.
-              pthread_cond_timedwait(&g_notify_cond, &g_notify_mutex, &ts);
+            if (!session->notify_do) // Only wait if we know we have nothing to do.
+              pthread_cond_timedwait(&session->notify_cond, &session->notify_mutex, &ts);
           }
           
-          g_notify_do = 0;
-          bool playback_done = g_playback_done;
-          bool playback_stopped = g_playback_stopped;
-          g_playback_done = 0;
-          g_playback_stopped = 0;
-          pthread_mutex_unlock(&g_notify_mutex);
-          pthread_mutex_lock(&g_spotify_mutex);
+          session->notify_do = 0;
+          bool playback_done = session->playback_done;
+          bool playback_stopped = session->playback_stopped;
+          session->playback_done = 0;
+          session->playback_stopped = 0;
+          pthread_mutex_unlock(&session->notify_mutex);
+          pthread_mutex_lock(&session->spotify_mutex);
           if (playback_done) {
-            track_ended(JNI_FALSE);
+            track_ended(session, JNI_FALSE);
           } else if (playback_stopped) {
-            track_ended(JNI_TRUE);
-          }
-          pthread_mutex_unlock(&g_notify_mutex);
-          pthread_mutex_lock(&g_spotify_mutex);
-          
-          if (g_playback_done) {
-            track_ended(JNI_FALSE);
-            g_playback_done = 0;
-            g_playback_stopped = 0;
-          } else if (g_playback_stopped) {
-            track_ended(JNI_TRUE);
-            g_playback_stopped = 0;
-            g_playback_done = 0;
+            track_ended(session, JNI_TRUE);
           }
           
           sp_connectionstate conn_state = sp_session_connectionstate(sp);
@@ -1626,7 +2527,7 @@ JNIEXPORT jint JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeInitialize(JNIE
               break;
             case SP_CONNECTION_STATE_DISCONNECTED:
               log_warn("jahspotify", "Java_jahspotify_impl_JahSpotifyImpl_initialize", "Disconnected!");
-              signalDisconnected();
+              signalDisconnected(session);
               break;
             }
           }
@@ -1635,29 +2536,56 @@ JNIEXPORT jint JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeInitialize(JNIE
             sp_session_process_events(sp, &next_timeout);
           } while (next_timeout == 0);
           
-          pthread_mutex_unlock(&g_spotify_mutex);
-          if (g_stop) break;
-          pthread_mutex_lock(&g_notify_mutex);
+          if (session->loading.dirty) checkLoaded(session);
+          if (session->library.dirty) library_index_refresh(&session->library);
+          metadata_store_sync_due(monotonic_millis());
+          if (search_registry_outstanding(&session->searches)) {
+            expireSearches(session);
+            // Wake up in time to notice deadlines, libspotify may ask to sleep much longer
+            if (next_timeout > SEARCH_CHECK_INTERVAL) next_timeout = SEARCH_CHECK_INTERVAL;
+          }
+          
+          signals = session_take_signals(session);
+          pthread_mutex_unlock(&session->spotify_mutex);
+          deliverSignals(env, session, signals);
+          if (session->stop) break;
+          pthread_mutex_lock(&session->notify_mutex);
 	}
 
 	log_debug("jahspotify", "Java_jahspotify_impl_JahSpotifyImpl_initialize", "Cleaning up.");
-	sp_session_release(g_sess);
+	session_release_playlists(session);
+	pthread_mutex_lock(&session->spotify_mutex);
+	unwatchPlaylists(env, session, NULL);
+	browse_cache_clear(env, &session->browses);
+	clearImageLoads(env, session);
+	library_index_clear(&session->library);
+	pthread_mutex_unlock(&session->spotify_mutex);
+	sp_session_release(session->sess);
+	session->sess = NULL;
+	pthread_mutex_lock(&session->spotify_mutex);
+	search_registry_clear(&session->searches);
+	signals = session_take_signals(session);
+	pthread_mutex_unlock(&session->spotify_mutex);
+	deliverSignals(env, session, signals);
 
 	if (nativeCacheFolder) (*env)->ReleaseStringUTFChars(env, cacheFolder, nativeCacheFolder);
-	signalInitialized(0);
+	signalInitialized(session, 0);
 	return 0;
 }
 
 JNIEXPORT jint JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeLogin(JNIEnv *env, jobject obj, jstring username, jstring password, jstring blob,
 		jboolean savePassword) {
+	jahspotify_session *session = session_from_java(env, obj);
 	sp_error err;
 	const char *nativePassword = NULL;
 	const char *nativeUsername = NULL;
 	const char *nativeBlob = NULL;
 
+	if (!session) return 1;
+
 	if (!username && (!password || !blob)) {
 		log_error("jahspotify", "Java_jahspotify_impl_JahSpotifyImpl_initialize", "Try to login without username and/or password.");
-		err = sp_session_relogin(g_sess);
+		err = sp_session_relogin(session->sess);
 
 		if (err == SP_ERROR_NO_CREDENTIALS) {
 			log_error("jahspotify", "Java_jahspotify_impl_JahSpotifyImpl_initialize", "Username or password not specified and not remembered.");
@@ -1671,7 +2599,7 @@ JNIEXPORT jint JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeLogin(JNIEnv *e
 		log_debug("jahspotify", "Java_jahspotify_impl_JahSpotifyImpl_initialize", "Locking");
 		log_debug("jahspotify", "Java_jahspotify_impl_JahSpotifyImpl_initialize", "Initiating login: %s", nativeUsername);
 		if (savePassword == JNI_TRUE) log_debug("jahspotify", "Java_jahspotify_impl_JahSpotifyImpl_initialize", "Going to remember this user.");
-		sp_session_login(g_sess, nativeUsername, nativePassword, savePassword == JNI_TRUE ? 1 : 0, nativeBlob);
+		sp_session_login(session->sess, nativeUsername, nativePassword, savePassword == JNI_TRUE ? 1 : 0, nativeBlob);
 	}
 
 	if (nativeUsername) (*env)->ReleaseStringUTFChars(env, username, nativeUsername);
@@ -1682,87 +2610,210 @@ JNIEXPORT jint JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeLogin(JNIEnv *e
 }
 
 JNIEXPORT void JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeLogout(JNIEnv *env, jobject obj) {
-  pthread_mutex_lock(&g_notify_mutex);
-  sp_session_logout(g_sess);
-  pthread_mutex_unlock(&g_notify_mutex);
+  jahspotify_session *session = session_from_java(env, obj);
+  if (!session) return;
+
+  pthread_mutex_lock(&session->notify_mutex);
+  sp_session_logout(session->sess);
+  pthread_mutex_unlock(&session->notify_mutex);
 }
 
 JNIEXPORT void JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeForgetMe(JNIEnv *env, jobject obj) {
-  pthread_mutex_lock(&g_notify_mutex);
-  sp_session_forget_me(g_sess);
-  pthread_mutex_unlock(&g_notify_mutex);
+  jahspotify_session *session = session_from_java(env, obj);
+  if (!session) return;
+
+  pthread_mutex_lock(&session->notify_mutex);
+  sp_session_forget_me(session->sess);
+  pthread_mutex_unlock(&session->notify_mutex);
 }
 
 JNIEXPORT jint JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeDestroy(JNIEnv *env, jobject obj) {
-  pthread_mutex_lock(&g_notify_mutex);
-  g_stop_after_logout = 1;
-  sp_session_logout(g_sess);
-  pthread_mutex_unlock(&g_notify_mutex);
+  jahspotify_session *session = session_from_java(env, obj);
+  if (!session) return 1;
+
+  pthread_mutex_lock(&session->notify_mutex);
+  session->stop_after_logout = 1;
+  sp_session_logout(session->sess);
+  pthread_mutex_unlock(&session->notify_mutex);
+
+  metadata_store_sync();
   return 0;
 }
 
 
-void addLoading(jobject javainstance, sp_track* track, sp_album* album, sp_artist* artist, int browse) {
-  pthread_mutex_lock(&g_spotify_mutex);
+void addLoading(jahspotify_session *session, jobject javainstance, sp_track* track, sp_album* album, sp_artist* artist, int browse) {
+  pthread_mutex_lock(&session->spotify_mutex);
   
-  media *lmedia = malloc(sizeof *lmedia);
-  lmedia->prev = NULL;
-  lmedia->next = loading;
+  media *lmedia = calloc(1, sizeof *lmedia);
   lmedia->javainstance = javainstance;
   lmedia->track = track;
   lmedia->album = album;
   lmedia->artist = artist;
   lmedia->browse = browse;
   
-  if (loading != NULL)
-		loading->prev = lmedia;
-  loading = lmedia;
+  if (pending_add(&session->loading, lmedia) != 0) {
+    log_error("jahspotify", "addLoading", "Could not queue item");
+    free(lmedia);
+  }
+  
+  pthread_mutex_unlock(&session->spotify_mutex);
   
-  pthread_mutex_unlock(&g_spotify_mutex);
+  // Wake the event loop so the item is checked even if no metadata update follows
+  pthread_mutex_lock(&session->notify_mutex);
+  session->notify_do = 1;
+  pthread_cond_signal(&session->notify_cond);
+  pthread_mutex_unlock(&session->notify_mutex);
 }
 
-void checkLoaded() {
-  pthread_mutex_lock(&g_spotify_mutex);
+/**
+ * Populates every queued Java instance whose item has loaded. Called from the event loop once
+ * per iteration after metadata_updated, so all completions of a tick share one pass over the table.
+ */
+void checkLoaded(jahspotify_session *session) {
+  pthread_mutex_lock(&session->spotify_mutex);
   
   JNIEnv* env = NULL;
   
-  media *checkload = loading;
-  while (checkload != NULL) {
+  session->loading.dirty = 0;
+  if (session->loading.size == 0 || !retrieveEnv((JNIEnv*) &env)) {
+    pthread_mutex_unlock(&session->spotify_mutex);
+    return;
+  }
+  
+  media *completed = pending_take_loaded(&session->loading);
+  uint64_t now = monotonic_millis();
+  int count = 0;
+  
+  while (completed != NULL) {
+    media *checkload = completed;
+    completed = completed->next;
     
-    if (  (checkload->track && sp_track_is_loaded(checkload->track))
-          || (checkload->artist && sp_artist_is_loaded(checkload->artist))
-          || (checkload->album && sp_album_is_loaded(checkload->album))) {
-      if (loading == checkload) { // First
-        loading = checkload->next;
-        if (loading != NULL)
-          loading->prev = NULL;
-      } else { // Any other.
-        if (checkload->prev != NULL)
-          checkload->prev->next = checkload->next;
-        if (checkload->next != NULL)
-          checkload->next->prev = checkload->prev;
-      }
-      
-      if (!env && !retrieveEnv((JNIEnv*) &env)) return;
-      
-      if (checkload->track) {
+    // Every request for the same item
+    while (checkload != NULL) {
+      if (!checkload->javainstance) {
+        refreshMetadata(checkload);
+      } else if (checkload->track) {
         populateJTrackInstance(env, checkload->javainstance, checkload->track);
       } else if (checkload->artist) {
-        populateJArtistInstance(env, checkload->javainstance, checkload->artist, checkload->browse);
+        populateJArtistInstance(env, session, checkload->javainstance, checkload->artist, checkload->browse);
       } else if (checkload->album) {
-        populateJAlbumInstance(env, checkload->javainstance, checkload->album, checkload->browse);
+        populateJAlbumInstance(env, session, checkload->javainstance, checkload->album, checkload->browse);
       }
-      (*env)->DeleteGlobalRef(env, checkload->javainstance);
+      if (checkload->javainstance) (*env)->DeleteGlobalRef(env, checkload->javainstance);
+      pending_completed(&session->loading, checkload, now);
+      count++;
       
       media *toFree = checkload;
-      checkload = checkload->next;
+      checkload = checkload->waiting;
       free(toFree);
-    } else {
-      checkload = checkload->next;
     }
   }
-  if (env)
-    detachThread();
+  if (count > 0)
+    log_debug("jahspotify", "checkLoaded", "Completed %d loads, %u still pending", count, session->loading.waiting);
+  detachThread();
+  
+  pthread_mutex_unlock(&session->spotify_mutex);
+}
+
+JNIEXPORT void JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeReadStatistics(JNIEnv *env, jobject obj, jobject statistics) {
+  jahspotify_session *session = session_from_java(env, obj);
+  if (!session) return;
+  
+  pthread_mutex_lock(&session->spotify_mutex);
+  setObjectLongField(env, statistics, "pendingLoads", session->loading.waiting);
+  setObjectLongField(env, statistics, "completedLoads", session->loading.completed);
+  setObjectLongField(env, statistics, "totalLoadLatency", session->loading.latency_total);
+  setObjectLongField(env, statistics, "maxLoadLatency", session->loading.latency_max);
+  setObjectLongField(env, statistics, "browseCacheHits", session->browses.hits);
+  setObjectLongField(env, statistics, "browseCacheMisses", session->browses.misses);
+  setObjectLongField(env, statistics, "browseCacheCoalesced", session->browses.coalesced);
+  setObjectLongField(env, statistics, "browseCacheExpired", session->browses.expired);
+  setObjectLongField(env, statistics, "browseCacheEntries", session->browses.size);
+  setObjectLongField(env, statistics, "runningSearches", session->searches.num_running);
+  setObjectLongField(env, statistics, "queuedSearches", session->searches.num_queued);
+  setObjectLongField(env, statistics, "completedSearches", session->searches.completed);
+  setObjectLongField(env, statistics, "failedSearches", session->searches.failed);
+  setObjectLongField(env, statistics, "timedOutSearches", session->searches.timed_out);
+  setObjectLongField(env, statistics, "cancelledSearches", session->searches.cancelled);
+  setObjectLongField(env, statistics, "totalSearchLatency", session->searches.latency_total);
+  setObjectLongField(env, statistics, "maxSearchLatency", session->searches.latency_max);
+  pthread_mutex_unlock(&session->spotify_mutex);
+  
+  library_index_stats libraryStats;
+  library_index_read_stats(&session->library, &libraryStats);
+  setObjectLongField(env, statistics, "libraryTracks", libraryStats.tracks);
+  setObjectLongField(env, statistics, "libraryPendingTracks", libraryStats.pending);
+  setObjectLongField(env, statistics, "libraryRemovedTracks", libraryStats.removed);
+  setObjectLongField(env, statistics, "libraryTerms", libraryStats.terms);
+  setObjectLongField(env, statistics, "libraryPostingBytes", libraryStats.bytes);
+  
+  metadata_cache_stats cacheStats;
+  metadata_cache_read_stats(&cacheStats);
+  setObjectLongField(env, statistics, "metadataCacheHits", cacheStats.hits);
+  setObjectLongField(env, statistics, "metadataCacheMisses", cacheStats.misses);
+  setObjectLongField(env, statistics, "metadataStoreHits", cacheStats.store_hits);
+  setObjectLongField(env, statistics, "metadataCacheEvictions", cacheStats.evictions);
+  setObjectLongField(env, statistics, "metadataCacheEntries", cacheStats.entries);
+  setObjectLongField(env, statistics, "metadataCacheBytes", cacheStats.bytes);
+  
+  image_cache_stats imageStats;
+  image_cache_read_stats(&imageStats);
+  setObjectLongField(env, statistics, "imageCacheHits", imageStats.hits);
+  setObjectLongField(env, statistics, "imageCacheMisses", imageStats.misses);
+  setObjectLongField(env, statistics, "imageCacheEvictions", imageStats.evictions);
+  setObjectLongField(env, statistics, "imageCacheEntries", imageStats.entries);
+  setObjectLongField(env, statistics, "imageCacheBytes", imageStats.bytes);
+}
+
+JNIEXPORT void JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeSetMetadataCacheBudget(JNIEnv *env, jobject obj, jlong bytes) {
+  metadata_cache_set_budget(bytes > 0 ? (size_t) bytes : 0);
+}
+
+JNIEXPORT void JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeSetImageCacheBudget(JNIEnv *env, jobject obj, jlong bytes) {
+  image_cache_set_budget(bytes > 0 ? (size_t) bytes : 0);
+}
+
+/**
+ * Returns a copy of the bytes of a thumbnail from the image cache, NULL if it is not cached.
+ */
+JNIEXPORT jbyteArray JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeReadCachedImage(JNIEnv *env, jobject obj, jstring uri, jint variant) {
+  uint8_t id[IMAGE_ID_SIZE];
+  jbyteArray bytes = NULL;
+  const void *data;
+  size_t size = 0;
+  
+  const char *nativeURI = (*env)->GetStringUTFChars(env, uri, NULL);
+  if (!nativeURI) return NULL;
+  
+  if (image_id_from_uri(nativeURI, id) == 0) {
+    data = image_cache_acquire(id, variant, &size);
+    if (data) {
+      bytes = createJImageBytes(env, data, size);
+      image_cache_release();
+    }
+  }
+  
+  (*env)->ReleaseStringUTFChars(env, uri, nativeURI);
+  return bytes;
+}
+
+/**
+ * Stores a thumbnail built by the Java side next to the original in the image cache.
+ */
+JNIEXPORT void JNICALL Java_jahspotify_impl_JahSpotifyImpl_nativeCacheImage(JNIEnv *env, jobject obj, jstring uri, jint variant, jbyteArray bytes) {
+  uint8_t id[IMAGE_ID_SIZE];
+  
+  const char *nativeURI = (*env)->GetStringUTFChars(env, uri, NULL);
+  if (!nativeURI) return;
+  
+  if (variant != IMAGE_VARIANT_ORIGINAL && image_id_from_uri(nativeURI, id) == 0) {
+    jsize size = (*env)->GetArrayLength(env, bytes);
+    jbyte *data = (*env)->GetByteArrayElements(env, bytes, NULL);
+    if (data) {
+      image_cache_put(id, variant, data, (size_t) size);
+      (*env)->ReleaseByteArrayElements(env, bytes, data, JNI_ABORT);
+    }
+  }
   
-  pthread_mutex_unlock(&g_spotify_mutex);
+  (*env)->ReleaseStringUTFChars(env, uri, nativeURI);
 }
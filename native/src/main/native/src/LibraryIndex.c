@@ -0,0 +1,803 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "LibraryIndex.h"
+#include "Logging.h"
+
+/*
+ * Inverted index over the tracks of the playlist container, so the user's own library can be
+ * searched without going to Spotify.
+ *
+ * Every distinct track gets a slot holding a reference and the number of playlist positions it is
+ * in. Once loaded it is given the next doc and its title, artist and album terms are appended to
+ * the posting lists of those terms. A track leaving every playlist keeps its doc and is filtered
+ * out when matching, so putting it back costs nothing; the removed tracks are purged from the
+ * posting lists once they outnumber the live ones.
+ *
+ * Terms are split at anything but ASCII letters and digits or non-ASCII characters, apostrophes
+ * are dropped and ASCII and Latin-1 letters are folded to lower case.
+ */
+
+static uint32_t library_hash_pointer(const void *pointer) {
+	uint64_t value = (uint64_t) (uintptr_t) pointer;
+	value ^= value >> 33;
+	value *= 0xff51afd7ed558ccdULL;
+	value ^= value >> 33;
+	return (uint32_t) value;
+}
+
+static uint32_t library_hash_term(int field, const char *term) {
+	uint32_t hash = 2166136261u ^ (uint32_t) field;
+	while (*term) {
+		hash ^= (uint8_t) *term++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static int library_grow(void **array, uint32_t *capacity, uint32_t needed, size_t size) {
+	uint32_t grown;
+	void *resized;
+
+	if (needed <= *capacity) return 0;
+	grown = *capacity > 0 ? *capacity * 2 : 64;
+	while (grown < needed)
+		grown *= 2;
+
+	resized = realloc(*array, grown * size);
+	if (!resized) {
+		log_error("libraryindex", "library_grow", "Could not grow array to %u entries", grown);
+		return -1;
+	}
+	*array = resized;
+	*capacity = grown;
+	return 0;
+}
+
+static int library_term_byte(uint8_t c) {
+	return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+}
+
+/**
+ * Reads the next term of the text into term, which has room for LIBRARY_MAX_TERM bytes and the
+ * terminator, and moves the text past it.
+ *
+ * @return Length of the term, 0 at the end of the text.
+ */
+size_t library_next_term(const char **text, char *term) {
+	const uint8_t *p = (const uint8_t*) *text;
+	size_t length = 0;
+
+	while (*p && !library_term_byte(*p))
+		p++;
+
+	while (*p && (library_term_byte(*p) || *p == '\'')) {
+		uint8_t c = *p++;
+		if (c == '\'') continue;
+
+		if (c >= 'A' && c <= 'Z') {
+			c += 'a' - 'A';
+		} else if (c == 0xC3 && *p >= 0x80 && *p <= 0x9E && *p != 0x97) {
+			// Upper case Latin-1 letter, the lower case one is 0x20 further on
+			if (length + 2 <= LIBRARY_MAX_TERM) {
+				term[length++] = (char) c;
+				term[length++] = (char) (*p + 0x20);
+			}
+			p++;
+			continue;
+		}
+		if (length < LIBRARY_MAX_TERM) term[length++] = (char) c;
+	}
+
+	term[length] = '\0';
+	*text = (const char*) p;
+	return length;
+}
+
+/* ----------------------------  POSTING LISTS  ---------------------------- */
+
+static size_t library_put_varint(uint8_t *out, uint32_t value) {
+	size_t size = 0;
+	while (value >= 0x80) {
+		out[size++] = (uint8_t) (value | 0x80);
+		value >>= 7;
+	}
+	out[size++] = (uint8_t) value;
+	return size;
+}
+
+static uint32_t library_get_varint(const uint8_t **in) {
+	uint32_t value = 0;
+	int shift = 0;
+	uint8_t b;
+	do {
+		b = *(*in)++;
+		value |= (uint32_t) (b & 0x7F) << shift;
+		shift += 7;
+	} while (b & 0x80);
+	return value;
+}
+
+static int library_resize_terms(library_index *index, uint32_t capacity) {
+	library_postings **terms = calloc(capacity, sizeof(library_postings*));
+	library_postings *postings;
+	uint32_t bucket;
+
+	if (!terms) {
+		log_error("libraryindex", "library_resize_terms", "Could not allocate %u term buckets", capacity);
+		return -1;
+	}
+
+	for (bucket = 0; bucket < index->capacity_terms; bucket++) {
+		while ((postings = index->terms[bucket])) {
+			uint32_t moved = library_hash_term(postings->field, postings->term) & (capacity - 1);
+			index->terms[bucket] = postings->next;
+			postings->next = terms[moved];
+			terms[moved] = postings;
+		}
+	}
+
+	free(index->terms);
+	index->terms = terms;
+	index->capacity_terms = capacity;
+	return 0;
+}
+
+static library_postings *library_postings_for(library_index *index, int field, const char *term, int create) {
+	library_postings *postings;
+	size_t length;
+	uint32_t bucket;
+
+	if (index->capacity_terms == 0 && (!create || library_resize_terms(index, 1024) != 0)) return NULL;
+
+	bucket = library_hash_term(field, term) & (index->capacity_terms - 1);
+	for (postings = index->terms[bucket]; postings; postings = postings->next) {
+		if (postings->field == field && strcmp(postings->term, term) == 0) return postings;
+	}
+	if (!create) return NULL;
+
+	if (index->num_terms >= index->capacity_terms && library_resize_terms(index, index->capacity_terms * 2) == 0)
+		bucket = library_hash_term(field, term) & (index->capacity_terms - 1);
+
+	length = strlen(term);
+	postings = calloc(1, sizeof(library_postings) + length + 1);
+	if (!postings) {
+		log_error("libraryindex", "library_postings_for", "Could not allocate posting list");
+		return NULL;
+	}
+	postings->field = (uint8_t) field;
+	memcpy(postings->term, term, length + 1);
+	postings->next = index->terms[bucket];
+	index->terms[bucket] = postings;
+	index->num_terms++;
+	return postings;
+}
+
+static int library_postings_append(library_index *index, library_postings *postings, uint32_t doc) {
+	if (postings->size + 5 > postings->capacity) {
+		size_t capacity = postings->capacity > 0 ? postings->capacity * 2 : 8;
+		uint8_t *data = realloc(postings->data, capacity);
+		if (!data) {
+			log_error("libraryindex", "library_postings_append", "Could not grow posting list");
+			return -1;
+		}
+		index->postings_bytes += capacity - postings->capacity;
+		postings->data = data;
+		postings->capacity = capacity;
+	}
+
+	postings->size += library_put_varint(postings->data + postings->size, postings->count > 0 ? doc - postings->last : doc);
+	postings->last = doc;
+	postings->count++;
+	return 0;
+}
+
+static uint32_t *library_postings_decode(const library_postings *postings) {
+	uint32_t *docs = malloc(sizeof(uint32_t) * (postings->count + 1));
+	const uint8_t *in = postings->data;
+	uint32_t doc = 0, i;
+
+	if (!docs) {
+		log_error("libraryindex", "library_postings_decode", "Could not allocate %u docs", postings->count);
+		return NULL;
+	}
+	for (i = 0; i < postings->count; i++) {
+		doc += library_get_varint(&in);
+		docs[i] = doc;
+	}
+	return docs;
+}
+
+static int library_doc_live(library_index *index, uint32_t doc) {
+	uint32_t slot = index->docs[doc];
+	return slot != LIBRARY_NO_SLOT && index->tracks[slot].refs > 0;
+}
+
+/**
+ * Drops the docs of removed tracks from the list. Re-encoding in place is safe: the delta to the
+ * previous kept doc never takes more bytes than the deltas it replaces.
+ */
+static void library_postings_purge(library_index *index, library_postings *postings) {
+	const uint8_t *in = postings->data;
+	size_t size = 0;
+	uint32_t doc = 0, count = 0, last = 0, i;
+
+	for (i = 0; i < postings->count; i++) {
+		doc += library_get_varint(&in);
+		if (!library_doc_live(index, doc)) continue;
+		size += library_put_varint(postings->data + size, count > 0 ? doc - last : doc);
+		last = doc;
+		count++;
+	}
+
+	postings->size = size;
+	postings->count = count;
+	postings->last = last;
+}
+
+static void library_add_terms(library_index *index, int field, const char *text, uint32_t doc) {
+	char term[LIBRARY_MAX_TERM + 1];
+	library_postings *postings;
+
+	if (!text) return;
+	while (library_next_term(&text, term) > 0) {
+		postings = library_postings_for(index, field, term, 1);
+		// Terms repeated within a field are posted once
+		if (postings && (postings->count == 0 || postings->last != doc)) library_postings_append(index, postings, doc);
+	}
+}
+
+/* --------------------------------  TRACKS  ------------------------------- */
+
+static uint32_t *library_lookup_bucket(library_index *index, const sp_track *track) {
+	uint32_t mask = index->capacity_lookup - 1;
+	uint32_t i = library_hash_pointer(track) & mask;
+	while (index->lookup[i] && index->tracks[index->lookup[i] - 1].track != track)
+		i = (i + 1) & mask;
+	return &index->lookup[i];
+}
+
+static int library_rebuild_lookup(library_index *index, uint32_t capacity) {
+	uint32_t *lookup = calloc(capacity, sizeof(uint32_t));
+	uint32_t slot;
+
+	if (!lookup) {
+		log_error("libraryindex", "library_rebuild_lookup", "Could not allocate %u lookup buckets", capacity);
+		return -1;
+	}
+
+	free(index->lookup);
+	index->lookup = lookup;
+	index->capacity_lookup = capacity;
+	for (slot = 0; slot < index->num_tracks; slot++) {
+		if (index->tracks[slot].track) *library_lookup_bucket(index, index->tracks[slot].track) = slot + 1;
+	}
+	return 0;
+}
+
+static void library_free_slot(library_index *index, uint32_t slot) {
+	library_track *entry = &index->tracks[slot];
+
+	sp_track_release(entry->track);
+	free(entry->uri);
+	memset(entry, 0, sizeof(library_track));
+	entry->doc = index->free_slot;
+	index->free_slot = (int32_t) slot;
+}
+
+/**
+ * Counts another playlist position holding the track, giving it a slot if it is new.
+ */
+static int library_acquire(library_index *index, sp_track *track) {
+	library_track *entry;
+	uint32_t *bucket;
+	uint32_t slot;
+
+	if (index->capacity_lookup > 0) {
+		bucket = library_lookup_bucket(index, track);
+		if (*bucket) {
+			entry = &index->tracks[*bucket - 1];
+			goto found;
+		}
+	}
+
+	if ((index->num_tracks + 1) * 2 > index->capacity_lookup
+			&& library_rebuild_lookup(index, index->capacity_lookup > 0 ? index->capacity_lookup * 2 : 1024) != 0) return -1;
+	if (library_grow((void**) &index->pending, &index->capacity_pending, index->num_pending + 1, sizeof(uint32_t)) != 0) return -1;
+
+	if (index->free_slot >= 0) {
+		slot = (uint32_t) index->free_slot;
+		index->free_slot = index->tracks[slot].doc;
+	} else {
+		if (library_grow((void**) &index->tracks, &index->capacity_tracks, index->num_tracks + 1, sizeof(library_track)) != 0) return -1;
+		slot = index->num_tracks++;
+	}
+
+	entry = &index->tracks[slot];
+	memset(entry, 0, sizeof(library_track));
+	entry->track = track;
+	entry->doc = -1;
+	sp_track_add_ref(track);
+	*library_lookup_bucket(index, track) = slot + 1;
+	index->pending[index->num_pending++] = slot;
+
+	found:
+	if (entry->refs++ == 0 && entry->doc >= 0) {
+		index->num_removed--;
+		index->num_live++;
+	}
+	return 0;
+}
+
+static void library_release(library_index *index, sp_track *track) {
+	library_track *entry;
+	uint32_t *bucket;
+
+	if (index->capacity_lookup == 0) return;
+	bucket = library_lookup_bucket(index, track);
+	if (!*bucket) return;
+
+	entry = &index->tracks[*bucket - 1];
+	if (entry->refs > 0 && --entry->refs == 0 && entry->doc >= 0) {
+		index->num_live--;
+		index->num_removed++;
+	}
+}
+
+/**
+ * A track can be indexed once its album and artists have names too. Tracks which failed to load
+ * are indexed without terms rather than waited for forever.
+ */
+static int library_track_ready(sp_track *track) {
+	sp_album *album;
+	int i;
+
+	if (!sp_track_is_loaded(track)) return 0;
+	if (sp_track_error(track) != SP_ERROR_OK) return 1;
+
+	album = sp_track_album(track);
+	if (album && !sp_album_is_loaded(album)) return 0;
+	for (i = 0; i < sp_track_num_artists(track); i++) {
+		sp_artist *artist = sp_track_artist(track, i);
+		if (artist && !sp_artist_is_loaded(artist)) return 0;
+	}
+	return 1;
+}
+
+static int library_index_track(library_index *index, uint32_t slot) {
+	library_track *entry = &index->tracks[slot];
+	char uri[128];
+	sp_link *link;
+	sp_album *album;
+	uint32_t doc;
+	int i;
+
+	if (index->num_docs >= LIBRARY_MAX_DOC - index->first_doc) {
+		log_error("libraryindex", "library_index_track", "Out of docs");
+		return -1;
+	}
+	if (library_grow((void**) &index->docs, &index->capacity_docs, index->num_docs + 1, sizeof(uint32_t)) != 0) return -1;
+
+	link = sp_link_create_from_track(entry->track, 0);
+	if (!link) return -1;
+	sp_link_as_string(link, uri, sizeof(uri));
+	sp_link_release(link);
+
+	entry->uri = strdup(uri);
+	if (!entry->uri) {
+		log_error("libraryindex", "library_index_track", "Could not copy %s", uri);
+		return -1;
+	}
+
+	doc = index->num_docs++;
+	index->docs[doc] = slot;
+	entry->doc = (int32_t) doc;
+	if (entry->refs > 0) index->num_live++;
+	else index->num_removed++;
+
+	if (sp_track_error(entry->track) != SP_ERROR_OK) return 0;
+
+	library_add_terms(index, LIBRARY_FIELD_TITLE, sp_track_name(entry->track), doc);
+	album = sp_track_album(entry->track);
+	if (album) library_add_terms(index, LIBRARY_FIELD_ALBUM, sp_album_name(album), doc);
+	for (i = 0; i < sp_track_num_artists(entry->track); i++) {
+		sp_artist *artist = sp_track_artist(entry->track, i);
+		if (artist) library_add_terms(index, LIBRARY_FIELD_ARTIST, sp_artist_name(artist), doc);
+	}
+	return 0;
+}
+
+/**
+ * Indexes the waiting tracks which have loaded and drops those which left every playlist
+ * before they did.
+ */
+static void library_index_pending(library_index *index) {
+	uint32_t i, kept = 0;
+	int freed = 0;
+
+	for (i = 0; i < index->num_pending; i++) {
+		uint32_t slot = index->pending[i];
+		if (index->tracks[slot].refs == 0) {
+			library_free_slot(index, slot);
+			freed = 1;
+		} else if (!library_track_ready(index->tracks[slot].track) || library_index_track(index, slot) != 0) {
+			index->pending[kept++] = slot;
+		}
+	}
+	index->num_pending = kept;
+
+	// Open addressing cannot take single buckets out
+	if (freed) library_rebuild_lookup(index, index->capacity_lookup);
+}
+
+static void library_purge(library_index *index) {
+	library_postings **link, *postings;
+	uint32_t bucket, doc;
+
+	for (bucket = 0; bucket < index->capacity_terms; bucket++) {
+		link = &index->terms[bucket];
+		while ((postings = *link)) {
+			library_postings_purge(index, postings);
+			if (postings->count > 0) {
+				link = &postings->next;
+				continue;
+			}
+			*link = postings->next;
+			index->postings_bytes -= postings->capacity;
+			index->num_terms--;
+			free(postings->data);
+			free(postings);
+		}
+	}
+
+	for (doc = 0; doc < index->num_docs; doc++) {
+		if (library_doc_live(index, doc) || index->docs[doc] == LIBRARY_NO_SLOT) continue;
+		library_free_slot(index, index->docs[doc]);
+		index->docs[doc] = LIBRARY_NO_SLOT;
+	}
+
+	log_debug("libraryindex", "library_purge", "Purged %u removed tracks, %u remain", index->num_removed, index->num_live);
+	index->num_removed = 0;
+	library_rebuild_lookup(index, index->capacity_lookup);
+}
+
+/* ------------------------------  PLAYLISTS  ------------------------------ */
+
+static library_playlist **library_find_playlist(library_index *index, sp_playlist *playlist) {
+	library_playlist **link = &index->playlists;
+	while (*link && (*link)->playlist != playlist)
+		link = &(*link)->next;
+	return link;
+}
+
+/**
+ * Brings the tracks of the playlist up to date. The new tracks are counted before the old ones
+ * are let go, so tracks which stay never look removed.
+ */
+static void library_sync_playlist(library_index *index, library_playlist *entry) {
+	sp_track **tracks = NULL;
+	int count, i;
+
+	if (!sp_playlist_is_loaded(entry->playlist)) {
+		index->num_unsynced++;
+		return;
+	}
+
+	count = sp_playlist_num_tracks(entry->playlist);
+	if (count > 0 && !(tracks = malloc(sizeof(sp_track*) * count))) {
+		log_error("libraryindex", "library_sync_playlist", "Could not allocate %d tracks", count);
+		index->num_unsynced++;
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		tracks[i] = sp_playlist_track(entry->playlist, i);
+		if (tracks[i] && library_acquire(index, tracks[i]) != 0) tracks[i] = NULL;
+	}
+	for (i = 0; i < entry->num_tracks; i++) {
+		if (entry->tracks[i]) library_release(index, entry->tracks[i]);
+	}
+
+	free(entry->tracks);
+	entry->tracks = tracks;
+	entry->num_tracks = count;
+	entry->stale = 0;
+}
+
+void library_index_init(library_index *index) {
+	memset(index, 0, sizeof(library_index));
+	pthread_mutex_init(&index->mutex, NULL);
+	index->free_slot = -1;
+}
+
+/**
+ * Starts indexing a playlist of the container, its tracks are read on the next refresh.
+ */
+void library_index_add_playlist(library_index *index, sp_playlist *playlist) {
+	library_playlist *entry;
+
+	pthread_mutex_lock(&index->mutex);
+	if (*library_find_playlist(index, playlist)) goto exit;
+
+	entry = calloc(1, sizeof(library_playlist));
+	if (!entry) {
+		log_error("libraryindex", "library_index_add_playlist", "Could not allocate playlist");
+		goto exit;
+	}
+	sp_playlist_add_ref(playlist);
+	entry->playlist = playlist;
+	entry->stale = 1;
+	entry->next = index->playlists;
+	index->playlists = entry;
+	index->dirty = 1;
+
+	exit:
+	pthread_mutex_unlock(&index->mutex);
+}
+
+void library_index_remove_playlist(library_index *index, sp_playlist *playlist) {
+	library_playlist **link, *entry;
+	int i;
+
+	pthread_mutex_lock(&index->mutex);
+	link = library_find_playlist(index, playlist);
+	if (!(entry = *link)) goto exit;
+
+	*link = entry->next;
+	for (i = 0; i < entry->num_tracks; i++) {
+		if (entry->tracks[i]) library_release(index, entry->tracks[i]);
+	}
+	sp_playlist_release(entry->playlist);
+	free(entry->tracks);
+	free(entry);
+	index->dirty = 1;
+
+	exit:
+	pthread_mutex_unlock(&index->mutex);
+}
+
+/**
+ * Notes that tracks were added to or removed from the playlist.
+ */
+void library_index_touch(library_index *index, sp_playlist *playlist) {
+	library_playlist *entry;
+
+	pthread_mutex_lock(&index->mutex);
+	entry = *library_find_playlist(index, playlist);
+	if (entry) {
+		entry->stale = 1;
+		index->dirty = 1;
+	}
+	pthread_mutex_unlock(&index->mutex);
+}
+
+/**
+ * Called when libspotify loaded metadata, which waiting tracks and playlists may have been after.
+ */
+void library_index_metadata_updated(library_index *index) {
+	if (index->num_pending > 0 || index->num_unsynced > 0) index->dirty = 1;
+}
+
+/**
+ * Applies the changes noted since the last refresh. Called from the event loop with the spotify
+ * mutex held.
+ */
+void library_index_refresh(library_index *index) {
+	library_playlist *entry;
+
+	pthread_mutex_lock(&index->mutex);
+	index->dirty = 0;
+	index->num_unsynced = 0;
+
+	for (entry = index->playlists; entry; entry = entry->next) {
+		if (entry->stale) library_sync_playlist(index, entry);
+	}
+	library_index_pending(index);
+
+	if (index->num_removed >= LIBRARY_PURGE_THRESHOLD && index->num_removed > index->num_live) library_purge(index);
+	pthread_mutex_unlock(&index->mutex);
+}
+
+/**
+ * Releases every track and forgets all playlists. Called with the spotify mutex held, on logout
+ * and before the session is released.
+ */
+void library_index_clear(library_index *index) {
+	library_playlist *entry;
+	library_postings *postings;
+	uint32_t i;
+
+	pthread_mutex_lock(&index->mutex);
+	while ((entry = index->playlists)) {
+		index->playlists = entry->next;
+		sp_playlist_release(entry->playlist);
+		free(entry->tracks);
+		free(entry);
+	}
+
+	for (i = 0; i < index->num_tracks; i++) {
+		if (index->tracks[i].track) library_free_slot(index, i);
+	}
+	for (i = 0; i < index->capacity_terms; i++) {
+		while ((postings = index->terms[i])) {
+			index->terms[i] = postings->next;
+			free(postings->data);
+			free(postings);
+		}
+	}
+
+	free(index->tracks);
+	free(index->docs);
+	free(index->lookup);
+	free(index->terms);
+	free(index->pending);
+	index->tracks = NULL;
+	index->docs = NULL;
+	index->lookup = NULL;
+	index->terms = NULL;
+	index->pending = NULL;
+	index->num_tracks = index->capacity_tracks = 0;
+	// Docs matched before the clear must not name the tracks indexed after it
+	if (index->num_docs > LIBRARY_MAX_DOC - index->first_doc) {
+		log_debug("libraryindex", "library_index_clear", "Docs wrapped around");
+		index->first_doc = 0;
+	} else {
+		index->first_doc += index->num_docs;
+	}
+	index->num_docs = index->capacity_docs = 0;
+	index->capacity_lookup = 0;
+	index->num_terms = index->capacity_terms = 0;
+	index->num_pending = index->capacity_pending = 0;
+	index->num_removed = index->num_live = index->num_unsynced = 0;
+	index->postings_bytes = 0;
+	index->free_slot = -1;
+	index->dirty = 0;
+	pthread_mutex_unlock(&index->mutex);
+}
+
+/* -------------------------------  MATCHING  ------------------------------ */
+
+static uint32_t library_union(const uint32_t *a, uint32_t na, const uint32_t *b, uint32_t nb, uint32_t *out) {
+	uint32_t i = 0, j = 0, n = 0;
+	while (i < na && j < nb) {
+		if (a[i] < b[j]) out[n++] = a[i++];
+		else if (b[j] < a[i]) out[n++] = b[j++];
+		else {
+			out[n++] = a[i++];
+			j++;
+		}
+	}
+	while (i < na)
+		out[n++] = a[i++];
+	while (j < nb)
+		out[n++] = b[j++];
+	return n;
+}
+
+/**
+ * Intersects two ascending lists, out may be a as it is written no faster than it is read.
+ */
+static uint32_t library_intersect(uint32_t *a, uint32_t na, const uint32_t *b, uint32_t nb, uint32_t *out) {
+	uint32_t i = 0, j = 0, n = 0;
+	while (i < na && j < nb) {
+		if (a[i] < b[j]) i++;
+		else if (b[j] < a[i]) j++;
+		else {
+			out[n++] = a[i++];
+			j++;
+		}
+	}
+	return n;
+}
+
+/**
+ * Docs of the tracks containing the term in any of the fields, ascending.
+ */
+static uint32_t *library_match_term(library_index *index, int fields, const char *term, uint32_t *count) {
+	uint32_t *matches = NULL, *decoded, *merged;
+	library_postings *postings;
+	int field;
+
+	*count = 0;
+	for (field = LIBRARY_FIELD_TITLE; field <= LIBRARY_FIELD_ALBUM; field <<= 1) {
+		if (!(fields & field) || !(postings = library_postings_for(index, field, term, 0))) continue;
+
+		if (!(decoded = library_postings_decode(postings))) goto fail;
+		if (!matches) {
+			matches = decoded;
+			*count = postings->count;
+			continue;
+		}
+
+		merged = malloc(sizeof(uint32_t) * (*count + postings->count));
+		if (!merged) {
+			free(decoded);
+			goto fail;
+		}
+		*count = library_union(matches, *count, decoded, postings->count, merged);
+		free(matches);
+		free(decoded);
+		matches = merged;
+	}
+	return matches ? matches : calloc(1, sizeof(uint32_t));
+
+	fail:
+	free(matches);
+	return NULL;
+}
+
+/**
+ * Finds the tracks of the library containing every term of the text in one of the fields. An
+ * empty text matches all tracks.
+ *
+ * @param  docs   Set to the ascending docs of the tracks, to be freed by the caller
+ * @param  count  Set to the number of docs
+ * @return 0 on success, -1 if memory ran out
+ */
+int library_index_match(library_index *index, int fields, const char *text, uint32_t **docs, uint32_t *count) {
+	char term[LIBRARY_MAX_TERM + 1];
+	uint32_t *result = NULL, *matches;
+	uint32_t num_result = 0, num_matches, i;
+	int first = 1;
+
+	*docs = NULL;
+	*count = 0;
+
+	pthread_mutex_lock(&index->mutex);
+	while (library_next_term(&text, term) > 0) {
+		if (!(matches = library_match_term(index, fields, term, &num_matches))) goto fail;
+		if (first) {
+			result = matches;
+			num_result = num_matches;
+			first = 0;
+		} else {
+			num_result = library_intersect(result, num_result, matches, num_matches, result);
+			free(matches);
+		}
+		if (num_result == 0) break;
+	}
+
+	if (first) {
+		if (!(result = malloc(sizeof(uint32_t) * (index->num_docs + 1)))) goto fail;
+		for (i = 0; i < index->num_docs; i++)
+			result[i] = i;
+		num_result = index->num_docs;
+	}
+
+	// Leave out tracks which are in no playlist anymore
+	for (i = 0, *count = 0; i < num_result; i++) {
+		if (library_doc_live(index, result[i])) result[(*count)++] = index->first_doc + result[i];
+	}
+	pthread_mutex_unlock(&index->mutex);
+
+	*docs = result;
+	return 0;
+
+	fail:
+	pthread_mutex_unlock(&index->mutex);
+	log_error("libraryindex", "library_index_match", "Could not match %s", text);
+	free(result);
+	*count = 0;
+	return -1;
+}
+
+/**
+ * URI of the track of the doc, NULL if the doc is unknown, removed or from before the last clear.
+ * The caller holds the index mutex while using it.
+ */
+const char *library_index_uri(library_index *index, uint32_t doc) {
+	if (doc < index->first_doc) return NULL;
+	doc -= index->first_doc;
+	if (doc >= index->num_docs || !library_doc_live(index, doc)) return NULL;
+	return index->tracks[index->docs[doc]].uri;
+}
+
+void library_index_read_stats(library_index *index, library_index_stats *stats) {
+	pthread_mutex_lock(&index->mutex);
+	stats->tracks = index->num_live;
+	stats->pending = index->num_pending;
+	stats->removed = index->num_removed;
+	stats->terms = index->num_terms;
+	stats->bytes = index->postings_bytes;
+	pthread_mutex_unlock(&index->mutex);
+}
@@ -1,83 +1,289 @@
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
 #include "Logging.h"
+#include "ThreadHelpers.h"
+#include "jahspotify_impl_NativeLogger.h"
+
+#define LOG_COMPONENT_SIZE 32
+#define LOG_SUBCOMPONENT_SIZE 96
+/* Maximum number of records delivered to Java per drain pass */
+#define LOG_BATCH_SIZE 64
+/* Number of queued records at which producers wake the drain thread right away */
+#define LOG_HIGH_WATER (LOG_RING_SIZE / 4)
+/* Time records below the high-water mark may wait to be delivered, in milliseconds */
+#define LOG_FLUSH_INTERVAL 200
 
+/* What the drain thread is doing, tells producers whether they have to wake it */
+#define LOG_DRAIN_RUNNING 0
+#define LOG_DRAIN_IDLE 1
+#define LOG_DRAIN_FLUSHING 2
+
+extern JavaVM* g_vm;
 extern jclass g_loggerClass;
 
-static void logToJava(const char *method, const char *component, const char *subComponent, const char *format, va_list args) {
-	jmethodID jMethod = NULL;
-	JNIEnv* env = NULL;
+typedef struct log_record {
+	volatile unsigned int sequence;
+	int level;
+	char component[LOG_COMPONENT_SIZE];
+	char subComponent[LOG_SUBCOMPONENT_SIZE];
+	char message[LOG_MESSAGE_SIZE];
+} log_record;
 
-	// FIXME: This should probably be a little more clever?
-	char *buffer = calloc(1, 1024);
+volatile int g_log_level = LOG_LEVEL_TRACE;
 
-	vsprintf(buffer, format, args);
+/// The ring, a bounded multi producer / single consumer queue. Producers claim a slot by advancing
+/// the enqueue position with a CAS, the sequence number of a slot tells who owns it.
+static log_record g_log_ring[LOG_RING_SIZE];
+static volatile unsigned int g_log_enqueue_pos = 0;
+static volatile unsigned int g_log_dequeue_pos = 0;
+static volatile unsigned int g_log_dropped = 0;
+static volatile int g_log_started = 0;
+static volatile int g_log_ring_initialized = 0;
 
-	if (!retrieveEnv((JNIEnv*) &env)) {
-		goto fail;
-	}
+/// The drain thread sleeps on the condition while the ring is empty, and for at most the flush
+/// interval while it holds fewer records than the high-water mark.
+static pthread_mutex_t g_log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_log_cond = PTHREAD_COND_INITIALIZER;
+static volatile int g_log_drain_state = LOG_DRAIN_RUNNING;
 
-	jstring componentStr = (*env)->NewStringUTF(env, component);
-	jstring subComponentStr = (*env)->NewStringUTF(env, subComponent);
-	jstring messageStr = (*env)->NewStringUTF(env, buffer);
+static const char *g_log_methods[] = { "trace", "debug", "info", "warn", "error", "fatal" };
+static jmethodID g_log_method_ids[LOG_LEVEL_FATAL + 1];
 
-	jMethod = (*env)->GetStaticMethodID(env, g_loggerClass, method, "(Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;)V");
+static void log_ring_init() {
+	unsigned int i;
+	if (g_log_ring_initialized) return;
+	if (!__sync_bool_compare_and_swap(&g_log_ring_initialized, 0, 1)) return;
+	for (i = 0; i < LOG_RING_SIZE; i++)
+		g_log_ring[i].sequence = i;
+	__sync_synchronize();
+	g_log_ring_initialized = 2;
+}
 
-	if (!jMethod) {
-		goto fail;
+static void log_copy(char *dest, const char *src, size_t size) {
+	if (!src) {
+		dest[0] = '\0';
+		return;
 	}
+	strncpy(dest, src, size - 1);
+	dest[size - 1] = '\0';
+}
 
-	(*env)->CallStaticVoidMethod(env, g_loggerClass, jMethod, componentStr, subComponentStr, messageStr);
+static unsigned int log_backlog() {
+	return g_log_enqueue_pos - g_log_dequeue_pos;
+}
+
+/**
+ * Wakes the drain thread if it is waiting for the first record, or waiting for the flush interval
+ * while the ring is filling up.
+ */
+static void log_wake() {
+	int state;
+
+	// Pairs with the barrier in log_drain, either the drain thread sees the record or we see it waiting
+	__sync_synchronize();
+	state = g_log_drain_state;
+	if (state == LOG_DRAIN_RUNNING || (state == LOG_DRAIN_FLUSHING && log_backlog() < LOG_HIGH_WATER)) return;
+
+	pthread_mutex_lock(&g_log_mutex);
+	pthread_cond_signal(&g_log_cond);
+	pthread_mutex_unlock(&g_log_mutex);
+}
+
+static void log_enqueue(int level, const char *component, const char *subComponent, const char *format, va_list args) {
+	log_record *record;
+	unsigned int pos;
+	int diff;
 
-	fail: if (buffer) {
-		free(buffer);
+	if (g_log_ring_initialized != 2) log_ring_init();
+	while (g_log_ring_initialized != 2)
+		; // Another thread is initializing the ring.
+
+	pos = g_log_enqueue_pos;
+	for (;;) {
+		record = &g_log_ring[pos & (LOG_RING_SIZE - 1)];
+		diff = (int) (record->sequence - pos);
+		if (diff == 0) {
+			if (__sync_bool_compare_and_swap(&g_log_enqueue_pos, pos, pos + 1)) break;
+		} else if (diff < 0) {
+			// The ring is full, the drain thread will report what we lost.
+			__sync_fetch_and_add(&g_log_dropped, 1);
+			log_wake();
+			return;
+		}
+		pos = g_log_enqueue_pos;
 	}
 
+	record->level = level;
+	log_copy(record->component, component, LOG_COMPONENT_SIZE);
+	log_copy(record->subComponent, subComponent, LOG_SUBCOMPONENT_SIZE);
+	vsnprintf(record->message, LOG_MESSAGE_SIZE, format, args);
+
+	__sync_synchronize();
+	record->sequence = pos + 1;
+	log_wake();
+}
+
+static void log_deliver(JNIEnv *env, int level, const char *component, const char *subComponent, const char *message) {
+	jmethodID jMethod = g_log_method_ids[level];
+	if (!jMethod) return;
+
+	jstring componentStr = (*env)->NewStringUTF(env, component);
+	jstring subComponentStr = (*env)->NewStringUTF(env, subComponent);
+	jstring messageStr = (*env)->NewStringUTF(env, message);
+
+	(*env)->CallStaticVoidMethod(env, g_loggerClass, jMethod, componentStr, subComponentStr, messageStr);
+	if ((*env)->ExceptionCheck(env)) (*env)->ExceptionClear(env);
+
 	if (componentStr) (*env)->DeleteLocalRef(env, componentStr);
 	if (subComponentStr) (*env)->DeleteLocalRef(env, subComponentStr);
 	if (messageStr) (*env)->DeleteLocalRef(env, messageStr);
-	detachThread();
-	return;
+}
+
+/**
+ * Hands up to LOG_BATCH_SIZE records to NativeLogger, returns the number of records delivered.
+ */
+static int log_drain_batch(JNIEnv *env) {
+	int count = 0;
+	while (count < LOG_BATCH_SIZE) {
+		log_record *record = &g_log_ring[g_log_dequeue_pos & (LOG_RING_SIZE - 1)];
+		if ((int) (record->sequence - (g_log_dequeue_pos + 1)) < 0) break;
+
+		__sync_synchronize();
+		log_deliver(env, record->level, record->component, record->subComponent, record->message);
+
+		__sync_synchronize();
+		record->sequence = g_log_dequeue_pos + LOG_RING_SIZE;
+		g_log_dequeue_pos++;
+		count++;
+	}
+
+	unsigned int dropped = __sync_fetch_and_and(&g_log_dropped, 0);
+	if (dropped > 0) {
+		char message[64];
+		snprintf(message, sizeof(message), "Log ring overflowed, dropped %u messages", dropped);
+		log_deliver(env, LOG_LEVEL_WARN, "logging", "log_drain", message);
+	}
+	return count;
+}
+
+static void log_drain(void *params) {
+	JNIEnv *env = NULL;
+	int level;
+
+	if ((*g_vm)->AttachCurrentThreadAsDaemon(g_vm, (void**) &env, NULL) != JNI_OK) {
+		fprintf(stderr, "jahspotify::log_drain: unable to attach the log thread\n");
+		g_log_started = 0;
+		return;
+	}
+
+	for (level = LOG_LEVEL_TRACE; level <= LOG_LEVEL_FATAL; level++) {
+		g_log_method_ids[level] = (*env)->GetStaticMethodID(env, g_loggerClass, g_log_methods[level],
+				"(Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;)V");
+	}
+
+	for (;;) {
+		pthread_mutex_lock(&g_log_mutex);
+		g_log_drain_state = LOG_DRAIN_IDLE;
+		__sync_synchronize();
+		while (log_backlog() == 0 && g_log_dropped == 0)
+			pthread_cond_wait(&g_log_cond, &g_log_mutex);
+
+		// Give the ring a chance to fill so records are delivered in batches
+		g_log_drain_state = LOG_DRAIN_FLUSHING;
+		__sync_synchronize();
+		if (log_backlog() < LOG_HIGH_WATER) {
+			struct timespec deadline;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			deadline.tv_nsec += (long) LOG_FLUSH_INTERVAL * 1000000;
+			deadline.tv_sec += deadline.tv_nsec / 1000000000;
+			deadline.tv_nsec %= 1000000000;
+			pthread_cond_timedwait(&g_log_cond, &g_log_mutex, &deadline);
+		}
+		g_log_drain_state = LOG_DRAIN_RUNNING;
+		pthread_mutex_unlock(&g_log_mutex);
+
+		while (log_drain_batch(env) == LOG_BATCH_SIZE)
+			;
+	}
+}
+
+/**
+ * Starts the thread which forwards the queued records to NativeLogger. Records logged
+ * before this is called are kept in the ring.
+ */
+int log_start(JNIEnv *env) {
+	jmethodID jMethod;
+
+	if (!__sync_bool_compare_and_swap(&g_log_started, 0, 1)) return 0;
+	log_ring_init();
+
+	jMethod = (*env)->GetStaticMethodID(env, g_loggerClass, "getDefaultLevel", "()I");
+	if (jMethod) log_set_level((*env)->CallStaticIntMethod(env, g_loggerClass, jMethod));
+
+	return placeInThread(log_drain, NULL);
+}
+
+void log_set_level(int level) {
+	if (level < LOG_LEVEL_TRACE) level = LOG_LEVEL_TRACE;
+	if (level > LOG_LEVEL_FATAL + 1) level = LOG_LEVEL_FATAL + 1;
+	g_log_level = level;
+}
+
+unsigned int log_dropped() {
+	return g_log_dropped;
+}
 
+JNIEXPORT void JNICALL Java_jahspotify_impl_NativeLogger_setNativeLevel(JNIEnv *env, jclass cls, jint level) {
+	log_set_level(level);
 }
 
 void log_trace(const char *component, const char *subComponent, const char *format, ...) {
+	if (!log_enabled(LOG_LEVEL_TRACE)) return;
 	va_list args;
 	va_start(args, format);
-	logToJava("trace", component, subComponent, format, args);
+	log_enqueue(LOG_LEVEL_TRACE, component, subComponent, format, args);
 	va_end(args);
 }
 
 void log_debug(const char *component, const char *subComponent, const char *format, ...) {
+	if (!log_enabled(LOG_LEVEL_DEBUG)) return;
 	va_list args;
 	va_start(args, format);
-	logToJava("debug", component, subComponent, format, args);
+	log_enqueue(LOG_LEVEL_DEBUG, component, subComponent, format, args);
 	va_end(args);
 }
 
 void log_info(const char *component, const char *subComponent, char *format, ...) {
+	if (!log_enabled(LOG_LEVEL_INFO)) return;
 	va_list args;
 	va_start(args, format);
-	logToJava("info", component, subComponent, format, args);
+	log_enqueue(LOG_LEVEL_INFO, component, subComponent, format, args);
 	va_end(args);
 }
 
 void log_warn(const char *component, const char *subComponent, char *format, ...) {
+	if (!log_enabled(LOG_LEVEL_WARN)) return;
 	va_list args;
 	va_start(args, format);
-	logToJava("warn", component, subComponent, format, args);
+	log_enqueue(LOG_LEVEL_WARN, component, subComponent, format, args);
 	va_end(args);
 }
 
 void log_error(const char *component, const char *subComponent, char *format, ...) {
+	if (!log_enabled(LOG_LEVEL_ERROR)) return;
 	va_list args;
 	va_start(args, format);
-	logToJava("error", component, subComponent, format, args);
+	log_enqueue(LOG_LEVEL_ERROR, component, subComponent, format, args);
 	va_end(args);
 }
 
 void log_fatal(const char *component, const char *subComponent, char *format, ...) {
+	if (!log_enabled(LOG_LEVEL_FATAL)) return;
 	va_list args;
 	va_start(args, format);
-	logToJava("fatal", component, subComponent, format, args);
+	log_enqueue(LOG_LEVEL_FATAL, component, subComponent, format, args);
 	va_end(args);
 }
 
@@ -0,0 +1,113 @@
+#include <string.h>
+
+#include "MediaRecord.h"
+
+/* Strings longer than this are cut, the length has to fit the unsigned short before them */
+#define MEDIA_RECORD_MAX_STRING (MEDIA_RECORD_MISSING - 1)
+
+static size_t string_length(const char *str) {
+	size_t length = strlen(str);
+	return length > MEDIA_RECORD_MAX_STRING ? MEDIA_RECORD_MAX_STRING : length;
+}
+
+static size_t record_string_size(const char *str) {
+	return 2 + (str ? string_length(str) : 0);
+}
+
+static size_t record_link_size(const char *uri) {
+	size_t size;
+	if (!uri) return 1;
+	// A URI is always longer than the id it is reduced to, so this is enough either way
+	size = 1 + record_string_size(uri);
+	return size < 1 + METADATA_GID_SIZE ? 1 + METADATA_GID_SIZE : size;
+}
+
+static uint8_t *put_short(uint8_t *out, unsigned int value) {
+	out[0] = (uint8_t) (value >> 8);
+	out[1] = (uint8_t) value;
+	return out + 2;
+}
+
+static uint8_t *put_int(uint8_t *out, int value) {
+	uint32_t bits = (uint32_t) value;
+	out[0] = (uint8_t) (bits >> 24);
+	out[1] = (uint8_t) (bits >> 16);
+	out[2] = (uint8_t) (bits >> 8);
+	out[3] = (uint8_t) bits;
+	return out + 4;
+}
+
+static uint8_t *put_string(uint8_t *out, const char *str) {
+	size_t length;
+	if (!str) return put_short(out, MEDIA_RECORD_MISSING);
+	length = string_length(str);
+	out = put_short(out, (unsigned int) length);
+	memcpy(out, str, length);
+	return out + length;
+}
+
+/**
+ * Writes a link as its kind and id when it is a track, album or artist, as the URI otherwise.
+ */
+static uint8_t *put_link(uint8_t *out, const char *uri) {
+	metadata_kind kind;
+
+	if (!uri) {
+		*out++ = MEDIA_RECORD_LINK_NONE;
+		return out;
+	}
+	if (metadata_gid(uri, &kind, out + 1) == 0) {
+		*out = (uint8_t) kind;
+		return out + 1 + METADATA_GID_SIZE;
+	}
+	*out++ = MEDIA_RECORD_LINK_URI;
+	return put_string(out, uri);
+}
+
+/**
+ * Upper bound of the number of bytes media_record_write() needs for the item.
+ */
+size_t media_record_size(const metadata *item) {
+	size_t size = MEDIA_RECORD_HEADER_SIZE;
+	int i;
+
+	size += record_link_size(item->uri) + record_string_size(item->name) + record_link_size(item->parent) + record_link_size(item->cover);
+	for (i = 0; i < item->num_artists; i++)
+		size += record_link_size(item->artists[i]);
+	return size;
+}
+
+/**
+ * Encodes the item into the buffer, which must hold media_record_size() bytes. Returns the
+ * number of bytes written.
+ */
+size_t media_record_write(const metadata *item, uint8_t *buffer) {
+	uint8_t *out = buffer;
+	int i;
+
+	*out++ = (uint8_t) item->kind;
+	*out++ = 0;
+	out = put_short(out, (unsigned int) item->num_artists);
+	for (i = 0; i < 3; i++)
+		out = put_int(out, item->values[i]);
+
+	out = put_link(out, item->uri);
+	out = put_string(out, item->name);
+	out = put_link(out, item->parent);
+	out = put_link(out, item->cover);
+	for (i = 0; i < item->num_artists; i++)
+		out = put_link(out, item->artists[i]);
+
+	return (size_t) (out - buffer);
+}
+
+/**
+ * Reads eight bytes of an id as the big-endian long Java holds it in.
+ */
+uint64_t media_record_gid_half(const uint8_t *gid) {
+	uint64_t value = 0;
+	int i;
+	for (i = 0; i < 8; i++)
+		value = (value << 8) | gid[i];
+	return value;
+}
@@ -0,0 +1,309 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "MetadataCache.h"
+#include "MetadataStore.h"
+#include "Logging.h"
+
+/* Initial number of hash buckets, must be a power of two */
+#define METADATA_CACHE_INITIAL_CAPACITY 1024
+#define METADATA_BASE62_LENGTH 22
+
+typedef struct cache_entry {
+	struct cache_entry *hash_next;
+	/// Neighbours in the LRU list, head is the most recently used
+	struct cache_entry *prev;
+	struct cache_entry *next;
+	metadata_kind kind;
+	uint8_t gid[METADATA_GID_SIZE];
+	size_t size;
+	/// Read back from the store and not yet confirmed by libspotify
+	int stale;
+	/// Strings and the artist array live in the same allocation, right after the entry
+	metadata item;
+} cache_entry;
+
+static pthread_mutex_t g_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static cache_entry **g_cache_buckets = NULL;
+static unsigned int g_cache_capacity = 0;
+static cache_entry *g_cache_head = NULL;
+static cache_entry *g_cache_tail = NULL;
+static size_t g_cache_budget = METADATA_CACHE_DEFAULT_BUDGET;
+static metadata_cache_stats g_cache_stats;
+
+static int base62_value(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'z') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'Z') return c - 'A' + 36;
+	return -1;
+}
+
+/**
+ * Extracts the kind and the 16 byte id from a track, album or artist URI. Returns non-zero
+ * for any other URI.
+ */
+int metadata_gid(const char *uri, metadata_kind *kind, uint8_t *gid) {
+	static const char prefix[] = "spotify:";
+	uint32_t limbs[4] = { 0, 0, 0, 0 };
+	const char *id;
+	int i, j;
+
+	if (!uri || strncmp(uri, prefix, sizeof(prefix) - 1) != 0) return 1;
+	uri += sizeof(prefix) - 1;
+
+	if (strncmp(uri, "track:", 6) == 0) {
+		*kind = METADATA_TRACK;
+		id = uri + 6;
+	} else if (strncmp(uri, "album:", 6) == 0) {
+		*kind = METADATA_ALBUM;
+		id = uri + 6;
+	} else if (strncmp(uri, "artist:", 7) == 0) {
+		*kind = METADATA_ARTIST;
+		id = uri + 7;
+	} else {
+		return 1;
+	}
+
+	for (i = 0; i < METADATA_BASE62_LENGTH; i++) {
+		int digit = base62_value(id[i]);
+		uint64_t carry;
+		if (digit < 0) return 1;
+
+		// limbs = limbs * 62 + digit, least significant limb last
+		carry = (uint64_t) digit;
+		for (j = 3; j >= 0; j--) {
+			uint64_t value = (uint64_t) limbs[j] * 62 + carry;
+			limbs[j] = (uint32_t) value;
+			carry = value >> 32;
+		}
+	}
+	if (id[METADATA_BASE62_LENGTH] != '\0') return 1;
+
+	for (i = 0; i < 4; i++) {
+		gid[i * 4] = (uint8_t) (limbs[i] >> 24);
+		gid[i * 4 + 1] = (uint8_t) (limbs[i] >> 16);
+		gid[i * 4 + 2] = (uint8_t) (limbs[i] >> 8);
+		gid[i * 4 + 3] = (uint8_t) limbs[i];
+	}
+	return 0;
+}
+
+static unsigned int cache_hash(metadata_kind kind, const uint8_t *gid, unsigned int capacity) {
+	// Ids are random, their last bytes are as good a hash as any
+	uint32_t value = ((uint32_t) gid[12] << 24) | ((uint32_t) gid[13] << 16) | ((uint32_t) gid[14] << 8) | gid[15];
+	return (value ^ (uint32_t) kind) & (capacity - 1);
+}
+
+static void cache_resize(unsigned int capacity) {
+	cache_entry **buckets = calloc(capacity, sizeof(cache_entry*));
+	unsigned int i;
+
+	if (!buckets) {
+		log_error("metadatacache", "cache_resize", "Could not allocate %u buckets", capacity);
+		return;
+	}
+
+	for (i = 0; i < g_cache_capacity; i++) {
+		cache_entry *entry = g_cache_buckets[i];
+		while (entry) {
+			cache_entry *next = entry->hash_next;
+			unsigned int bucket = cache_hash(entry->kind, entry->gid, capacity);
+			entry->hash_next = buckets[bucket];
+			buckets[bucket] = entry;
+			entry = next;
+		}
+	}
+
+	free(g_cache_buckets);
+	g_cache_buckets = buckets;
+	g_cache_capacity = capacity;
+}
+
+static cache_entry *cache_find(metadata_kind kind, const uint8_t *gid) {
+	cache_entry *entry;
+	if (!g_cache_buckets) return NULL;
+	for (entry = g_cache_buckets[cache_hash(kind, gid, g_cache_capacity)]; entry; entry = entry->hash_next) {
+		if (entry->kind == kind && memcmp(entry->gid, gid, METADATA_GID_SIZE) == 0) return entry;
+	}
+	return NULL;
+}
+
+static void cache_lru_unlink(cache_entry *entry) {
+	if (entry->prev) entry->prev->next = entry->next;
+	else g_cache_head = entry->next;
+	if (entry->next) entry->next->prev = entry->prev;
+	else g_cache_tail = entry->prev;
+	entry->prev = entry->next = NULL;
+}
+
+static void cache_lru_push(cache_entry *entry) {
+	entry->prev = NULL;
+	entry->next = g_cache_head;
+	if (g_cache_head) g_cache_head->prev = entry;
+	g_cache_head = entry;
+	if (!g_cache_tail) g_cache_tail = entry;
+}
+
+static void cache_remove(cache_entry *entry) {
+	cache_entry **link = &g_cache_buckets[cache_hash(entry->kind, entry->gid, g_cache_capacity)];
+	while (*link && *link != entry)
+		link = &(*link)->hash_next;
+	if (*link) *link = entry->hash_next;
+
+	cache_lru_unlink(entry);
+	g_cache_stats.entries--;
+	g_cache_stats.bytes -= entry->size;
+	free(entry);
+}
+
+static void cache_trim() {
+	while (g_cache_tail && g_cache_stats.bytes > g_cache_budget) {
+		cache_remove(g_cache_tail);
+		g_cache_stats.evictions++;
+	}
+}
+
+static size_t string_size(const char *str) {
+	return str ? strlen(str) + 1 : 0;
+}
+
+static const char *copy_string(char **dest, const char *str) {
+	const char *result = *dest;
+	size_t size = string_size(str);
+	if (!str) return NULL;
+	memcpy(*dest, str, size);
+	*dest += size;
+	return result;
+}
+
+/**
+ * Adds a copy of the item, replacing any previous entry for the same id. Called with the cache
+ * locked, returns NULL if the item could not be added.
+ */
+static cache_entry *cache_insert(const metadata *item, metadata_kind kind, const uint8_t *gid, int stale) {
+	cache_entry *entry, *existing;
+	size_t size;
+	char *strings;
+	int i;
+
+	size = sizeof(cache_entry) + item->num_artists * sizeof(char*);
+	size += string_size(item->uri) + string_size(item->name) + string_size(item->parent) + string_size(item->cover);
+	for (i = 0; i < item->num_artists; i++)
+		size += string_size(item->artists[i]);
+
+	if (size > g_cache_budget) return NULL;
+
+	entry = malloc(size);
+	if (!entry) {
+		log_error("metadatacache", "cache_insert", "Could not allocate %u bytes", (unsigned int) size);
+		return NULL;
+	}
+
+	entry->kind = kind;
+	memcpy(entry->gid, gid, METADATA_GID_SIZE);
+	entry->size = size;
+	entry->stale = stale;
+	entry->item = *item;
+	entry->item.artists = (const char**) (entry + 1);
+	strings = (char*) (entry->item.artists + item->num_artists);
+	entry->item.uri = copy_string(&strings, item->uri);
+	entry->item.name = copy_string(&strings, item->name);
+	entry->item.parent = copy_string(&strings, item->parent);
+	entry->item.cover = copy_string(&strings, item->cover);
+	for (i = 0; i < item->num_artists; i++)
+		entry->item.artists[i] = copy_string(&strings, item->artists[i]);
+
+	existing = cache_find(kind, gid);
+	if (existing) cache_remove(existing);
+
+	if (!g_cache_buckets) cache_resize(METADATA_CACHE_INITIAL_CAPACITY);
+	else if (g_cache_stats.entries >= g_cache_capacity) cache_resize(g_cache_capacity * 2);
+
+	if (!g_cache_buckets) {
+		free(entry);
+		return NULL;
+	}
+
+	unsigned int bucket = cache_hash(kind, gid, g_cache_capacity);
+	entry->hash_next = g_cache_buckets[bucket];
+	g_cache_buckets[bucket] = entry;
+	cache_lru_push(entry);
+	g_cache_stats.entries++;
+	g_cache_stats.bytes += size;
+	cache_trim();
+	return entry;
+}
+
+/**
+ * Stores a copy of the item in the cache and writes it through to the on-disk store.
+ */
+void metadata_cache_put(const metadata *item) {
+	uint8_t gid[METADATA_GID_SIZE];
+	metadata_kind kind;
+	size_t budget;
+
+	if (metadata_gid(item->uri, &kind, gid) != 0 || kind != item->kind) return;
+
+	pthread_mutex_lock(&g_cache_mutex);
+	budget = g_cache_budget;
+	if (budget > 0) cache_insert(item, kind, gid, 0);
+	pthread_mutex_unlock(&g_cache_mutex);
+
+	if (budget > 0) metadata_store_write(item, gid);
+}
+
+/**
+ * Looks up an item, falling back to the on-disk store. When found the cache stays locked so the
+ * item cannot be evicted while it is being read, metadata_cache_release() must be called once
+ * done with it. Stale is set for the first lookup of an item which came from the store and
+ * should be revalidated.
+ */
+const metadata *metadata_cache_acquire(metadata_kind kind, const uint8_t *gid, int *stale) {
+	cache_entry *entry;
+
+	*stale = 0;
+	pthread_mutex_lock(&g_cache_mutex);
+	entry = cache_find(kind, gid);
+	if (entry) {
+		g_cache_stats.hits++;
+		cache_lru_unlink(entry);
+		cache_lru_push(entry);
+	} else {
+		stored_metadata stored;
+		g_cache_stats.misses++;
+		if (g_cache_budget > 0 && metadata_store_read(kind, gid, &stored) == 0) {
+			entry = cache_insert(&stored.item, kind, gid, 1);
+			if (entry) g_cache_stats.store_hits++;
+		}
+	}
+
+	if (!entry) {
+		pthread_mutex_unlock(&g_cache_mutex);
+		return NULL;
+	}
+
+	if (entry->stale) {
+		*stale = 1;
+		entry->stale = 0;
+	}
+	return &entry->item;
+}
+
+void metadata_cache_release() {
+	pthread_mutex_unlock(&g_cache_mutex);
+}
+
+void metadata_cache_set_budget(size_t budget) {
+	pthread_mutex_lock(&g_cache_mutex);
+	g_cache_budget = budget;
+	cache_trim();
+	pthread_mutex_unlock(&g_cache_mutex);
+}
+
+void metadata_cache_read_stats(metadata_cache_stats *stats) {
+	pthread_mutex_lock(&g_cache_mutex);
+	*stats = g_cache_stats;
+	stats->budget = g_cache_budget;
+	pthread_mutex_unlock(&g_cache_mutex);
+}
@@ -0,0 +1,272 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "MetadataStore.h"
+#include "Logging.h"
+
+#define METADATA_STORE_MAGIC 0x444d534a
+/* Number of slots looked at before the home slot of a record is overwritten */
+#define METADATA_STORE_PROBES 16
+
+typedef struct store_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t record_size;
+	uint32_t capacity;
+	uint32_t count;
+	uint8_t reserved[METADATA_STORE_RECORD_SIZE - 20];
+} store_header;
+
+/**
+ * Fixed layout of a slot in the file. The text holds the uri, name, parent, cover and artist
+ * URIs, each nul terminated, empty strings standing for missing values.
+ */
+typedef struct store_record {
+	uint8_t kind;
+	uint8_t num_artists;
+	uint16_t text_size;
+	/// Checksum of the rest of the record, guards against torn writes
+	uint32_t check;
+	int32_t values[3];
+	uint8_t gid[METADATA_GID_SIZE];
+	char text[METADATA_STORE_TEXT_SIZE];
+} store_record;
+
+static pthread_mutex_t g_store_mutex = PTHREAD_MUTEX_INITIALIZER;
+static store_header *g_store = NULL;
+static size_t g_store_size = 0;
+/// Records written since the last sync and the time the first of them was written
+static unsigned int g_store_unsynced = 0;
+static uint64_t g_store_unsynced_since = 0;
+
+static store_record *store_slot(unsigned int index) {
+	return (store_record*) ((char*) g_store + sizeof(store_header)) + index;
+}
+
+static uint32_t store_checksum(const store_record *record) {
+	const uint8_t *bytes = (const uint8_t*) record;
+	uint32_t hash = 2166136261u;
+	size_t i, size = offsetof(store_record, text) + record->text_size;
+
+	for (i = 0; i < size; i++) {
+		if (i == offsetof(store_record, check)) i += sizeof(record->check);
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	return hash;
+}
+
+static unsigned int store_home(metadata_kind kind, const uint8_t *gid) {
+	uint32_t value = ((uint32_t) gid[0] << 24) | ((uint32_t) gid[1] << 16) | ((uint32_t) gid[2] << 8) | gid[3];
+	return (value ^ (uint32_t) kind) & (METADATA_STORE_CAPACITY - 1);
+}
+
+/**
+ * Maps the store kept in the given folder, creating it if it is missing or was written by
+ * another version. The store is shared by all sessions, later calls are ignored.
+ */
+int metadata_store_open(const char *folder) {
+	char path[1024];
+	struct stat st;
+	size_t size = sizeof(store_header) + (size_t) METADATA_STORE_CAPACITY * sizeof(store_record);
+	void *mapped;
+	int fd, fresh = 0;
+
+	pthread_mutex_lock(&g_store_mutex);
+	if (g_store) {
+		pthread_mutex_unlock(&g_store_mutex);
+		return 0;
+	}
+
+	snprintf(path, sizeof(path), "%s/%s", folder, METADATA_STORE_FILE);
+	fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0 || fstat(fd, &st) != 0) goto fail;
+
+	if ((size_t) st.st_size != size) {
+		// New file or another layout, start over with an empty store
+		if (ftruncate(fd, 0) != 0 || ftruncate(fd, size) != 0) goto fail;
+		fresh = 1;
+	}
+
+	mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (mapped == MAP_FAILED) goto fail;
+	close(fd);
+
+	g_store = (store_header*) mapped;
+	g_store_size = size;
+
+	if (fresh || g_store->magic != METADATA_STORE_MAGIC || g_store->version != METADATA_STORE_VERSION
+			|| g_store->record_size != sizeof(store_record) || g_store->capacity != METADATA_STORE_CAPACITY) {
+		if (!fresh) memset(g_store, 0, size);
+		g_store->count = 0;
+		g_store->magic = METADATA_STORE_MAGIC;
+		g_store->version = METADATA_STORE_VERSION;
+		g_store->record_size = sizeof(store_record);
+		g_store->capacity = METADATA_STORE_CAPACITY;
+	}
+
+	log_debug("metadatastore", "metadata_store_open", "Opened %s with %u records", path, g_store->count);
+	pthread_mutex_unlock(&g_store_mutex);
+	return 0;
+
+	fail:
+	if (fd >= 0) close(fd);
+	pthread_mutex_unlock(&g_store_mutex);
+	log_error("metadatastore", "metadata_store_open", "Could not open %s", path);
+	return 1;
+}
+
+/**
+ * Schedules the dirty pages of the store for writing, without waiting for them.
+ */
+void metadata_store_sync() {
+	pthread_mutex_lock(&g_store_mutex);
+	if (g_store) msync(g_store, g_store_size, MS_ASYNC);
+	g_store_unsynced = 0;
+	pthread_mutex_unlock(&g_store_mutex);
+}
+
+/**
+ * Syncs the store if enough records were written since the last sync or the oldest of them has
+ * waited long enough, so a crash loses at most that much. Called from the event loop.
+ */
+void metadata_store_sync_due(uint64_t now) {
+	pthread_mutex_lock(&g_store_mutex);
+	if (g_store_unsynced == 0) {
+		g_store_unsynced_since = now;
+	} else if (g_store && (g_store_unsynced >= METADATA_STORE_SYNC_WRITES || now - g_store_unsynced_since >= METADATA_STORE_SYNC_INTERVAL)) {
+		msync(g_store, g_store_size, MS_ASYNC);
+		g_store_unsynced = 0;
+		g_store_unsynced_since = now;
+	}
+	pthread_mutex_unlock(&g_store_mutex);
+}
+
+static int store_append(store_record *record, const char *str) {
+	size_t size = str ? strlen(str) + 1 : 1;
+	if (record->text_size + size > METADATA_STORE_TEXT_SIZE) return 1;
+	if (str) memcpy(record->text + record->text_size, str, size);
+	else record->text[record->text_size] = '\0';
+	record->text_size += size;
+	return 0;
+}
+
+/**
+ * Writes the item to its slot, replacing an older version of it. Items which do not fit a
+ * record are skipped, rather than stored with some of their artists missing.
+ */
+int metadata_store_write(const metadata *item, const uint8_t *gid) {
+	store_record record;
+	store_record *slot = NULL, *home;
+	unsigned int index, i;
+
+	if (item->num_artists > METADATA_STORE_MAX_ARTISTS) {
+		log_debug("metadatastore", "metadata_store_write", "Not storing %s, it has %d artists", item->uri, item->num_artists);
+		return 1;
+	}
+
+	memset(&record, 0, offsetof(store_record, text));
+	record.kind = (uint8_t) item->kind;
+	memcpy(record.values, item->values, sizeof(record.values));
+	memcpy(record.gid, gid, METADATA_GID_SIZE);
+
+	if (store_append(&record, item->uri) || store_append(&record, item->name) || store_append(&record, item->parent)
+			|| store_append(&record, item->cover)) return 1;
+	for (i = 0; i < (unsigned int) item->num_artists; i++) {
+		if (store_append(&record, item->artists[i])) return 1;
+		record.num_artists++;
+	}
+	record.check = store_checksum(&record);
+
+	pthread_mutex_lock(&g_store_mutex);
+	if (!g_store) {
+		pthread_mutex_unlock(&g_store_mutex);
+		return 1;
+	}
+
+	index = store_home(item->kind, gid);
+	home = store_slot(index);
+	for (i = 0; i < METADATA_STORE_PROBES; i++) {
+		store_record *candidate = store_slot((index + i) & (METADATA_STORE_CAPACITY - 1));
+		if (candidate->kind == item->kind && memcmp(candidate->gid, gid, METADATA_GID_SIZE) == 0) {
+			slot = candidate;
+			break;
+		}
+		if (!slot && candidate->kind == METADATA_NONE) slot = candidate;
+	}
+	if (!slot) slot = home;
+	if (slot->kind == METADATA_NONE) g_store->count++;
+
+	// The checksum goes in last so a record torn by a crash fails it
+	uint32_t check = record.check;
+	record.check = 0;
+	slot->check = 0;
+	__sync_synchronize();
+	memcpy(slot, &record, offsetof(store_record, text) + record.text_size);
+	__sync_synchronize();
+	slot->check = check;
+	g_store_unsynced++;
+	pthread_mutex_unlock(&g_store_mutex);
+	return 0;
+}
+
+static const char *store_next(stored_metadata *stored, unsigned int *offset, unsigned int size) {
+	const char *str = stored->text + *offset;
+	size_t length = strnlen(str, size - *offset);
+	if (*offset + length >= size) return NULL;
+	*offset += length + 1;
+	return length > 0 ? str : NULL;
+}
+
+/**
+ * Reads the item back, returns non-zero if it is not in the store or its record is damaged.
+ */
+int metadata_store_read(metadata_kind kind, const uint8_t *gid, stored_metadata *stored) {
+	store_record *slot = NULL;
+	unsigned int index, i, offset = 0, size;
+
+	pthread_mutex_lock(&g_store_mutex);
+	if (!g_store) {
+		pthread_mutex_unlock(&g_store_mutex);
+		return 1;
+	}
+
+	index = store_home(kind, gid);
+	for (i = 0; i < METADATA_STORE_PROBES; i++) {
+		store_record *candidate = store_slot((index + i) & (METADATA_STORE_CAPACITY - 1));
+		if (candidate->kind == kind && memcmp(candidate->gid, gid, METADATA_GID_SIZE) == 0) {
+			slot = candidate;
+			break;
+		}
+	}
+
+	if (!slot || slot->text_size > METADATA_STORE_TEXT_SIZE || slot->num_artists > METADATA_STORE_MAX_ARTISTS
+			|| slot->check != store_checksum(slot)) {
+		pthread_mutex_unlock(&g_store_mutex);
+		return 1;
+	}
+
+	size = slot->text_size;
+	memset(&stored->item, 0, sizeof(stored->item));
+	stored->item.kind = kind;
+	memcpy(stored->item.values, slot->values, sizeof(stored->item.values));
+	stored->item.num_artists = slot->num_artists;
+	memcpy(stored->text, slot->text, size);
+	pthread_mutex_unlock(&g_store_mutex);
+
+	stored->item.uri = store_next(stored, &offset, size);
+	stored->item.name = store_next(stored, &offset, size);
+	stored->item.parent = store_next(stored, &offset, size);
+	stored->item.cover = store_next(stored, &offset, size);
+	stored->item.artists = stored->artists;
+	for (i = 0; i < (unsigned int) stored->item.num_artists; i++) {
+		stored->artists[i] = store_next(stored, &offset, size);
+		if (!stored->artists[i]) return 1;
+	}
+	return stored->item.uri ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+#include <stdlib.h>
+
+#include "PendingLoads.h"
+#include "Clock.h"
+#include "Logging.h"
+
+static void *pending_key(media *item) {
+	if (item->track) return item->track;
+	if (item->album) return item->album;
+	return item->artist;
+}
+
+static unsigned int pending_hash(void *key, unsigned int capacity) {
+	uintptr_t value = (uintptr_t) key;
+	// Allocations are aligned, drop the low bits before mixing
+	value = (value >> 4) * 2654435761u;
+	return (unsigned int) (value ^ (value >> 16)) & (capacity - 1);
+}
+
+static int pending_resize(pending_table *table, unsigned int capacity) {
+	media **buckets = calloc(capacity, sizeof(media*));
+	unsigned int i;
+
+	if (!buckets) {
+		log_error("pending", "pending_resize", "Could not allocate %u buckets", capacity);
+		return 1;
+	}
+
+	for (i = 0; i < table->capacity; i++) {
+		media *item = table->buckets[i];
+		while (item) {
+			media *next = item->next;
+			unsigned int bucket = pending_hash(pending_key(item), capacity);
+			item->next = buckets[bucket];
+			buckets[bucket] = item;
+			item = next;
+		}
+	}
+
+	free(table->buckets);
+	table->buckets = buckets;
+	table->capacity = capacity;
+	return 0;
+}
+
+/**
+ * Queues the item, the table takes ownership of it. Returns non-zero if the item could not be queued.
+ */
+int pending_add(pending_table *table, media *item) {
+	void *key = pending_key(item);
+	media *existing;
+
+	if (!table->buckets && pending_resize(table, PENDING_INITIAL_CAPACITY)) return 1;
+	if ((table->size + 1) * 4 > table->capacity * 3) pending_resize(table, table->capacity * 2);
+
+	item->next = NULL;
+	item->waiting = NULL;
+	item->added = monotonic_millis();
+
+	unsigned int bucket = pending_hash(key, table->capacity);
+	for (existing = table->buckets[bucket]; existing; existing = existing->next) {
+		if (pending_key(existing) == key) {
+			item->waiting = existing->waiting;
+			existing->waiting = item;
+			table->waiting++;
+			table->dirty = 1;
+			return 0;
+		}
+	}
+
+	item->next = table->buckets[bucket];
+	table->buckets[bucket] = item;
+	table->size++;
+	table->waiting++;
+	// The item may have loaded between the caller checking it and queueing it
+	table->dirty = 1;
+	return 0;
+}
+
+/**
+ * Unlinks every item libspotify reports as loaded and returns them chained through next.
+ * Requests for the same item stay chained through waiting.
+ */
+media *pending_take_loaded(pending_table *table) {
+	media *loaded = NULL;
+	unsigned int i;
+
+	for (i = 0; i < table->capacity && table->size > 0; i++) {
+		media **link = &table->buckets[i];
+		while (*link) {
+			media *item = *link;
+			if ((item->track && sp_track_is_loaded(item->track)) || (item->artist && sp_artist_is_loaded(item->artist))
+					|| (item->album && sp_album_is_loaded(item->album))) {
+				*link = item->next;
+				item->next = loaded;
+				loaded = item;
+				table->size--;
+			} else {
+				link = &item->next;
+			}
+		}
+	}
+	return loaded;
+}
+
+void pending_completed(pending_table *table, media *item, uint64_t now) {
+	uint64_t latency = now > item->added ? now - item->added : 0;
+
+	table->waiting--;
+	table->completed++;
+	table->latency_total += latency;
+	if (latency > table->latency_max) table->latency_max = latency;
+}
+
+/**
+ * Drops every item still waiting along with the Java instances waiting for it, leaving the
+ * table empty.
+ */
+void pending_clear(JNIEnv *env, pending_table *table) {
+	unsigned int i;
+
+	for (i = 0; i < table->capacity; i++) {
+		media *item = table->buckets[i];
+		while (item) {
+			media *next = item->next;
+			while (item) {
+				media *waiting = item->waiting;
+				if (item->javainstance) (*env)->DeleteGlobalRef(env, item->javainstance);
+				free(item);
+				item = waiting;
+			}
+			item = next;
+		}
+	}
+
+	free(table->buckets);
+	table->buckets = NULL;
+	table->capacity = 0;
+	table->size = 0;
+	table->waiting = 0;
+	table->dirty = 0;
+}
@@ -0,0 +1,183 @@
+#include <stdlib.h>
+
+#include "SearchRegistry.h"
+#include "Logging.h"
+
+/*
+ * Keeps track of the searches of a session. At most max_running searches run in libspotify at
+ * the same time, the others wait in line in the order they were submitted. Searches which take
+ * longer than the timeout or are cancelled from Java are abandoned: their listeners are told
+ * right away and the slot is handed to the next search, the libspotify callback only frees them.
+ */
+
+search_request *search_request_create(struct jahspotify_session *session, int32_t token) {
+	search_request *request = calloc(1, sizeof(search_request));
+	if (!request) {
+		log_error("searchregistry", "search_request_create", "Could not allocate search request");
+		return NULL;
+	}
+	request->session = session;
+	request->token = token;
+	return request;
+}
+
+void search_request_free(search_request *request) {
+	free(request->query);
+	free(request);
+}
+
+static unsigned int search_max_running(search_registry *registry) {
+	return registry->max_running > 0 ? registry->max_running : SEARCH_DEFAULT_MAX_RUNNING;
+}
+
+static void search_unlink_running(search_registry *registry, search_request *request) {
+	search_request **link = &registry->running;
+	while (*link && *link != request)
+		link = &(*link)->next;
+	if (*link) *link = request->next;
+	request->next = NULL;
+}
+
+/**
+ * Unlinks the queued request following the given link, which is NULL for the head of the queue.
+ */
+static void search_unlink_queued(search_registry *registry, search_request *previous) {
+	search_request *request = previous ? previous->next : registry->queue_head;
+	if (previous) previous->next = request->next;
+	else registry->queue_head = request->next;
+	if (registry->queue_tail == request) registry->queue_tail = previous;
+	request->next = NULL;
+	registry->num_queued--;
+}
+
+/**
+ * Puts the request in line, the registry owns it from now on.
+ */
+void search_registry_submit(search_registry *registry, search_request *request, uint64_t now) {
+	request->state = SEARCH_QUEUED;
+	request->submitted = now;
+	request->deadline = now + (registry->timeout > 0 ? registry->timeout : SEARCH_DEFAULT_TIMEOUT);
+	request->next = NULL;
+
+	if (registry->queue_tail) registry->queue_tail->next = request;
+	else registry->queue_head = request;
+	registry->queue_tail = request;
+	registry->num_queued++;
+}
+
+/**
+ * Takes the next queued request if a slot is free, the caller creates its libspotify search.
+ */
+search_request *search_registry_next(search_registry *registry) {
+	search_request *request;
+
+	if (!registry->queue_head || registry->num_running >= search_max_running(registry)) return NULL;
+
+	request = registry->queue_head;
+	search_unlink_queued(registry, NULL);
+	request->state = SEARCH_RUNNING;
+	request->next = registry->running;
+	registry->running = request;
+	registry->num_running++;
+	return request;
+}
+
+/**
+ * Takes the request out of the registry once libspotify called back for it. The caller frees it.
+ */
+void search_registry_finish(search_registry *registry, search_request *request, int success, uint64_t now) {
+	search_unlink_running(registry, request);
+	if (request->state != SEARCH_RUNNING) return;
+
+	registry->num_running--;
+	if (success) {
+		uint64_t latency = now - request->submitted;
+		registry->completed++;
+		registry->latency_total += latency;
+		if (latency > registry->latency_max) registry->latency_max = latency;
+	} else {
+		registry->failed++;
+	}
+}
+
+static void search_abandon(search_registry *registry, search_request *request) {
+	request->state = SEARCH_ABANDONED;
+	registry->num_running--;
+}
+
+/**
+ * Cancels the search with the token. Returns the request if it was still queued, which the caller
+ * frees, NULL otherwise; a running search is abandoned.
+ */
+search_request *search_registry_cancel(search_registry *registry, int32_t token) {
+	search_request *request, *previous = NULL;
+
+	for (request = registry->queue_head; request; previous = request, request = request->next) {
+		if (request->token == token) {
+			search_unlink_queued(registry, previous);
+			request->state = SEARCH_EXPIRED;
+			registry->cancelled++;
+			return request;
+		}
+	}
+
+	for (request = registry->running; request; request = request->next) {
+		if (request->token == token && request->state == SEARCH_RUNNING) {
+			search_abandon(registry, request);
+			registry->cancelled++;
+			break;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Returns a search past its deadline, NULL if there are none. Queued searches come back
+ * SEARCH_EXPIRED and out of the registry, the caller frees them; running ones are abandoned.
+ */
+search_request *search_registry_expire(search_registry *registry, uint64_t now) {
+	search_request *request, *previous = NULL;
+
+	for (request = registry->running; request; request = request->next) {
+		if (request->state == SEARCH_RUNNING && now >= request->deadline) {
+			search_abandon(registry, request);
+			registry->timed_out++;
+			return request;
+		}
+	}
+
+	for (request = registry->queue_head; request; previous = request, request = request->next) {
+		if (now >= request->deadline) {
+			search_unlink_queued(registry, previous);
+			request->state = SEARCH_EXPIRED;
+			registry->timed_out++;
+			return request;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Returns non-zero while searches are running or queued.
+ */
+int search_registry_outstanding(search_registry *registry) {
+	return registry->num_running > 0 || registry->num_queued > 0;
+}
+
+/**
+ * Frees all requests, called once libspotify no longer calls back for running searches.
+ */
+void search_registry_clear(search_registry *registry) {
+	search_request *request, *next;
+
+	for (request = registry->running; request; request = next) {
+		next = request->next;
+		search_request_free(request);
+	}
+	for (request = registry->queue_head; request; request = next) {
+		next = request->next;
+		search_request_free(request);
+	}
+	registry->running = registry->queue_head = registry->queue_tail = NULL;
+	registry->num_running = registry->num_queued = 0;
+}
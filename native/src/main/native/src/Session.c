@@ -0,0 +1,170 @@
+#include <stdlib.h>
+
+#include "Session.h"
+#include "Logging.h"
+
+/// Field of JahSpotifyImpl holding the address of its session
+static jfieldID g_nativeSessionField = NULL;
+
+jahspotify_session *session_create() {
+	pthread_mutexattr_t attr;
+	jahspotify_session *session = calloc(1, sizeof(jahspotify_session));
+
+	if (!session) {
+		log_error("session", "session_create", "Could not allocate session");
+		return NULL;
+	}
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&session->spotify_mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+
+	pthread_mutex_init(&session->notify_mutex, NULL);
+	pthread_cond_init(&session->notify_cond, NULL);
+
+	library_index_init(&session->library);
+
+	return session;
+}
+
+jahspotify_session *session_from_java(JNIEnv *env, jobject obj) {
+	jahspotify_session *session;
+
+	if (!g_nativeSessionField) {
+		jclass aClass = (*env)->GetObjectClass(env, obj);
+		g_nativeSessionField = (*env)->GetFieldID(env, aClass, "_nativeSession", "J");
+		(*env)->DeleteLocalRef(env, aClass);
+		if (!g_nativeSessionField) {
+			log_error("session", "session_from_java", "Could not load field _nativeSession");
+			return NULL;
+		}
+	}
+
+	session = (jahspotify_session*) (intptr_t) (*env)->GetLongField(env, obj, g_nativeSessionField);
+	if (!session) {
+		log_error("session", "session_from_java", "No native session attached to this instance");
+	}
+	return session;
+}
+
+/**
+ * Detaches the session from its JahSpotifyImpl instance and frees it. Called once the event loop
+ * has exited and the libspotify session was released, so no callback can reach it anymore.
+ */
+void session_destroy(JNIEnv *env, jobject obj, jahspotify_session *session) {
+	jobject *refs[] = { &session->connectionListener, &session->playbackListener, &session->searchCompleteListener,
+			&session->mediaLoadedListener, &session->playlistContainer };
+	unsigned int i;
+
+	if (g_nativeSessionField) (*env)->SetLongField(env, obj, g_nativeSessionField, 0);
+
+	for (i = 0; i < sizeof(refs) / sizeof(refs[0]); i++) {
+		if (*refs[i]) (*env)->DeleteGlobalRef(env, *refs[i]);
+		*refs[i] = NULL;
+	}
+
+	pthread_mutex_lock(&session->spotify_mutex);
+	pending_clear(env, &session->loading);
+	session_drop_signals(env, session_take_signals(session));
+	pthread_mutex_unlock(&session->spotify_mutex);
+
+	pthread_mutex_destroy(&session->library.mutex);
+	pthread_mutex_destroy(&session->spotify_mutex);
+	pthread_mutex_destroy(&session->notify_mutex);
+	pthread_cond_destroy(&session->notify_cond);
+	free(session);
+}
+
+session_request *session_request_create(jahspotify_session *session, jobject instance, int32_t token) {
+	session_request *request = calloc(1, sizeof(session_request));
+	if (!request) {
+		log_error("session", "session_request_create", "Could not allocate request");
+		return NULL;
+	}
+	request->session = session;
+	request->instance = instance;
+	request->token = token;
+	return request;
+}
+
+/**
+ * Queues a listener call for the instance, a global reference which is handed over. Called with
+ * the spotify mutex held, returns the queued call for the caller to fill in or NULL if it could
+ * not be queued.
+ */
+session_signal *session_defer_signal(jahspotify_session *session, session_signal_type type, jobject instance) {
+	session_signal *signal = calloc(1, sizeof(session_signal));
+	if (!signal) {
+		log_error("session", "session_defer_signal", "Could not allocate signal");
+		return NULL;
+	}
+	signal->type = type;
+	signal->instance = instance;
+
+	if (session->signals_tail) session->signals_tail->next = signal;
+	else session->signals_head = signal;
+	session->signals_tail = signal;
+	return signal;
+}
+
+/**
+ * Takes all queued listener calls, called with the spotify mutex held. The caller makes them once
+ * the mutex is released.
+ */
+session_signal *session_take_signals(jahspotify_session *session) {
+	session_signal *signals = session->signals_head;
+	session->signals_head = session->signals_tail = NULL;
+	return signals;
+}
+
+/**
+ * Frees taken listener calls without making them.
+ */
+void session_drop_signals(JNIEnv *env, session_signal *signal) {
+	session_signal *next;
+
+	for (; signal; signal = next) {
+		next = signal->next;
+		if (signal->instance) (*env)->DeleteGlobalRef(env, signal->instance);
+		if (signal->bytes) (*env)->DeleteGlobalRef(env, signal->bytes);
+		free(signal->message);
+		free(signal);
+	}
+}
+
+/**
+ * Keeps a reference to the playlist, releasing the one retained longest ago when all slots are
+ * taken.
+ */
+void session_retain_playlist(jahspotify_session *session, sp_playlist *playlist) {
+	int i;
+
+	pthread_mutex_lock(&session->spotify_mutex);
+	for (i = 0; i < SESSION_RETAINED_PLAYLISTS; i++) {
+		if (session->retained_playlists[i] == playlist) goto exit;
+	}
+
+	if (session->retained_playlists[session->retained_next]) sp_playlist_release(session->retained_playlists[session->retained_next]);
+	sp_playlist_add_ref(playlist);
+	session->retained_playlists[session->retained_next] = playlist;
+	session->retained_next = (session->retained_next + 1) % SESSION_RETAINED_PLAYLISTS;
+
+	exit:
+	pthread_mutex_unlock(&session->spotify_mutex);
+}
+
+/**
+ * Drops all retained playlists, called before the libspotify session is released.
+ */
+void session_release_playlists(jahspotify_session *session) {
+	int i;
+
+	pthread_mutex_lock(&session->spotify_mutex);
+	for (i = 0; i < SESSION_RETAINED_PLAYLISTS; i++) {
+		if (session->retained_playlists[i]) sp_playlist_release(session->retained_playlists[i]);
+		session->retained_playlists[i] = NULL;
+	}
+	session->retained_next = 0;
+	pthread_mutex_unlock(&session->spotify_mutex);
+}